@@ -0,0 +1,94 @@
+/***********************************************************************
+AttractorCloud - Cloud of points lying on a strange attractor, used to
+seed particles that are already converged instead of spending their
+first seconds approaching the attractor. The cloud is computed by
+integrating random points from the system's seed cube until they have
+settled onto the attractor, discarding any that escaped, and is cached
+in a particle snapshot file, so that later runs with the same system and
+parameters load it instead of computing it again.
+***********************************************************************/
+
+#include "AttractorCloud.h"
+
+#include <vector>
+#include <stdexcept>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+#include "AttractorSystems.h"
+#include "ParticleSnapshot.h"
+#include "CounterRandom.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+struct Seed // Structure describing a random point before it is added to the warmup store
+	{
+	/* Elements: */
+	public:
+	float position[3]; // Initial point position
+	unsigned char color[4]; // Point color; always white
+	};
+
+}
+
+/*******************************
+Methods of class AttractorCloud:
+*******************************/
+
+AttractorCloud::AttractorCloud(const ParticleKernels::StepParameters& stepParameters,size_t numPoints,float warmupTime,const char* cacheFileName)
+	:points(numPoints),
+	 loaded(false)
+	{
+	if(cacheFileName!=0)
+		{
+		/* Try loading a cloud computed earlier for the same system and parameters: */
+		try
+			{
+			ParticleSnapshot::load(cacheFileName,points,stepParameters,0.0,true);
+			loaded=points.getNumParticles()>0;
+			}
+		catch(const std::runtime_error&)
+			{
+			/* Compute the cloud instead: */
+			}
+		if(loaded)
+			return;
+		}
+
+	/* Scatter random points through the system's seed cube, from fixed random streams so that every computation yields the same cloud: */
+	const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+	ParticleStore warmup(numPoints);
+	static const float center[3]={0.0f,0.0f,0.0f};
+	static const ParticleStore::Color white[4]={255,255,255,255};
+	std::vector<Seed> seeds(numPoints);
+	CounterRandom().generateSeeds(0,numPoints,0,center,si.seedRadius,255,seeds.data());
+	warmup.addParticles(seeds.data(),numPoints,0.0f,Math::Constants<float>::max);
+
+	/* Let the points settle onto the attractor: */
+	unsigned int numWarmupSteps=(unsigned int)(Math::ceil(warmupTime/stepParameters.timeStep));
+	for(unsigned int step=0;step<numWarmupSteps;++step)
+		ParticleKernels::stepParticles(stepParameters,warmup.getPositions(0),warmup.getPositions(1),warmup.getPositions(2),warmup.getPaddedNumParticles());
+
+	/* Keep only the points that stayed near the attractor's extent: */
+	float maxDistance=2.0f*si.densityRadius;
+	for(size_t i=0;i<warmup.getNumParticles();++i)
+		{
+		ParticleStore::Scalar position[3];
+		bool keep=true;
+		for(int j=0;j<3;++j)
+			{
+			position[j]=warmup.getPositions(j)[i];
+			keep=keep&&Math::abs(position[j]-si.densityCenter[j])<=maxDistance; // Also false for NaNs
+			}
+		if(keep)
+			points.addParticle(position,white,0.0f,Math::Constants<float>::max);
+		}
+
+	/* Cache the cloud for later runs; failing to do so only costs time: */
+	if(cacheFileName!=0&&points.getNumParticles()>0)
+		ParticleSnapshot::save(cacheFileName,points,stepParameters,0.0);
+	}
@@ -0,0 +1,46 @@
+/***********************************************************************
+AttractorCloud - Cloud of points lying on a strange attractor, used to
+seed particles that are already converged instead of spending their
+first seconds approaching the attractor. The cloud is computed by
+integrating random points from the system's seed cube until they have
+settled onto the attractor, discarding any that escaped, and is cached
+in a particle snapshot file, so that later runs with the same system and
+parameters load it instead of computing it again.
+***********************************************************************/
+
+#ifndef ATTRACTORCLOUD_INCLUDED
+#define ATTRACTORCLOUD_INCLUDED
+
+#include <stddef.h>
+
+#include "ParticleStore.h"
+#include "ParticleKernels.h"
+
+class AttractorCloud
+	{
+	/* Elements: */
+	private:
+	ParticleStore points; // Points on the attractor, stored as particles so that they can be cached as a snapshot
+	bool loaded; // Flag whether the cloud was loaded from its cache file
+
+	/* Constructors and destructors: */
+	public:
+	AttractorCloud(const ParticleKernels::StepParameters& stepParameters,size_t numPoints,float warmupTime,const char* cacheFileName); // Loads the cloud from the given cache file if it holds a cloud of the given system and parameters; otherwise integrates the given number of random points over the given simulation time and writes the cache file, unless its name is null
+
+	/* Methods: */
+	bool wasLoaded(void) const // Returns true if the cloud was loaded from its cache file
+		{
+		return loaded;
+		}
+	size_t getNumPoints(void) const // Returns the number of points in the cloud
+		{
+		return points.getNumParticles();
+		}
+	void getPoint(size_t index,ParticleStore::Scalar position[3]) const // Returns the position of the given point
+		{
+		for(int i=0;i<3;++i)
+			position[i]=points.getPositions(i)[index];
+		}
+	};
+
+#endif
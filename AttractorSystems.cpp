@@ -0,0 +1,44 @@
+/***********************************************************************
+AttractorSystems - Functor classes evaluating the right-hand sides of
+three-dimensional ODE systems with strange attractors. The functors are
+templates over the value type, so that the same code evaluates scalars
+or full SIMD packs and is inlined into the integrators calling it.
+***********************************************************************/
+
+#include "AttractorSystems.h"
+
+#include <strings.h>
+
+namespace AttractorSystems {
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const SystemInfo systemInfos[NUM_SYSTEMS]=
+	{
+	{"Lorenz",3,{"sigma","rho","beta"},{10.0f,28.0f,2.667f},0.003f,20.0f,150.0f,{0.0f,0.0f,25.0f},30.0f},
+	{"Rossler",3,{"a","b","c"},{0.2f,0.2f,5.7f},0.02f,10.0f,100.0f,{0.0f,0.0f,11.0f},13.0f},
+	{"Aizawa",6,{"a","b","c","d","e","f"},{0.95f,0.7f,0.6f,3.5f,0.25f,0.1f},0.01f,1.5f,10.0f,{0.0f,0.0f,0.7f},1.6f},
+	{"Thomas",1,{"b"},{0.208186f},0.05f,3.0f,25.0f,{0.0f,0.0f,0.0f},5.0f},
+	{"Halvorsen",1,{"a"},{1.89f},0.005f,10.0f,75.0f,{-1.5f,-1.5f,-1.5f},10.0f}
+	};
+
+}
+
+const SystemInfo& getSystemInfo(SystemType system)
+	{
+	return systemInfos[system];
+	}
+
+SystemType findSystem(const char* name)
+	{
+	for(int i=0;i<NUM_SYSTEMS;++i)
+		if(strcasecmp(name,systemInfos[i].name)==0)
+			return SystemType(i);
+	return NUM_SYSTEMS;
+	}
+
+}
@@ -0,0 +1,163 @@
+/***********************************************************************
+AttractorSystems - Functor classes evaluating the right-hand sides of
+three-dimensional ODE systems with strange attractors. The functors are
+templates over the value type, so that the same code evaluates scalars
+or full SIMD packs and is inlined into the integrators calling it.
+***********************************************************************/
+
+#ifndef ATTRACTORSYSTEMS_INCLUDED
+#define ATTRACTORSYSTEMS_INCLUDED
+
+namespace AttractorSystems {
+
+enum SystemType // Enumerated type for supported ODE systems
+	{
+	LORENZ=0,ROSSLER,AIZAWA,THOMAS,HALVORSEN,
+	NUM_SYSTEMS
+	};
+
+static const int maxNumParameters=6; // Maximum number of parameters of any system
+
+struct SystemInfo // Structure describing an ODE system
+	{
+	/* Elements: */
+	public:
+	const char* name; // Name of the system
+	int numParameters; // Number of system parameters
+	const char* parameterNames[maxNumParameters]; // Names of the system parameters
+	float defaultParameters[maxNumParameters]; // Default parameter values producing a strange attractor
+	float defaultTimeStep; // Default integration time step
+	float seedRadius; // Half-size of the cube in which initial particles are seeded
+	float displayRadius; // Radius of the sphere to which the navigation transformation is reset
+	float densityCenter[3]; // Center of the cube enclosing the attractor for default parameters
+	float densityRadius; // Half-size of the cube enclosing the attractor for default parameters
+	};
+
+const SystemInfo& getSystemInfo(SystemType system); // Returns the description of the given system
+SystemType findSystem(const char* name); // Returns the system of the given name (case-insensitive), or NUM_SYSTEMS if there is none
+
+/**********************************************************************
+ODE functors. Each is created from an array of parameters in the order
+given by the system's SystemInfo, and evaluates the derivative d of a
+position p.
+**********************************************************************/
+
+class Lorenz
+	{
+	/* Elements: */
+	public:
+	float sigma,rho,beta;
+
+	/* Constructors and destructors: */
+	Lorenz(const float parameters[])
+		:sigma(parameters[0]),rho(parameters[1]),beta(parameters[2])
+		{
+		}
+
+	/* Methods: */
+	template <class ValueParam>
+	void operator()(const ValueParam p[3],ValueParam d[3]) const
+		{
+		d[0]=ValueParam(sigma)*(p[1]-p[0]);
+		d[1]=p[0]*(ValueParam(rho)-p[2])-p[1];
+		d[2]=p[0]*p[1]-ValueParam(beta)*p[2];
+		}
+	};
+
+class Rossler
+	{
+	/* Elements: */
+	public:
+	float a,b,c;
+
+	/* Constructors and destructors: */
+	Rossler(const float parameters[])
+		:a(parameters[0]),b(parameters[1]),c(parameters[2])
+		{
+		}
+
+	/* Methods: */
+	template <class ValueParam>
+	void operator()(const ValueParam p[3],ValueParam d[3]) const
+		{
+		d[0]=-p[1]-p[2];
+		d[1]=fma(ValueParam(a),p[1],p[0]);
+		d[2]=fma(p[2],p[0]-ValueParam(c),ValueParam(b));
+		}
+	};
+
+class Aizawa
+	{
+	/* Elements: */
+	public:
+	float a,b,c,d,e,f;
+
+	/* Constructors and destructors: */
+	Aizawa(const float parameters[])
+		:a(parameters[0]),b(parameters[1]),c(parameters[2]),d(parameters[3]),e(parameters[4]),f(parameters[5])
+		{
+		}
+
+	/* Methods: */
+	template <class ValueParam>
+	void operator()(const ValueParam p[3],ValueParam dp[3]) const
+		{
+		ValueParam zb=p[2]-ValueParam(b);
+		dp[0]=zb*p[0]-ValueParam(d)*p[1];
+		dp[1]=fma(ValueParam(d),p[0],zb*p[1]);
+		ValueParam z2=p[2]*p[2];
+		ValueParam r2=p[0]*p[0]+p[1]*p[1];
+		dp[2]=ValueParam(c)+ValueParam(a)*p[2]-z2*p[2]*ValueParam(1.0/3.0)-r2*fma(ValueParam(e),p[2],ValueParam(1.0f))+ValueParam(f)*p[2]*p[0]*p[0]*p[0];
+		}
+	};
+
+class Thomas
+	{
+	/* Elements: */
+	public:
+	float b;
+
+	/* Constructors and destructors: */
+	Thomas(const float parameters[])
+		:b(parameters[0])
+		{
+		}
+
+	/* Methods: */
+	template <class ValueParam>
+	void operator()(const ValueParam p[3],ValueParam d[3]) const
+		{
+		ValueParam bv(b);
+		d[0]=sin(p[1])-bv*p[0];
+		d[1]=sin(p[2])-bv*p[1];
+		d[2]=sin(p[0])-bv*p[2];
+		}
+	};
+
+class Halvorsen
+	{
+	/* Elements: */
+	public:
+	float a;
+
+	/* Constructors and destructors: */
+	Halvorsen(const float parameters[])
+		:a(parameters[0])
+		{
+		}
+
+	/* Methods: */
+	template <class ValueParam>
+	void operator()(const ValueParam p[3],ValueParam d[3]) const
+		{
+		ValueParam av(a);
+		ValueParam four(4.0f);
+		d[0]=-av*p[0]-four*(p[1]+p[2])-p[1]*p[1];
+		d[1]=-av*p[1]-four*(p[2]+p[0])-p[2]*p[2];
+		d[2]=-av*p[2]-four*(p[0]+p[1])-p[0]*p[0];
+		}
+	};
+
+}
+
+#endif
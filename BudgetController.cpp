@@ -0,0 +1,113 @@
+/***********************************************************************
+BudgetController - Feedback controller adapting the particle load to the
+hardware the application runs on. It is fed the fraction of time the
+simulation thread spends busy and the GPU time spent drawing particles
+per frame, each compared against a budget, and adjusts two independent
+scales: the render scale sets the fraction of particles drawn, and the
+simulation scale sets the number of live particles admitted and the
+lifespan of new ones. A scale drops in proportion to the overload as
+soon as its load exceeds the budget, but only rises in small steps
+after the load has stayed well below the budget for several updates in
+a row, so the settings do not oscillate around the budget. Once drawing
+is decimated as far as allowed, render overload also sheds particles.
+***********************************************************************/
+
+#include "BudgetController.h"
+
+/*****************************************
+Static elements of class BudgetController:
+*****************************************/
+
+const float BudgetController::restoreThreshold=0.7f;
+const float BudgetController::restoreFactor=1.1f;
+
+/***************************************
+Methods of class BudgetController::Loop:
+***************************************/
+
+bool BudgetController::Loop::update(double load,unsigned int numRestoreUpdates)
+	{
+	float newScale=scale;
+	if(load>1.0)
+		{
+		/* Shed the overload at once, but by at most half per update to ride out measurement spikes: */
+		float factor=float(0.95/load);
+		newScale*=factor>0.5f?factor:0.5f;
+		if(newScale<minScale)
+			newScale=minScale;
+		numCalmUpdates=0;
+		}
+	else if(load<double(restoreThreshold))
+		{
+		/* Raise the scale in a small step once the load has stayed low for long enough: */
+		if(++numCalmUpdates>=numRestoreUpdates)
+			{
+			newScale*=restoreFactor;
+			if(newScale>1.0f)
+				newScale=1.0f;
+			numCalmUpdates=0;
+			}
+		}
+	else
+		{
+		/* Hold the scale while the load is inside the dead band between the thresholds: */
+		numCalmUpdates=0;
+		}
+
+	bool changed=newScale!=scale;
+	scale=newScale;
+	return changed;
+	}
+
+/*********************************
+Methods of class BudgetController:
+*********************************/
+
+BudgetController::BudgetController(size_t sMaxNumParticles,float sMaxLifespan,double sSimulationBudget,double sDrawBudget,unsigned int sNumRestoreUpdates)
+	:maxNumParticles(sMaxNumParticles),maxLifespan(sMaxLifespan),
+	 simulationBudget(sSimulationBudget),drawBudget(sDrawBudget),
+	 numRestoreUpdates(sNumRestoreUpdates>0?sNumRestoreUpdates:1)
+	{
+	simulationLoop.scale=1.0f;
+	simulationLoop.minScale=1.0f/64.0f;
+	simulationLoop.numCalmUpdates=0;
+	renderLoop.scale=1.0f;
+	renderLoop.minScale=0.1f;
+	renderLoop.numCalmUpdates=0;
+	}
+
+bool BudgetController::update(double simulationBusy,double drawTime)
+	{
+	double simulationLoad=simulationBudget>0.0?simulationBusy/simulationBudget:0.0;
+	double renderLoad=drawBudget>0.0?drawTime/drawBudget:0.0;
+
+	/* Decimate drawing first, as it takes effect in the next frame: */
+	bool changed=renderLoop.update(renderLoad,numRestoreUpdates);
+
+	/* Shed particles if the simulation is overloaded, or if drawing cannot be decimated any further: */
+	if(renderLoad>1.0&&renderLoop.scale<=renderLoop.minScale&&renderLoad>simulationLoad)
+		simulationLoad=renderLoad;
+	else if(renderLoop.scale<1.0f&&simulationLoad<double(restoreThreshold))
+		{
+		/* Do not admit more particles while drawing is still decimated: */
+		simulationLoad=double(restoreThreshold);
+		}
+	if(simulationLoop.update(simulationLoad,numRestoreUpdates))
+		changed=true;
+
+	return changed;
+	}
+
+BudgetController::Budget BudgetController::getBudget(void) const
+	{
+	Budget result;
+
+	/* Fewer particles are admitted in proportion to the simulation scale, and new ones live up to half as long: */
+	result.maxNumParticles=size_t(double(maxNumParticles)*double(simulationLoop.scale));
+	if(result.maxNumParticles<1)
+		result.maxNumParticles=1;
+	result.lifespan=maxLifespan*(0.5f+0.5f*simulationLoop.scale);
+	result.drawFraction=renderLoop.scale;
+
+	return result;
+	}
@@ -0,0 +1,74 @@
+/***********************************************************************
+BudgetController - Feedback controller adapting the particle load to the
+hardware the application runs on. It is fed the fraction of time the
+simulation thread spends busy and the GPU time spent drawing particles
+per frame, each compared against a budget, and adjusts two independent
+scales: the render scale sets the fraction of particles drawn, and the
+simulation scale sets the number of live particles admitted and the
+lifespan of new ones. A scale drops in proportion to the overload as
+soon as its load exceeds the budget, but only rises in small steps
+after the load has stayed well below the budget for several updates in
+a row, so the settings do not oscillate around the budget. Once drawing
+is decimated as far as allowed, render overload also sheds particles.
+***********************************************************************/
+
+#ifndef BUDGETCONTROLLER_INCLUDED
+#define BUDGETCONTROLLER_INCLUDED
+
+#include <stddef.h>
+
+class BudgetController
+	{
+	/* Embedded classes: */
+	public:
+	struct Budget // Structure for the settings derived from the current scales
+		{
+		/* Elements: */
+		public:
+		size_t maxNumParticles; // Number of live particles beyond which new seeds are dropped
+		float lifespan; // Lifespan given to new particles
+		float drawFraction; // Fraction of particles drawn
+		};
+
+	private:
+	struct Loop // Structure for the state of one feedback loop
+		{
+		/* Elements: */
+		public:
+		float scale; // Current scale, between the loop's minimum and one
+		float minScale; // Smallest scale
+		unsigned int numCalmUpdates; // Number of consecutive updates during which the load stayed below the restore threshold
+
+		/* Methods: */
+		bool update(double load,unsigned int numRestoreUpdates); // Adjusts the scale to the given load relative to the budget; returns true if the scale changed
+		};
+
+	/* Elements: */
+	static const float restoreThreshold; // Relative load below which a loop counts an update as calm
+	static const float restoreFactor; // Factor by which a loop raises its scale after enough calm updates
+	size_t maxNumParticles; // Number of live particles at full simulation scale
+	float maxLifespan; // Lifespan of new particles at full simulation scale
+	double simulationBudget; // Largest acceptable fraction of time the simulation thread spends busy
+	double drawBudget; // Largest acceptable GPU time per frame spent drawing particles, in seconds
+	unsigned int numRestoreUpdates; // Number of consecutive calm updates after which a loop raises its scale
+	Loop simulationLoop; // Loop scaling the number and lifespan of particles
+	Loop renderLoop; // Loop scaling the fraction of particles drawn
+
+	/* Constructors and destructors: */
+	public:
+	BudgetController(size_t sMaxNumParticles,float sMaxLifespan,double sSimulationBudget,double sDrawBudget,unsigned int sNumRestoreUpdates =3); // Creates a controller at full scale for the given particle capacity, lifespan, and budgets
+
+	/* Methods: */
+	bool update(double simulationBusy,double drawTime); // Adapts the scales to the given busy fraction of the simulation thread and GPU draw time per frame; returns true if the budget changed
+	Budget getBudget(void) const; // Returns the settings derived from the current scales
+	float getSimulationScale(void) const // Returns the current simulation scale
+		{
+		return simulationLoop.scale;
+		}
+	float getRenderScale(void) const // Returns the current render scale
+		{
+		return renderLoop.scale;
+		}
+	};
+
+#endif
@@ -0,0 +1,261 @@
+/***********************************************************************
+ClusterParticleSync - Distributes the particle state of a simulation
+running on a cluster's head node to all render nodes over a multicast
+pipe, so that render nodes show exactly the head node's particles
+instead of each simulating its own diverging copy. Every broadcast state
+only carries the full attributes of particles that moved into a slot
+since the previous state; all other particles only send their positions
+as 16-bit fractions of the state's bounding box. Render nodes keep a
+mirror of the particle arrays, and derive previous positions for
+interpolation from the positions of the previous state unless the head
+node took more than one step in between. In density mode, the
+tone-mapped density histogram is broadcast instead.
+***********************************************************************/
+
+#include "ClusterParticleSync.h"
+
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <Cluster/MulticastPipe.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline void extendFiniteBounds(const float* values,size_t numValues,bool& found,float& min,float& max) // Extends the given range by all finite values; sets the flag once the range holds any value
+	{
+	for(size_t i=0;i<numValues;++i)
+		if(std::isfinite(values[i]))
+			{
+			if(!found||min>values[i])
+				min=values[i];
+			if(!found||max<values[i])
+				max=values[i];
+			found=true;
+			}
+	}
+
+}
+
+/************************************
+Methods of class ClusterParticleSync:
+************************************/
+
+void ClusterParticleSync::sendQuantized(const float* values,size_t numValues,float min,float max)
+	{
+	float extent=max-min;
+	float scale=extent>0.0f?65535.0f/extent:0.0f;
+	quantized.resize(numValues);
+	for(size_t i=0;i<numValues;++i)
+		{
+		/* Clamp values outside the range, such as escaped particles, to its ends, and map NaN to 0: */
+		float q=(values[i]-min)*scale;
+		quantized[i]=!(q>0.0f)?uint16_t(0):q>=65535.0f?uint16_t(65535):uint16_t(q+0.5f);
+		}
+	pipe->write(quantized.data(),numValues);
+	}
+
+void ClusterParticleSync::receiveQuantized(float* values,size_t numValues,float min,float max)
+	{
+	float scale=(max-min)/65535.0f;
+	quantized.resize(numValues);
+	pipe->read(quantized.data(),numValues);
+	for(size_t i=0;i<numValues;++i)
+		values[i]=min+float(quantized[i])*scale;
+	}
+
+void ClusterParticleSync::receiveParticles(void)
+	{
+	size_t newNumParticles=pipe->read<uint32_t>();
+	size_t numChanged=pipe->read<uint32_t>();
+	bool singleStep=pipe->read<uint32_t>()!=0;
+	float boundsMin[3],boundsMax[3];
+	pipe->read(boundsMin,3);
+	pipe->read(boundsMax,3);
+
+	/* Resize the mirror; slots beyond the previous state are always among the changed slots: */
+	for(int j=0;j<3;++j)
+		{
+		positions[j].resize(newNumParticles);
+		previousPositions[j].resize(newNumParticles);
+		}
+	for(int j=0;j<4;++j)
+		colors[j].resize(newNumParticles);
+	birthTimes.resize(newNumParticles);
+	lifespans.resize(newNumParticles);
+
+	/* After a single step, particles that stayed in their slots started it from their previously received positions: */
+	if(singleStep)
+		{
+		size_t numKept=std::min(numParticles,newNumParticles);
+		for(int j=0;j<3;++j)
+			std::copy(positions[j].begin(),positions[j].begin()+numKept,previousPositions[j].begin());
+		}
+
+	if(numChanged>0)
+		{
+		/* Receive the attributes of changed particles: */
+		changedSlots.resize(numChanged);
+		pipe->read(changedSlots.data(),numChanged);
+		changedColors.resize(numChanged*4);
+		pipe->read(changedColors.data(),numChanged*4);
+		size_t numAttributes=singleStep?5:2;
+		changedAttributes.resize(numChanged*numAttributes);
+		pipe->read(changedAttributes.data(),numChanged*numAttributes);
+
+		/* Write them into their slots: */
+		for(size_t i=0;i<numChanged;++i)
+			{
+			size_t slot=changedSlots[i];
+			if(slot>=newNumParticles)
+				continue;
+			for(int j=0;j<4;++j)
+				colors[j][slot]=changedColors[j*numChanged+i];
+			birthTimes[slot]=changedAttributes[i];
+			lifespans[slot]=changedAttributes[numChanged+i];
+			if(singleStep)
+				{
+				for(int j=0;j<3;++j)
+					previousPositions[j][slot]=changedAttributes[(2+j)*numChanged+i];
+				}
+			}
+		}
+
+	/* Receive the positions of all particles, and their previous positions if the head node took several steps: */
+	if(newNumParticles>0)
+		{
+		for(int j=0;j<3;++j)
+			receiveQuantized(positions[j].data(),newNumParticles,boundsMin[j],boundsMax[j]);
+		if(!singleStep)
+			{
+			for(int j=0;j<3;++j)
+				receiveQuantized(previousPositions[j].data(),newNumParticles,boundsMin[j],boundsMax[j]);
+			}
+		}
+	numParticles=newNumParticles;
+	}
+
+void ClusterParticleSync::receiveDensity(void)
+	{
+	numParticles=pipe->read<uint32_t>();
+	size_t numVoxels=pipe->read<uint32_t>();
+	densityVoxels.resize(numVoxels);
+	if(numVoxels>0)
+		pipe->read(densityVoxels.data(),numVoxels);
+	}
+
+ClusterParticleSync::ClusterParticleSync(Cluster::MulticastPipe* sPipe)
+	:pipe(sPipe),
+	 numParticles(0)
+	{
+	}
+
+ClusterParticleSync::~ClusterParticleSync(void)
+	{
+	delete pipe;
+	}
+
+void ClusterParticleSync::sendParticles(const ParticleStore& particles,bool singleStep)
+	{
+	/* Find the slots whose particle changed since the previous state, by comparing persistent ids: */
+	size_t n=particles.getNumParticles();
+	const ParticleStore::Id* ids=particles.getIds();
+	changedSlots.clear();
+	for(size_t i=0;i<n;++i)
+		if(i>=sentIds.size()||sentIds[i]!=ids[i])
+			changedSlots.push_back(uint32_t(i));
+	sentIds.assign(ids,ids+n);
+
+	/* Stage the attributes of changed particles as one array per attribute; previous positions are only needed after a single step: */
+	size_t numChanged=changedSlots.size();
+	size_t numAttributes=singleStep?5:2;
+	changedColors.resize(numChanged*4);
+	changedAttributes.resize(numChanged*numAttributes);
+	const float* birthPtr=particles.getBirthTimes();
+	const float* expiryPtr=particles.getExpiryTimes();
+	for(size_t i=0;i<numChanged;++i)
+		{
+		size_t slot=changedSlots[i];
+		for(int j=0;j<4;++j)
+			changedColors[j*numChanged+i]=particles.getColors(j)[slot];
+		changedAttributes[i]=birthPtr[slot];
+		changedAttributes[numChanged+i]=expiryPtr[slot]-birthPtr[slot];
+		if(singleStep)
+			{
+			for(int j=0;j<3;++j)
+				changedAttributes[(2+j)*numChanged+i]=particles.getPreviousPositions(j)[slot];
+			}
+		}
+
+	/* Find the bounding box of all finite coordinates sent quantized, so that escaped particles do not collapse all others onto its corner: */
+	float boundsMin[3],boundsMax[3];
+	for(int j=0;j<3;++j)
+		{
+		bool found=false;
+		boundsMin[j]=boundsMax[j]=0.0f;
+		extendFiniteBounds(particles.getPositions(j),n,found,boundsMin[j],boundsMax[j]);
+		if(!singleStep)
+			extendFiniteBounds(particles.getPreviousPositions(j),n,found,boundsMin[j],boundsMax[j]);
+		}
+
+	/* Send the state: */
+	pipe->write<uint32_t>(PARTICLES);
+	pipe->write<uint32_t>(uint32_t(n));
+	pipe->write<uint32_t>(uint32_t(numChanged));
+	pipe->write<uint32_t>(singleStep?1U:0U);
+	pipe->write(boundsMin,3);
+	pipe->write(boundsMax,3);
+	if(numChanged>0)
+		{
+		pipe->write(changedSlots.data(),numChanged);
+		pipe->write(changedColors.data(),numChanged*4);
+		pipe->write(changedAttributes.data(),numChanged*numAttributes);
+		}
+	if(n>0)
+		{
+		for(int j=0;j<3;++j)
+			sendQuantized(particles.getPositions(j),n,boundsMin[j],boundsMax[j]);
+		if(!singleStep)
+			{
+			for(int j=0;j<3;++j)
+				sendQuantized(particles.getPreviousPositions(j),n,boundsMin[j],boundsMax[j]);
+			}
+		}
+	pipe->flush();
+	}
+
+void ClusterParticleSync::sendDensity(size_t numStateParticles,const unsigned char* voxels,size_t numVoxels)
+	{
+	pipe->write<uint32_t>(DENSITY);
+	pipe->write<uint32_t>(uint32_t(numStateParticles));
+	pipe->write<uint32_t>(uint32_t(numVoxels));
+	if(numVoxels>0)
+		pipe->write(voxels,numVoxels);
+	pipe->flush();
+	}
+
+void ClusterParticleSync::sendShutdown(void)
+	{
+	pipe->write<uint32_t>(SHUTDOWN);
+	pipe->flush();
+	}
+
+ClusterParticleSync::MessageType ClusterParticleSync::receive(void)
+	{
+	MessageType message=MessageType(pipe->read<uint32_t>());
+	if(message==PARTICLES)
+		receiveParticles();
+	else if(message==DENSITY)
+		receiveDensity();
+	return message;
+	}
+
+void ClusterParticleSync::exportDensity(unsigned char* voxels,size_t numVoxels) const
+	{
+	size_t numCopied=std::min(numVoxels,densityVoxels.size());
+	memcpy(voxels,densityVoxels.data(),numCopied);
+	memset(voxels+numCopied,0,numVoxels-numCopied);
+	}
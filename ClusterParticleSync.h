@@ -0,0 +1,95 @@
+/***********************************************************************
+ClusterParticleSync - Distributes the particle state of a simulation
+running on a cluster's head node to all render nodes over a multicast
+pipe, so that render nodes show exactly the head node's particles
+instead of each simulating its own diverging copy. Every broadcast state
+only carries the full attributes of particles that moved into a slot
+since the previous state; all other particles only send their positions
+as 16-bit fractions of the state's bounding box. Render nodes keep a
+mirror of the particle arrays, and derive previous positions for
+interpolation from the positions of the previous state unless the head
+node took more than one step in between. In density mode, the
+tone-mapped density histogram is broadcast instead.
+***********************************************************************/
+
+#ifndef CLUSTERPARTICLESYNC_INCLUDED
+#define CLUSTERPARTICLESYNC_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ParticleStore.h"
+
+/* Forward declarations: */
+namespace Cluster {
+class MulticastPipe;
+}
+
+class ClusterParticleSync
+	{
+	/* Embedded classes: */
+	public:
+	enum MessageType // Enumerated type for messages sent from the head node
+		{
+		PARTICLES=0,DENSITY,SHUTDOWN
+		};
+
+	/* Elements: */
+	private:
+	Cluster::MulticastPipe* pipe; // Pipe joining the head node and all render nodes
+	std::vector<ParticleStore::Id> sentIds; // Head node: persistent id of the particle in each slot as of the most recently sent state
+	std::vector<uint32_t> changedSlots; // Slots whose particle changed since the previous state, staged in both directions
+	std::vector<float> changedAttributes; // Staging area for the birth times, lifespans, and previous positions of changed particles
+	std::vector<ParticleStore::Color> changedColors; // Staging area for the colors of changed particles
+	std::vector<uint16_t> quantized; // Staging area for quantized coordinates in both directions
+	size_t numParticles; // Render nodes: number of particles in the most recently received state
+	std::vector<float> positions[3]; // Render nodes: particle x, y, and z coordinates of the most recently received state
+	std::vector<float> previousPositions[3]; // Render nodes: particle coordinates before the head node's most recent step
+	std::vector<ParticleStore::Color> colors[4]; // Render nodes: particle red, green, blue, and alpha channels
+	std::vector<float> birthTimes; // Render nodes: particle birth times
+	std::vector<float> lifespans; // Render nodes: particle lifespans
+	std::vector<unsigned char> densityVoxels; // Render nodes: tone-mapped density histogram of the most recently received state
+
+	/* Private methods: */
+	ClusterParticleSync(const ClusterParticleSync& source); // Prohibit copy constructor
+	ClusterParticleSync& operator=(const ClusterParticleSync& source); // Prohibit assignment operator
+	void sendQuantized(const float* values,size_t numValues,float min,float max); // Sends an array of coordinates as 16-bit fractions of the given range
+	void receiveQuantized(float* values,size_t numValues,float min,float max); // Receives an array of coordinates sent by sendQuantized
+	void receiveParticles(void); // Applies a received particle state to the mirror
+	void receiveDensity(void); // Receives a density histogram
+
+	/* Constructors and destructors: */
+	public:
+	ClusterParticleSync(Cluster::MulticastPipe* sPipe); // Distributes particle states over the given pipe; takes ownership of the pipe
+	~ClusterParticleSync(void);
+
+	/* Methods: */
+	void sendParticles(const ParticleStore& particles,bool singleStep); // Head node: broadcasts the given compacted particle store; flag is true if it took exactly one step since the previous broadcast
+	void sendDensity(size_t numStateParticles,const unsigned char* voxels,size_t numVoxels); // Head node: broadcasts the given tone-mapped density histogram, produced from the given number of particles
+	void sendShutdown(void); // Head node: tells all render nodes that no more states follow
+	MessageType receive(void); // Render nodes: blocks until the next message arrives and applies it; returns its type
+	size_t getNumParticles(void) const // Render nodes: returns the number of particles in the most recently received state
+		{
+		return numParticles;
+		}
+	template <class VertexParam>
+	void exportVertices(VertexParam* vertices) const // Render nodes: writes the mirrored particles into an interleaved vertex array like ParticleStore::exportInterpolationVertices
+		{
+		for(size_t i=0;i<numParticles;++i,++vertices)
+			{
+			vertices->texCoord[0]=birthTimes[i];
+			vertices->texCoord[1]=lifespans[i];
+			for(int j=0;j<4;++j)
+				vertices->color[j]=colors[j][i];
+			for(int j=0;j<3;++j)
+				{
+				vertices->normal[j]=previousPositions[j][i];
+				vertices->position[j]=positions[j][i];
+				}
+			}
+		}
+	void exportDensity(unsigned char* voxels,size_t numVoxels) const; // Render nodes: copies the most recently received density histogram into the given array of the given size
+	};
+
+#endif
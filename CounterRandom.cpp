@@ -0,0 +1,119 @@
+/***********************************************************************
+CounterRandom - Counter-based random number generator (Philox4x32-10)
+for seeding particles. Random bits are a pure function of a 64-bit seed
+and a counter made from a stream index, a domain, and a draw index, so
+every particle draws from its own stream without any shared state;
+streams can be generated in any order, on any number of threads, and
+reproduce bit for bit across runs and cluster nodes. The bulk generator
+runs many streams side by side in lanes the compiler can vectorize.
+***********************************************************************/
+
+#include "CounterRandom.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const uint32_t philoxMultipliers[2]={0xd2511f53U,0xcd9e8d57U}; // Round multipliers
+const uint32_t philoxWeyl[2]={0x9e3779b9U,0xbb67ae85U}; // Key increments between rounds
+const int numPhiloxRounds=10;
+const size_t numLanes=16; // Number of streams generated side by side by the bulk generator
+
+/****************
+Helper functions:
+****************/
+
+inline void philoxRound(uint32_t& c0,uint32_t& c1,uint32_t& c2,uint32_t& c3,uint32_t k0,uint32_t k1)
+	{
+	uint64_t p0=uint64_t(philoxMultipliers[0])*uint64_t(c0);
+	uint64_t p1=uint64_t(philoxMultipliers[1])*uint64_t(c2);
+	uint32_t n0=uint32_t(p1>>32)^c1^k0;
+	uint32_t n2=uint32_t(p0>>32)^c3^k1;
+	c1=uint32_t(p1);
+	c3=uint32_t(p0);
+	c0=n0;
+	c2=n2;
+	}
+
+}
+
+/******************************
+Methods of class CounterRandom:
+******************************/
+
+CounterRandom::CounterRandom(uint64_t seed)
+	{
+	key[0]=uint32_t(seed);
+	key[1]=uint32_t(seed>>32);
+	}
+
+void CounterRandom::philox(const uint32_t counter[4],const uint32_t key[2],CounterRandom::Block result)
+	{
+	uint32_t c0=counter[0],c1=counter[1],c2=counter[2],c3=counter[3];
+	uint32_t k0=key[0],k1=key[1];
+	for(int round=0;round<numPhiloxRounds;++round)
+		{
+		philoxRound(c0,c1,c2,c3,k0,k1);
+		k0+=philoxWeyl[0];
+		k1+=philoxWeyl[1];
+		}
+	result[0]=c0;
+	result[1]=c1;
+	result[2]=c2;
+	result[3]=c3;
+	}
+
+void CounterRandom::generate(uint64_t stream,uint32_t domain,uint32_t index,CounterRandom::Block result) const
+	{
+	uint32_t counter[4]={uint32_t(stream),uint32_t(stream>>32),domain,index};
+	philox(counter,key,result);
+	}
+
+void CounterRandom::generate(uint64_t firstStream,size_t numStreams,uint32_t domain,uint32_t index,CounterRandom::Block* results) const
+	{
+	for(size_t base=0;base<numStreams;base+=numLanes)
+		{
+		/* Load the counters of a group of streams into separate lanes: */
+		uint32_t c0[numLanes],c1[numLanes],c2[numLanes],c3[numLanes];
+		for(size_t l=0;l<numLanes;++l)
+			{
+			uint64_t stream=firstStream+base+l;
+			c0[l]=uint32_t(stream);
+			c1[l]=uint32_t(stream>>32);
+			c2[l]=domain;
+			c3[l]=index;
+			}
+
+		/* Run all rounds on all lanes at once: */
+		uint32_t k0=key[0],k1=key[1];
+		for(int round=0;round<numPhiloxRounds;++round)
+			{
+			for(size_t l=0;l<numLanes;++l)
+				{
+				/* Same as philoxRound, spelled out on the lane arrays so that the compiler vectorizes across lanes: */
+				uint64_t p0=uint64_t(philoxMultipliers[0])*uint64_t(c0[l]);
+				uint64_t p1=uint64_t(philoxMultipliers[1])*uint64_t(c2[l]);
+				uint32_t n0=uint32_t(p1>>32)^c1[l]^k0;
+				uint32_t n2=uint32_t(p0>>32)^c3[l]^k1;
+				c1[l]=uint32_t(p1);
+				c3[l]=uint32_t(p0);
+				c0[l]=n0;
+				c2[l]=n2;
+				}
+			k0+=philoxWeyl[0];
+			k1+=philoxWeyl[1];
+			}
+
+		/* Store the lanes belonging to requested streams: */
+		size_t numGroupStreams=numStreams-base<numLanes?numStreams-base:numLanes;
+		for(size_t l=0;l<numGroupStreams;++l)
+			{
+			results[base+l][0]=c0[l];
+			results[base+l][1]=c1[l];
+			results[base+l][2]=c2[l];
+			results[base+l][3]=c3[l];
+			}
+		}
+	}
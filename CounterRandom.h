@@ -0,0 +1,71 @@
+/***********************************************************************
+CounterRandom - Counter-based random number generator (Philox4x32-10)
+for seeding particles. Random bits are a pure function of a 64-bit seed
+and a counter made from a stream index, a domain, and a draw index, so
+every particle draws from its own stream without any shared state;
+streams can be generated in any order, on any number of threads, and
+reproduce bit for bit across runs and cluster nodes. The bulk generator
+runs many streams side by side in lanes the compiler can vectorize.
+***********************************************************************/
+
+#ifndef COUNTERRANDOM_INCLUDED
+#define COUNTERRANDOM_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+class CounterRandom
+	{
+	/* Embedded classes: */
+	public:
+	typedef uint32_t Block[4]; // Random bits generated from one counter value
+
+	/* Elements: */
+	private:
+	static const size_t seedBatchSize=256; // Number of streams generated at once when creating seeds
+	uint32_t key[2]; // Key derived from the seed
+
+	/* Constructors and destructors: */
+	public:
+	CounterRandom(uint64_t seed =0); // Creates a generator for the given seed
+
+	/* Methods: */
+	static void philox(const uint32_t counter[4],const uint32_t key[2],Block result); // Applies ten Philox rounds to the given counter with the given key
+	void generate(uint64_t stream,uint32_t domain,uint32_t index,Block result) const; // Generates the given draw of the given stream in the given domain
+	void generate(uint64_t firstStream,size_t numStreams,uint32_t domain,uint32_t index,Block* results) const; // Generates the given draw of a run of consecutive streams in the given domain, several streams at a time
+	static float toUnit(uint32_t bits) // Converts random bits to a uniformly distributed float in [0, 1)
+		{
+		return float(bits>>8)*(1.0f/16777216.0f);
+		}
+	static float uniform(uint32_t bits,float min,float max) // Converts random bits to a uniformly distributed float in [min, max)
+		{
+		return min+(max-min)*toUnit(bits);
+		}
+	static size_t index(uint32_t bits,size_t numValues) // Converts random bits to a uniformly distributed index in [0, numValues) for up to 2^32 values
+		{
+		return size_t((uint64_t(bits)*uint64_t(numValues))>>32);
+		}
+	template <class SeedParam>
+	void generateSeeds(uint64_t firstStream,size_t numSeeds,uint32_t domain,const float center[3],float radius,unsigned int minColor,SeedParam* seeds) const // Generates seeds with position and color components from a run of consecutive streams, with positions in a cube of the given radius around the given center and color channels between the given minimum and 255
+		{
+		Block blocks[seedBatchSize];
+		for(size_t base=0;base<numSeeds;base+=seedBatchSize)
+			{
+			size_t numBatchSeeds=numSeeds-base<seedBatchSize?numSeeds-base:seedBatchSize;
+			generate(firstStream+base,numBatchSeeds,domain,0,blocks);
+
+			/* Draw the position from the first three words, and the colors from the bytes of the fourth: */
+			SeedParam* sPtr=seeds+base;
+			for(size_t i=0;i<numBatchSeeds;++i,++sPtr)
+				{
+				for(int j=0;j<3;++j)
+					sPtr->position[j]=uniform(blocks[i][j],center[j]-radius,center[j]+radius);
+				for(int j=0;j<3;++j)
+					sPtr->color[j]=minColor+((((blocks[i][3]>>(j*8))&0xffU)*(256U-minColor))>>8);
+				sPtr->color[3]=255;
+				}
+			}
+		}
+	};
+
+#endif
@@ -0,0 +1,134 @@
+/***********************************************************************
+DensityHistogram - Voxel histogram accumulating particle positions over
+time in a fixed cubic domain. Each worker thread counts samples into its
+own private set of bins, so accumulation needs no atomic operations;
+the private bins are merged into 64-bit totals one slab of voxels at a
+time, which lets merging run in parallel as well. Memory use depends
+only on the resolution and the number of workers, no matter how many
+samples are accumulated.
+***********************************************************************/
+
+#include "DensityHistogram.h"
+
+#include <string.h>
+#include <math.h>
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+static const size_t numSampleCounterSpacing=8; // Spacing of the per-worker sample counters in 64-bit words, to keep them in separate cache lines
+
+}
+
+/*********************************
+Methods of class DensityHistogram:
+*********************************/
+
+DensityHistogram::DensityHistogram(const float center[3],float radius,unsigned int sResolution,unsigned int sNumWorkers)
+	:resolution(sResolution>0?sResolution:1),
+	 numWorkers(sNumWorkers>0?sNumWorkers:1),
+	 numSamples(0)
+	{
+	for(int i=0;i<3;++i)
+		origin[i]=center[i]-radius;
+	cellScale=float(resolution)/(2.0f*radius);
+	numCells=size_t(resolution)*size_t(resolution)*size_t(resolution);
+
+	/* Allocate zeroed private bins for all workers and the merged totals: */
+	workerCounts=new Count*[numWorkers];
+	for(unsigned int i=0;i<numWorkers;++i)
+		{
+		workerCounts[i]=new Count[numCells];
+		memset(workerCounts[i],0,numCells*sizeof(Count));
+		}
+	workerNumSamples=new uint64_t[numWorkers*numSampleCounterSpacing];
+	memset(workerNumSamples,0,numWorkers*numSampleCounterSpacing*sizeof(uint64_t));
+	totals=new uint64_t[numCells];
+	memset(totals,0,numCells*sizeof(uint64_t));
+	}
+
+DensityHistogram::~DensityHistogram(void)
+	{
+	for(unsigned int i=0;i<numWorkers;++i)
+		delete[] workerCounts[i];
+	delete[] workerCounts;
+	delete[] workerNumSamples;
+	delete[] totals;
+	}
+
+void DensityHistogram::getDomain(float domainMin[3],float domainMax[3]) const
+	{
+	for(int i=0;i<3;++i)
+		{
+		domainMin[i]=origin[i];
+		domainMax[i]=origin[i]+float(resolution)/cellScale;
+		}
+	}
+
+void DensityHistogram::accumulate(unsigned int workerIndex,const float* x,const float* y,const float* z,const float* birthTimes,float maxBirthTime,size_t numParticles)
+	{
+	Count* counts=workerCounts[workerIndex];
+	const float* ps[3]={x,y,z};
+	size_t numAdded=0;
+	for(size_t i=0;i<numParticles;++i)
+		{
+		/* Skip particles that have not yet converged onto the attractor: */
+		if(birthTimes[i]>maxBirthTime)
+			continue;
+		++numAdded;
+
+		/* Find the particle's voxel, skipping particles outside the domain: */
+		unsigned int cell[3];
+		bool inside=true;
+		for(int j=0;j<3;++j)
+			{
+			float c=(ps[j][i]-origin[j])*cellScale;
+			inside=inside&&c>=0.0f&&c<float(resolution);
+			cell[j]=inside?(unsigned int)(c):0U;
+			}
+		if(inside)
+			++counts[(size_t(cell[2])*resolution+cell[1])*resolution+cell[0]];
+		}
+	workerNumSamples[workerIndex*numSampleCounterSpacing]+=numAdded;
+	}
+
+uint64_t DensityHistogram::mergeSlab(unsigned int slab)
+	{
+	size_t slabSize=size_t(resolution)*size_t(resolution);
+	uint64_t* tPtr=totals+slab*slabSize;
+	uint64_t maxTotal=0;
+	for(unsigned int worker=0;worker<numWorkers;++worker)
+		{
+		Count* cPtr=workerCounts[worker]+slab*slabSize;
+		for(size_t i=0;i<slabSize;++i)
+			tPtr[i]+=cPtr[i];
+		memset(cPtr,0,slabSize*sizeof(Count));
+		}
+	for(size_t i=0;i<slabSize;++i)
+		if(maxTotal<tPtr[i])
+			maxTotal=tPtr[i];
+	return maxTotal;
+	}
+
+void DensityHistogram::countSamples(void)
+	{
+	for(unsigned int worker=0;worker<numWorkers;++worker)
+		{
+		numSamples+=workerNumSamples[worker*numSampleCounterSpacing];
+		workerNumSamples[worker*numSampleCounterSpacing]=0;
+		}
+	}
+
+void DensityHistogram::toneMapSlab(unsigned int slab,uint64_t maxTotal,unsigned char* voxels) const
+	{
+	/* Map totals logarithmically, so that sparse filaments remain visible next to dense cores: */
+	size_t slabSize=size_t(resolution)*size_t(resolution);
+	const uint64_t* tPtr=totals+slab*slabSize;
+	unsigned char* vPtr=voxels+slab*slabSize;
+	float scale=maxTotal>0?255.0f/logf(1.0f+float(maxTotal)):0.0f;
+	for(size_t i=0;i<slabSize;++i)
+		vPtr[i]=(unsigned char)(logf(1.0f+float(tPtr[i]))*scale+0.5f);
+	}
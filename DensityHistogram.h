@@ -0,0 +1,64 @@
+/***********************************************************************
+DensityHistogram - Voxel histogram accumulating particle positions over
+time in a fixed cubic domain. Each worker thread counts samples into its
+own private set of bins, so accumulation needs no atomic operations;
+the private bins are merged into 64-bit totals one slab of voxels at a
+time, which lets merging run in parallel as well. Memory use depends
+only on the resolution and the number of workers, no matter how many
+samples are accumulated.
+***********************************************************************/
+
+#ifndef DENSITYHISTOGRAM_INCLUDED
+#define DENSITYHISTOGRAM_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+class DensityHistogram
+	{
+	/* Embedded classes: */
+	public:
+	typedef unsigned int Count; // Type for per-worker sample counts between merges
+
+	/* Elements: */
+	private:
+	float origin[3]; // Lower corner of the histogram's domain
+	float cellScale; // Number of voxels per unit length
+	unsigned int resolution; // Number of voxels along each axis
+	size_t numCells; // Total number of voxels
+	unsigned int numWorkers; // Number of workers with private bins
+	Count** workerCounts; // Private bins of all workers
+	uint64_t* workerNumSamples; // Number of samples each worker added since the last merge, spaced to avoid false sharing
+	uint64_t* totals; // Merged sample counts of all voxels
+	uint64_t numSamples; // Total number of merged samples, including those outside the domain
+
+	/* Private methods: */
+	DensityHistogram(const DensityHistogram& source); // Prohibit copy constructor
+	DensityHistogram& operator=(const DensityHistogram& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	DensityHistogram(const float center[3],float radius,unsigned int sResolution,unsigned int sNumWorkers); // Creates an empty histogram covering the cube of the given center and half-size with the given number of voxels along each axis, for the given number of workers
+	~DensityHistogram(void);
+
+	/* Methods: */
+	unsigned int getResolution(void) const // Returns the number of voxels along each axis
+		{
+		return resolution;
+		}
+	size_t getNumCells(void) const // Returns the total number of voxels
+		{
+		return numCells;
+		}
+	uint64_t getNumSamples(void) const // Returns the number of merged samples
+		{
+		return numSamples;
+		}
+	void getDomain(float domainMin[3],float domainMax[3]) const; // Returns the corners of the histogram's domain
+	void accumulate(unsigned int workerIndex,const float* x,const float* y,const float* z,const float* birthTimes,float maxBirthTime,size_t numParticles); // Adds the positions of all particles born no later than the given time to the given worker's private bins
+	uint64_t mergeSlab(unsigned int slab); // Adds all private bins of the given z slab into the totals and clears them; returns the slab's largest total; can be called concurrently on different slabs
+	void countSamples(void); // Adds all workers' sample counts to the total number of samples; must be called after all slabs have been merged
+	void toneMapSlab(unsigned int slab,uint64_t maxTotal,unsigned char* voxels) const; // Writes the logarithmically tone-mapped totals of the given z slab into the same slab of an 8-bit voxel array, mapping the given total to full intensity
+	};
+
+#endif
@@ -0,0 +1,125 @@
+/***********************************************************************
+EnsembleSimulator - CPU simulation engine advancing many independent
+ensembles of particles along the same ODE system and integrator, but
+with per-ensemble system parameters taken from an ensemble table. Each
+ensemble keeps its own structure-of-arrays particle store, and every
+step advances the chunks of all ensembles in one batched job on one
+worker pool, so that a parameter sweep costs one thread pool and one
+hand-off per step instead of one process per parameter set. Like
+ParticleSimulator, it does not depend on Vrui's application or
+rendering layers.
+***********************************************************************/
+
+#include "EnsembleSimulator.h"
+
+#include <string.h>
+
+/*******************************************
+Methods of class EnsembleSimulator::StepJob:
+*******************************************/
+
+void EnsembleSimulator::StepJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	const Chunk& chunk=simulator.chunks[chunkIndex];
+	ParticleStore& particles=simulator.ensembles[chunk.ensemble];
+	size_t numPacked=particles.getPaddedNumParticles();
+	size_t count=numPacked-chunk.begin<simulator.chunkSize?numPacked-chunk.begin:simulator.chunkSize;
+
+	/* Find this chunk's expired particles, if any in its ensemble can have expired: */
+	if(simulator.sweepEnsembles[chunk.ensemble])
+		{
+		size_t end=chunk.begin+simulator.chunkSize<particles.getNumParticles()?chunk.begin+simulator.chunkSize:particles.getNumParticles();
+		simulator.expirySweeps[chunkIndex]=particles.findExpired(sweepTime,chunk.begin,end);
+		}
+
+	/* Keep the positions before the step for interpolation: */
+	if(savePrevious)
+		particles.savePreviousPositions(chunk.begin,chunk.begin+count);
+
+	/* Advance the chunk along the ensemble's own system parameters: */
+	ParticleKernels::StepParameters stepParameters=simulator.stepParameters;
+	memcpy(stepParameters.systemParameters,simulator.table.getParameters(chunk.ensemble),size_t(simulator.table.getNumParameters())*sizeof(float));
+	ParticleKernels::stepParticles(stepParameters,particles.getPositions(0)+chunk.begin,particles.getPositions(1)+chunk.begin,particles.getPositions(2)+chunk.begin,count);
+	}
+
+/**********************************
+Methods of class EnsembleSimulator:
+**********************************/
+
+void EnsembleSimulator::collectChunks(bool padded)
+	{
+	chunks.clear();
+	for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+		{
+		size_t numSlots=padded?ensembles[ensemble].getPaddedNumParticles():ensembles[ensemble].getNumParticles();
+		Chunk chunk;
+		chunk.ensemble=(unsigned int)(ensemble);
+		for(chunk.begin=0;chunk.begin<numSlots;chunk.begin+=chunkSize)
+			chunks.push_back(chunk);
+		}
+	}
+
+EnsembleSimulator::EnsembleSimulator(const ParticleKernels::StepParameters& sStepParameters,const EnsembleTable& sTable,size_t capacityPerEnsemble,unsigned int numThreads,size_t sChunkSize)
+	:stepParameters(sStepParameters),
+	 table(sTable),
+	 numEnsembles(table.getNumEnsembles()),
+	 ensembles(new ParticleStore[numEnsembles]),
+	 sweepEnsembles(numEnsembles,false),
+	 workerPool(numThreads),
+	 chunkSize(ParticleStore::padToPackSize(sChunkSize>0?sChunkSize:1)) // Keep chunks aligned to full SIMD packs
+	{
+	/* Allocate all ensembles and per-step buffers once, so that steps never allocate memory: */
+	size_t maxNumChunks=0;
+	for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+		{
+		ensembles[ensemble].reserve(capacityPerEnsemble);
+		maxNumChunks+=(ensembles[ensemble].getCapacity()+chunkSize-1)/chunkSize;
+		}
+	chunks.reserve(maxNumChunks);
+	expirySweeps.resize(maxNumChunks);
+	}
+
+EnsembleSimulator::~EnsembleSimulator(void)
+	{
+	delete[] ensembles;
+	}
+
+size_t EnsembleSimulator::getNumParticles(void) const
+	{
+	size_t result=0;
+	for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+		result+=ensembles[ensemble].getNumParticles();
+	return result;
+	}
+
+void EnsembleSimulator::step(double currentTime,bool savePrevious)
+	{
+	/* Check which ensembles' particles can have expired since the last step: */
+	bool sweep=false;
+	for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+		{
+		sweepEnsembles[ensemble]=ensembles[ensemble].needsExpirySweep(currentTime);
+		if(sweepEnsembles[ensemble])
+			{
+			ensembles[ensemble].beginExpirySweep();
+			sweep=true;
+			}
+		}
+
+	/* Advance all ensembles in one parallel job, finding expired particles along the way: */
+	collectChunks(true);
+	StepJob stepJob(*this,currentTime,savePrevious);
+	workerPool.run(stepJob,chunks.size());
+
+	/* Put the slots of all expired particles onto their ensembles' free lists, in ascending order per ensemble: */
+	if(sweep)
+		for(size_t chunkIndex=0;chunkIndex<chunks.size();++chunkIndex)
+			if(sweepEnsembles[chunks[chunkIndex].ensemble])
+				ensembles[chunks[chunkIndex].ensemble].commitExpired(chunks[chunkIndex].begin,expirySweeps[chunkIndex]);
+	}
+
+void EnsembleSimulator::compact(void)
+	{
+	for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+		ensembles[ensemble].closeFreeSlots();
+	}
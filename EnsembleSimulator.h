@@ -0,0 +1,156 @@
+/***********************************************************************
+EnsembleSimulator - CPU simulation engine advancing many independent
+ensembles of particles along the same ODE system and integrator, but
+with per-ensemble system parameters taken from an ensemble table. Each
+ensemble keeps its own structure-of-arrays particle store, and every
+step advances the chunks of all ensembles in one batched job on one
+worker pool, so that a parameter sweep costs one thread pool and one
+hand-off per step instead of one process per parameter set. Like
+ParticleSimulator, it does not depend on Vrui's application or
+rendering layers.
+***********************************************************************/
+
+#ifndef ENSEMBLESIMULATOR_INCLUDED
+#define ENSEMBLESIMULATOR_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+#include "ParticleStore.h"
+#include "ParticleKernels.h"
+#include "WorkerPool.h"
+#include "EnsembleTable.h"
+
+class EnsembleSimulator
+	{
+	/* Embedded classes: */
+	private:
+	struct Chunk // Structure identifying one chunk of one ensemble's particles
+		{
+		/* Elements: */
+		public:
+		unsigned int ensemble; // Index of the ensemble
+		size_t begin; // Index of the chunk's first particle in the ensemble
+		};
+
+	class StepJob:public WorkerPool::Job // Job advancing one chunk of one ensemble by one step
+		{
+		/* Elements: */
+		public:
+		EnsembleSimulator& simulator; // Simulator whose ensembles are being advanced
+		double sweepTime; // Application time against which particle expiry is checked
+		bool savePrevious; // Flag whether to save particle positions for interpolation before stepping
+
+		/* Constructors and destructors: */
+		StepJob(EnsembleSimulator& sSimulator,double sSweepTime,bool sSavePrevious)
+			:simulator(sSimulator),sweepTime(sSweepTime),savePrevious(sSavePrevious)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	template <class VertexParam>
+	class ExportJob:public WorkerPool::Job // Job writing one chunk of one ensemble into its range of an interleaved render copy
+		{
+		/* Elements: */
+		public:
+		const EnsembleSimulator& simulator; // Simulator whose ensembles are being exported
+		VertexParam* vertices; // Interleaved vertex array receiving the render copy
+		const unsigned int* ensembleFirsts; // Index of each ensemble's first vertex
+
+		/* Constructors and destructors: */
+		ExportJob(const EnsembleSimulator& sSimulator,VertexParam* sVertices,const unsigned int* sEnsembleFirsts)
+			:simulator(sSimulator),vertices(sVertices),ensembleFirsts(sEnsembleFirsts)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex)
+			{
+			const Chunk& chunk=simulator.chunks[chunkIndex];
+			const ParticleStore& particles=simulator.ensembles[chunk.ensemble];
+			size_t end=chunk.begin+simulator.chunkSize<particles.getNumParticles()?chunk.begin+simulator.chunkSize:particles.getNumParticles();
+			particles.exportInterpolationVertices(vertices+ensembleFirsts[chunk.ensemble],chunk.begin,end);
+			}
+		};
+
+	friend class StepJob;
+	template <class VertexParam>
+	friend class ExportJob;
+
+	/* Elements: */
+	ParticleKernels::StepParameters stepParameters; // ODE system, integrator, and time step shared by all ensembles
+	EnsembleTable table; // Per-ensemble ODE system parameters
+	size_t numEnsembles; // Number of ensembles
+	ParticleStore* ensembles; // Structure-of-arrays states of all ensembles' live particles
+	std::vector<bool> sweepEnsembles; // Flags whether each ensemble is swept for expired particles in the current step
+	std::vector<Chunk> chunks; // Chunks of all ensembles processed by the current job, reserved for the full pools
+	std::vector<ParticleStore::ExpirySweep> expirySweeps; // Per-chunk expiry sweep results, reserved for the full pools
+	WorkerPool workerPool; // Pool of worker threads sharing the particle updates of each step; the thread calling the simulator is its first worker
+	size_t chunkSize; // Number of particles handed to a worker at a time; multiple of the SIMD pack width
+
+	/* Private methods: */
+	EnsembleSimulator(const EnsembleSimulator& source); // Prohibit copy constructor
+	EnsembleSimulator& operator=(const EnsembleSimulator& source); // Prohibit assignment operator
+	void collectChunks(bool padded); // Lists the chunks of all ensembles' used particle slots, padded to the SIMD pack width if flag is true
+
+	/* Constructors and destructors: */
+	public:
+	EnsembleSimulator(const ParticleKernels::StepParameters& sStepParameters,const EnsembleTable& sTable,size_t capacityPerEnsemble,unsigned int numThreads,size_t sChunkSize); // Creates a simulator for the ensembles of the given table, each holding up to the given number of particles, using the given total number of threads and particles per chunk
+	~EnsembleSimulator(void);
+
+	/* Methods: */
+	const ParticleKernels::StepParameters& getStepParameters(void) const // Returns the shared simulation parameters
+		{
+		return stepParameters;
+		}
+	const EnsembleTable& getTable(void) const // Returns the per-ensemble parameters
+		{
+		return table;
+		}
+	size_t getNumEnsembles(void) const // Returns the number of ensembles
+		{
+		return numEnsembles;
+		}
+	ParticleStore& getEnsemble(size_t ensemble) // Returns the particle store of the given ensemble
+		{
+		return ensembles[ensemble];
+		}
+	const ParticleStore& getEnsemble(size_t ensemble) const
+		{
+		return ensembles[ensemble];
+		}
+	size_t getNumParticles(void) const; // Returns the total number of used particle slots of all ensembles
+	unsigned int getNumThreads(void) const // Returns the total number of threads sharing each step
+		{
+		return workerPool.getNumWorkers();
+		}
+	void step(double currentTime,bool savePrevious); // Advances all ensembles' particles by one step in one batched job and puts the slots of particles expired at the given time onto the free lists; saves positions for interpolation first if flag is true
+	template <class SeedParam>
+	size_t addParticles(size_t ensemble,const SeedParam* seeds,size_t numSeeds,float birthTime,float expiryTime) // Adds a batch of new particles to the given ensemble; returns the number of particles added
+		{
+		return ensembles[ensemble].addParticles(seeds,numSeeds,birthTime,expiryTime);
+		}
+	void compact(void); // Closes all free slots of all ensembles left after a step and seeding
+	template <class VertexParam>
+	void exportVertices(VertexParam* vertices,unsigned int* ensembleFirsts) // Writes the interleaved render copies of all ensembles one after another like ParticleSimulator::exportVertices, and writes the index of each ensemble's first vertex followed by the total number of vertices, in parallel
+		{
+		/* Lay out the ensembles one after another: */
+		unsigned int first=0;
+		for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+			{
+			ensembleFirsts[ensemble]=first;
+			first+=(unsigned int)(ensembles[ensemble].getNumParticles());
+			}
+		ensembleFirsts[numEnsembles]=first;
+
+		/* Export all chunks of all ensembles in one job: */
+		collectChunks(false);
+		ExportJob<VertexParam> exportJob(*this,vertices,ensembleFirsts);
+		workerPool.run(exportJob,chunks.size());
+		}
+	};
+
+#endif
@@ -0,0 +1,46 @@
+/***********************************************************************
+EnsembleTable - Compact table of ODE system parameter sets, one row per
+independent ensemble of particles. Tables start out with one row of
+base parameters, and each sweep axis replaces every row by a run of
+rows varying one parameter evenly over a range, so that two axes span a
+regular grid over a pair of parameters.
+***********************************************************************/
+
+#include "EnsembleTable.h"
+
+/******************************
+Methods of class EnsembleTable:
+******************************/
+
+EnsembleTable::EnsembleTable(AttractorSystems::SystemType sSystem,const float baseParameters[])
+	:system(sSystem),
+	 numParameters(AttractorSystems::getSystemInfo(system).numParameters),
+	 parameters(baseParameters,baseParameters+numParameters)
+	{
+	}
+
+void EnsembleTable::addAxis(int parameterIndex,float min,float max,unsigned int numValues)
+	{
+	Axis axis;
+	axis.parameterIndex=parameterIndex;
+	axis.min=min;
+	axis.max=max;
+	axis.numValues=numValues>0?numValues:1;
+	axes.push_back(axis);
+
+	/* Expand every row into a run of rows stepping through the parameter range: */
+	size_t numOldEnsembles=getNumEnsembles();
+	std::vector<float> newParameters;
+	newParameters.reserve(numOldEnsembles*axis.numValues*size_t(numParameters));
+	for(size_t ensemble=0;ensemble<numOldEnsembles;++ensemble)
+		{
+		const float* row=getParameters(ensemble);
+		for(unsigned int value=0;value<axis.numValues;++value)
+			{
+			newParameters.insert(newParameters.end(),row,row+numParameters);
+			float t=axis.numValues>1?float(value)/float(axis.numValues-1):0.0f;
+			newParameters[newParameters.size()-numParameters+parameterIndex]=min+(max-min)*t;
+			}
+		}
+	parameters.swap(newParameters);
+	}
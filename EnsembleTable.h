@@ -0,0 +1,69 @@
+/***********************************************************************
+EnsembleTable - Compact table of ODE system parameter sets, one row per
+independent ensemble of particles. Tables start out with one row of
+base parameters, and each sweep axis replaces every row by a run of
+rows varying one parameter evenly over a range, so that two axes span a
+regular grid over a pair of parameters.
+***********************************************************************/
+
+#ifndef ENSEMBLETABLE_INCLUDED
+#define ENSEMBLETABLE_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+#include "AttractorSystems.h"
+
+class EnsembleTable
+	{
+	/* Embedded classes: */
+	public:
+	struct Axis // Structure describing one sweep axis
+		{
+		/* Elements: */
+		public:
+		int parameterIndex; // Index of the swept parameter in the system's parameter list
+		float min,max; // Range of parameter values, inclusive
+		unsigned int numValues; // Number of evenly spaced values in the range
+		};
+
+	/* Elements: */
+	private:
+	AttractorSystems::SystemType system; // ODE system whose parameters are stored
+	int numParameters; // Number of parameters per row, equal to the system's number of parameters
+	std::vector<float> parameters; // Parameter rows of all ensembles, one after another
+	std::vector<Axis> axes; // Sweep axes in the order they were added; later axes vary fastest
+
+	/* Constructors and destructors: */
+	public:
+	EnsembleTable(AttractorSystems::SystemType sSystem,const float baseParameters[]); // Creates a table with a single ensemble of the given parameters
+
+	/* Methods: */
+	AttractorSystems::SystemType getSystem(void) const // Returns the ODE system
+		{
+		return system;
+		}
+	int getNumParameters(void) const // Returns the number of parameters per ensemble
+		{
+		return numParameters;
+		}
+	size_t getNumEnsembles(void) const // Returns the number of ensembles
+		{
+		return parameters.size()/size_t(numParameters>0?numParameters:1);
+		}
+	const float* getParameters(size_t ensemble) const // Returns the parameters of the given ensemble, in the order given by the system's SystemInfo
+		{
+		return parameters.data()+ensemble*size_t(numParameters);
+		}
+	size_t getNumAxes(void) const // Returns the number of sweep axes
+		{
+		return axes.size();
+		}
+	const Axis& getAxis(size_t index) const // Returns the given sweep axis
+		{
+		return axes[index];
+		}
+	void addAxis(int parameterIndex,float min,float max,unsigned int numValues); // Replaces every ensemble by the given number of ensembles sweeping the given parameter over the given range
+	};
+
+#endif
@@ -0,0 +1,105 @@
+/***********************************************************************
+FrameQueue - Bounded queue handing frames from one pipeline stage to the
+next. The queue owns a fixed set of frame buffers that circulate between
+the producer, which fills free frames and posts them, and the consumer,
+which takes posted frames in order and releases them when it is done.
+Unlike the simulation's hand-offs to the renderer, nothing is ever
+dropped: a producer that runs ahead blocks until the consumer releases a
+frame, so the slowest stage sets the pace of an offline pipeline while
+the memory held by frames in flight stays bounded.
+***********************************************************************/
+
+#ifndef FRAMEQUEUE_INCLUDED
+#define FRAMEQUEUE_INCLUDED
+
+#include <deque>
+#include <vector>
+#include <Threads/Mutex.h>
+#include <Threads/Cond.h>
+
+template <class FrameParam>
+class FrameQueue
+	{
+	/* Elements: */
+	private:
+	FrameParam* frames; // Fixed set of frame buffers
+	unsigned int numFrames; // Number of frame buffers
+	Threads::Mutex queueMutex; // Mutex protecting the frame lists and the closed flag
+	Threads::Cond freeCond; // Condition variable signaled when a frame is released
+	Threads::Cond postedCond; // Condition variable signaled when a frame is posted or the queue is closed
+	std::vector<FrameParam*> freeFrames; // Frame buffers available to the producer
+	std::deque<FrameParam*> postedFrames; // Frame buffers waiting for the consumer, in order of posting
+	bool closed; // Flag whether the producer will not post any more frames
+
+	/* Private methods: */
+	FrameQueue(const FrameQueue& source); // Prohibit copy constructor
+	FrameQueue& operator=(const FrameQueue& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	FrameQueue(unsigned int sNumFrames) // Creates a queue with the given number of frame buffers
+		:frames(0),numFrames(sNumFrames>0?sNumFrames:1),closed(false)
+		{
+		frames=new FrameParam[numFrames];
+		for(unsigned int i=0;i<numFrames;++i)
+			freeFrames.push_back(&frames[numFrames-1-i]);
+		}
+	~FrameQueue(void)
+		{
+		delete[] frames;
+		}
+
+	/* Methods: */
+	unsigned int getNumFrames(void) const // Returns the number of frame buffers
+		{
+		return numFrames;
+		}
+	FrameParam& getFrame(unsigned int index) // Returns the frame buffer of the given index, to allocate its storage up front
+		{
+		return frames[index];
+		}
+
+	/* Producer methods: */
+	FrameParam* startFrame(void) // Returns a free frame buffer, waiting until the consumer releases one
+		{
+		Threads::Mutex::Lock queueLock(queueMutex);
+		while(freeFrames.empty())
+			freeCond.wait(queueMutex);
+		FrameParam* result=freeFrames.back();
+		freeFrames.pop_back();
+		return result;
+		}
+	void postFrame(FrameParam* frame) // Hands a filled frame buffer to the consumer
+		{
+		Threads::Mutex::Lock queueLock(queueMutex);
+		postedFrames.push_back(frame);
+		postedCond.signal();
+		}
+	void close(void) // Tells the consumer that no more frames will be posted
+		{
+		Threads::Mutex::Lock queueLock(queueMutex);
+		closed=true;
+		postedCond.signal();
+		}
+
+	/* Consumer methods: */
+	FrameParam* lockFrame(void) // Returns the oldest posted frame buffer, waiting until one is posted; returns null once the queue is closed and empty
+		{
+		Threads::Mutex::Lock queueLock(queueMutex);
+		while(postedFrames.empty()&&!closed)
+			postedCond.wait(queueMutex);
+		if(postedFrames.empty())
+			return 0;
+		FrameParam* result=postedFrames.front();
+		postedFrames.pop_front();
+		return result;
+		}
+	void releaseFrame(FrameParam* frame) // Returns a consumed frame buffer to the producer
+		{
+		Threads::Mutex::Lock queueLock(queueMutex);
+		freeFrames.push_back(frame);
+		freeCond.signal();
+		}
+	};
+
+#endif
@@ -0,0 +1,422 @@
+/***********************************************************************
+GPUParticleEngine - Alternative particle engine keeping all particle
+state in shader storage buffers on the GPU, and advancing particles along
+the selected ODE system with a compute shader. The CPU only seeds new
+particles, which are written into a ring of slots in the storage buffers
+once per frame; as all particles share the same lifespan, the slot
+reused next always holds the oldest particle. The storage buffers double
+as vertex buffers, so particle state never crosses the bus after
+seeding.
+Requires OpenGL 4.3 or the GL_ARB_compute_shader and
+GL_ARB_shader_storage_buffer_object extensions.
+***********************************************************************/
+
+#include "GPUParticleEngine.h"
+
+#include <string.h>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <GL/glext.h>
+#include <GL/GLContextData.h>
+#include <GL/GLExtensionManager.h>
+
+#include "ShaderHelpers.h"
+#include "ParticleAppearance.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+static const GLuint workGroupSize=256; // Number of particles processed by each compute shader work group
+
+/* GLSL derivative functions of all ODE systems; these must match the functors in AttractorSystems.h: */
+const char* systemSources[AttractorSystems::NUM_SYSTEMS]=
+	{
+	/* Lorenz: */
+	"vec3 derivative(vec3 p)\n"
+	"	{\n"
+	"	return vec3(parameters[0]*(p.y-p.x),p.x*(parameters[1]-p.z)-p.y,p.x*p.y-parameters[2]*p.z);\n"
+	"	}\n",
+
+	/* Rossler: */
+	"vec3 derivative(vec3 p)\n"
+	"	{\n"
+	"	return vec3(-p.y-p.z,p.x+parameters[0]*p.y,parameters[1]+p.z*(p.x-parameters[2]));\n"
+	"	}\n",
+
+	/* Aizawa: */
+	"vec3 derivative(vec3 p)\n"
+	"	{\n"
+	"	float zb=p.z-parameters[1];\n"
+	"	float r2=p.x*p.x+p.y*p.y;\n"
+	"	return vec3(zb*p.x-parameters[3]*p.y,parameters[3]*p.x+zb*p.y,\n"
+	"	            parameters[2]+parameters[0]*p.z-p.z*p.z*p.z*(1.0/3.0)-r2*(1.0+parameters[4]*p.z)+parameters[5]*p.z*p.x*p.x*p.x);\n"
+	"	}\n",
+
+	/* Thomas: */
+	"vec3 derivative(vec3 p)\n"
+	"	{\n"
+	"	return sin(p.yzx)-parameters[0]*p;\n"
+	"	}\n",
+
+	/* Halvorsen: */
+	"vec3 derivative(vec3 p)\n"
+	"	{\n"
+	"	return -parameters[0]*p-4.0*(p.yzx+p.zxy)-p.yzx*p.yzx;\n"
+	"	}\n"
+	};
+
+/* GLSL step functions of all integrators; these must match the policy classes in Integrators.h: */
+const char* integratorSources[Integrators::NUM_INTEGRATORS]=
+	{
+	/* Euler: */
+	"vec3 integrate(vec3 p,float dt)\n"
+	"	{\n"
+	"	return p+derivative(p)*dt;\n"
+	"	}\n",
+
+	/* RK4: */
+	"vec3 integrate(vec3 p,float dt)\n"
+	"	{\n"
+	"	vec3 k1=derivative(p);\n"
+	"	vec3 k2=derivative(p+k1*(dt*0.5));\n"
+	"	vec3 k3=derivative(p+k2*(dt*0.5));\n"
+	"	vec3 k4=derivative(p+k3*dt);\n"
+	"	return p+(k1+2.0*(k2+k3)+k4)*(dt/6.0);\n"
+	"	}\n",
+
+	/* Dormand-Prince: */
+	"vec3 integrate(vec3 p,float dt)\n"
+	"	{\n"
+	"	float doneThreshold=dt*1.0e-4;\n"
+	"	float minH=dt/float(1<<min(maxSubsteps,20));\n"
+	"	float remaining=dt;\n"
+	"	float h=dt;\n"
+	"	vec3 k1=derivative(p);\n"
+	"	for(int substep=0;remaining>doneThreshold;++substep)\n"
+	"		{\n"
+	"		bool forced=substep>=maxSubsteps;\n"
+	"		float hs=forced?remaining:min(h,remaining);\n"
+	"		vec3 k2=derivative(p+hs*((1.0/5.0)*k1));\n"
+	"		vec3 k3=derivative(p+hs*((3.0/40.0)*k1+(9.0/40.0)*k2));\n"
+	"		vec3 k4=derivative(p+hs*((44.0/45.0)*k1-(56.0/15.0)*k2+(32.0/9.0)*k3));\n"
+	"		vec3 k5=derivative(p+hs*((19372.0/6561.0)*k1-(25360.0/2187.0)*k2+(64448.0/6561.0)*k3-(212.0/729.0)*k4));\n"
+	"		vec3 k6=derivative(p+hs*((9017.0/3168.0)*k1-(355.0/33.0)*k2+(46732.0/5247.0)*k3+(49.0/176.0)*k4-(5103.0/18656.0)*k5));\n"
+	"		vec3 y5=p+hs*((35.0/384.0)*k1+(500.0/1113.0)*k3+(125.0/192.0)*k4-(2187.0/6784.0)*k5+(11.0/84.0)*k6);\n"
+	"		vec3 k7=derivative(y5);\n"
+	"		vec3 e=abs(hs*((71.0/57600.0)*k1-(71.0/16695.0)*k3+(71.0/1920.0)*k4-(17253.0/339200.0)*k5+(22.0/525.0)*k6-(1.0/40.0)*k7));\n"
+	"		float err=max(e.x,max(e.y,e.z));\n"
+	"		if(forced||err<=tolerance||hs<=minH)\n"
+	"			{\n"
+	"			p=y5;\n"
+	"			k1=k7;\n"
+	"			remaining-=hs;\n"
+	"			if(err<tolerance*(1.0/32.0))\n"
+	"				h=min(h*2.0,dt);\n"
+	"			}\n"
+	"		else\n"
+	"			h=max(hs*0.5,minH);\n"
+	"		}\n"
+	"	return p;\n"
+	"	}\n"
+	};
+
+/* Declarations shared by all step programs: */
+const char* stepHeaderSource=
+	"#version 430\n"
+	"layout(local_size_x=256) in;\n"
+	"layout(std430,binding=0) buffer PositionBuffer { vec4 positions[]; }; // Particle positions in xyz, expiry times in w\n"
+	"uniform float currentTime;\n"
+	"uniform float timeStep;\n"
+	"uniform int numSteps;\n"
+	"uniform int numSubsteps;\n"
+	"uniform uint numParticles;\n"
+	"uniform float parameters[6];\n"
+	"uniform float tolerance;\n"
+	"uniform int maxSubsteps;\n";
+
+/* Main function of all step programs: */
+const char* stepMainSource=
+	"void main()\n"
+	"	{\n"
+	"	uint index=gl_GlobalInvocationID.x;\n"
+	"	if(index>=numParticles)\n"
+	"		return;\n"
+	"	\n"
+	"	/* Skip expired particles: */\n"
+	"	vec4 pe=positions[index];\n"
+	"	if(pe.w<=currentTime)\n"
+	"		return;\n"
+	"	\n"
+	"	/* Advance the particle: */\n"
+	"	vec3 p=pe.xyz;\n"
+	"	for(int stepIndex=0;stepIndex<numSteps*numSubsteps;++stepIndex)\n"
+	"		p=integrate(p,timeStep);\n"
+	"	positions[index]=vec4(p,pe.w);\n"
+	"	}\n";
+
+/* Names of the step program's uniform variables, in the order of DataItem::stepUniforms: */
+const char* stepUniformNames[8]=
+	{
+	"currentTime","timeStep","numSteps","numSubsteps","numParticles","parameters","tolerance","maxSubsteps"
+	};
+
+/* Shaders drawing live particles straight from the storage buffers, fading them by age; expired particles are moved outside the view volume: */
+const char* renderVertexSource=
+	"attribute vec4 positionExpiry;\n"
+	"attribute vec4 color;\n"
+	"uniform float lifespan;\n"
+	"varying vec4 particleColor;\n"
+	"void main()\n"
+	"	{\n"
+	"	if(positionExpiry.w>currentTime)\n"
+	"		gl_Position=gl_ModelViewProjectionMatrix*vec4(positionExpiry.xyz,1.0);\n"
+	"	else\n"
+	"		gl_Position=vec4(2.0,2.0,2.0,1.0);\n"
+	"	float age=particleAge(positionExpiry.w-lifespan,lifespan);\n"
+	"	particleColor=agedColor(color,age);\n"
+	"	gl_PointSize=agedPointSize(age);\n"
+	"	}\n";
+
+const char* renderFragmentSource=
+	"#version 120\n"
+	"varying vec4 particleColor;\n"
+	"void main()\n"
+	"	{\n"
+	"	gl_FragColor=particleColor;\n"
+	"	}\n";
+
+const char* renderAttributeNames[2]=
+	{
+	"positionExpiry","color"
+	};
+
+/* Names of the render program's uniform variables, in the order of DataItem::renderUniforms: */
+const char* renderUniformNames[3]=
+	{
+	"currentTime","pointSize","lifespan"
+	};
+
+}
+
+/**********************************************
+Methods of class GPUParticleEngine::DataItem:
+**********************************************/
+
+GPUParticleEngine::DataItem::DataItem(double stepInterval,unsigned int maxCatchUpSteps)
+	:supported(GLExtensionManager::isExtensionSupported("GL_ARB_compute_shader")&&GLExtensionManager::isExtensionSupported("GL_ARB_shader_storage_buffer_object")),
+	 stepProgram(0),renderProgram(0),
+	 frameTime(0.0),clock(stepInterval,maxCatchUpSteps),seedBatch(0),numUploadedSeeds(0)
+	{
+	bufferIds[0]=bufferIds[1]=0;
+	if(supported)
+		glGenBuffers(2,bufferIds);
+	}
+
+GPUParticleEngine::DataItem::~DataItem(void)
+	{
+	if(bufferIds[0]!=0)
+		glDeleteBuffers(2,bufferIds);
+	if(stepProgram!=0)
+		glDeleteProgram(stepProgram);
+	if(renderProgram!=0)
+		glDeleteProgram(renderProgram);
+	}
+
+/**********************************
+Methods of class GPUParticleEngine:
+**********************************/
+
+void GPUParticleEngine::uploadSeeds(GPUParticleEngine::DataItem* dataItem) const
+	{
+	/* Start over if the context holds an older batch, or continue after the seeds it already holds: */
+	if(dataItem->seedBatch!=seedBatch)
+		dataItem->numUploadedSeeds=0;
+	size_t numSeeds=seedColors.size();
+	size_t seed=dataItem->numUploadedSeeds;
+	size_t slot=seedSlot+seed;
+	if(slot>=capacity)
+		slot-=capacity;
+
+	/* Write the seeds in up to two runs, as they can wrap around the end of the slot ring: */
+	while(seed<numSeeds)
+		{
+		size_t runLength=numSeeds-seed<capacity-slot?numSeeds-seed:capacity-slot;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER,dataItem->bufferIds[0]);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER,slot*4*sizeof(GLfloat),runLength*4*sizeof(GLfloat),&seedPositions[seed*4]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER,dataItem->bufferIds[1]);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER,slot*sizeof(GLuint),runLength*sizeof(GLuint),&seedColors[seed]);
+		seed+=runLength;
+		slot=0;
+		}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER,0);
+	dataItem->seedBatch=seedBatch;
+	dataItem->numUploadedSeeds=numSeeds;
+	}
+
+void GPUParticleEngine::stepParticles(GPUParticleEngine::DataItem* dataItem) const
+	{
+	/* Calculate the number of steps due since the last frame: */
+	unsigned int numSteps=dataItem->clock.update(frameTime);
+	if(numSteps==0||numUsedSlots==0)
+		return;
+	
+	/* Run the step program over all slots that ever received a particle: */
+	glUseProgram(dataItem->stepProgram);
+	glUniform1f(dataItem->stepUniforms[0],GLfloat(frameTime));
+	glUniform1f(dataItem->stepUniforms[1],stepParameters.timeStep/GLfloat(stepParameters.numSubsteps));
+	glUniform1i(dataItem->stepUniforms[2],GLint(numSteps));
+	glUniform1i(dataItem->stepUniforms[3],GLint(stepParameters.numSubsteps));
+	glUniform1ui(dataItem->stepUniforms[4],GLuint(numUsedSlots));
+	glUniform1fv(dataItem->stepUniforms[5],AttractorSystems::maxNumParameters,stepParameters.systemParameters);
+	glUniform1f(dataItem->stepUniforms[6],stepParameters.tolerance);
+	glUniform1i(dataItem->stepUniforms[7],GLint(stepParameters.maxSubsteps));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER,0,dataItem->bufferIds[0]);
+	glDispatchCompute(GLuint((numUsedSlots+workGroupSize-1)/workGroupSize),1,1);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER,0,0);
+	glUseProgram(0);
+
+	/* Make the step's results visible to vertex fetches and the next step: */
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT|GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+GPUParticleEngine::GPUParticleEngine(const ParticleKernels::StepParameters& sStepParameters,size_t sCapacity,float sLifespan,double sStepInterval,unsigned int sMaxCatchUpSteps)
+	:stepParameters(sStepParameters),
+	 capacity(sCapacity>0?sCapacity:1),
+	 lifespan(sLifespan),
+	 stepInterval(sStepInterval),maxCatchUpSteps(sMaxCatchUpSteps),
+	 frameTime(0.0),
+	 seedSlot(0),seedBatch(1),numContexts(0),numSyncedContexts(0),
+	 nextSlot(0),numUsedSlots(0)
+	{
+	}
+
+void GPUParticleEngine::initContext(GLContextData& contextData) const
+	{
+	DataItem* dataItem=new DataItem(stepInterval,maxCatchUpSteps);
+	contextData.addDataItem(this,dataItem);
+
+	if(!dataItem->supported)
+		{
+		std::cerr<<"GPUParticleEngine: OpenGL context does not support compute shaders; particles will not be shown"<<std::endl;
+		return;
+		}
+
+	/* Allocate the storage buffers; zeroed expiry times mark all slots as empty: */
+	std::vector<GLfloat> zeroPositions(capacity*4,0.0f);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER,dataItem->bufferIds[0]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,capacity*4*sizeof(GLfloat),zeroPositions.data(),GL_DYNAMIC_DRAW);
+	std::vector<GLuint> zeroColors(capacity,0U);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER,dataItem->bufferIds[1]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,capacity*sizeof(GLuint),zeroColors.data(),GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER,0);
+
+	try
+		{
+		/* Assemble and compile the step program for the selected system and integrator: */
+		std::string stepSource=stepHeaderSource;
+		stepSource.append(systemSources[stepParameters.system]);
+		stepSource.append(integratorSources[stepParameters.integrator]);
+		stepSource.append(stepMainSource);
+		dataItem->stepProgram=ShaderHelpers::createComputeProgram(stepSource.c_str());
+		for(int i=0;i<8;++i)
+			dataItem->stepUniforms[i]=glGetUniformLocation(dataItem->stepProgram,stepUniformNames[i]);
+
+		/* Compile the render program with the shared particle appearance functions: */
+		std::string vertexSource="#version 120\n";
+		vertexSource.append(ParticleAppearance::getShaderSource());
+		vertexSource.append(renderVertexSource);
+		dataItem->renderProgram=ShaderHelpers::createRenderProgram(vertexSource.c_str(),renderFragmentSource,renderAttributeNames,2);
+		for(int i=0;i<3;++i)
+			dataItem->renderUniforms[i]=glGetUniformLocation(dataItem->renderProgram,renderUniformNames[i]);
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"GPUParticleEngine: "<<err.what()<<"; particles will not be shown"<<std::endl;
+		dataItem->supported=false;
+		}
+	if(dataItem->supported)
+		++numContexts;
+
+	/* Start the context's simulation clock at the current frame: */
+	dataItem->frameTime=frameTime;
+	dataItem->clock.reset(frameTime);
+	}
+
+void GPUParticleEngine::startFrame(double newFrameTime)
+	{
+	frameTime=newFrameTime;
+
+	/* Start a new seed batch once all contexts have uploaded the current one; otherwise, keep adding to it, so that contexts that did not display do not miss any seeds: */
+	if(numSyncedContexts.load()>=numContexts.load())
+		{
+		seedPositions.clear();
+		seedColors.clear();
+		seedSlot=nextSlot;
+		++seedBatch;
+		}
+	numSyncedContexts.store(0);
+	}
+
+void GPUParticleEngine::addParticle(const float position[3],const unsigned char color[4],float expiryTime)
+	{
+	/* Drop seeds that would overwrite particles seeded in the same batch: */
+	if(seedColors.size()>=capacity)
+		return;
+
+	for(int i=0;i<3;++i)
+		seedPositions.push_back(position[i]);
+	seedPositions.push_back(expiryTime);
+	GLuint packedColor;
+	memcpy(&packedColor,color,sizeof(GLuint)); // Keeps the byte order expected by the ubyte vertex attribute
+	seedColors.push_back(packedColor);
+
+	/* Advance around the slot ring: */
+	if(++nextSlot==capacity)
+		nextSlot=0;
+	if(numUsedSlots<capacity)
+		++numUsedSlots;
+	}
+
+void GPUParticleEngine::display(GLContextData& contextData) const
+	{
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	if(!dataItem->supported)
+		return;
+
+	/* Update the context's particles once per frame, no matter how many times it is rendered: */
+	if(dataItem->frameTime!=frameTime)
+		{
+		dataItem->frameTime=frameTime;
+
+		/* Write the seeds this context does not hold yet into their slots: */
+		if(dataItem->seedBatch!=seedBatch||dataItem->numUploadedSeeds<seedColors.size())
+			uploadSeeds(dataItem);
+		++numSyncedContexts;
+
+		stepParticles(dataItem);
+		}
+
+	if(numUsedSlots==0)
+		return;
+
+	/* Draw all used slots directly from the storage buffers: */
+	glUseProgram(dataItem->renderProgram);
+	glUniform1f(dataItem->renderUniforms[0],GLfloat(frameTime));
+	glUniform1f(dataItem->renderUniforms[1],ParticleAppearance::defaultPointSize);
+	glUniform1f(dataItem->renderUniforms[2],lifespan);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->bufferIds[0]);
+	glVertexAttribPointer(0,4,GL_FLOAT,GL_FALSE,0,0);
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->bufferIds[1]);
+	glVertexAttribPointer(1,4,GL_UNSIGNED_BYTE,GL_TRUE,0,0);
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+	glDrawArrays(GL_POINTS,0,GLsizei(numUsedSlots));
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	glUseProgram(0);
+	}
@@ -0,0 +1,98 @@
+/***********************************************************************
+GPUParticleEngine - Alternative particle engine keeping all particle
+state in shader storage buffers on the GPU, and advancing particles along
+the selected ODE system with a compute shader. The CPU only seeds new
+particles, which are written into a ring of slots in the storage buffers
+once per frame; as all particles share the same lifespan, the slot
+reused next always holds the oldest particle. The storage buffers double
+as vertex buffers, so particle state never crosses the bus after
+seeding.
+Requires OpenGL 4.3 or the GL_ARB_compute_shader and
+GL_ARB_shader_storage_buffer_object extensions.
+***********************************************************************/
+
+#ifndef GPUPARTICLEENGINE_INCLUDED
+#define GPUPARTICLEENGINE_INCLUDED
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+
+#include "ParticleKernels.h"
+#include "SimulationClock.h"
+
+/* Forward declarations: */
+class GLContextData;
+
+class GPUParticleEngine:public GLObject
+	{
+	/* Embedded classes: */
+	private:
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elements: */
+		public:
+		bool supported; // Flag whether the context supports compute shaders and shader storage buffers
+		GLuint bufferIds[2]; // IDs of the position/expiry time and packed color storage buffers
+		GLuint stepProgram; // Compute shader program advancing particles
+		GLint stepUniforms[8]; // Locations of the step program's uniform variables
+		GLuint renderProgram; // Shader program drawing live particles directly from the storage buffers
+		GLint renderUniforms[3]; // Locations of the render program's uniform variables
+		double frameTime; // Application time of the last frame in which this context advanced its particles
+		SimulationClock clock; // Fixed-timestep clock scheduling this context's steps
+		unsigned int seedBatch; // Index of the last seed batch uploaded into this context's storage buffers
+		size_t numUploadedSeeds; // Number of seeds of that batch already uploaded into this context's storage buffers
+
+		/* Constructors and destructors: */
+		DataItem(double stepInterval,unsigned int maxCatchUpSteps);
+		virtual ~DataItem(void);
+		};
+
+	/* Elements: */
+	ParticleKernels::StepParameters stepParameters; // ODE system, parameters, integrator, and time step of the simulation
+	size_t capacity; // Number of particle slots in the storage buffers
+	float lifespan; // Lifespan shared by all particles; the ring of slots relies on all particles living equally long
+	double stepInterval; // Application time between simulation steps
+	unsigned int maxCatchUpSteps; // Maximum number of steps taken in a single frame; slower frames slow down the simulation
+	double frameTime; // Application time of the current frame
+	std::vector<GLfloat> seedPositions; // Positions and expiry times of particles seeded during the current frame, as x, y, z, expiry quadruples
+	std::vector<GLuint> seedColors; // Packed RGBA colors of particles seeded during the current frame
+	size_t seedSlot; // Slot receiving the first particle of the current seed batch
+	unsigned int seedBatch; // Index of the current seed batch
+	mutable std::atomic<unsigned int> numContexts; // Number of contexts supporting the engine, all of which must upload every seed batch
+	mutable std::atomic<unsigned int> numSyncedContexts; // Number of contexts that have uploaded all seeds of the current batch during the current frame
+	size_t nextSlot; // Slot receiving the next seeded particle
+	size_t numUsedSlots; // Number of slots that have ever received a particle
+
+	/* Private methods: */
+	void uploadSeeds(DataItem* dataItem) const; // Writes the seeds of the current batch not yet uploaded into the given context's storage buffers
+	void stepParticles(DataItem* dataItem) const; // Advances the given context's particles up to the current frame time
+
+	/* Constructors and destructors: */
+	public:
+	GPUParticleEngine(const ParticleKernels::StepParameters& sStepParameters,size_t sCapacity,float sLifespan,double sStepInterval,unsigned int sMaxCatchUpSteps); // Creates an engine with the given simulation parameters, particle capacity, particle lifespan, step interval, and catch-up limit
+
+	/* Methods from GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+
+	/* New methods: */
+	size_t getCapacity(void) const // Returns the number of particle slots
+		{
+		return capacity;
+		}
+	size_t getNumUsedSlots(void) const // Returns the number of slots that have ever received a particle; an upper bound for the number of live particles
+		{
+		return numUsedSlots;
+		}
+	static size_t getSeedSize(void) // Returns the number of bytes uploaded to the GPU per seeded particle
+		{
+		return 4*sizeof(GLfloat)+sizeof(GLuint);
+		}
+	void startFrame(double newFrameTime); // Starts a new frame at the given application time; must be called before any particles are seeded for the frame
+	void addParticle(const float position[3],const unsigned char color[4],float expiryTime); // Seeds a particle; overwrites the oldest particle once all slots are in use
+	void display(GLContextData& contextData) const; // Advances the context's particles once per frame and draws all live particles as points
+	};
+
+#endif
@@ -0,0 +1,79 @@
+/***********************************************************************
+GPUTimer - Per-context ring of OpenGL timer queries measuring how long
+the GPU spends on a bracketed sequence of commands. Results are read
+back several frames later, once they are available, so timing never
+stalls the pipeline; if all queries are still in flight, a frame is
+simply not timed. Finished measurements are handed to a Profiler as GPU
+zones.
+Requires OpenGL 3.3 or the GL_ARB_timer_query extension.
+***********************************************************************/
+
+#include "GPUTimer.h"
+
+#include <GL/glext.h>
+#include <GL/GLExtensionManager.h>
+
+#include "SimulationClock.h"
+
+/*************************
+Methods of class GPUTimer:
+*************************/
+
+GPUTimer::GPUTimer(void)
+	:supported(GLExtensionManager::isExtensionSupported("GL_ARB_timer_query")),
+	 head(0),numPending(0),running(false)
+	{
+	for(int i=0;i<numQueries;++i)
+		{
+		queryIds[i]=0;
+		issueTimes[i]=0.0;
+		}
+	if(supported)
+		glGenQueries(numQueries,queryIds);
+	}
+
+GPUTimer::~GPUTimer(void)
+	{
+	if(supported)
+		glDeleteQueries(numQueries,queryIds);
+	}
+
+void GPUTimer::collect(Profiler& profiler,Profiler::ZoneId zone)
+	{
+	/* Read back finished queries in the order in which they were issued: */
+	while(numPending>0)
+		{
+		GLint available=0;
+		glGetQueryObjectiv(queryIds[head],GL_QUERY_RESULT_AVAILABLE,&available);
+		if(!available)
+			break;
+
+		GLuint64 elapsed=0;
+		glGetQueryObjectui64v(queryIds[head],GL_QUERY_RESULT,&elapsed);
+		profiler.recordGpuZone(zone,issueTimes[head],double(elapsed)*1.0e-9);
+		head=(head+1)%numQueries;
+		--numPending;
+		}
+	}
+
+void GPUTimer::start(void)
+	{
+	/* Skip timing if all queries are still in flight: */
+	if(!supported||numPending==numQueries)
+		return;
+
+	int index=(head+numPending)%numQueries;
+	issueTimes[index]=SimulationClock::getWallTime();
+	glBeginQuery(GL_TIME_ELAPSED,queryIds[index]);
+	running=true;
+	}
+
+void GPUTimer::stop(void)
+	{
+	if(!running)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	++numPending;
+	running=false;
+	}
@@ -0,0 +1,52 @@
+/***********************************************************************
+GPUTimer - Per-context ring of OpenGL timer queries measuring how long
+the GPU spends on a bracketed sequence of commands. Results are read
+back several frames later, once they are available, so timing never
+stalls the pipeline; if all queries are still in flight, a frame is
+simply not timed. Finished measurements are handed to a Profiler as GPU
+zones.
+Requires OpenGL 3.3 or the GL_ARB_timer_query extension.
+***********************************************************************/
+
+#ifndef GPUTIMER_INCLUDED
+#define GPUTIMER_INCLUDED
+
+#include <GL/gl.h>
+
+#include "Profiler.h"
+
+class GPUTimer
+	{
+	/* Embedded classes: */
+	public:
+	static const int numQueries=4; // Number of queries that can be in flight at once
+
+	/* Elements: */
+	private:
+	bool supported; // Flag whether the current context supports timer queries
+	GLuint queryIds[numQueries]; // IDs of the timer query objects
+	double issueTimes[numQueries]; // Wall-clock times at which the in-flight queries were started
+	int head; // Index of the oldest in-flight query
+	int numPending; // Number of in-flight queries
+	bool running; // Flag whether a query is currently bracketing commands
+
+	/* Private methods: */
+	GPUTimer(const GPUTimer& source); // Prohibit copy constructor
+	GPUTimer& operator=(const GPUTimer& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	GPUTimer(void); // Creates timer queries in the current OpenGL context
+	~GPUTimer(void);
+
+	/* Methods: */
+	bool isSupported(void) const // Returns true if the current context supports timer queries
+		{
+		return supported;
+		}
+	void collect(Profiler& profiler,Profiler::ZoneId zone); // Hands all finished measurements to the given profiler as occurrences of the given zone
+	void start(void); // Starts timing subsequent commands if a query is free
+	void stop(void); // Stops timing commands
+	};
+
+#endif
@@ -0,0 +1,40 @@
+/***********************************************************************
+Integrators - Policy classes advancing a three-dimensional state along
+an ODE system by one time step. Integrators are templates over the
+system functor and the value type, so that each combination of system
+and integrator compiles to a single inlined, vectorized loop body.
+***********************************************************************/
+
+#include "Integrators.h"
+
+#include <strings.h>
+
+namespace Integrators {
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const char* integratorNames[NUM_INTEGRATORS]=
+	{
+	"Euler","RK4","DormandPrince"
+	};
+
+}
+
+const char* getIntegratorName(IntegratorType integrator)
+	{
+	return integratorNames[integrator];
+	}
+
+IntegratorType findIntegrator(const char* name)
+	{
+	for(int i=0;i<NUM_INTEGRATORS;++i)
+		if(strcasecmp(name,integratorNames[i])==0)
+			return IntegratorType(i);
+	return NUM_INTEGRATORS;
+	}
+
+}
@@ -0,0 +1,167 @@
+/***********************************************************************
+Integrators - Policy classes advancing a three-dimensional state along
+an ODE system by one time step. Integrators are templates over the
+system functor and the value type, so that each combination of system
+and integrator compiles to a single inlined, vectorized loop body. Time
+steps and coefficients are passed in double precision and rounded once
+to the value type, so that double-precision states keep their accuracy.
+***********************************************************************/
+
+#ifndef INTEGRATORS_INCLUDED
+#define INTEGRATORS_INCLUDED
+
+namespace Integrators {
+
+enum IntegratorType // Enumerated type for supported integrators
+	{
+	EULER=0,RK4,DORMANDPRINCE,
+	NUM_INTEGRATORS
+	};
+
+const char* getIntegratorName(IntegratorType integrator); // Returns the name of the given integrator
+IntegratorType findIntegrator(const char* name); // Returns the integrator of the given name (case-insensitive), or NUM_INTEGRATORS if there is none
+
+class Euler // Explicit first-order Euler method
+	{
+	/* Methods: */
+	public:
+	template <class SystemParam,class ValueParam>
+	void step(const SystemParam& system,ValueParam p[3],double dt) const
+		{
+		ValueParam d[3];
+		system(p,d);
+		ValueParam dtv(dt);
+		for(int i=0;i<3;++i)
+			p[i]=fma(d[i],dtv,p[i]);
+		}
+	};
+
+class RungeKutta4 // Classical fourth-order Runge-Kutta method
+	{
+	/* Methods: */
+	public:
+	template <class SystemParam,class ValueParam>
+	void step(const SystemParam& system,ValueParam p[3],double dt) const
+		{
+		ValueParam halfDt(dt*0.5);
+		ValueParam dtv(dt);
+		ValueParam k1[3],k2[3],k3[3],k4[3],q[3];
+
+		system(p,k1);
+		for(int i=0;i<3;++i)
+			q[i]=fma(k1[i],halfDt,p[i]);
+		system(q,k2);
+		for(int i=0;i<3;++i)
+			q[i]=fma(k2[i],halfDt,p[i]);
+		system(q,k3);
+		for(int i=0;i<3;++i)
+			q[i]=fma(k3[i],dtv,p[i]);
+		system(q,k4);
+
+		ValueParam sixthDt(dt/6.0);
+		ValueParam two(2.0f);
+		for(int i=0;i<3;++i)
+			p[i]=fma(k1[i]+two*(k2[i]+k3[i])+k4[i],sixthDt,p[i]);
+		}
+	};
+
+class DormandPrince // Adaptive fifth-order Dormand-Prince method with embedded fourth-order error estimate
+	{
+	/* Elements: */
+	public:
+	float tolerance; // Maximum absolute local error per substep
+	unsigned int maxSubsteps; // Maximum number of adaptive trial substeps per step; each lane's step size shrinks no further than dt/2^maxSubsteps, and a lane that has not covered the full step after that many trials finishes it with one unchecked substep
+
+	/* Constructors and destructors: */
+	DormandPrince(float sTolerance,unsigned int sMaxSubsteps)
+		:tolerance(sTolerance),maxSubsteps(sMaxSubsteps)
+		{
+		}
+
+	/* Methods: */
+	template <class SystemParam,class ValueParam>
+	void step(const SystemParam& system,ValueParam p[3],double dt) const
+		{
+		/* Butcher tableau of the Dormand-Prince 5(4) pair: */
+		static const double a21=1.0/5.0;
+		static const double a31=3.0/40.0,a32=9.0/40.0;
+		static const double a41=44.0/45.0,a42=-56.0/15.0,a43=32.0/9.0;
+		static const double a51=19372.0/6561.0,a52=-25360.0/2187.0,a53=64448.0/6561.0,a54=-212.0/729.0;
+		static const double a61=9017.0/3168.0,a62=-355.0/33.0,a63=46732.0/5247.0,a64=49.0/176.0,a65=-5103.0/18656.0;
+		static const double b1=35.0/384.0,b3=500.0/1113.0,b4=125.0/192.0,b5=-2187.0/6784.0,b6=11.0/84.0;
+		static const double e1=71.0/57600.0,e3=-71.0/16695.0,e4=71.0/1920.0,e5=-17253.0/339200.0,e6=22.0/525.0,e7=-1.0/40.0;
+
+		/*******************************************************************
+		Each lane advances independently until it has covered the full time
+		step. Rejected substeps halve a lane's step size; substeps whose
+		error is below 1/32 of the tolerance, where a fifth-order method
+		would stay within tolerance at twice the size, double it again.
+		After maxSubsteps trials, lanes that still have time left cover it
+		in one forced substep, so that no particle falls behind the clock.
+		*******************************************************************/
+
+		ValueParam zero(0.0f);
+		ValueParam doneThreshold(dt*1.0e-4); // Remaining time below which a lane counts as done, absorbing rounding errors
+		ValueParam tol(tolerance);
+		ValueParam smallTol(tolerance*(1.0f/32.0f));
+		ValueParam fullDt(dt);
+		ValueParam minH(dt/double(1U<<(maxSubsteps<20?maxSubsteps:20)));
+		ValueParam remaining(dt);
+		ValueParam h(dt);
+
+		ValueParam k1[3],k2[3],k3[3],k4[3],k5[3],k6[3],k7[3],q[3],y5[3];
+		system(p,k1);
+		for(unsigned int substep=0;;++substep)
+			{
+			/* Stop once all lanes have covered the time step: */
+			auto active=doneThreshold<remaining;
+			if(!any(active))
+				break;
+
+			/* Clamp the trial step size to the remaining time, or cover all of it once the trials are used up: */
+			bool forced=substep>=maxSubsteps;
+			ValueParam hs=forced?remaining:min(h,remaining);
+
+			/* Evaluate the stages: */
+			for(int i=0;i<3;++i)
+				q[i]=p[i]+hs*(ValueParam(a21)*k1[i]);
+			system(q,k2);
+			for(int i=0;i<3;++i)
+				q[i]=p[i]+hs*(ValueParam(a31)*k1[i]+ValueParam(a32)*k2[i]);
+			system(q,k3);
+			for(int i=0;i<3;++i)
+				q[i]=p[i]+hs*(ValueParam(a41)*k1[i]+ValueParam(a42)*k2[i]+ValueParam(a43)*k3[i]);
+			system(q,k4);
+			for(int i=0;i<3;++i)
+				q[i]=p[i]+hs*(ValueParam(a51)*k1[i]+ValueParam(a52)*k2[i]+ValueParam(a53)*k3[i]+ValueParam(a54)*k4[i]);
+			system(q,k5);
+			for(int i=0;i<3;++i)
+				q[i]=p[i]+hs*(ValueParam(a61)*k1[i]+ValueParam(a62)*k2[i]+ValueParam(a63)*k3[i]+ValueParam(a64)*k4[i]+ValueParam(a65)*k5[i]);
+			system(q,k6);
+			for(int i=0;i<3;++i)
+				y5[i]=p[i]+hs*(ValueParam(b1)*k1[i]+ValueParam(b3)*k3[i]+ValueParam(b4)*k4[i]+ValueParam(b5)*k5[i]+ValueParam(b6)*k6[i]);
+			system(y5,k7);
+
+			/* Estimate the local error as the maximum difference between the fifth- and fourth-order solutions: */
+			ValueParam err=zero;
+			for(int i=0;i<3;++i)
+				err=max(err,abs(hs*(ValueParam(e1)*k1[i]+ValueParam(e3)*k3[i]+ValueParam(e4)*k4[i]+ValueParam(e5)*k5[i]+ValueParam(e6)*k6[i]+ValueParam(e7)*k7[i])));
+
+			/* Accept substeps within tolerance, at the minimum step size, or forced, to guarantee progress: */
+			auto accept=forced?active:active&((err<=tol)|(hs<=minH));
+			for(int i=0;i<3;++i)
+				{
+				p[i]=select(accept,y5[i],p[i]);
+				k1[i]=select(accept,k7[i],k1[i]); // First stage of the next substep is the last stage of this one
+				}
+			remaining=select(accept,remaining-hs,remaining);
+
+			/* Adapt the step sizes: */
+			h=select(andNot(active,accept),max(hs*ValueParam(0.5f),minH),select(accept&(err<smallTol),min(h*ValueParam(2.0f),fullDt),h));
+			}
+		}
+	};
+
+}
+
+#endif
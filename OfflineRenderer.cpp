@@ -0,0 +1,540 @@
+/***********************************************************************
+OfflineRenderer - Headless batch renderer producing high-resolution
+frames of a particle simulation without Vrui or a window, for
+publications and videos. It drives the CPU simulation engine from the
+simulation library and draws every frame with a CPU splat rasterizer at
+any resolution and number of samples per particle. Simulation,
+rasterization, and writing run in three threads connected by bounded
+frame queues, so that the three stages of consecutive frames overlap,
+and frames are written as binary PPM images, either one file per frame
+or as one stream that can be piped into a video encoder.
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <atomic>
+#include <limits>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+#include <Threads/Thread.h>
+
+#include "AttractorSystems.h"
+#include "Integrators.h"
+#include "ParticleKernels.h"
+#include "ParticleSimulator.h"
+#include "SimulationSettings.h"
+#include "SimulationClock.h"
+#include "SeedQueue.h"
+#include "CounterRandom.h"
+#include "WorkerPool.h"
+#include "FrameQueue.h"
+#include "SplatRasterizer.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct VertexFrame // Structure holding the render copy of the particles at the end of one frame
+	{
+	/* Elements: */
+	public:
+	unsigned int index; // Index of the frame
+	float time; // Simulation time at the end of the frame, against which particle ages are measured
+	size_t numVertices; // Number of particles in the frame
+	std::vector<SplatRasterizer::Vertex> vertices; // Interleaved particle vertices
+	};
+
+struct ImageFrame // Structure holding one tone-mapped frame
+	{
+	/* Elements: */
+	public:
+	unsigned int index; // Index of the frame
+	std::vector<unsigned char> pixels; // RGB pixels, row by row from the top
+	};
+
+class RenderPipeline // Class for the rasterization and writing stages of the pipeline, each running in its own thread
+	{
+	/* Elements: */
+	public:
+	SplatRasterizer rasterizer; // Rasterizer drawing the frames
+	FrameQueue<VertexFrame> vertexQueue; // Queue handing particle frames from the simulation to the rasterizer
+	FrameQueue<ImageFrame> imageQueue; // Queue handing tone-mapped frames from the rasterizer to the writer
+	float center[3]; // Point the camera looks at
+	float distance; // Distance from the camera to the center
+	float azimuth,elevation; // Camera direction of the first frame in radians
+	float orbit; // Change of the camera azimuth from one frame to the next in radians
+	float fov; // Vertical field of view in radians
+	const char* outputName; // Name pattern of the output files, or name of the output stream; "-" is standard output
+	bool oneFilePerFrame; // Flag whether the output name is a pattern receiving the frame index
+	FILE* stream; // Stream receiving all frames, if frames are not written to individual files
+	std::atomic<bool> writeError; // Flag whether writing a frame failed; later frames are discarded
+	double rasterTime; // Time spent rasterizing, excluding waits for the neighboring stages
+	double writeTime; // Time spent writing, excluding waits for the rasterizer
+	Threads::Thread rasterThread; // Thread rasterizing particle frames
+	Threads::Thread writerThread; // Thread writing tone-mapped frames
+
+	/* Private methods: */
+	private:
+	bool writeImage(FILE* file,const ImageFrame& frame); // Writes a frame as a binary PPM image to the given file
+	void* rasterThreadMethod(void); // Thread method rasterizing particle frames
+	void* writerThreadMethod(void); // Thread method writing tone-mapped frames
+
+	/* Constructors and destructors: */
+	public:
+	RenderPipeline(unsigned int width,unsigned int height,unsigned int numRasterThreads,unsigned int queueLength,size_t maxNumParticles,const char* sOutputName); // Creates the pipeline's stages for frames of the given size and particle count; throws std::runtime_error if the output stream cannot be opened
+	~RenderPipeline(void);
+
+	/* Methods: */
+	void start(void); // Starts the rasterization and writing threads
+	void finish(void); // Waits until all posted frames have been written and stops both threads
+	};
+
+/********************************
+Methods of class RenderPipeline:
+********************************/
+
+bool RenderPipeline::writeImage(FILE* file,const ImageFrame& frame)
+	{
+	if(fprintf(file,"P6\n%u %u\n255\n",rasterizer.getWidth(),rasterizer.getHeight())<0)
+		return false;
+	return fwrite(frame.pixels.data(),1,frame.pixels.size(),file)==frame.pixels.size();
+	}
+
+void* RenderPipeline::rasterThreadMethod(void)
+	{
+	VertexFrame* vertexFrame;
+	while((vertexFrame=vertexQueue.lockFrame())!=0)
+		{
+		/* Draw the particles from the camera position of this frame, and release them for the next simulated frame: */
+		double start=SimulationClock::getWallTime();
+		rasterizer.setView(center,distance,azimuth+orbit*float(vertexFrame->index),elevation,fov);
+		rasterizer.splat(vertexFrame->vertices.data(),vertexFrame->numVertices,vertexFrame->time);
+		unsigned int index=vertexFrame->index;
+		vertexQueue.releaseFrame(vertexFrame);
+		rasterTime+=SimulationClock::getWallTime()-start;
+
+		/* Tone-map the image into a free image frame and hand it to the writer: */
+		ImageFrame* imageFrame=imageQueue.startFrame();
+		start=SimulationClock::getWallTime();
+		imageFrame->index=index;
+		rasterizer.resolve(imageFrame->pixels.data());
+		rasterTime+=SimulationClock::getWallTime()-start;
+		imageQueue.postFrame(imageFrame);
+		}
+
+	/* Tell the writer that no more frames will follow: */
+	imageQueue.close();
+	return 0;
+	}
+
+void* RenderPipeline::writerThreadMethod(void)
+	{
+	ImageFrame* imageFrame;
+	while((imageFrame=imageQueue.lockFrame())!=0)
+		{
+		double start=SimulationClock::getWallTime();
+		if(!writeError.load())
+			{
+			bool ok;
+			if(oneFilePerFrame)
+				{
+				/* Write the frame into its own file: */
+				char fileName[1024];
+				snprintf(fileName,sizeof(fileName),outputName,imageFrame->index);
+				FILE* file=fopen(fileName,"wb");
+				ok=file!=0&&writeImage(file,*imageFrame);
+				if(file!=0&&fclose(file)!=0)
+					ok=false;
+				if(!ok)
+					std::cerr<<"OfflineRenderer: Unable to write frame file "<<fileName<<std::endl;
+				}
+			else
+				{
+				/* Append the frame to the output stream: */
+				ok=writeImage(stream,*imageFrame)&&fflush(stream)==0;
+				if(!ok)
+					std::cerr<<"OfflineRenderer: Unable to write frame "<<imageFrame->index<<" to "<<outputName<<std::endl;
+				}
+			if(!ok)
+				writeError.store(true);
+			}
+		imageQueue.releaseFrame(imageFrame);
+		writeTime+=SimulationClock::getWallTime()-start;
+		}
+	return 0;
+	}
+
+RenderPipeline::RenderPipeline(unsigned int width,unsigned int height,unsigned int numRasterThreads,unsigned int queueLength,size_t maxNumParticles,const char* sOutputName)
+	:rasterizer(width,height,numRasterThreads),
+	 vertexQueue(queueLength),imageQueue(queueLength),
+	 distance(1.0f),azimuth(0.0f),elevation(0.0f),orbit(0.0f),fov(0.7f),
+	 outputName(sOutputName),oneFilePerFrame(strchr(sOutputName,'%')!=0),stream(0),
+	 writeError(false),
+	 rasterTime(0.0),writeTime(0.0)
+	{
+	for(int j=0;j<3;++j)
+		center[j]=0.0f;
+
+	/* Allocate and touch all frames up front, so that page faults do not stall the pipeline: */
+	for(unsigned int i=0;i<vertexQueue.getNumFrames();++i)
+		vertexQueue.getFrame(i).vertices.resize(maxNumParticles);
+	for(unsigned int i=0;i<imageQueue.getNumFrames();++i)
+		imageQueue.getFrame(i).pixels.resize(rasterizer.getImageSize());
+
+	/* Open the output stream if all frames go into one: */
+	if(!oneFilePerFrame)
+		{
+		stream=strcmp(outputName,"-")==0?stdout:fopen(outputName,"wb");
+		if(stream==0)
+			throw std::runtime_error(std::string("OfflineRenderer: Unable to open output stream ")+outputName);
+		}
+	}
+
+RenderPipeline::~RenderPipeline(void)
+	{
+	if(stream!=0&&stream!=stdout)
+		fclose(stream);
+	}
+
+void RenderPipeline::start(void)
+	{
+	rasterThread.start(this,&RenderPipeline::rasterThreadMethod);
+	writerThread.start(this,&RenderPipeline::writerThreadMethod);
+	}
+
+void RenderPipeline::finish(void)
+	{
+	/* Drain the pipeline stage by stage: */
+	vertexQueue.close();
+	rasterThread.join();
+	writerThread.join();
+	}
+
+/****************
+Helper functions:
+****************/
+
+void refill(ParticleSimulator& simulator,size_t numParticles,const CounterRandom& random,float birthTime,float lifespan) // Seeds new particles until the simulator holds the given number of live particles
+	{
+	static const float seedCenter[3]={0.0f,0.0f,0.0f};
+	float seedRadius=AttractorSystems::getSystemInfo(simulator.getStepParameters().system).seedRadius;
+	float expiryTime=lifespan>0.0f?birthTime+lifespan:std::numeric_limits<float>::infinity();
+	SeedQueue::Seed seeds[4096];
+	while(simulator.getParticles().getNumParticles()<numParticles)
+		{
+		/* Draw each seed from the stream keyed by the id it will receive: */
+		size_t numSeeds=numParticles-simulator.getParticles().getNumParticles();
+		if(numSeeds>4096)
+			numSeeds=4096;
+		random.generateSeeds(simulator.getParticles().getNextId(),numSeeds,0,seedCenter,seedRadius,64,seeds);
+		if(simulator.addParticles(seeds,numSeeds,birthTime,expiryTime)==0)
+			break;
+		}
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Set up the default settings: */
+	ParticleKernels::StepParameters stepParameters;
+	float timeStepOverride=0.0f;
+	size_t numParticles=1000000;
+	float lifespan=0.0f;
+	bool highAccuracy=false;
+	const char* settingsFileName=0;
+	std::vector<std::pair<const char*,const char*> > settingOverrides;
+	unsigned int numCPUs=WorkerPool::getNumCPUs();
+	unsigned int numThreads=numCPUs>1?numCPUs/2:1;
+	unsigned int numRasterThreads=0;
+	size_t chunkSize=16384;
+	unsigned int width=7680;
+	unsigned int height=4320;
+	unsigned int numSamples=4;
+	float exposure=1.0f;
+	unsigned int numFrames=600;
+	unsigned int numStepsPerFrame=1;
+	unsigned int numWarmupSteps=600;
+	float frameRate=60.0f;
+	float azimuth=-75.0f;
+	float elevation=15.0f;
+	float orbit=0.0f;
+	float distance=3.0f;
+	float fov=40.0f;
+	unsigned int queueLength=3;
+	const char* outputName="frame%05u.ppm";
+	uint64_t randomSeed=0;
+
+	/* Parse the command line: */
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"system")==0&&i+1<argc)
+				{
+				++i;
+				AttractorSystems::SystemType system=AttractorSystems::findSystem(argv[i]);
+				if(system!=AttractorSystems::NUM_SYSTEMS)
+					stepParameters.setSystem(system);
+				else
+					std::cerr<<"OfflineRenderer: Unknown ODE system "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"integrator")==0&&i+1<argc)
+				{
+				++i;
+				Integrators::IntegratorType integrator=Integrators::findIntegrator(argv[i]);
+				if(integrator!=Integrators::NUM_INTEGRATORS)
+					stepParameters.integrator=integrator;
+				else
+					std::cerr<<"OfflineRenderer: Unknown integrator "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"timeStep")==0&&i+1<argc)
+				{
+				++i;
+				timeStepOverride=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"substeps")==0&&i+1<argc)
+				{
+				++i;
+				stepParameters.numSubsteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"particles")==0&&i+1<argc)
+				{
+				++i;
+				numParticles=size_t(atof(argv[i])+0.5);
+				}
+			else if(strcasecmp(argv[i]+1,"lifespan")==0&&i+1<argc)
+				{
+				++i;
+				lifespan=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"highAccuracy")==0)
+				highAccuracy=true;
+			else if(strcasecmp(argv[i]+1,"settings")==0&&i+1<argc)
+				{
+				++i;
+				settingsFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"set")==0&&i+2<argc)
+				{
+				settingOverrides.push_back(std::make_pair(argv[i+1],argv[i+2]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"numThreads")==0&&i+1<argc)
+				{
+				++i;
+				numThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"rasterThreads")==0&&i+1<argc)
+				{
+				++i;
+				numRasterThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"chunkSize")==0&&i+1<argc)
+				{
+				++i;
+				chunkSize=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"size")==0&&i+2<argc)
+				{
+				width=atoi(argv[i+1]);
+				height=atoi(argv[i+2]);
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"samples")==0&&i+1<argc)
+				{
+				++i;
+				numSamples=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"exposure")==0&&i+1<argc)
+				{
+				++i;
+				exposure=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"frames")==0&&i+1<argc)
+				{
+				++i;
+				numFrames=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"stepsPerFrame")==0&&i+1<argc)
+				{
+				++i;
+				numStepsPerFrame=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"warmup")==0&&i+1<argc)
+				{
+				++i;
+				numWarmupSteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"frameRate")==0&&i+1<argc)
+				{
+				++i;
+				frameRate=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"view")==0&&i+2<argc)
+				{
+				azimuth=atof(argv[i+1]);
+				elevation=atof(argv[i+2]);
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"orbit")==0&&i+1<argc)
+				{
+				++i;
+				orbit=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"distance")==0&&i+1<argc)
+				{
+				++i;
+				distance=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"fov")==0&&i+1<argc)
+				{
+				++i;
+				fov=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"queueLength")==0&&i+1<argc)
+				{
+				++i;
+				queueLength=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"output")==0&&i+1<argc)
+				{
+				++i;
+				outputName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"randomSeed")==0&&i+1<argc)
+				{
+				++i;
+				randomSeed=strtoull(argv[i],0,10);
+				}
+			else
+				std::cerr<<"OfflineRenderer: Ignoring unknown option "<<argv[i]<<std::endl;
+			}
+		}
+	if(timeStepOverride>0.0f)
+		stepParameters.timeStep=timeStepOverride;
+	if(stepParameters.numSubsteps<1)
+		stepParameters.numSubsteps=1;
+	if(numStepsPerFrame<1)
+		numStepsPerFrame=1;
+	if(frameRate<=0.0f)
+		frameRate=60.0f;
+	if(numRasterThreads==0)
+		numRasterThreads=numCPUs>numThreads?numCPUs-numThreads:1;
+
+	/* Start from the settings given by the options above, overridden by the settings file and then by individual settings; lifespans of 0 never expire: */
+	SimulationSettings settings(stepParameters,lifespan>0.0f?lifespan:std::numeric_limits<float>::infinity(),numParticles);
+	if(settingsFileName!=0)
+		{
+		try
+			{
+			settings.load(stepParameters.system,settingsFileName);
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"OfflineRenderer: "<<err.what()<<std::endl;
+			return 1;
+			}
+		}
+	for(std::vector<std::pair<const char*,const char*> >::iterator soIt=settingOverrides.begin();soIt!=settingOverrides.end();++soIt)
+		if(!settings.set(stepParameters.system,soIt->first,soIt->second))
+			std::cerr<<"OfflineRenderer: Ignoring invalid setting "<<soIt->first<<' '<<soIt->second<<std::endl;
+	settings.apply(stepParameters);
+	lifespan=settings.lifespan<std::numeric_limits<float>::infinity()?settings.lifespan:0.0f;
+	numParticles=settings.maxNumParticles;
+	if(numParticles<1)
+		numParticles=1;
+
+	try
+		{
+		/* Create the simulation and the pipeline stages behind it: */
+		ParticleSimulator simulator(stepParameters,numParticles,numThreads,chunkSize);
+		if(highAccuracy)
+			simulator.enableHighAccuracy();
+		RenderPipeline pipeline(width,height,numRasterThreads,queueLength,numParticles,outputName);
+		pipeline.rasterizer.setSampling(numSamples,exposure);
+		const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+		for(int j=0;j<3;++j)
+			pipeline.center[j]=si.densityCenter[j];
+		pipeline.distance=distance*si.densityRadius;
+		float degrees=Math::Constants<float>::pi/180.0f;
+		pipeline.azimuth=azimuth*degrees;
+		pipeline.elevation=elevation*degrees;
+		pipeline.orbit=orbit*degrees;
+		pipeline.fov=fov*degrees;
+
+		/* Seed all particles with staggered ages, so that they do not all expire at once: */
+		CounterRandom random(randomSeed);
+		float stepInterval=1.0f/(frameRate*float(numStepsPerFrame));
+		float time=0.0f;
+		if(lifespan>0.0f)
+			{
+			size_t numBatches=(numParticles+4095)/4096;
+			for(size_t batch=0;batch<numBatches;++batch)
+				refill(simulator,numParticles*(batch+1)/numBatches,random,-lifespan*float(batch)/float(numBatches),lifespan);
+			}
+		else
+			refill(simulator,numParticles,random,time,lifespan);
+
+		/* Let the particles settle onto the attractor before the first frame: */
+		std::cerr<<"OfflineRenderer: "<<si.name<<'/'<<Integrators::getIntegratorName(stepParameters.integrator)<<", "<<numParticles<<" particles, "<<numWarmupSteps<<" warmup steps"<<std::endl;
+		for(unsigned int step=0;step<numWarmupSteps;++step)
+			{
+			simulator.step(time,false);
+			time+=stepInterval;
+			simulator.compact();
+			refill(simulator,numParticles,random,time,lifespan);
+			}
+
+		/* Simulate all frames, handing each one to the rasterizer while simulating the next: */
+		std::cerr<<"OfflineRenderer: Rendering "<<numFrames<<" frames of "<<width<<'x'<<height<<" pixels with "<<numSamples<<" samples per particle on "<<numThreads<<"+"<<pipeline.rasterizer.getNumThreads()<<" threads"<<std::endl;
+		double start=SimulationClock::getWallTime();
+		double simulationTime=0.0;
+		pipeline.start();
+		for(unsigned int frame=0;frame<numFrames&&!pipeline.writeError.load();++frame)
+			{
+			double stepStart=SimulationClock::getWallTime();
+			for(unsigned int step=0;step<numStepsPerFrame;++step)
+				{
+				/* Only the last step's starting positions are needed for motion blur: */
+				simulator.step(time,step+1==numStepsPerFrame);
+				time+=stepInterval;
+				simulator.compact();
+				refill(simulator,numParticles,random,time,lifespan);
+				}
+			simulationTime+=SimulationClock::getWallTime()-stepStart;
+
+			/* Export the particles into a free frame, waiting for the rasterizer if it fell behind: */
+			VertexFrame* vertexFrame=pipeline.vertexQueue.startFrame();
+			stepStart=SimulationClock::getWallTime();
+			vertexFrame->index=frame;
+			vertexFrame->time=time;
+			vertexFrame->numVertices=simulator.getParticles().getNumParticles();
+			simulator.exportVertices(vertexFrame->vertices.data());
+			simulationTime+=SimulationClock::getWallTime()-stepStart;
+			pipeline.vertexQueue.postFrame(vertexFrame);
+			}
+		pipeline.finish();
+		double totalTime=SimulationClock::getWallTime()-start;
+
+		/* Report how busy each stage was; the slowest stage sets the frame rate: */
+		std::cerr<<"OfflineRenderer: "<<numFrames<<" frames in "<<totalTime<<" s ("<<double(numFrames)/totalTime<<" frames/s); busy time simulating "<<simulationTime<<" s, rasterizing "<<pipeline.rasterTime<<" s, writing "<<pipeline.writeTime<<" s"<<std::endl;
+		if(pipeline.writeError.load())
+			return 1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<err.what()<<std::endl;
+		return 1;
+		}
+
+	return 0;
+	}
@@ -0,0 +1,49 @@
+/***********************************************************************
+ParticleAppearance - GLSL functions shared by all particle render
+programs, which derive a particle's color and point size from its age.
+Particles carry their birth time and lifespan instead of having their
+colors rewritten on every step, and fade out over exactly one lifespan
+by draining their green, then red, then blue channels, while shrinking
+to half their initial point size.
+***********************************************************************/
+
+#include "ParticleAppearance.h"
+
+namespace ParticleAppearance {
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const char* shaderSource=
+	"uniform float currentTime;\n"
+	"uniform float pointSize;\n"
+	"float particleAge(float birthTime,float lifespan)\n"
+	"	{\n"
+	"	/* Return the fraction of the particle's lifespan that has passed: */\n"
+	"	return clamp((currentTime-birthTime)/lifespan,0.0,1.0);\n"
+	"	}\n"
+	"vec4 agedColor(vec4 color,float age)\n"
+	"	{\n"
+	"	/* Drain the color channels in order such that the particle turns black at the end of its lifespan: */\n"
+	"	float drain=age*(color.r+color.g+color.b);\n"
+	"	float dg=min(color.g,drain);\n"
+	"	float dr=min(color.r,drain-dg);\n"
+	"	float db=min(color.b,drain-dg-dr);\n"
+	"	return vec4(color.r-dr,color.g-dg,color.b-db,color.a);\n"
+	"	}\n"
+	"float agedPointSize(float age)\n"
+	"	{\n"
+	"	return pointSize*(1.0-0.5*age);\n"
+	"	}\n";
+
+}
+
+const char* getShaderSource(void)
+	{
+	return shaderSource;
+	}
+
+}
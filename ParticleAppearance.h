@@ -0,0 +1,20 @@
+/***********************************************************************
+ParticleAppearance - GLSL functions shared by all particle render
+programs, which derive a particle's color and point size from its age.
+Particles carry their birth time and lifespan instead of having their
+colors rewritten on every step, and fade out over exactly one lifespan
+by draining their green, then red, then blue channels, while shrinking
+to half their initial point size.
+***********************************************************************/
+
+#ifndef PARTICLEAPPEARANCE_INCLUDED
+#define PARTICLEAPPEARANCE_INCLUDED
+
+namespace ParticleAppearance {
+
+const char* getShaderSource(void); // Returns GLSL 1.20 source declaring the uniforms currentTime and pointSize, and the functions particleAge, agedColor, and agedPointSize
+const float defaultPointSize=3.0f; // Point size of newly seeded particles in pixels
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+/***********************************************************************
+ParticleArena - Allocator for the large, long-lived arrays of particle
+data: the particle store's attribute arrays and the render copies in the
+triple buffer's slots. Every block is mapped from the kernel as its own
+slab, aligned to and optionally backed by huge pages to cut TLB misses,
+and left untouched, so that its pages are placed on the NUMA node of the
+first thread writing to them instead of on that of the allocating
+thread. All blocks together are held under a hard memory cap.
+***********************************************************************/
+
+#include "ParticleArena.h"
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <stdexcept>
+
+/******************************
+Methods of class ParticleArena:
+******************************/
+
+ParticleArena::ParticleArena(size_t sMaxSize,bool sHugePages)
+	:maxSize(sMaxSize),hugePages(sHugePages),
+	 slabSize(size_t(sysconf(_SC_PAGESIZE))),
+	 usedSize(0),peakSize(0)
+	{
+	#ifdef MADV_HUGEPAGE
+	/* Align blocks to transparent huge pages, so that they can be backed by huge pages from their first byte: */
+	if(hugePages)
+		slabSize=size_t(2)<<20;
+	#else
+	hugePages=false;
+	#endif
+	}
+
+ParticleArena::~ParticleArena(void)
+	{
+	}
+
+void* ParticleArena::allocate(size_t size)
+	{
+	if(size==0)
+		return 0;
+	size_t blockSize=getBlockSize(size);
+
+	/* Charge the block against the memory cap: */
+	{
+	Threads::Mutex::Lock sizeLock(sizeMutex);
+	if(maxSize!=0&&blockSize>maxSize-usedSize)
+		throw std::runtime_error("ParticleArena: Allocation would exceed the memory cap");
+	usedSize+=blockSize;
+	if(peakSize<usedSize)
+		peakSize=usedSize;
+	}
+
+	/* Map enough pages to cut an aligned block out of them, and unmap the excess on either side: */
+	size_t mapSize=slabSize>size_t(sysconf(_SC_PAGESIZE))?blockSize+slabSize:blockSize;
+	void* map=mmap(0,mapSize,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	if(map==MAP_FAILED)
+		{
+		Threads::Mutex::Lock sizeLock(sizeMutex);
+		usedSize-=blockSize;
+		throw std::bad_alloc();
+		}
+	char* mapStart=static_cast<char*>(map);
+	char* block=reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(mapStart)+slabSize-1)/slabSize*slabSize);
+	if(block!=mapStart)
+		munmap(mapStart,block-mapStart);
+	if(block+blockSize!=mapStart+mapSize)
+		munmap(block+blockSize,(mapStart+mapSize)-(block+blockSize));
+
+	#ifdef MADV_HUGEPAGE
+	/* Ask the kernel to back the block by huge pages; it silently keeps small pages if it can not: */
+	if(hugePages)
+		madvise(block,blockSize,MADV_HUGEPAGE);
+	#endif
+
+	return block;
+	}
+
+void ParticleArena::release(void* block,size_t size)
+	{
+	if(block==0)
+		return;
+	size_t blockSize=getBlockSize(size);
+	munmap(block,blockSize);
+
+	Threads::Mutex::Lock sizeLock(sizeMutex);
+	usedSize-=blockSize;
+	}
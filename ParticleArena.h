@@ -0,0 +1,139 @@
+/***********************************************************************
+ParticleArena - Allocator for the large, long-lived arrays of particle
+data: the particle store's attribute arrays and the render copies in the
+triple buffer's slots. Every block is mapped from the kernel as its own
+slab, aligned to and optionally backed by huge pages to cut TLB misses,
+and left untouched, so that its pages are placed on the NUMA node of the
+first thread writing to them instead of on that of the allocating
+thread. All blocks together are held under a hard memory cap.
+***********************************************************************/
+
+#ifndef PARTICLEARENA_INCLUDED
+#define PARTICLEARENA_INCLUDED
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <Threads/Mutex.h>
+
+class ParticleArena
+	{
+	/* Embedded classes: */
+	public:
+	template <class ValueParam>
+	class Allocator // Standard allocator drawing from an arena, or from the heap if it has none; default-initializes elements, so that resizing a container does not touch its pages
+		{
+		/* Embedded classes: */
+		public:
+		typedef ValueParam value_type;
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+		template <class OtherValueParam>
+		struct rebind
+			{
+			/* Embedded classes: */
+			public:
+			typedef Allocator<OtherValueParam> other;
+			};
+
+		/* Elements: */
+		ParticleArena* arena; // Arena from which elements are allocated, or null
+
+		/* Constructors and destructors: */
+		Allocator(ParticleArena* sArena =0) // Creates an allocator for the given arena
+			:arena(sArena)
+			{
+			}
+		template <class OtherValueParam>
+		Allocator(const Allocator<OtherValueParam>& source) // Creates an allocator for the same arena as the given one
+			:arena(source.arena)
+			{
+			}
+
+		/* Methods: */
+		ValueParam* allocate(size_t numElements) // Allocates an array of the given number of elements
+			{
+			if(arena!=0)
+				return static_cast<ValueParam*>(arena->allocate(numElements*sizeof(ValueParam)));
+			else
+				return static_cast<ValueParam*>(::operator new(numElements*sizeof(ValueParam)));
+			}
+		void deallocate(ValueParam* elements,size_t numElements) // Releases an array allocated by an allocator for the same arena
+			{
+			if(arena!=0)
+				arena->release(elements,numElements*sizeof(ValueParam));
+			else
+				::operator delete(elements);
+			}
+		template <class ConstructParam>
+		void construct(ConstructParam* element) // Default-initializes an element, leaving plain data untouched
+			{
+			::new(static_cast<void*>(element)) ConstructParam;
+			}
+		template <class ConstructParam,class... ArgumentParams>
+		void construct(ConstructParam* element,ArgumentParams&&... arguments) // Constructs an element from the given arguments
+			{
+			::new(static_cast<void*>(element)) ConstructParam(std::forward<ArgumentParams>(arguments)...);
+			}
+		template <class OtherValueParam>
+		bool operator==(const Allocator<OtherValueParam>& other) const
+			{
+			return arena==other.arena;
+			}
+		template <class OtherValueParam>
+		bool operator!=(const Allocator<OtherValueParam>& other) const
+			{
+			return arena!=other.arena;
+			}
+		};
+
+	/* Elements: */
+	private:
+	size_t maxSize; // Hard cap on the total size of all blocks in bytes, or 0 for no cap
+	bool hugePages; // Flag whether blocks are backed by huge pages where the kernel allows it
+	size_t slabSize; // Granularity and alignment of blocks in bytes; the huge page size if blocks are backed by huge pages
+	Threads::Mutex sizeMutex; // Mutex serializing changes to the used size
+	size_t usedSize; // Total size of all allocated blocks in bytes
+	size_t peakSize; // Largest total size of all allocated blocks so far
+
+	/* Private methods: */
+	ParticleArena(const ParticleArena& source); // Prohibit copy constructor
+	ParticleArena& operator=(const ParticleArena& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	ParticleArena(size_t sMaxSize,bool sHugePages); // Creates an arena holding at most the given number of bytes, or any number if 0, with optional huge page backing
+	~ParticleArena(void);
+
+	/* Methods: */
+	size_t getMaxSize(void) const // Returns the memory cap in bytes, or 0 if there is none
+		{
+		return maxSize;
+		}
+	bool getHugePages(void) const // Returns true if blocks are backed by huge pages where the kernel allows it
+		{
+		return hugePages;
+		}
+	size_t getSlabSize(void) const // Returns the granularity of blocks in bytes
+		{
+		return slabSize;
+		}
+	size_t getBlockSize(size_t size) const // Returns the number of bytes taken up by a block of the given size
+		{
+		return (size+slabSize-1)/slabSize*slabSize;
+		}
+	size_t getUsedSize(void) const // Returns the total size of all allocated blocks in bytes
+		{
+		return usedSize;
+		}
+	size_t getPeakSize(void) const // Returns the largest total size of all allocated blocks so far in bytes
+		{
+		return peakSize;
+		}
+	void* allocate(size_t size); // Allocates a zero-filled block of at least the given size whose pages are not placed until first written; throws an exception if the block would exceed the memory cap
+	void release(void* block,size_t size); // Releases a block of the given size allocated from this arena
+	};
+
+#endif
@@ -0,0 +1,196 @@
+/***********************************************************************
+ParticleGrid - Uniform grid partitioning exported particle vertices by
+position, so that renderers can skip cells outside the view frustum and
+draw distant cells at reduced density. The simulation thread bins all
+particles into the grid's cells with a parallel counting sort while it
+exports their vertices, so that each cell's particles are contiguous in
+the vertex array and the grid costs no extra pass over particle state.
+Particles outside the grid's domain go into one overflow cell, which is
+always drawn in full.
+***********************************************************************/
+
+#include "ParticleGrid.h"
+
+#include <string.h>
+#include <math.h>
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+static const float cellMargin=0.25f; // Fraction of a cell's size by which cells are grown for culling, covering particles interpolated from positions outside their cell and the extent of point splats
+
+}
+
+/*****************************
+Methods of class ParticleGrid:
+*****************************/
+
+ParticleGrid::ParticleGrid(const float center[3],float radius,unsigned int sResolution)
+	:resolution(sResolution>0?sResolution:1)
+	{
+	for(int i=0;i<3;++i)
+		origin[i]=center[i]-radius;
+	cellSize=2.0f*radius/float(resolution);
+	cellScale=1.0f/cellSize;
+	numCells=size_t(resolution)*size_t(resolution)*size_t(resolution)+1;
+	}
+
+void ParticleGrid::reserve(size_t capacity,size_t maxNumChunks)
+	{
+	cellIndices.resize(capacity);
+	chunkOffsets.resize(maxNumChunks*numCells);
+	}
+
+void ParticleGrid::classify(size_t chunkIndex,const float* x,const float* y,const float* z,size_t begin,size_t end)
+	{
+	unsigned int* counts=chunkOffsets.data()+chunkIndex*numCells;
+	memset(counts,0,numCells*sizeof(unsigned int));
+	const float* ps[3]={x,y,z};
+	unsigned int overflow=(unsigned int)(numCells-1);
+	for(size_t i=begin;i<end;++i)
+		{
+		/* Find the particle's cell, sending particles outside the domain to the overflow cell: */
+		unsigned int cell[3];
+		bool inside=true;
+		for(int j=0;j<3;++j)
+			{
+			float c=(ps[j][i]-origin[j])*cellScale;
+			inside=inside&&c>=0.0f&&c<float(resolution);
+			cell[j]=inside?(unsigned int)(c):0U;
+			}
+		unsigned int cellIndex=inside?(unsigned int)((size_t(cell[2])*resolution+cell[1])*resolution+cell[0]):overflow;
+		cellIndices[i]=cellIndex;
+		++counts[cellIndex];
+		}
+	}
+
+void ParticleGrid::computeOffsets(size_t numChunks,unsigned int* cellCounts)
+	{
+	/* Lay out cells one after another, and each cell's particles in chunk order: */
+	unsigned int offset=0;
+	for(size_t cell=0;cell<numCells;++cell)
+		{
+		unsigned int cellStart=offset;
+		for(size_t chunk=0;chunk<numChunks;++chunk)
+			{
+			unsigned int& co=chunkOffsets[chunk*numCells+cell];
+			unsigned int count=co;
+			co=offset;
+			offset+=count;
+			}
+		cellCounts[cell]=offset-cellStart;
+		}
+	}
+
+const unsigned int* ParticleGrid::assignVertexIndices(size_t chunkIndex,size_t begin,size_t end)
+	{
+	unsigned int* offsets=chunkOffsets.data()+chunkIndex*numCells;
+	for(size_t i=begin;i<end;++i)
+		cellIndices[i]=offsets[cellIndices[i]]++;
+	return cellIndices.data()+begin;
+	}
+
+size_t ParticleGrid::selectDrawRanges(const double modelview[16],const double projection[16],float lodDistance,float minFraction,float drawFraction,const unsigned int* cellCounts,int* firsts,int* counts) const
+	{
+	/* Calculate the combined clip matrix: */
+	double clip[16];
+	for(int col=0;col<4;++col)
+		for(int row=0;row<4;++row)
+			{
+			double sum=0.0;
+			for(int k=0;k<4;++k)
+				sum+=projection[k*4+row]*modelview[col*4+k];
+			clip[col*4+row]=sum;
+			}
+
+	/* Extract the six frustum planes in model coordinates, as sums and differences of the clip matrix's last row and its other rows: */
+	double planes[6][4];
+	for(int axis=0;axis<3;++axis)
+		for(int c=0;c<4;++c)
+			{
+			planes[axis*2+0][c]=clip[c*4+3]+clip[c*4+axis];
+			planes[axis*2+1][c]=clip[c*4+3]-clip[c*4+axis];
+			}
+
+	double lodDistance2=double(lodDistance)*double(lodDistance);
+	float halfSize=cellSize*(0.5f+cellMargin);
+	size_t numRanges=0;
+	int first=0;
+	for(size_t cellIndex=0;cellIndex<numCells;first+=int(cellCounts[cellIndex]),++cellIndex)
+		{
+		int count=int(cellCounts[cellIndex]);
+		if(count==0)
+			continue;
+
+		if(cellIndex+1<numCells)
+			{
+			/* Calculate the cell's center: */
+			size_t ci=cellIndex;
+			double center[3];
+			for(int i=0;i<3;++i)
+				{
+				center[i]=double(origin[i])+(double(ci%resolution)+0.5)*double(cellSize);
+				ci/=resolution;
+				}
+
+			/* Skip the cell if its grown box lies completely outside any frustum plane: */
+			bool visible=true;
+			for(int p=0;p<6&&visible;++p)
+				{
+				double d=planes[p][3];
+				double extent=0.0;
+				for(int i=0;i<3;++i)
+					{
+					d+=planes[p][i]*center[i];
+					extent+=fabs(planes[p][i])*double(halfSize);
+					}
+				visible=d+extent>=0.0;
+				}
+			if(!visible)
+				continue;
+
+			if(drawFraction<1.0f)
+				{
+				/* Decimate all cells evenly: */
+				int decimatedCount=int(ceil(double(count)*double(drawFraction)));
+				count=decimatedCount>0?decimatedCount:1;
+				}
+
+			if(lodDistance>0.0f)
+				{
+				/* Thin out cells whose center is farther from the eye than the LOD distance, in proportion to their projected area: */
+				double eye2=0.0;
+				for(int i=0;i<3;++i)
+					{
+					double e=modelview[12+i];
+					for(int j=0;j<3;++j)
+						e+=modelview[j*4+i]*center[j];
+					eye2+=e*e;
+					}
+				if(eye2>lodDistance2)
+					{
+					double fraction=lodDistance2/eye2;
+					if(fraction<double(minFraction))
+						fraction=double(minFraction);
+					int lodCount=int(ceil(double(count)*fraction));
+					count=lodCount>0?lodCount:1;
+					}
+				}
+			}
+
+		/* Append the cell's leading particles to the previous range if they are adjacent: */
+		if(numRanges>0&&firsts[numRanges-1]+counts[numRanges-1]==first)
+			counts[numRanges-1]+=count;
+		else
+			{
+			firsts[numRanges]=first;
+			counts[numRanges]=count;
+			++numRanges;
+			}
+		}
+
+	return numRanges;
+	}
@@ -0,0 +1,54 @@
+/***********************************************************************
+ParticleGrid - Uniform grid partitioning exported particle vertices by
+position, so that renderers can skip cells outside the view frustum and
+draw distant cells at reduced density. The simulation thread bins all
+particles into the grid's cells with a parallel counting sort while it
+exports their vertices, so that each cell's particles are contiguous in
+the vertex array and the grid costs no extra pass over particle state.
+Particles outside the grid's domain go into one overflow cell, which is
+always drawn in full.
+***********************************************************************/
+
+#ifndef PARTICLEGRID_INCLUDED
+#define PARTICLEGRID_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+class ParticleGrid
+	{
+	/* Elements: */
+	private:
+	float origin[3]; // Lower corner of the grid's domain
+	float cellSize; // Edge length of a cell
+	float cellScale; // Number of cells per unit length
+	unsigned int resolution; // Number of cells along each axis
+	size_t numCells; // Total number of cells, including the overflow cell
+	std::vector<unsigned int> cellIndices; // Cell index of each particle during binning, then its index in the exported vertex array
+	std::vector<unsigned int> chunkOffsets; // Per-chunk, per-cell particle counts, turned into vertex array offsets by computeOffsets
+
+	/* Constructors and destructors: */
+	public:
+	ParticleGrid(const float center[3],float radius,unsigned int sResolution); // Creates a grid covering the cube of the given center and half-size with the given number of cells along each axis
+
+	/* Methods: */
+	unsigned int getResolution(void) const // Returns the number of cells along each axis
+		{
+		return resolution;
+		}
+	size_t getNumCells(void) const // Returns the total number of cells, including the overflow cell
+		{
+		return numCells;
+		}
+	void reserve(size_t capacity,size_t maxNumChunks); // Allocates binning buffers for up to the given number of particles and chunks
+
+	/* Binning methods, called by the simulation: */
+	void classify(size_t chunkIndex,const float* x,const float* y,const float* z,size_t begin,size_t end); // Finds the cells of particles [begin, end) and counts them per cell for the given chunk; can be called concurrently on different chunks
+	void computeOffsets(size_t numChunks,unsigned int* cellCounts); // Turns all chunks' per-cell counts into vertex array offsets such that each cell's particles are contiguous, and writes the number of particles in each cell
+	const unsigned int* assignVertexIndices(size_t chunkIndex,size_t begin,size_t end); // Returns the vertex array indices of particles [begin, end) of the given chunk; can be called concurrently on different chunks
+
+	/* Rendering methods: */
+	size_t selectDrawRanges(const double modelview[16],const double projection[16],float lodDistance,float minFraction,float drawFraction,const unsigned int* cellCounts,int* firsts,int* counts) const; // Writes the vertex ranges of all cells that intersect the view frustum of the given column-major OpenGL matrices, drawing only the given leading fraction of each cell, and only a leading fraction of that for cells farther than the given eye-space distance, as low as the given minimum, unless the distance is zero; returns the number of ranges
+	};
+
+#endif
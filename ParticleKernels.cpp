@@ -0,0 +1,142 @@
+/***********************************************************************
+ParticleKernels - Vectorized kernels advancing structure-of-arrays
+particle state by one simulation step.
+***********************************************************************/
+
+#include "ParticleKernels.h"
+
+#include "StepKernel.h"
+
+namespace ParticleKernels {
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct SingleArrays // Particle position arrays advanced in single precision
+	{
+	/* Elements: */
+	public:
+	float* x;
+	float* y;
+	float* z;
+	size_t numParticles;
+
+	/* Methods: */
+	template <class SystemParam,class IntegratorParam>
+	void step(const SystemParam& system,const IntegratorParam& integrator,double dt,unsigned int numSubsteps) const
+		{
+		stepParticles(system,integrator,x,y,z,numParticles,dt,numSubsteps);
+		}
+	};
+
+struct DoubleArrays // Particle position arrays advanced in double precision, with their single-precision render copies
+	{
+	/* Elements: */
+	public:
+	double* x;
+	double* y;
+	double* z;
+	float* renderX;
+	float* renderY;
+	float* renderZ;
+	size_t numParticles;
+
+	/* Methods: */
+	template <class SystemParam,class IntegratorParam>
+	void step(const SystemParam& system,const IntegratorParam& integrator,double dt,unsigned int numSubsteps) const
+		{
+		stepParticles(system,integrator,x,y,z,renderX,renderY,renderZ,numParticles,dt,numSubsteps);
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+template <class SystemParam,class ArraysParam>
+inline void stepSystem(const StepParameters& parameters,const ArraysParam& arrays) // Dispatches to the selected integrator for a fixed system
+	{
+	SystemParam system(parameters.systemParameters);
+	switch(parameters.integrator)
+		{
+		case Integrators::RK4:
+			arrays.step(system,Integrators::RungeKutta4(),parameters.timeStep,parameters.numSubsteps);
+			break;
+		
+		case Integrators::DORMANDPRINCE:
+			arrays.step(system,Integrators::DormandPrince(parameters.tolerance,parameters.maxSubsteps),parameters.timeStep,parameters.numSubsteps);
+			break;
+		
+		default:
+			arrays.step(system,Integrators::Euler(),parameters.timeStep,parameters.numSubsteps);
+		}
+	}
+
+template <class ArraysParam>
+inline void dispatchStep(const StepParameters& parameters,const ArraysParam& arrays) // Dispatches once per call to the fully inlined kernel for the selected system and integrator
+	{
+	switch(parameters.system)
+		{
+		case AttractorSystems::ROSSLER:
+			stepSystem<AttractorSystems::Rossler>(parameters,arrays);
+			break;
+		
+		case AttractorSystems::AIZAWA:
+			stepSystem<AttractorSystems::Aizawa>(parameters,arrays);
+			break;
+		
+		case AttractorSystems::THOMAS:
+			stepSystem<AttractorSystems::Thomas>(parameters,arrays);
+			break;
+		
+		case AttractorSystems::HALVORSEN:
+			stepSystem<AttractorSystems::Halvorsen>(parameters,arrays);
+			break;
+		
+		default:
+			stepSystem<AttractorSystems::Lorenz>(parameters,arrays);
+		}
+	}
+
+}
+
+/********************************
+Methods of struct StepParameters:
+********************************/
+
+StepParameters::StepParameters(void)
+	:integrator(Integrators::EULER),numSubsteps(1),
+	 tolerance(1.0e-4f),maxSubsteps(16)
+	{
+	setSystem(AttractorSystems::LORENZ);
+	}
+
+void StepParameters::setSystem(AttractorSystems::SystemType newSystem)
+	{
+	system=newSystem;
+	const AttractorSystems::SystemInfo& info=AttractorSystems::getSystemInfo(system);
+	for(int i=0;i<AttractorSystems::maxNumParameters;++i)
+		systemParameters[i]=i<info.numParameters?info.defaultParameters[i]:0.0f;
+	timeStep=info.defaultTimeStep;
+	}
+
+/****************
+Kernel functions:
+****************/
+
+void stepParticles(const StepParameters& parameters,float* x,float* y,float* z,size_t numParticles)
+	{
+	SingleArrays arrays={x,y,z,numParticles};
+	dispatchStep(parameters,arrays);
+	}
+
+void stepParticles(const StepParameters& parameters,double* x,double* y,double* z,float* renderX,float* renderY,float* renderZ,size_t numParticles)
+	{
+	DoubleArrays arrays={x,y,z,renderX,renderY,renderZ,numParticles};
+	dispatchStep(parameters,arrays);
+	}
+
+}
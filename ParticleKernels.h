@@ -0,0 +1,46 @@
+/***********************************************************************
+ParticleKernels - Vectorized kernels advancing structure-of-arrays
+particle state by one simulation step.
+***********************************************************************/
+
+#ifndef PARTICLEKERNELS_INCLUDED
+#define PARTICLEKERNELS_INCLUDED
+
+#include <stddef.h>
+
+#include "AttractorSystems.h"
+#include "Integrators.h"
+
+namespace ParticleKernels {
+
+struct StepParameters // Structure selecting the ODE system and integrator for a simulation step
+	{
+	/* Elements: */
+	public:
+	AttractorSystems::SystemType system; // ODE system along which particles move
+	float systemParameters[AttractorSystems::maxNumParameters]; // Parameters of the ODE system
+	Integrators::IntegratorType integrator; // Integration method
+	float timeStep; // Simulation time covered by one step
+	unsigned int numSubsteps; // Number of integration substeps per step, each covering an equal share of the time step
+	float tolerance; // Local error tolerance for adaptive integrators
+	unsigned int maxSubsteps; // Maximum number of trial substeps per step for adaptive integrators
+
+	/* Constructors and destructors: */
+	StepParameters(void); // Creates parameters for the Lorenz system with explicit Euler integration
+	
+	/* Methods: */
+	void setSystem(AttractorSystems::SystemType newSystem); // Selects a system and resets its parameters and time step to their defaults
+	};
+
+/*********************************************************************
+All kernels process particle arrays in full SIMD packs. Arrays must be
+aligned to Simd::alignment, and the particle count must be a multiple
+of Simd::FloatPack::numLanes (see ParticleStore::getPaddedNumParticles).
+*********************************************************************/
+
+void stepParticles(const StepParameters& parameters,float* x,float* y,float* z,size_t numParticles); // Advances particles along the selected system using the selected integrator
+void stepParticles(const StepParameters& parameters,double* x,double* y,double* z,float* renderX,float* renderY,float* renderZ,size_t numParticles); // Advances particles along the selected system using the selected integrator in double precision, and writes their new positions rounded to single precision into the render arrays
+
+}
+
+#endif
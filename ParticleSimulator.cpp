@@ -0,0 +1,273 @@
+/***********************************************************************
+ParticleSimulator - CPU simulation engine advancing a pool of particles
+along an ODE system. The simulator owns the structure-of-arrays particle
+store and a worker pool, and splits each step and each export of
+interleaved render vertices into chunks shared by all workers. It does
+not depend on Vrui's application or rendering layers, and is the entry
+point of the simulation library shared by the interactive application,
+the benchmark, and other headless tools: they advance particles with
+step, seed them with addParticles, query them through getParticles, and
+publish render copies with the export methods.
+Given a particle arena, the simulator first-touches each worker's share
+of the particle store's chunks, and of the render copies its exports
+write, from that worker, so that on NUMA systems each worker steps and
+exports particles in memory local to its node.
+***********************************************************************/
+
+#include "ParticleSimulator.h"
+
+#include <string.h>
+
+#include "SeedQueue.h"
+
+/*************************************************
+Methods of class ParticleSimulator::StoreRangeJob:
+*************************************************/
+
+void ParticleSimulator::StoreRangeJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t end=begin+chunkSize<numSlots?begin+chunkSize:numSlots;
+	(particles.*method)(begin,end);
+	}
+
+/********************************************
+Methods of class ParticleSimulator::TouchJob:
+********************************************/
+
+void ParticleSimulator::TouchJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t end=begin+chunkSize<numElements?begin+chunkSize:numElements;
+	memset(array+begin*elementSize,0,(end-begin)*elementSize);
+	}
+
+/*******************************************
+Methods of class ParticleSimulator::StepJob:
+*******************************************/
+
+void ParticleSimulator::StepJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t count=numPacked-begin<chunkSize?numPacked-begin:chunkSize;
+
+	/* Find this chunk's expired particles, if any can have expired: */
+	if(sweeps!=0)
+		{
+		size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+		sweeps[chunkIndex]=particles.findExpired(sweepTime,begin,end);
+		}
+
+	/* Keep the positions before the step for interpolation: */
+	if(savePrevious)
+		particles.savePreviousPositions(begin,begin+count);
+
+	/* Update the [x,y,z] coordinate of this chunk's Particles along the attractor system: */
+	if(particles.hasMasterPositions())
+		{
+		/* Advance the master copy and round the results into the positions: */
+		ParticleKernels::stepParticles(stepParameters,particles.getMasterPositions(0)+begin,particles.getMasterPositions(1)+begin,particles.getMasterPositions(2)+begin,particles.getPositions(0)+begin,particles.getPositions(1)+begin,particles.getPositions(2)+begin,count);
+		}
+	else
+		ParticleKernels::stepParticles(stepParameters,particles.getPositions(0)+begin,particles.getPositions(1)+begin,particles.getPositions(2)+begin,count);
+
+	/* Add the new positions to this worker's private density bins while they are still in cache: */
+	if(density!=0)
+		{
+		size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+		if(end>begin)
+			density->accumulate(workerIndex,particles.getPositions(0)+begin,particles.getPositions(1)+begin,particles.getPositions(2)+begin,particles.getBirthTimes()+begin,maxDensityBirthTime,end-begin);
+		}
+	}
+
+/******************************************************
+Methods of class ParticleSimulator::QuantizedExportJob:
+******************************************************/
+
+void ParticleSimulator::QuantizedExportJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+	particles.exportQuantizedVertices(vertices,begin,end,quantizer);
+	}
+
+/***************************************************
+Methods of class ParticleSimulator::GridClassifyJob:
+***************************************************/
+
+void ParticleSimulator::GridClassifyJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+	grid.classify(chunkIndex,particles.getPositions(0),particles.getPositions(1),particles.getPositions(2),begin,end);
+	}
+
+/**********************************************************
+Methods of class ParticleSimulator::QuantizedGridExportJob:
+**********************************************************/
+
+void ParticleSimulator::QuantizedGridExportJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+	particles.scatterQuantizedVertices(vertices,begin,end,grid.assignVertexIndices(chunkIndex,begin,end),quantizer);
+	}
+
+/***************************************************
+Methods of class ParticleSimulator::DensityMergeJob:
+***************************************************/
+
+void ParticleSimulator::DensityMergeJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	slabMaxTotals[chunkIndex]=density.mergeSlab((unsigned int)(chunkIndex));
+	}
+
+/*****************************************************
+Methods of class ParticleSimulator::DensityToneMapJob:
+*****************************************************/
+
+void ParticleSimulator::DensityToneMapJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	density.toneMapSlab((unsigned int)(chunkIndex),maxTotal,voxels);
+	}
+
+/**********************************
+Methods of class ParticleSimulator:
+**********************************/
+
+ParticleSimulator::ParticleSimulator(const ParticleKernels::StepParameters& sStepParameters,size_t capacity,unsigned int numThreads,size_t sChunkSize,ParticleArena* arena)
+	:stepParameters(sStepParameters),
+	 particles(capacity,arena),
+	 workerPool(numThreads),
+	 chunkSize(ParticleStore::padToPackSize(sChunkSize>0?sChunkSize:1)), // Keep chunks aligned to full SIMD packs
+	 density(0),densityWarmup(0.0),
+	 grid(0)
+	{
+	/* Allocate all per-step buffers once, so that steps never allocate memory: */
+	expirySweeps.reserve(getNumChunks(particles.getCapacity()));
+	
+	if(arena!=0)
+		{
+		/* Place the chunks of a full pool near the workers that start out stepping them; arena pages are not placed until first written: */
+		StoreRangeJob placeJob(particles,&ParticleStore::placeArrays,particles.getCapacity(),chunkSize);
+		workerPool.run(placeJob,getNumChunks(particles.getCapacity()));
+		}
+	}
+
+ParticleSimulator::~ParticleSimulator(void)
+	{
+	delete density;
+	delete grid;
+	}
+
+void ParticleSimulator::enableHighAccuracy(void)
+	{
+	if(particles.hasMasterPositions())
+		return;
+	
+	/* Start the master copy in parallel, so that each worker's chunks of it are placed near that worker: */
+	particles.allocateMasterPositions();
+	StoreRangeJob copyJob(particles,&ParticleStore::copyMasterPositions,particles.getCapacity(),chunkSize);
+	workerPool.run(copyJob,getNumChunks(particles.getCapacity()));
+	}
+
+void ParticleSimulator::touch(void* array,size_t elementSize,size_t numElements)
+	{
+	TouchJob touchJob(array,elementSize,numElements,chunkSize);
+	workerPool.run(touchJob,getNumChunks(numElements));
+	}
+
+void ParticleSimulator::step(double currentTime,bool savePrevious)
+	{
+	/* Check whether any particle's lifespan can have run out since the last step: */
+	bool sweep=particles.needsExpirySweep(currentTime);
+
+	/* Advance all particles in parallel, finding expired particles along the way: */
+	StepJob stepJob(particles,chunkSize,stepParameters);
+	stepJob.savePrevious=savePrevious;
+	stepJob.density=density;
+	stepJob.maxDensityBirthTime=float(currentTime-densityWarmup);
+	size_t numChunks=getNumChunks(stepJob.numPacked);
+	if(sweep)
+		{
+		particles.beginExpirySweep();
+		expirySweeps.resize(numChunks);
+		stepJob.sweepTime=currentTime;
+		stepJob.sweeps=expirySweeps.data();
+		}
+	workerPool.run(stepJob,numChunks);
+
+	/* Put the slots of all expired particles onto the free list: */
+	if(sweep)
+		for(size_t chunkIndex=0;chunkIndex<numChunks;++chunkIndex)
+			particles.commitExpired(chunkIndex*chunkSize,expirySweeps[chunkIndex]);
+	}
+
+size_t ParticleSimulator::addParticles(SeedQueue& seedQueue,size_t maxNumParticles,float birthTime,float expiryTime)
+	{
+	size_t numDrained=0;
+	const SeedQueue::Seed* seeds;
+	size_t numSeeds;
+	while((numSeeds=seedQueue.beginDrain(seeds))>0)
+		{
+		/* Admit seeds only up to the particle limit; the rest are dropped like seeds beyond the pool's capacity: */
+		size_t numLive=particles.getNumParticles();
+		size_t numAdmitted=numLive<maxNumParticles?maxNumParticles-numLive:0;
+		if(numAdmitted>numSeeds)
+			numAdmitted=numSeeds;
+		particles.addParticles(seeds,numAdmitted,birthTime,expiryTime);
+		seedQueue.endDrain(numSeeds);
+		numDrained+=numSeeds;
+		}
+	return numDrained;
+	}
+
+void ParticleSimulator::enableDensity(const float center[3],float radius,unsigned int resolution,double warmup)
+	{
+	/* Give every worker of the pool its own private bins: */
+	delete density;
+	density=new DensityHistogram(center,radius,resolution,workerPool.getNumWorkers());
+	densityWarmup=warmup;
+	densitySlabMaxTotals.resize(density->getResolution());
+	}
+
+void ParticleSimulator::exportDensity(unsigned char* voxels)
+	{
+	/* Merge all private bins in parallel slabs, finding the largest total along the way: */
+	DensityMergeJob mergeJob(*density,densitySlabMaxTotals.data());
+	workerPool.run(mergeJob,density->getResolution());
+	density->countSamples();
+	uint64_t maxTotal=0;
+	for(std::vector<uint64_t>::iterator smtIt=densitySlabMaxTotals.begin();smtIt!=densitySlabMaxTotals.end();++smtIt)
+		if(maxTotal<*smtIt)
+			maxTotal=*smtIt;
+
+	/* Tone-map the merged histogram in parallel slabs: */
+	DensityToneMapJob toneMapJob(*density,maxTotal,voxels);
+	workerPool.run(toneMapJob,density->getResolution());
+	}
+
+void ParticleSimulator::enableGrid(const float center[3],float radius,unsigned int resolution)
+	{
+	/* Allocate the grid's binning buffers for the full pool, so that exports never allocate memory: */
+	delete grid;
+	grid=new ParticleGrid(center,radius,resolution);
+	grid->reserve(particles.getCapacity(),getNumChunks(particles.getCapacity()));
+	}
+
+void ParticleSimulator::exportVertices(QuantizedVertex* vertices,const VertexQuantizer& quantizer)
+	{
+	QuantizedExportJob exportJob(particles,vertices,quantizer,chunkSize);
+	workerPool.run(exportJob,getNumChunks(particles.getNumParticles()));
+	}
+
+void ParticleSimulator::exportVertices(QuantizedVertex* vertices,unsigned int* cellCounts,const VertexQuantizer& quantizer)
+	{
+	/* Bin all particles, lay out the cells, and scatter each particle into its cell, in parallel: */
+	size_t numChunks=getNumChunks(particles.getNumParticles());
+	GridClassifyJob classifyJob(particles,*grid,chunkSize);
+	workerPool.run(classifyJob,numChunks);
+	grid->computeOffsets(numChunks,cellCounts);
+	QuantizedGridExportJob exportJob(particles,*grid,vertices,quantizer,chunkSize);
+	workerPool.run(exportJob,numChunks);
+	}
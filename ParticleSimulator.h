@@ -0,0 +1,411 @@
+/***********************************************************************
+ParticleSimulator - CPU simulation engine advancing a pool of particles
+along an ODE system. The simulator owns the structure-of-arrays particle
+store and a worker pool, and splits each step and each export of
+interleaved render vertices into chunks shared by all workers. It does
+not depend on Vrui's application or rendering layers, and is the entry
+point of the simulation library shared by the interactive application,
+the benchmark, and other headless tools: they advance particles with
+step, seed them with addParticles, query them through getParticles, and
+publish render copies with the export methods.
+Given a particle arena, the simulator first-touches each worker's share
+of the particle store's chunks, and of the render copies its exports
+write, from that worker, so that on NUMA systems each worker steps and
+exports particles in memory local to its node.
+***********************************************************************/
+
+#ifndef PARTICLESIMULATOR_INCLUDED
+#define PARTICLESIMULATOR_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+#include "ParticleStore.h"
+#include "ParticleKernels.h"
+#include "WorkerPool.h"
+#include "DensityHistogram.h"
+#include "ParticleGrid.h"
+
+/* Forward declarations: */
+class SeedQueue;
+class ParticleArena;
+
+class ParticleSimulator
+	{
+	/* Embedded classes: */
+	private:
+	class StoreRangeJob:public WorkerPool::Job // Job calling a method of the particle store on the slots of one chunk
+		{
+		/* Embedded classes: */
+		public:
+		typedef void (ParticleStore::*Method)(size_t begin,size_t end); // Type for store methods processing a range of slots
+
+		/* Elements: */
+		ParticleStore& particles; // Particle store being processed
+		Method method; // Method called on each chunk's range of slots
+		size_t numSlots; // Number of slots to process
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		StoreRangeJob(ParticleStore& sParticles,Method sMethod,size_t sNumSlots,size_t sChunkSize)
+			:particles(sParticles),method(sMethod),numSlots(sNumSlots),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class TouchJob:public WorkerPool::Job // Job writing zeros into the elements of one chunk of an array
+		{
+		/* Elements: */
+		public:
+		unsigned char* array; // Array being touched
+		size_t elementSize; // Size of an array element in bytes
+		size_t numElements; // Number of elements in the array
+		size_t chunkSize; // Number of elements per chunk
+
+		/* Constructors and destructors: */
+		TouchJob(void* sArray,size_t sElementSize,size_t sNumElements,size_t sChunkSize)
+			:array(static_cast<unsigned char*>(sArray)),elementSize(sElementSize),numElements(sNumElements),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class StepJob:public WorkerPool::Job // Job advancing one chunk of particles by one step
+		{
+		/* Elements: */
+		public:
+		ParticleStore& particles; // Particle store being advanced
+		size_t numPacked; // Number of particles to process, padded to the SIMD pack width
+		size_t chunkSize; // Number of particles per chunk
+		const ParticleKernels::StepParameters& stepParameters; // ODE system and integrator along which particles are advanced
+		double sweepTime; // Application time against which particle expiry is checked
+		ParticleStore::ExpirySweep* sweeps; // Array receiving each chunk's expiry sweep result, or null if no particles can have expired
+		bool savePrevious; // Flag whether to save particle positions for interpolation before stepping
+		DensityHistogram* density; // Histogram accumulating the particles' positions after the step, or null
+		float maxDensityBirthTime; // Birth time of the youngest particles added to the density histogram
+
+		/* Constructors and destructors: */
+		StepJob(ParticleStore& sParticles,size_t sChunkSize,const ParticleKernels::StepParameters& sStepParameters)
+			:particles(sParticles),numPacked(particles.getPaddedNumParticles()),chunkSize(sChunkSize),
+			 stepParameters(sStepParameters),
+			 sweepTime(0.0),sweeps(0),savePrevious(false),
+			 density(0),maxDensityBirthTime(0.0f)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	template <class VertexParam>
+	class ExportJob:public WorkerPool::Job // Job writing one chunk of particles into an interleaved render copy
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being exported
+		VertexParam* vertices; // Interleaved vertex array receiving the render copy
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		ExportJob(const ParticleStore& sParticles,VertexParam* sVertices,size_t sChunkSize)
+			:particles(sParticles),vertices(sVertices),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex)
+			{
+			size_t begin=chunkIndex*chunkSize;
+			size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+			particles.exportInterpolationVertices(vertices,begin,end);
+			}
+		};
+
+	template <class VertexParam>
+	class MotionExportJob:public WorkerPool::Job // Job writing the positions and previous positions of one chunk of particles into a render copy
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being exported
+		VertexParam* vertices; // Vertex array receiving the render copy
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		MotionExportJob(const ParticleStore& sParticles,VertexParam* sVertices,size_t sChunkSize)
+			:particles(sParticles),vertices(sVertices),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex)
+			{
+			size_t begin=chunkIndex*chunkSize;
+			size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+			particles.exportMotionVertices(vertices,begin,end);
+			}
+		};
+
+	template <class VertexParam>
+	class TrailExportJob:public WorkerPool::Job // Job writing one chunk of particles into a trail history layer
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being exported
+		VertexParam* vertices; // Trail vertex array receiving the layer
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		TrailExportJob(const ParticleStore& sParticles,VertexParam* sVertices,size_t sChunkSize)
+			:particles(sParticles),vertices(sVertices),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex)
+			{
+			size_t begin=chunkIndex*chunkSize;
+			size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+			particles.exportTrailVertices(vertices,begin,end);
+			}
+		};
+
+	class QuantizedExportJob:public WorkerPool::Job // Job writing one chunk of particles into a compact render copy
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being exported
+		QuantizedVertex* vertices; // Compact vertex array receiving the render copy
+		const VertexQuantizer& quantizer; // Quantizer encoding the vertices
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		QuantizedExportJob(const ParticleStore& sParticles,QuantizedVertex* sVertices,const VertexQuantizer& sQuantizer,size_t sChunkSize)
+			:particles(sParticles),vertices(sVertices),quantizer(sQuantizer),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class GridClassifyJob:public WorkerPool::Job // Job binning one chunk of particles into the culling grid's cells
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being binned
+		ParticleGrid& grid; // Grid receiving the particles
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		GridClassifyJob(const ParticleStore& sParticles,ParticleGrid& sGrid,size_t sChunkSize)
+			:particles(sParticles),grid(sGrid),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	template <class VertexParam>
+	class GridExportJob:public WorkerPool::Job // Job writing one chunk of binned particles into the cells of an interleaved render copy
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being exported
+		ParticleGrid& grid; // Grid into which the particles have been binned
+		VertexParam* vertices; // Interleaved vertex array receiving the render copy
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		GridExportJob(const ParticleStore& sParticles,ParticleGrid& sGrid,VertexParam* sVertices,size_t sChunkSize)
+			:particles(sParticles),grid(sGrid),vertices(sVertices),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex)
+			{
+			size_t begin=chunkIndex*chunkSize;
+			size_t end=begin+chunkSize<particles.getNumParticles()?begin+chunkSize:particles.getNumParticles();
+			particles.scatterInterpolationVertices(vertices,begin,end,grid.assignVertexIndices(chunkIndex,begin,end));
+			}
+		};
+
+	class QuantizedGridExportJob:public WorkerPool::Job // Job writing one chunk of binned particles into the cells of a compact render copy
+		{
+		/* Elements: */
+		public:
+		const ParticleStore& particles; // Particle store being exported
+		ParticleGrid& grid; // Grid into which the particles have been binned
+		QuantizedVertex* vertices; // Compact vertex array receiving the render copy
+		const VertexQuantizer& quantizer; // Quantizer encoding the vertices
+		size_t chunkSize; // Number of particles per chunk
+
+		/* Constructors and destructors: */
+		QuantizedGridExportJob(const ParticleStore& sParticles,ParticleGrid& sGrid,QuantizedVertex* sVertices,const VertexQuantizer& sQuantizer,size_t sChunkSize)
+			:particles(sParticles),grid(sGrid),vertices(sVertices),quantizer(sQuantizer),chunkSize(sChunkSize)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class DensityMergeJob:public WorkerPool::Job // Job merging one slab of the density histogram's private bins
+		{
+		/* Elements: */
+		public:
+		DensityHistogram& density; // Histogram being merged
+		uint64_t* slabMaxTotals; // Array receiving each slab's largest total
+
+		/* Constructors and destructors: */
+		DensityMergeJob(DensityHistogram& sDensity,uint64_t* sSlabMaxTotals)
+			:density(sDensity),slabMaxTotals(sSlabMaxTotals)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class DensityToneMapJob:public WorkerPool::Job // Job tone-mapping one slab of the density histogram
+		{
+		/* Elements: */
+		public:
+		const DensityHistogram& density; // Histogram being tone-mapped
+		uint64_t maxTotal; // Total mapped to full intensity
+		unsigned char* voxels; // Voxel array receiving the tone-mapped histogram
+
+		/* Constructors and destructors: */
+		DensityToneMapJob(const DensityHistogram& sDensity,uint64_t sMaxTotal,unsigned char* sVoxels)
+			:density(sDensity),maxTotal(sMaxTotal),voxels(sVoxels)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	/* Elements: */
+	ParticleKernels::StepParameters stepParameters; // ODE system, parameters, integrator, and time step of the simulation
+	ParticleStore particles; // Structure-of-arrays state of all live particles
+	std::vector<ParticleStore::ExpirySweep> expirySweeps; // Per-chunk expiry sweep results, reserved for the full pool
+	WorkerPool workerPool; // Pool of worker threads sharing the particle updates of each step; the thread calling the simulator is its first worker
+	size_t chunkSize; // Number of particles handed to a worker at a time; multiple of the SIMD pack width
+	DensityHistogram* density; // Histogram accumulating particle positions after every step, or null
+	double densityWarmup; // Age particles must reach before their positions are added to the density histogram
+	std::vector<uint64_t> densitySlabMaxTotals; // Per-slab largest totals found while merging the density histogram
+	ParticleGrid* grid; // Grid into which exported vertices are binned for culling, or null
+
+	/* Private methods: */
+	ParticleSimulator(const ParticleSimulator& source); // Prohibit copy constructor
+	ParticleSimulator& operator=(const ParticleSimulator& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	ParticleSimulator(const ParticleKernels::StepParameters& sStepParameters,size_t capacity,unsigned int numThreads,size_t sChunkSize,ParticleArena* arena =0); // Creates a simulator for up to the given number of particles, using the given total number of threads and particles per chunk; allocates the particle store from the given arena and places each worker's share of it near that worker
+	~ParticleSimulator(void);
+
+	/* Methods: */
+	const ParticleKernels::StepParameters& getStepParameters(void) const // Returns the simulation parameters
+		{
+		return stepParameters;
+		}
+	void setStepParameters(const ParticleKernels::StepParameters& newStepParameters) // Changes the system parameters, time step, or integrator for all following steps; must not be called during a step
+		{
+		stepParameters=newStepParameters;
+		}
+	ParticleStore& getParticles(void) // Returns the particle store
+		{
+		return particles;
+		}
+	const ParticleStore& getParticles(void) const
+		{
+		return particles;
+		}
+	unsigned int getNumThreads(void) const // Returns the total number of threads sharing each step
+		{
+		return workerPool.getNumWorkers();
+		}
+	size_t getChunkSize(void) const // Returns the number of particles per chunk
+		{
+		return chunkSize;
+		}
+	size_t getNumChunks(size_t numParticles) const // Returns the number of chunks covering the given number of particles
+		{
+		return (numParticles+chunkSize-1)/chunkSize;
+		}
+	void enableHighAccuracy(void); // Advances particles in double precision from now on, rounding their positions to single precision after every step for seeding, export, and all other uses; doubles the cost of a step
+	bool getHighAccuracy(void) const // Returns true if particles are advanced in double precision
+		{
+		return particles.hasMasterPositions();
+		}
+	void touch(void* array,size_t elementSize,size_t numElements); // Writes zeros into an array holding one element per particle slot, with each worker writing the share of chunks it steps, so that the array's pages are placed near the workers exporting into it
+	template <class VectorParam>
+	void reserveRenderCopy(VectorParam& vertices) // Reserves room for the full pool in a vector receiving render copies, and places its pages near the workers exporting into it if the vector's allocator leaves new elements untouched, like ParticleArena::Allocator
+		{
+		vertices.resize(particles.getCapacity());
+		touch(vertices.data(),sizeof(typename VectorParam::value_type),vertices.size());
+		vertices.clear();
+		}
+	void step(double currentTime,bool savePrevious); // Advances all particles by one step and puts the slots of particles expired at the given time onto the free list; saves positions for interpolation first if flag is true
+	template <class SeedParam>
+	size_t addParticles(const SeedParam* seeds,size_t numSeeds,float birthTime,float expiryTime) // Adds a batch of new particles, reusing the slots of expired particles first; returns the number of particles added
+		{
+		return particles.addParticles(seeds,numSeeds,birthTime,expiryTime);
+		}
+	size_t addParticles(SeedQueue& seedQueue,size_t maxNumParticles,float birthTime,float expiryTime); // Drains all seeds published to the given queue, adding them in bulk while fewer than the given number of particles are live and dropping the rest; returns the number of seeds drained
+	void compact(void) // Closes all free slots left after a step and seeding, keeping live particles contiguous
+		{
+		particles.closeFreeSlots();
+		}
+	void enableDensity(const float center[3],float radius,unsigned int resolution,double warmup); // Starts accumulating the positions of particles older than the given age after every step into a voxel histogram of the given domain and resolution
+	const DensityHistogram* getDensity(void) const // Returns the density histogram, or null if density accumulation is disabled
+		{
+		return density;
+		}
+	void exportDensity(unsigned char* voxels); // Merges all samples accumulated since the last export into the density histogram and writes its tone-mapped voxels, in parallel
+	template <class VertexParam>
+	void exportVertices(VertexParam* vertices) // Writes the interleaved render copy of all particles, with birth times and lifespans in the vertex texture coordinates and previous positions in the vertex normals, in parallel
+		{
+		ExportJob<VertexParam> exportJob(particles,vertices,chunkSize);
+		workerPool.run(exportJob,getNumChunks(particles.getNumParticles()));
+		}
+	template <class VertexParam>
+	void exportMotionVertices(VertexParam* vertices) // Writes only the previous positions, in the vertex normals, and positions of all particles in slot order, in parallel, for render copies whose other attributes are only updated for slots that changed particles
+		{
+		MotionExportJob<VertexParam> exportJob(particles,vertices,chunkSize);
+		workerPool.run(exportJob,getNumChunks(particles.getNumParticles()));
+		}
+	void enableGrid(const float center[3],float radius,unsigned int resolution); // Bins exported vertices into a culling grid covering the given domain with the given number of cells along each axis
+	const ParticleGrid* getGrid(void) const // Returns the culling grid, or null if exported vertices are not binned
+		{
+		return grid;
+		}
+	template <class VertexParam>
+	void exportVertices(VertexParam* vertices,unsigned int* cellCounts) // Writes the interleaved render copy of all particles like exportVertices, but sorted by culling grid cell, and writes the number of particles in each cell; requires a culling grid
+		{
+		/* Bin all particles, lay out the cells, and scatter each particle into its cell, in parallel: */
+		size_t numChunks=getNumChunks(particles.getNumParticles());
+		GridClassifyJob classifyJob(particles,*grid,chunkSize);
+		workerPool.run(classifyJob,numChunks);
+		grid->computeOffsets(numChunks,cellCounts);
+		GridExportJob<VertexParam> exportJob(particles,*grid,vertices,chunkSize);
+		workerPool.run(exportJob,numChunks);
+		}
+	template <class VertexParam>
+	void exportTrailVertices(VertexParam* vertices) // Writes the position, id tag, and color of all particles in slot order into a trail history layer, in parallel
+		{
+		TrailExportJob<VertexParam> exportJob(particles,vertices,chunkSize);
+		workerPool.run(exportJob,getNumChunks(particles.getNumParticles()));
+		}
+	void exportVertices(QuantizedVertex* vertices,const VertexQuantizer& quantizer); // Writes the compact render copy of all particles, encoded by the given quantizer, in parallel
+	void exportVertices(QuantizedVertex* vertices,unsigned int* cellCounts,const VertexQuantizer& quantizer); // Writes the compact render copy of all particles like exportVertices, but sorted by culling grid cell, and writes the number of particles in each cell; requires a culling grid
+	};
+
+#endif
@@ -0,0 +1,77 @@
+/***********************************************************************
+ParticleSnapshot - Compact binary snapshots of a particle store. A
+snapshot holds a header naming the ODE system, its parameters, and the
+application time at which it was taken, followed by the store's
+positions, colors, birth and expiry times, and ids as one contiguous
+native-endian array each, which are read straight into the store's
+structure-of-arrays buffers. Birth and expiry times are moved to the
+time base of the restoring process, so that particles keep their ages
+across a restart.
+***********************************************************************/
+
+#include "ParticleSnapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <stdexcept>
+
+namespace ParticleSnapshot {
+
+bool save(const char* fileName,const ParticleStore& particles,const ParticleKernels::StepParameters& stepParameters,double time)
+	{
+	/* Prepare the header: */
+	Header header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,fileMagic,sizeof(header.magic));
+	header.version=version;
+	header.system=uint32_t(stepParameters.system);
+	memcpy(header.systemParameters,stepParameters.systemParameters,sizeof(header.systemParameters));
+	header.numParticles=particles.getNumParticles();
+	header.nextId=particles.getNextId();
+	header.time=time;
+
+	/* Write the snapshot into a temporary file next to the destination: */
+	std::string tempFileName=fileName;
+	tempFileName.append(".tmp");
+	FILE* file=fopen(tempFileName.c_str(),"wb");
+	if(file==0)
+		return false;
+	bool ok=fwrite(&header,sizeof(header),1,file)==1&&particles.writeArrays(file);
+	ok=fclose(file)==0&&ok;
+
+	/* Replace the previous snapshot only once the new one is complete: */
+	if(ok)
+		ok=rename(tempFileName.c_str(),fileName)==0;
+	if(!ok)
+		remove(tempFileName.c_str());
+	return ok;
+	}
+
+double load(const char* fileName,ParticleStore& particles,const ParticleKernels::StepParameters& stepParameters,double time,bool matchParameters)
+	{
+	FILE* file=fopen(fileName,"rb");
+	if(file==0)
+		throw std::runtime_error(std::string("ParticleSnapshot: Unable to open snapshot file ")+fileName);
+
+	/* Check the header: */
+	Header header;
+	std::string error;
+	if(fread(&header,sizeof(header),1,file)!=1||memcmp(header.magic,fileMagic,sizeof(header.magic))!=0)
+		error=" is not a snapshot file";
+	else if(header.version!=version)
+		error=" has an unsupported layout version";
+	else if(header.system!=uint32_t(stepParameters.system))
+		error=" was taken of a different system";
+	else if(matchParameters&&memcmp(header.systemParameters,stepParameters.systemParameters,sizeof(header.systemParameters))!=0)
+		error=" was taken with different system parameters";
+	else if(!particles.readArrays(file,size_t(header.numParticles),header.nextId,float(time-header.time)))
+		error=" is truncated";
+	fclose(file);
+	if(!error.empty())
+		throw std::runtime_error(std::string("ParticleSnapshot: Snapshot file ")+fileName+error);
+
+	return header.time;
+	}
+
+}
@@ -0,0 +1,45 @@
+/***********************************************************************
+ParticleSnapshot - Compact binary snapshots of a particle store. A
+snapshot holds a header naming the ODE system, its parameters, and the
+application time at which it was taken, followed by the store's
+positions, colors, birth and expiry times, and ids as one contiguous
+native-endian array each, which are read straight into the store's
+structure-of-arrays buffers. Birth and expiry times are moved to the
+time base of the restoring process, so that particles keep their ages
+across a restart.
+***********************************************************************/
+
+#ifndef PARTICLESNAPSHOT_INCLUDED
+#define PARTICLESNAPSHOT_INCLUDED
+
+#include <stdint.h>
+
+#include "AttractorSystems.h"
+#include "ParticleStore.h"
+#include "ParticleKernels.h"
+
+namespace ParticleSnapshot {
+
+static const char fileMagic[8]={'S','A','S','N','A','P','\0','\1'}; // Identifier at the start of every snapshot file
+static const uint32_t version=1; // Version of the layout described here
+
+struct Header // Structure at the start of a snapshot file
+	{
+	/* Elements: */
+	public:
+	char magic[8]; // Equal to fileMagic
+	uint32_t version; // Layout version
+	uint32_t system; // ODE system along which the particles moved
+	float systemParameters[AttractorSystems::maxNumParameters]; // Parameters of the ODE system
+	uint64_t numParticles; // Number of particles in the snapshot
+	uint32_t nextId; // Identifier of the next particle to be seeded
+	uint32_t reserved; // Padding
+	double time; // Application time at which the snapshot was taken
+	};
+
+bool save(const char* fileName,const ParticleStore& particles,const ParticleKernels::StepParameters& stepParameters,double time); // Writes a snapshot of the given particles, moving along the given system, taken at the given application time; writes to a temporary file first and renames it over the given file, so that an interrupted save keeps the previous snapshot; free list must be empty; returns false on errors
+double load(const char* fileName,ParticleStore& particles,const ParticleKernels::StepParameters& stepParameters,double time,bool matchParameters); // Replaces the given particles by a snapshot, dropping particles beyond the store's capacity and shifting their lifespans such that the snapshot appears taken at the given application time; returns the application time at which the snapshot was taken; throws std::runtime_error if the file cannot be read, or was taken of another system, or, if flag is true, with other system parameters
+
+}
+
+#endif
@@ -0,0 +1,409 @@
+/***********************************************************************
+ParticleStore - Structure-of-arrays storage of particle state. Each
+particle attribute (x, y, z, the four color channels, the birth and
+expiry times, the x, y, z before the most recent step, and a persistent
+id that survives moves between slots) lives in its own SIMD-aligned
+array, which lets the step kernels process a full register of particles
+per instruction. The interleaved vertex representation
+used for rendering is only created when the particles are handed off to
+a vertex buffer.
+In high-accuracy mode, the store also keeps a double-precision master
+copy of the positions, which the step kernels advance instead, rounding
+the results into the single-precision positions read by everything
+else.
+The store is a pool of fixed capacity. Expired particles are recorded in
+a free list whose slots are reused by new particles, and any slots left
+over are closed by moving particles from the end of the arrays, so that
+steady-state operation never allocates memory. Arrays can be drawn from
+a particle arena, which leaves their pages unplaced until each range is
+first written by the thread that will step it.
+***********************************************************************/
+
+#include "ParticleStore.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <Math/Constants.h>
+
+#include "ParticleArena.h"
+#include "Simd.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+template <class ElementParam>
+inline ElementParam* allocateArray(ParticleArena* arena,size_t numElements) // Allocates a zero-initialized, SIMD-aligned array from the given arena or from the heap
+	{
+	void* result=0;
+	if(numElements>0)
+		{
+		if(arena!=0)
+			{
+			/* Arena blocks are page-aligned and come zero-filled, with their pages not yet placed: */
+			result=arena->allocate(numElements*sizeof(ElementParam));
+			}
+		else
+			{
+			if(posix_memalign(&result,Simd::alignment,numElements*sizeof(ElementParam))!=0)
+				throw std::bad_alloc();
+			memset(result,0,numElements*sizeof(ElementParam));
+			}
+		}
+	return static_cast<ElementParam*>(result);
+	}
+
+template <class ElementParam>
+inline void releaseArray(ParticleArena* arena,ElementParam* array,size_t numElements) // Releases an array allocated by allocateArray
+	{
+	if(arena!=0)
+		arena->release(array,numElements*sizeof(ElementParam));
+	else
+		free(array);
+	}
+
+template <class ElementParam>
+inline void reallocateArray(ParticleArena* arena,ElementParam*& array,size_t numElements,size_t capacity,size_t newCapacity) // Moves an array's first elements into a larger aligned array
+	{
+	ElementParam* newArray=allocateArray<ElementParam>(arena,newCapacity);
+	if(numElements>0)
+		memcpy(newArray,array,numElements*sizeof(ElementParam));
+	releaseArray(arena,array,capacity);
+	array=newArray;
+	}
+
+template <class ElementParam>
+inline size_t getArraySize(const ParticleArena* arena,size_t numElements) // Returns the number of bytes taken up by an array allocated by allocateArray
+	{
+	size_t size=numElements*sizeof(ElementParam);
+	return arena!=0&&size>0?arena->getBlockSize(size):size;
+	}
+
+template <class ElementParam>
+inline void zeroArray(ElementParam* array,size_t begin,size_t end) // Writes zeros into a range of an array
+	{
+	if(end>begin)
+		memset(array+begin,0,(end-begin)*sizeof(ElementParam));
+	}
+
+template <class ElementParam>
+inline bool readArray(FILE* file,ElementParam* array,size_t numElements,size_t numSkippedElements) // Reads elements from a file into an array and skips the given number of elements following them
+	{
+	if(fread(array,sizeof(ElementParam),numElements,file)!=numElements)
+		return false;
+	return numSkippedElements==0||fseek(file,long(numSkippedElements*sizeof(ElementParam)),SEEK_CUR)==0;
+	}
+
+}
+
+/******************************
+Methods of class ParticleStore:
+******************************/
+
+void ParticleStore::moveParticle(size_t source,size_t dest)
+	{
+	for(int i=0;i<3;++i)
+		{
+		positions[i][dest]=positions[i][source];
+		previousPositions[i][dest]=previousPositions[i][source];
+		}
+	if(masterPositions[0]!=0)
+		for(int i=0;i<3;++i)
+			masterPositions[i][dest]=masterPositions[i][source];
+	for(int i=0;i<4;++i)
+		colors[i][dest]=colors[i][source];
+	birthTimes[dest]=birthTimes[source];
+	expiryTimes[dest]=expiryTimes[source];
+	ids[dest]=ids[source];
+	}
+
+ParticleStore::ParticleStore(size_t sCapacity,ParticleArena* sArena)
+	:arena(sArena),capacity(0),numParticles(0),
+	 birthTimes(0),expiryTimes(0),ids(0),nextId(0),earliestExpiry(Math::Constants<float>::max),
+	 freeSlots(0),numFreeSlots(0)
+	{
+	for(int i=0;i<3;++i)
+		positions[i]=previousPositions[i]=0;
+	for(int i=0;i<3;++i)
+		masterPositions[i]=0;
+	for(int i=0;i<4;++i)
+		colors[i]=0;
+
+	reserve(sCapacity);
+	}
+
+ParticleStore::~ParticleStore(void)
+	{
+	for(int i=0;i<3;++i)
+		{
+		releaseArray(arena,positions[i],capacity);
+		releaseArray(arena,previousPositions[i],capacity);
+		releaseArray(arena,masterPositions[i],capacity);
+		}
+	for(int i=0;i<4;++i)
+		releaseArray(arena,colors[i],capacity);
+	releaseArray(arena,birthTimes,capacity);
+	releaseArray(arena,expiryTimes,capacity);
+	releaseArray(arena,ids,capacity);
+	releaseArray(arena,freeSlots,capacity);
+	}
+
+size_t ParticleStore::padToPackSize(size_t numParticles)
+	{
+	return Simd::padToLanes(numParticles);
+	}
+
+size_t ParticleStore::getMemorySize(size_t capacity,bool masterPositions,const ParticleArena* arena)
+	{
+	capacity=Simd::padToLanes(capacity);
+	size_t result=getArraySize<Scalar>(arena,capacity)*6;
+	if(masterPositions)
+		result+=getArraySize<MasterScalar>(arena,capacity)*3;
+	result+=getArraySize<Color>(arena,capacity)*4;
+	result+=getArraySize<float>(arena,capacity)*2;
+	result+=getArraySize<Id>(arena,capacity);
+	result+=getArraySize<Index>(arena,capacity);
+	return result;
+	}
+
+size_t ParticleStore::getPaddedNumParticles(void) const
+	{
+	return Simd::padToLanes(numParticles);
+	}
+
+void ParticleStore::reserve(size_t newCapacity)
+	{
+	/* Pad the new capacity so that kernels can always process full packs: */
+	newCapacity=Simd::padToLanes(newCapacity);
+	if(newCapacity<=capacity)
+		return;
+
+	/* Move all arrays into larger ones: */
+	for(int i=0;i<3;++i)
+		{
+		reallocateArray(arena,positions[i],numParticles,capacity,newCapacity);
+		reallocateArray(arena,previousPositions[i],numParticles,capacity,newCapacity);
+		if(masterPositions[i]!=0)
+			reallocateArray(arena,masterPositions[i],numParticles,capacity,newCapacity);
+		}
+	for(int i=0;i<4;++i)
+		reallocateArray(arena,colors[i],numParticles,capacity,newCapacity);
+	reallocateArray(arena,birthTimes,numParticles,capacity,newCapacity);
+	reallocateArray(arena,expiryTimes,numParticles,capacity,newCapacity);
+	reallocateArray(arena,ids,numParticles,capacity,newCapacity);
+	reallocateArray(arena,freeSlots,numFreeSlots,capacity,newCapacity);
+	capacity=newCapacity;
+	}
+
+void ParticleStore::placeArrays(size_t begin,size_t end)
+	{
+	for(int i=0;i<3;++i)
+		{
+		zeroArray(positions[i],begin,end);
+		zeroArray(previousPositions[i],begin,end);
+		if(masterPositions[i]!=0)
+			zeroArray(masterPositions[i],begin,end);
+		}
+	for(int i=0;i<4;++i)
+		zeroArray(colors[i],begin,end);
+	zeroArray(birthTimes,begin,end);
+	zeroArray(expiryTimes,begin,end);
+	zeroArray(ids,begin,end);
+	zeroArray(freeSlots,begin,end);
+	}
+
+void ParticleStore::enableMasterPositions(void)
+	{
+	if(masterPositions[0]!=0)
+		return;
+
+	/* Start the master copy from the current positions, including the padding slots seen by the kernels: */
+	allocateMasterPositions();
+	copyMasterPositions(0,capacity);
+	}
+
+void ParticleStore::allocateMasterPositions(void)
+	{
+	if(masterPositions[0]!=0)
+		return;
+
+	for(int i=0;i<3;++i)
+		masterPositions[i]=allocateArray<MasterScalar>(arena,capacity);
+	}
+
+void ParticleStore::copyMasterPositions(size_t begin,size_t end)
+	{
+	for(int i=0;i<3;++i)
+		for(size_t j=begin;j<end;++j)
+			masterPositions[i][j]=positions[i][j];
+	}
+
+bool ParticleStore::addParticle(const ParticleStore::Scalar position[3],const ParticleStore::Color color[4],float birthTime,float expiryTime)
+	{
+	/* Reuse the most recently freed slot, or append a new slot: */
+	size_t slot;
+	if(numFreeSlots>0)
+		slot=freeSlots[--numFreeSlots];
+	else if(numParticles<capacity)
+		slot=numParticles++;
+	else
+		return false;
+
+	setParticle(slot,position,color,birthTime,expiryTime);
+	if(earliestExpiry>expiryTime)
+		earliestExpiry=expiryTime;
+
+	return true;
+	}
+
+void ParticleStore::savePreviousPositions(size_t begin,size_t end)
+	{
+	if(end>begin)
+		for(int i=0;i<3;++i)
+			memcpy(previousPositions[i]+begin,positions[i]+begin,(end-begin)*sizeof(Scalar));
+	}
+
+void ParticleStore::beginExpirySweep(void)
+	{
+	/* Reset the earliest expiry time; the sweep's commits will recalculate it from the survivors: */
+	earliestExpiry=Math::Constants<float>::max;
+	}
+
+ParticleStore::ExpirySweep ParticleStore::findExpired(double currentTime,size_t begin,size_t end)
+	{
+	/* Record the expired slots in the range's own section of the staging area: */
+	ExpirySweep result;
+	result.numExpired=0;
+	result.earliestExpiry=Math::Constants<float>::max;
+	Index* stagePtr=freeSlots+begin;
+	for(size_t i=begin;i<end;++i)
+		{
+		if(double(expiryTimes[i])>currentTime)
+			{
+			if(result.earliestExpiry>expiryTimes[i])
+				result.earliestExpiry=expiryTimes[i];
+			}
+		else
+			{
+			*stagePtr=Index(i);
+			++stagePtr;
+			++result.numExpired;
+			}
+		}
+
+	return result;
+	}
+
+void ParticleStore::commitExpired(size_t begin,const ParticleStore::ExpirySweep& sweep)
+	{
+	/* Move the range's staged slots down to the end of the free list; the free list never extends past begin: */
+	if(sweep.numExpired>0&&numFreeSlots!=begin)
+		memmove(freeSlots+numFreeSlots,freeSlots+begin,sweep.numExpired*sizeof(Index));
+	numFreeSlots+=sweep.numExpired;
+	if(earliestExpiry>sweep.earliestExpiry)
+		earliestExpiry=sweep.earliestExpiry;
+	}
+
+void ParticleStore::closeFreeSlots(void)
+	{
+	/* Fill free slots from the lowest one up with particles from the end of the arrays: */
+	size_t low=0;
+	size_t high=numFreeSlots;
+	while(low<high)
+		{
+		--numParticles;
+		if(freeSlots[high-1]==numParticles)
+			{
+			/* The last slot is free itself; drop it: */
+			--high;
+			}
+		else
+			{
+			/* Move the last particle into the lowest free slot: */
+			moveParticle(numParticles,freeSlots[low]);
+			++low;
+			}
+		}
+	numFreeSlots=0;
+	}
+
+bool ParticleStore::writeArrays(FILE* file) const
+	{
+	bool ok=true;
+	for(int i=0;i<3;++i)
+		ok=ok&&fwrite(positions[i],sizeof(Scalar),numParticles,file)==numParticles;
+	for(int i=0;i<4;++i)
+		ok=ok&&fwrite(colors[i],sizeof(Color),numParticles,file)==numParticles;
+	ok=ok&&fwrite(birthTimes,sizeof(float),numParticles,file)==numParticles;
+	ok=ok&&fwrite(expiryTimes,sizeof(float),numParticles,file)==numParticles;
+	ok=ok&&fwrite(ids,sizeof(Id),numParticles,file)==numParticles;
+	return ok;
+	}
+
+bool ParticleStore::readArrays(FILE* file,size_t numStoredParticles,ParticleStore::Id newNextId,float timeOffset)
+	{
+	/* Discard all particles and read the new ones straight into the arrays: */
+	numParticles=0;
+	numFreeSlots=0;
+	earliestExpiry=Math::Constants<float>::max;
+	size_t newNumParticles=numStoredParticles<capacity?numStoredParticles:capacity;
+	size_t numDropped=numStoredParticles-newNumParticles;
+	bool ok=true;
+	for(int i=0;i<3;++i)
+		ok=ok&&readArray(file,positions[i],newNumParticles,numDropped);
+	for(int i=0;i<4;++i)
+		ok=ok&&readArray(file,colors[i],newNumParticles,numDropped);
+	ok=ok&&readArray(file,birthTimes,newNumParticles,numDropped);
+	ok=ok&&readArray(file,expiryTimes,newNumParticles,numDropped);
+	ok=ok&&readArray(file,ids,newNumParticles,numDropped);
+	if(!ok)
+		return false;
+
+	/* Start the particles without motion to interpolate, and move their lifespans to the new time base: */
+	savePreviousPositions(0,newNumParticles);
+	if(masterPositions[0]!=0)
+		for(int i=0;i<3;++i)
+			for(size_t j=0;j<newNumParticles;++j)
+				masterPositions[i][j]=positions[i][j];
+	for(size_t i=0;i<newNumParticles;++i)
+		{
+		birthTimes[i]+=timeOffset;
+		expiryTimes[i]+=timeOffset;
+		if(earliestExpiry>expiryTimes[i])
+			earliestExpiry=expiryTimes[i];
+		}
+	numParticles=newNumParticles;
+	nextId=newNextId;
+
+	return true;
+	}
+
+void ParticleStore::exportQuantizedVertices(QuantizedVertex* vertices,size_t begin,size_t end,const VertexQuantizer& quantizer) const
+	{
+	vertices+=begin;
+	for(size_t i=begin;i<end;++i,++vertices)
+		writeQuantizedVertex(i,*vertices,quantizer);
+	}
+
+void ParticleStore::scatterQuantizedVertices(QuantizedVertex* vertices,size_t begin,size_t end,const unsigned int* vertexIndices,const VertexQuantizer& quantizer) const
+	{
+	for(size_t i=begin;i<end;++i,++vertexIndices)
+		writeQuantizedVertex(i,vertices[*vertexIndices],quantizer);
+	}
+
+size_t ParticleStore::removeExpired(double currentTime)
+	{
+	if(!needsExpirySweep(currentTime))
+		return 0;
+
+	/* Sweep the whole array at once and close all freed slots: */
+	beginExpirySweep();
+	ExpirySweep sweep=findExpired(currentTime,0,numParticles);
+	commitExpired(0,sweep);
+	closeFreeSlots();
+
+	return sweep.numExpired;
+	}
@@ -0,0 +1,312 @@
+/***********************************************************************
+ParticleStore - Structure-of-arrays storage of particle state. Each
+particle attribute (x, y, z, the four color channels, the birth and
+expiry times, the x, y, z before the most recent step, and a persistent
+id that survives moves between slots) lives in its own SIMD-aligned
+array, which lets the step kernels process a full register of particles
+per instruction. The interleaved vertex representation
+used for rendering is only created when the particles are handed off to
+a vertex buffer.
+In high-accuracy mode, the store also keeps a double-precision master
+copy of the positions, which the step kernels advance instead, rounding
+the results into the single-precision positions read by everything
+else.
+The store is a pool of fixed capacity. Expired particles are recorded in
+a free list whose slots are reused by new particles, and any slots left
+over are closed by moving particles from the end of the arrays, so that
+steady-state operation never allocates memory. Arrays can be drawn from
+a particle arena, which leaves their pages unplaced until each range is
+first written by the thread that will step it.
+***********************************************************************/
+
+#ifndef PARTICLESTORE_INCLUDED
+#define PARTICLESTORE_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "QuantizedVertex.h"
+
+/* Forward declarations: */
+class ParticleArena;
+
+class ParticleStore
+	{
+	/* Embedded classes: */
+	public:
+	typedef float Scalar; // Scalar type for particle positions
+	typedef double MasterScalar; // Scalar type for the master copy of particle positions in high-accuracy mode
+	typedef unsigned char Color; // Type for particle color channels
+	typedef unsigned int Index; // Type for particle slot indices
+	typedef unsigned int Id; // Type for persistent particle identifiers
+
+	struct ExpirySweep // Result of searching a range of particles for expired ones
+		{
+		/* Elements: */
+		public:
+		size_t numExpired; // Number of expired particles found in the range
+		float earliestExpiry; // Earliest expiry time of the surviving particles in the range
+		};
+
+	/* Elements: */
+	private:
+	ParticleArena* arena; // Arena from which arrays are allocated, or null to allocate them from the heap
+	size_t capacity; // Number of particles for which arrays are allocated; always a multiple of the SIMD pack width
+	size_t numParticles; // Number of particle slots in use, including free slots not yet closed
+	Scalar* positions[3]; // Arrays of particle x, y, and z coordinates
+	Scalar* previousPositions[3]; // Arrays of particle x, y, and z coordinates before the most recent step
+	MasterScalar* masterPositions[3]; // Arrays of double-precision particle x, y, and z coordinates from which positions are rounded after every step, or null if high-accuracy mode is off
+	Color* colors[4]; // Arrays of particle red, green, blue, and alpha channels
+	float* birthTimes; // Array of application times at which particles were seeded
+	float* expiryTimes; // Array of application times at which particles die
+	Id* ids; // Array of persistent particle identifiers, assigned in order of seeding
+	Id nextId; // Identifier assigned to the next seeded particle
+	float earliestExpiry; // Earliest expiry time of all live particles; no particle expires before this
+	Index* freeSlots; // Free list of slots of expired particles in ascending order, doubling as staging area for expiry sweeps
+	size_t numFreeSlots; // Number of slots in the free list
+
+	/* Private methods: */
+	ParticleStore(const ParticleStore& source); // Prohibit copy constructor
+	ParticleStore& operator=(const ParticleStore& source); // Prohibit assignment operator
+	void moveParticle(size_t source,size_t dest); // Copies a particle from one slot to another
+	void setParticle(size_t slot,const Scalar position[3],const Color color[4],float birthTime,float expiryTime) // Writes a new particle into the given slot
+		{
+		for(int i=0;i<3;++i)
+			positions[i][slot]=previousPositions[i][slot]=position[i];
+		if(masterPositions[0]!=0)
+			for(int i=0;i<3;++i)
+				masterPositions[i][slot]=position[i];
+		for(int i=0;i<4;++i)
+			colors[i][slot]=color[i];
+		birthTimes[slot]=birthTime;
+		expiryTimes[slot]=expiryTime;
+		ids[slot]=nextId++;
+		}
+	void writeQuantizedVertex(size_t slot,QuantizedVertex& vertex,const VertexQuantizer& quantizer) const // Writes the particle in the given slot into a compact vertex
+		{
+		for(int j=0;j<3;++j)
+			{
+			vertex.position[j]=quantizer.encodeCoordinate(j,positions[j][slot]);
+			vertex.previousPosition[j]=quantizer.encodeCoordinate(j,previousPositions[j][slot]);
+			}
+		vertex.age=quantizer.encodeAge(birthTimes[slot]);
+		vertex.lifespan=quantizer.encodeLifespan(expiryTimes[slot]-birthTimes[slot]);
+		for(int j=0;j<4;++j)
+			vertex.color[j]=colors[j][slot];
+		}
+	template <class VertexParam>
+	void writeInterpolationVertex(size_t slot,VertexParam& vertex) const // Writes the particle in the given slot into an interleaved vertex
+		{
+		vertex.texCoord[0]=birthTimes[slot];
+		vertex.texCoord[1]=expiryTimes[slot]-birthTimes[slot];
+		for(int j=0;j<4;++j)
+			vertex.color[j]=colors[j][slot];
+		for(int j=0;j<3;++j)
+			{
+			vertex.normal[j]=previousPositions[j][slot];
+			vertex.position[j]=positions[j][slot];
+			}
+		}
+
+	/* Constructors and destructors: */
+	public:
+	ParticleStore(size_t sCapacity =0,ParticleArena* sArena =0); // Creates an empty particle store with the given capacity, allocating its arrays from the given arena or from the heap
+	~ParticleStore(void);
+
+	/* Methods: */
+	size_t getNumParticles(void) const // Returns the number of used particle slots; equal to the number of live particles while the free list is empty
+		{
+		return numParticles;
+		}
+	size_t getCapacity(void) const // Returns the maximum number of particles
+		{
+		return capacity;
+		}
+	static size_t padToPackSize(size_t numParticles); // Rounds a number of particles up to the SIMD pack width
+	static size_t getMemorySize(size_t capacity,bool masterPositions,const ParticleArena* arena); // Returns the number of bytes taken up by the arrays of a store of the given capacity, with or without master positions, allocated from the given arena or from the heap
+	size_t getPaddedNumParticles(void) const; // Returns the number of used particle slots rounded up to the SIMD pack width; kernels may process this many
+	void reserve(size_t newCapacity); // Grows the arrays to hold at least the given number of particles; must not be called during an expiry sweep
+	void placeArrays(size_t begin,size_t end); // Writes zeros into slots [begin, end) of all arrays of an empty store, so that their pages are placed near the calling thread; can be called concurrently on disjoint ranges
+	void enableMasterPositions(void); // Switches to high-accuracy mode, starting the master copy from the current positions
+	void allocateMasterPositions(void); // Switches to high-accuracy mode like enableMasterPositions, but leaves starting the master copy to copyMasterPositions
+	void copyMasterPositions(size_t begin,size_t end); // Starts the master copy of slots [begin, end) from their positions; can be called concurrently on disjoint ranges
+	bool hasMasterPositions(void) const // Returns true if the store is in high-accuracy mode
+		{
+		return masterPositions[0]!=0;
+		}
+	bool addParticle(const Scalar position[3],const Color color[4],float birthTime,float expiryTime); // Adds a new particle into a free slot or at the end, with its previous position equal to its position; returns false if the store is full
+	template <class SeedParam>
+	size_t addParticles(const SeedParam* seeds,size_t numSeeds,float birthTime,float expiryTime) // Adds a batch of new particles with position and color components, filling free slots first and appending the rest in one run; returns the number of particles added
+		{
+		size_t numAdded=0;
+		
+		/* Reuse the most recently freed slots: */
+		for(;numAdded<numSeeds&&numFreeSlots>0;++numAdded)
+			setParticle(freeSlots[--numFreeSlots],seeds[numAdded].position,seeds[numAdded].color,birthTime,expiryTime);
+		
+		/* Append the remaining particles as one contiguous run per attribute array: */
+		size_t numAppended=numSeeds-numAdded;
+		if(numAppended>capacity-numParticles)
+			numAppended=capacity-numParticles;
+		for(int i=0;i<3;++i)
+			{
+			Scalar* pPtr=positions[i]+numParticles;
+			Scalar* ppPtr=previousPositions[i]+numParticles;
+			for(size_t j=0;j<numAppended;++j)
+				pPtr[j]=ppPtr[j]=seeds[numAdded+j].position[i];
+			if(masterPositions[i]!=0)
+				{
+				MasterScalar* mpPtr=masterPositions[i]+numParticles;
+				for(size_t j=0;j<numAppended;++j)
+					mpPtr[j]=seeds[numAdded+j].position[i];
+				}
+			}
+		for(int i=0;i<4;++i)
+			{
+			Color* cPtr=colors[i]+numParticles;
+			for(size_t j=0;j<numAppended;++j)
+				cPtr[j]=seeds[numAdded+j].color[i];
+			}
+		float* bPtr=birthTimes+numParticles;
+		float* ePtr=expiryTimes+numParticles;
+		Id* iPtr=ids+numParticles;
+		for(size_t j=0;j<numAppended;++j)
+			{
+			bPtr[j]=birthTime;
+			ePtr[j]=expiryTime;
+			iPtr[j]=nextId++;
+			}
+		numParticles+=numAppended;
+		numAdded+=numAppended;
+		
+		if(numAdded>0&&earliestExpiry>expiryTime)
+			earliestExpiry=expiryTime;
+		
+		return numAdded;
+		}
+	void savePreviousPositions(size_t begin,size_t end); // Copies the positions of particles [begin, end) into their previous positions before a step; can be called concurrently on disjoint ranges
+	bool needsExpirySweep(double currentTime) const // Returns true if any particle has expired at the given time
+		{
+		return numParticles>0&&double(earliestExpiry)<=currentTime;
+		}
+	void beginExpirySweep(void); // Starts a sweep for expired particles; free list must be empty
+	ExpirySweep findExpired(double currentTime,size_t begin,size_t end); // Stages the slots of expired particles in [begin, end); can be called concurrently on disjoint ranges
+	void commitExpired(size_t begin,const ExpirySweep& sweep); // Adds the slots staged by findExpired for a range starting at begin to the free list; must be called serially in ascending order of begin
+	size_t getNumFreeSlots(void) const // Returns the number of free slots waiting to be reused or closed
+		{
+		return numFreeSlots;
+		}
+	void closeFreeSlots(void); // Removes all remaining free slots by moving particles from the end of the arrays into them
+	size_t removeExpired(double currentTime); // Removes all particles whose expiry time is not after the given time in one serial sweep; returns number of removed particles
+	Scalar* getPositions(int dimension) // Returns the array of particle coordinates along the given dimension
+		{
+		return positions[dimension];
+		}
+	const Scalar* getPositions(int dimension) const
+		{
+		return positions[dimension];
+		}
+	MasterScalar* getMasterPositions(int dimension) // Returns the array of double-precision particle coordinates along the given dimension, or null if high-accuracy mode is off
+		{
+		return masterPositions[dimension];
+		}
+	const Scalar* getPreviousPositions(int dimension) const // Returns the array of particle coordinates before the most recent step along the given dimension
+		{
+		return previousPositions[dimension];
+		}
+	Color* getColors(int channel) // Returns the array of the given particle color channel
+		{
+		return colors[channel];
+		}
+	const Color* getColors(int channel) const
+		{
+		return colors[channel];
+		}
+	const float* getBirthTimes(void) const // Returns the array of particle birth times
+		{
+		return birthTimes;
+		}
+	const float* getExpiryTimes(void) const // Returns the array of particle expiry times
+		{
+		return expiryTimes;
+		}
+	const Id* getIds(void) const // Returns the array of persistent particle identifiers
+		{
+		return ids;
+		}
+	Id getNextId(void) const // Returns the identifier that will be assigned to the next seeded particle
+		{
+		return nextId;
+		}
+	bool writeArrays(FILE* file) const; // Writes the positions, colors, birth and expiry times, and ids of all used slots to the given file as one contiguous run per array; free list must be empty; returns false on write errors
+	bool readArrays(FILE* file,size_t numStoredParticles,Id newNextId,float timeOffset); // Replaces all particles by the given number of particles read from the given file as written by writeArrays, dropping those beyond the store's capacity, and shifts their birth and expiry times by the given offset; returns false and leaves the store empty on read errors
+	template <class VertexParam>
+	void exportVertices(VertexParam* vertices,size_t begin,size_t end) const // Writes live particles [begin, end) into the same range of an interleaved vertex array with color and position components
+		{
+		vertices+=begin;
+		for(size_t i=begin;i<end;++i,++vertices)
+			{
+			for(int j=0;j<4;++j)
+				vertices->color[j]=colors[j][i];
+			for(int j=0;j<3;++j)
+				vertices->position[j]=positions[j][i];
+			}
+		}
+	template <class VertexParam>
+	void exportVertices(VertexParam* vertices) const // Writes all live particles into an interleaved vertex array
+		{
+		exportVertices(vertices,0,numParticles);
+		}
+	template <class VertexParam>
+	void exportInterpolationVertices(VertexParam* vertices,size_t begin,size_t end) const // Writes live particles [begin, end) into an interleaved vertex array, storing birth times and lifespans in the vertices' texture coordinates and previous positions in their normal components
+		{
+		vertices+=begin;
+		for(size_t i=begin;i<end;++i,++vertices)
+			writeInterpolationVertex(i,*vertices);
+		}
+	template <class VertexParam>
+	void exportMotionVertices(VertexParam* vertices,size_t begin,size_t end) const // Writes live particles [begin, end) into the same range of a vertex array holding only the parts that change with every step, previous positions in the vertices' normal components and positions
+		{
+		vertices+=begin;
+		for(size_t i=begin;i<end;++i,++vertices)
+			for(int j=0;j<3;++j)
+				{
+				vertices->normal[j]=previousPositions[j][i];
+				vertices->position[j]=positions[j][i];
+				}
+		}
+	template <class VertexParam>
+	void gatherAttributeVertices(VertexParam* vertices,size_t begin,size_t end) const // Writes live particles [begin, end) into consecutive vertices starting at the given one, holding only the parts that stay fixed while a particle keeps its slot, birth times and lifespans in the vertices' texture coordinates and colors
+		{
+		for(size_t i=begin;i<end;++i,++vertices)
+			{
+			vertices->texCoord[0]=birthTimes[i];
+			vertices->texCoord[1]=expiryTimes[i]-birthTimes[i];
+			for(int j=0;j<4;++j)
+				vertices->color[j]=colors[j][i];
+			}
+		}
+	template <class VertexParam>
+	void scatterInterpolationVertices(VertexParam* vertices,size_t begin,size_t end,const unsigned int* vertexIndices) const // Writes live particles [begin, end) into an interleaved vertex array like exportInterpolationVertices, but each particle to the vertex of the given index, starting with that of particle begin
+		{
+		for(size_t i=begin;i<end;++i,++vertexIndices)
+			writeInterpolationVertex(i,vertices[*vertexIndices]);
+		}
+	template <class VertexParam>
+	void exportTrailVertices(VertexParam* vertices,size_t begin,size_t end) const // Writes live particles [begin, end) into the same range of an interleaved trail history array with position, tag, and color components, tagging each vertex with the low 24 bits of its particle's id
+		{
+		vertices+=begin;
+		for(size_t i=begin;i<end;++i,++vertices)
+			{
+			for(int j=0;j<3;++j)
+				vertices->position[j]=positions[j][i];
+			vertices->tag=float(ids[i]&0xffffffU);
+			for(int j=0;j<4;++j)
+				vertices->color[j]=colors[j][i];
+			}
+		}
+	void exportQuantizedVertices(QuantizedVertex* vertices,size_t begin,size_t end,const VertexQuantizer& quantizer) const; // Writes live particles [begin, end) into the same range of a compact vertex array, encoded by the given quantizer
+	void scatterQuantizedVertices(QuantizedVertex* vertices,size_t begin,size_t end,const unsigned int* vertexIndices,const VertexQuantizer& quantizer) const; // Writes live particles [begin, end) into a compact vertex array like exportQuantizedVertices, but each particle to the vertex of the given index, starting with that of particle begin
+	};
+
+#endif
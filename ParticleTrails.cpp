@@ -0,0 +1,199 @@
+/***********************************************************************
+ParticleTrails - Renderer drawing the recent path of every particle as a
+trail. Each context keeps a ring of history layers in one vertex buffer,
+each layer holding one vertex per particle slot; every new particle
+state overwrites the oldest layer with a single upload, so the traffic
+per state is one vertex per particle no matter how long the trails are.
+Trails are drawn as instanced line segments between consecutive layers,
+one instance per slot, reading both endpoints from the two layers'
+arrays; a segment whose endpoints were written by different particles,
+because the slot was recycled or compacted in between, is dropped by the
+vertex shader. Segments darken with the age of their layers.
+Requires OpenGL 3.3 or the GL_ARB_instanced_arrays and
+GL_ARB_draw_instanced extensions.
+***********************************************************************/
+
+#include "ParticleTrails.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <GL/glext.h>
+#include <GL/GLContextData.h>
+#include <GL/GLExtensionManager.h>
+
+#include "ShaderHelpers.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const char* renderVertexSource=
+	"#version 120\n"
+	"attribute float endpoint;\n"
+	"attribute vec4 fromPositionTag;\n"
+	"attribute vec4 toPositionTag;\n"
+	"attribute vec4 color;\n"
+	"uniform vec2 layerBrightness;\n"
+	"void main()\n"
+	"	{\n"
+	"	if(fromPositionTag.w!=toPositionTag.w)\n"
+	"		{\n"
+	"		/* The slot changed particles between the two layers; move the whole segment outside the view volume: */\n"
+	"		gl_Position=vec4(2.0,2.0,2.0,1.0);\n"
+	"		}\n"
+	"	else\n"
+	"		gl_Position=gl_ModelViewProjectionMatrix*vec4(mix(fromPositionTag.xyz,toPositionTag.xyz,endpoint),1.0);\n"
+	"	gl_FrontColor=vec4(color.rgb*mix(layerBrightness.x,layerBrightness.y,endpoint),color.a);\n"
+	"	}\n";
+
+const char* renderFragmentSource=
+	"#version 120\n"
+	"void main()\n"
+	"	{\n"
+	"	gl_FragColor=gl_Color;\n"
+	"	}\n";
+
+const char* renderAttributeNames[4]=
+	{
+	"endpoint","fromPositionTag","toPositionTag","color"
+	};
+
+/* Names of the render program's uniform variables, in the order of DataItem::renderUniforms: */
+const char* renderUniformNames[1]=
+	{
+	"layerBrightness"
+	};
+
+const GLfloat endpoints[2]={0.0f,1.0f}; // Endpoint selectors of the two vertices of a line segment
+
+}
+
+/*******************************************
+Methods of class ParticleTrails::DataItem:
+*******************************************/
+
+ParticleTrails::DataItem::DataItem(unsigned int numLayers)
+	:supported(GLExtensionManager::isExtensionSupported("GL_ARB_instanced_arrays")&&GLExtensionManager::isExtensionSupported("GL_ARB_draw_instanced")),
+	 historyBufferId(0),endpointBufferId(0),
+	 renderProgram(0),
+	 newestLayer(0),numFilledLayers(0),
+	 layerNumVertices(numLayers,0),
+	 uploadedStateTime(-1.0)
+	{
+	renderUniforms[0]=-1;
+	}
+
+ParticleTrails::DataItem::~DataItem(void)
+	{
+	if(historyBufferId!=0)
+		glDeleteBuffers(1,&historyBufferId);
+	if(endpointBufferId!=0)
+		glDeleteBuffers(1,&endpointBufferId);
+	if(renderProgram!=0)
+		glDeleteProgram(renderProgram);
+	}
+
+/*******************************
+Methods of class ParticleTrails:
+*******************************/
+
+ParticleTrails::ParticleTrails(size_t sCapacity,unsigned int sNumLayers)
+	:capacity(sCapacity>0?sCapacity:1),
+	 numLayers(sNumLayers>2?sNumLayers:2)
+	{
+	}
+
+void ParticleTrails::initContext(GLContextData& contextData) const
+	{
+	DataItem* dataItem=new DataItem(numLayers);
+	contextData.addDataItem(this,dataItem);
+
+	if(!dataItem->supported)
+		{
+		std::cerr<<"ParticleTrails: OpenGL context does not support instanced drawing; trails will not be shown"<<std::endl;
+		return;
+		}
+
+	/* Allocate the history buffer once for all layers; layers are only ever overwritten in place: */
+	glGenBuffers(1,&dataItem->historyBufferId);
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->historyBufferId);
+	glBufferData(GL_ARRAY_BUFFER,getLayerOffset(numLayers),0,GL_DYNAMIC_DRAW);
+
+	/* Upload the vertices shared by all segment instances: */
+	glGenBuffers(1,&dataItem->endpointBufferId);
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->endpointBufferId);
+	glBufferData(GL_ARRAY_BUFFER,sizeof(endpoints),endpoints,GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+
+	try
+		{
+		dataItem->renderProgram=ShaderHelpers::createRenderProgram(renderVertexSource,renderFragmentSource,renderAttributeNames,4);
+		dataItem->renderUniforms[0]=glGetUniformLocation(dataItem->renderProgram,renderUniformNames[0]);
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"ParticleTrails: "<<err.what()<<"; trails will not be shown"<<std::endl;
+		}
+	}
+
+void ParticleTrails::display(GLContextData& contextData,const ParticleTrails::Vertex* vertices,size_t numVertices,double stateTime) const
+	{
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	if(dataItem->renderProgram==0)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->historyBufferId);
+	if(dataItem->uploadedStateTime!=stateTime)
+		{
+		/* Overwrite the oldest layer with the new state: */
+		dataItem->newestLayer=(dataItem->newestLayer+1)%numLayers;
+		size_t numLayerVertices=numVertices<capacity?numVertices:capacity;
+		glBufferSubData(GL_ARRAY_BUFFER,getLayerOffset(dataItem->newestLayer),numLayerVertices*sizeof(Vertex),vertices);
+		dataItem->layerNumVertices[dataItem->newestLayer]=numLayerVertices;
+		if(dataItem->numFilledLayers<numLayers)
+			++dataItem->numFilledLayers;
+		dataItem->uploadedStateTime=stateTime;
+		}
+
+	if(dataItem->numFilledLayers>=2)
+		{
+		glUseProgram(dataItem->renderProgram);
+
+		/* Read the endpoint selector per vertex, and both endpoints and the color per segment instance: */
+		for(GLuint i=0;i<4;++i)
+			glEnableVertexAttribArray(i);
+		glBindBuffer(GL_ARRAY_BUFFER,dataItem->endpointBufferId);
+		glVertexAttribPointer(0,1,GL_FLOAT,GL_FALSE,0,0);
+		glBindBuffer(GL_ARRAY_BUFFER,dataItem->historyBufferId);
+		for(GLuint i=1;i<4;++i)
+			glVertexAttribDivisor(i,1);
+
+		/* Draw the segments between each pair of consecutive layers, from the oldest to the newest: */
+		for(unsigned int age=dataItem->numFilledLayers-1;age>0;--age)
+			{
+			unsigned int from=(dataItem->newestLayer+numLayers-age)%numLayers;
+			unsigned int to=(from+1)%numLayers;
+			size_t numSegments=dataItem->layerNumVertices[from]<dataItem->layerNumVertices[to]?dataItem->layerNumVertices[from]:dataItem->layerNumVertices[to];
+			if(numSegments==0)
+				continue;
+
+			glUniform2f(dataItem->renderUniforms[0],1.0f-GLfloat(age)/GLfloat(numLayers),1.0f-GLfloat(age-1)/GLfloat(numLayers));
+			const char* fromBase=reinterpret_cast<const char*>(getLayerOffset(from));
+			const char* toBase=reinterpret_cast<const char*>(getLayerOffset(to));
+			glVertexAttribPointer(1,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),fromBase+offsetof(Vertex,position));
+			glVertexAttribPointer(2,4,GL_FLOAT,GL_FALSE,sizeof(Vertex),toBase+offsetof(Vertex,position));
+			glVertexAttribPointer(3,4,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(Vertex),toBase+offsetof(Vertex,color));
+			glDrawArraysInstanced(GL_LINES,0,2,GLsizei(numSegments));
+			}
+
+		/* Reset the attribute state shared with other render programs: */
+		for(GLuint i=1;i<4;++i)
+			glVertexAttribDivisor(i,0);
+		for(GLuint i=0;i<4;++i)
+			glDisableVertexAttribArray(i);
+		glUseProgram(0);
+		}
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+	}
@@ -0,0 +1,85 @@
+/***********************************************************************
+ParticleTrails - Renderer drawing the recent path of every particle as a
+trail. Each context keeps a ring of history layers in one vertex buffer,
+each layer holding one vertex per particle slot; every new particle
+state overwrites the oldest layer with a single upload, so the traffic
+per state is one vertex per particle no matter how long the trails are.
+Trails are drawn as instanced line segments between consecutive layers,
+one instance per slot, reading both endpoints from the two layers'
+arrays; a segment whose endpoints were written by different particles,
+because the slot was recycled or compacted in between, is dropped by the
+vertex shader. Segments darken with the age of their layers.
+Requires OpenGL 3.3 or the GL_ARB_instanced_arrays and
+GL_ARB_draw_instanced extensions.
+***********************************************************************/
+
+#ifndef PARTICLETRAILS_INCLUDED
+#define PARTICLETRAILS_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+
+/* Forward declarations: */
+class GLContextData;
+
+class ParticleTrails:public GLObject
+	{
+	/* Embedded classes: */
+	public:
+	struct Vertex // Structure for one particle's entry in a history layer
+		{
+		/* Elements: */
+		public:
+		GLfloat position[3]; // Particle position
+		GLfloat tag; // Low 24 bits of the particle's persistent id, exactly representable as a float, telling apart particles that occupied the same slot
+		GLubyte color[4]; // RGBA color
+		};
+
+	private:
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elements: */
+		public:
+		bool supported; // Flag whether the context supports instanced drawing
+		GLuint historyBufferId; // ID of the vertex buffer holding all history layers
+		GLuint endpointBufferId; // ID of the vertex buffer holding the endpoint selectors of a line segment
+		GLuint renderProgram; // Shader program drawing segments between two history layers, or 0
+		GLint renderUniforms[1]; // Locations of the render program's uniform variables
+		unsigned int newestLayer; // Index of the layer holding the most recently uploaded state
+		unsigned int numFilledLayers; // Number of layers holding uploaded states
+		std::vector<size_t> layerNumVertices; // Number of valid vertices in each layer
+		double uploadedStateTime; // Time stamp of the most recently uploaded state
+
+		/* Constructors and destructors: */
+		DataItem(unsigned int numLayers);
+		virtual ~DataItem(void);
+		};
+
+	/* Elements: */
+	size_t capacity; // Maximum number of particles per layer
+	unsigned int numLayers; // Number of history layers, one more than the number of segments per trail
+
+	/* Private methods: */
+	size_t getLayerOffset(unsigned int layer) const // Returns the byte offset of the given layer in the history buffer
+		{
+		return size_t(layer)*capacity*sizeof(Vertex);
+		}
+
+	/* Constructors and destructors: */
+	public:
+	ParticleTrails(size_t sCapacity,unsigned int sNumLayers); // Creates trails for up to the given number of particles through the given number of recent states
+
+	/* Methods from GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+
+	/* New methods: */
+	unsigned int getNumLayers(void) const // Returns the number of history layers
+		{
+		return numLayers;
+		}
+	void display(GLContextData& contextData,const Vertex* vertices,size_t numVertices,double stateTime) const; // Adds the given history vertices of a state with the given time stamp as the newest layer if they are not already in the buffer, and draws all trails
+	};
+
+#endif
@@ -0,0 +1,125 @@
+/***********************************************************************
+Profiler - Low-overhead instrumentation of hot code paths. Scoped timers
+accumulate the time spent in named zones and counters accumulate event
+counts, both from any number of threads; the foreground thread condenses
+them into per-interval statistics. Optionally, every timed zone is also
+recorded into a preallocated event buffer that can be exported as a
+Chrome trace (chrome://tracing or Perfetto). While the profiler is
+disabled, a timer costs a single relaxed load and branch.
+***********************************************************************/
+
+#include "Profiler.h"
+
+#include <stdio.h>
+
+/*************************
+Methods of class Profiler:
+*************************/
+
+unsigned int Profiler::getThreadIndex(void)
+	{
+	/* Hand out indices in the order in which threads first record a zone: */
+	static std::atomic<unsigned int> nextThreadIndex(0);
+	static thread_local unsigned int threadIndex=nextThreadIndex.fetch_add(1,std::memory_order_relaxed);
+	return threadIndex;
+	}
+
+Profiler::Profiler(unsigned int sNumZones,const char* const sZoneNames[],unsigned int sNumCounters)
+	:enabled(false),
+	 numZones(sNumZones),zoneNames(sZoneNames),numCounters(sNumCounters),
+	 zones(new ZoneAccumulator[numZones]),counters(new CounterAccumulator[numCounters]),
+	 maxNumEvents(0),events(0),numEvents(0),
+	 startTime(SimulationClock::getWallTime()),snapshotTime(startTime),
+	 zoneAverages(numZones,0.0),zoneRates(numZones,0.0),counterRates(numCounters,0.0)
+	{
+	for(unsigned int i=0;i<numZones;++i)
+		{
+		zones[i].totalTime.store(0,std::memory_order_relaxed);
+		zones[i].count.store(0,std::memory_order_relaxed);
+		}
+	for(unsigned int i=0;i<numCounters;++i)
+		counters[i].total.store(0,std::memory_order_relaxed);
+	}
+
+Profiler::~Profiler(void)
+	{
+	delete[] zones;
+	delete[] counters;
+	delete[] events;
+	}
+
+void Profiler::enableTracing(size_t newMaxNumEvents)
+	{
+	delete[] events;
+	maxNumEvents=newMaxNumEvents;
+	events=maxNumEvents>0?new Event[maxNumEvents]:0;
+	numEvents.store(0,std::memory_order_relaxed);
+	}
+
+void Profiler::record(Profiler::ZoneId zone,unsigned int threadIndex,double start,double duration)
+	{
+	zones[zone].totalTime.fetch_add(uint64_t(duration*1.0e9),std::memory_order_relaxed);
+	zones[zone].count.fetch_add(1,std::memory_order_relaxed);
+
+	if(maxNumEvents>0)
+		{
+		/* Reserve a slot in the event buffer; events that do not fit are dropped: */
+		size_t eventIndex=numEvents.fetch_add(1,std::memory_order_relaxed);
+		if(eventIndex<maxNumEvents)
+			{
+			Event& event=events[eventIndex];
+			event.zone=zone;
+			event.threadIndex=threadIndex;
+			event.start=start;
+			event.duration=duration;
+			}
+		}
+	}
+
+void Profiler::takeSnapshot(double now)
+	{
+	double interval=now-snapshotTime;
+	if(interval<=0.0)
+		return;
+
+	/* Drain all accumulators; occurrences recorded concurrently end up in the next interval: */
+	for(unsigned int i=0;i<numZones;++i)
+		{
+		uint64_t totalTime=zones[i].totalTime.exchange(0,std::memory_order_relaxed);
+		uint64_t count=zones[i].count.exchange(0,std::memory_order_relaxed);
+		zoneAverages[i]=count>0?double(totalTime)*1.0e-9/double(count):0.0;
+		zoneRates[i]=double(count)/interval;
+		}
+	for(unsigned int i=0;i<numCounters;++i)
+		counterRates[i]=double(counters[i].total.exchange(0,std::memory_order_relaxed))/interval;
+
+	snapshotTime=now;
+	}
+
+size_t Profiler::getNumDroppedEvents(void) const
+	{
+	size_t numReserved=numEvents.load(std::memory_order_relaxed);
+	return numReserved>maxNumEvents?numReserved-maxNumEvents:0;
+	}
+
+bool Profiler::writeChromeTrace(const char* fileName) const
+	{
+	FILE* file=fopen(fileName,"w");
+	if(file==0)
+		return false;
+
+	/* Write complete events with microsecond time stamps relative to the profiler's creation: */
+	fprintf(file,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}",gpuThreadIndex);
+	size_t numRecorded=numEvents.load(std::memory_order_relaxed);
+	if(numRecorded>maxNumEvents)
+		numRecorded=maxNumEvents;
+	for(size_t i=0;i<numRecorded;++i)
+		{
+		const Event& event=events[i];
+		fprintf(file,",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",zoneNames[event.zone],event.threadIndex,(event.start-startTime)*1.0e6,event.duration*1.0e6);
+		}
+	fprintf(file,"\n]}\n");
+
+	return fclose(file)==0;
+	}
@@ -0,0 +1,150 @@
+/***********************************************************************
+Profiler - Low-overhead instrumentation of hot code paths. Scoped timers
+accumulate the time spent in named zones and counters accumulate event
+counts, both from any number of threads; the foreground thread condenses
+them into per-interval statistics. Optionally, every timed zone is also
+recorded into a preallocated event buffer that can be exported as a
+Chrome trace (chrome://tracing or Perfetto). While the profiler is
+disabled, a timer costs a single relaxed load and branch.
+***********************************************************************/
+
+#ifndef PROFILER_INCLUDED
+#define PROFILER_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "SimulationClock.h"
+
+class Profiler
+	{
+	/* Embedded classes: */
+	public:
+	typedef unsigned int ZoneId; // Type for indices of timed zones
+	typedef unsigned int CounterId; // Type for indices of event counters
+	static const unsigned int gpuThreadIndex=~0U; // Pseudo thread index for zones timed on the GPU
+
+	class Scope // Class timing the lifetime of an object as one occurrence of a zone
+		{
+		/* Elements: */
+		private:
+		Profiler& profiler; // Profiler receiving the measurement
+		ZoneId zone; // Timed zone
+		bool active; // Flag whether the profiler was enabled when the scope was entered
+		double start; // Wall-clock time at which the scope was entered
+
+		/* Constructors and destructors: */
+		public:
+		Scope(Profiler& sProfiler,ZoneId sZone)
+			:profiler(sProfiler),zone(sZone),active(profiler.isEnabled()),start(0.0)
+			{
+			if(active)
+				start=SimulationClock::getWallTime();
+			}
+		~Scope(void)
+			{
+			if(active)
+				profiler.recordZone(zone,start,SimulationClock::getWallTime()-start);
+			}
+		};
+
+	private:
+	struct ZoneAccumulator // Structure accumulating the occurrences of a zone since the last snapshot
+		{
+		/* Elements: */
+		public:
+		alignas(64) std::atomic<uint64_t> totalTime; // Total time spent in the zone in nanoseconds
+		std::atomic<uint64_t> count; // Number of occurrences of the zone
+		};
+
+	struct CounterAccumulator // Structure accumulating a counter since the last snapshot
+		{
+		/* Elements: */
+		public:
+		alignas(64) std::atomic<uint64_t> total; // Sum of all counted events
+		};
+
+	struct Event // Structure describing one recorded occurrence of a zone for the trace
+		{
+		/* Elements: */
+		public:
+		ZoneId zone; // Timed zone
+		unsigned int threadIndex; // Index of the recording thread, or gpuThreadIndex
+		double start; // Wall-clock start time
+		double duration; // Duration in seconds
+		};
+
+	/* Elements: */
+	std::atomic<bool> enabled; // Flag whether timers and counters are currently recording
+	unsigned int numZones; // Number of timed zones
+	const char* const* zoneNames; // Names of all timed zones
+	unsigned int numCounters; // Number of event counters
+	ZoneAccumulator* zones; // Per-zone accumulators
+	CounterAccumulator* counters; // Per-counter accumulators
+	size_t maxNumEvents; // Capacity of the trace event buffer; 0 disables tracing
+	Event* events; // Trace event buffer
+	std::atomic<size_t> numEvents; // Number of reserved slots in the trace event buffer; may exceed its capacity once it is full
+	double startTime; // Wall-clock time at which the profiler was created; origin of the trace time line
+	double snapshotTime; // Wall-clock time of the most recent snapshot
+	std::vector<double> zoneAverages; // Average duration of each zone in seconds during the most recent snapshot interval
+	std::vector<double> zoneRates; // Number of occurrences of each zone per second during the most recent snapshot interval
+	std::vector<double> counterRates; // Increase of each counter per second during the most recent snapshot interval
+
+	/* Private methods: */
+	Profiler(const Profiler& source); // Prohibit copy constructor
+	Profiler& operator=(const Profiler& source); // Prohibit assignment operator
+	static unsigned int getThreadIndex(void); // Returns a small unique index for the calling thread
+	void record(ZoneId zone,unsigned int threadIndex,double start,double duration); // Records one occurrence of a zone
+
+	/* Constructors and destructors: */
+	public:
+	Profiler(unsigned int sNumZones,const char* const sZoneNames[],unsigned int sNumCounters); // Creates a disabled profiler for the given zones, whose names must outlive the profiler, and number of counters
+	~Profiler(void);
+
+	/* Methods: */
+	bool isEnabled(void) const // Returns true if the profiler is recording
+		{
+		return enabled.load(std::memory_order_relaxed);
+		}
+	void setEnabled(bool newEnabled) // Starts or stops recording
+		{
+		enabled.store(newEnabled,std::memory_order_relaxed);
+		}
+	void enableTracing(size_t newMaxNumEvents); // Allocates a trace event buffer for the given number of events; must be called before any zone is recorded
+	void recordZone(ZoneId zone,double start,double duration) // Records one occurrence of a zone timed on the calling thread
+		{
+		record(zone,getThreadIndex(),start,duration);
+		}
+	void recordGpuZone(ZoneId zone,double start,double duration) // Records one occurrence of a zone timed on the GPU, issued at the given wall-clock time
+		{
+		record(zone,gpuThreadIndex,start,duration);
+		}
+	void count(CounterId counter,uint64_t amount) // Adds the given amount to a counter
+		{
+		if(isEnabled())
+			counters[counter].total.fetch_add(amount,std::memory_order_relaxed);
+		}
+	void takeSnapshot(double now); // Condenses all zones and counters accumulated since the last snapshot into per-interval statistics
+	double getSnapshotInterval(double now) const // Returns the wall-clock time elapsed since the most recent snapshot
+		{
+		return now-snapshotTime;
+		}
+	double getZoneAverage(ZoneId zone) const // Returns the average duration of a zone in seconds during the most recent snapshot interval
+		{
+		return zoneAverages[zone];
+		}
+	double getZoneRate(ZoneId zone) const // Returns the number of occurrences of a zone per second during the most recent snapshot interval
+		{
+		return zoneRates[zone];
+		}
+	double getCounterRate(CounterId counter) const // Returns the increase of a counter per second during the most recent snapshot interval
+		{
+		return counterRates[counter];
+		}
+	size_t getNumDroppedEvents(void) const; // Returns the number of zone occurrences that did not fit into the trace event buffer
+	bool writeChromeTrace(const char* fileName) const; // Writes all recorded trace events in Chrome trace event format; must not be called while zones are being recorded; returns false if the file could not be written
+	};
+
+#endif
@@ -0,0 +1,154 @@
+/***********************************************************************
+SeedEmitter - Emitter releasing particle seeds at a fixed rate in
+particles per second, independent of the rate at which it is polled,
+from a volume of a chosen shape around a position and direction: a
+cube, a solid sphere, a disk facing the direction, or a line running
+from the position along the direction. Seeds are generated in batches,
+drawing all random streams of a batch at once and mapping them to the
+shape in branch-free loops over the whole batch, so that emitting
+thousands of seeds per frame costs little more than copying them.
+***********************************************************************/
+
+#include "SeedEmitter.h"
+
+#include <strings.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const char* shapeNames[SeedEmitter::NUM_SHAPES]=
+	{
+	"Cube","Sphere","Disk","Line"
+	};
+
+}
+
+/****************************
+Methods of class SeedEmitter:
+****************************/
+
+SeedEmitter::SeedEmitter(SeedEmitter::Shape sShape,float sSize,double sRate)
+	:shape(sShape),size(sSize),rate(sRate>0.0?sRate:0.0),pendingSeeds(0.0)
+	{
+	}
+
+const char* SeedEmitter::getShapeName(SeedEmitter::Shape shape)
+	{
+	return shapeNames[shape];
+	}
+
+SeedEmitter::Shape SeedEmitter::findShape(const char* name)
+	{
+	for(int i=0;i<NUM_SHAPES;++i)
+		if(strcasecmp(name,shapeNames[i])==0)
+			return Shape(i);
+	return NUM_SHAPES;
+	}
+
+size_t SeedEmitter::advance(double timeStep,size_t maxNumSeeds)
+	{
+	/* Emit all whole seeds that have become due, and carry the fraction over to the next poll: */
+	pendingSeeds+=rate*timeStep;
+	size_t numSeeds=size_t(pendingSeeds);
+	pendingSeeds-=double(numSeeds);
+	return numSeeds<maxNumSeeds?numSeeds:maxNumSeeds;
+	}
+
+void SeedEmitter::generateSeeds(const CounterRandom& random,uint64_t firstStream,size_t numSeeds,uint32_t domain,const float center[3],const float direction[3],SeedQueue::Seed* seeds) const
+	{
+	/* Build an orthonormal frame around the direction, for shapes that face it: */
+	float axis[3]={direction[0],direction[1],direction[2]};
+	float axisLen=Math::sqrt(axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2]);
+	if(axisLen>0.0f)
+		for(int j=0;j<3;++j)
+			axis[j]/=axisLen;
+	else
+		{
+		axis[0]=0.0f;
+		axis[1]=0.0f;
+		axis[2]=1.0f;
+		}
+	float helper[3]={0.0f,0.0f,0.0f};
+	helper[Math::abs(axis[0])<0.9f?0:1]=1.0f;
+	float u[3]={helper[1]*axis[2]-helper[2]*axis[1],helper[2]*axis[0]-helper[0]*axis[2],helper[0]*axis[1]-helper[1]*axis[0]};
+	float uLen=Math::sqrt(u[0]*u[0]+u[1]*u[1]+u[2]*u[2]);
+	for(int j=0;j<3;++j)
+		u[j]/=uLen;
+	float v[3]={axis[1]*u[2]-axis[2]*u[1],axis[2]*u[0]-axis[0]*u[2],axis[0]*u[1]-axis[1]*u[0]};
+
+	CounterRandom::Block blocks[batchSize];
+	float r[3][batchSize]; // Uniform random numbers in [0, 1), one array per drawn word
+	float p[3][batchSize]; // Seed positions relative to the center
+	const float pi=Math::Constants<float>::pi;
+	for(size_t base=0;base<numSeeds;base+=batchSize)
+		{
+		/* Draw the random bits of all seeds in the batch at once: */
+		size_t numBatchSeeds=numSeeds-base<batchSize?numSeeds-base:batchSize;
+		random.generate(firstStream+base,numBatchSeeds,domain,0,blocks);
+		for(int j=0;j<3;++j)
+			for(size_t i=0;i<numBatchSeeds;++i)
+				r[j][i]=CounterRandom::toUnit(blocks[i][j]);
+
+		/* Map the random numbers to the emitter's volume, one shape-specific loop per batch: */
+		switch(shape)
+			{
+			case CUBE:
+				for(int j=0;j<3;++j)
+					for(size_t i=0;i<numBatchSeeds;++i)
+						p[j][i]=(2.0f*r[j][i]-1.0f)*size;
+				break;
+
+			case SPHERE:
+				for(size_t i=0;i<numBatchSeeds;++i)
+					{
+					/* Uniform direction from a uniform height and angle, and a radius with density growing with its square: */
+					float z=2.0f*r[0][i]-1.0f;
+					float ring=Math::sqrt(1.0f-z*z);
+					float angle=2.0f*pi*r[1][i];
+					float radius=size*Math::pow(r[2][i],1.0f/3.0f);
+					p[0][i]=radius*ring*Math::cos(angle);
+					p[1][i]=radius*ring*Math::sin(angle);
+					p[2][i]=radius*z;
+					}
+				break;
+
+			case DISK:
+				for(size_t i=0;i<numBatchSeeds;++i)
+					{
+					/* Uniform point in the disk spanned by the frame's two axes perpendicular to the direction: */
+					float radius=size*Math::sqrt(r[0][i]);
+					float angle=2.0f*pi*r[1][i];
+					float s=radius*Math::cos(angle);
+					float t=radius*Math::sin(angle);
+					for(int j=0;j<3;++j)
+						p[j][i]=u[j]*s+v[j]*t;
+					}
+				break;
+
+			case LINE:
+				for(int j=0;j<3;++j)
+					for(size_t i=0;i<numBatchSeeds;++i)
+						p[j][i]=axis[j]*(r[0][i]*size);
+				break;
+
+			default:
+				break;
+			}
+
+		/* Write the seeds, with colors drawn from the bytes of the fourth word: */
+		SeedQueue::Seed* sPtr=seeds+base;
+		for(size_t i=0;i<numBatchSeeds;++i,++sPtr)
+			{
+			for(int j=0;j<3;++j)
+				sPtr->position[j]=center[j]+p[j][i];
+			for(int j=0;j<3;++j)
+				sPtr->color[j]=32+((((blocks[i][3]>>(j*8))&0xffU)*(256U-32U))>>8);
+			sPtr->color[3]=255;
+			}
+		}
+	}
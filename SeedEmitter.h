@@ -0,0 +1,66 @@
+/***********************************************************************
+SeedEmitter - Emitter releasing particle seeds at a fixed rate in
+particles per second, independent of the rate at which it is polled,
+from a volume of a chosen shape around a position and direction: a
+cube, a solid sphere, a disk facing the direction, or a line running
+from the position along the direction. Seeds are generated in batches,
+drawing all random streams of a batch at once and mapping them to the
+shape in branch-free loops over the whole batch, so that emitting
+thousands of seeds per frame costs little more than copying them.
+***********************************************************************/
+
+#ifndef SEEDEMITTER_INCLUDED
+#define SEEDEMITTER_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CounterRandom.h"
+#include "SeedQueue.h"
+
+class SeedEmitter
+	{
+	/* Embedded classes: */
+	public:
+	enum Shape // Enumerated type for emitter shapes
+		{
+		CUBE=0,SPHERE,DISK,LINE,
+		NUM_SHAPES
+		};
+
+	/* Elements: */
+	private:
+	static const size_t batchSize=256; // Number of seeds generated at a time
+	Shape shape; // Shape of the emitting volume
+	float size; // Half-size of a cube, radius of a sphere or disk, or length of a line
+	double rate; // Number of seeds emitted per second
+	double pendingSeeds; // Fraction of a seed carried over from the last poll
+
+	/* Constructors and destructors: */
+	public:
+	SeedEmitter(Shape sShape,float sSize,double sRate); // Creates an emitter of the given shape, size, and rate
+
+	/* Methods: */
+	static const char* getShapeName(Shape shape); // Returns the name of the given shape
+	static Shape findShape(const char* name); // Returns the shape of the given name, ignoring case, or NUM_SHAPES if there is none
+	Shape getShape(void) const // Returns the emitter's shape
+		{
+		return shape;
+		}
+	float getSize(void) const // Returns the emitter's size
+		{
+		return size;
+		}
+	double getRate(void) const // Returns the number of seeds emitted per second
+		{
+		return rate;
+		}
+	void reset(void) // Drops the fraction of a seed carried over, when emission starts anew
+		{
+		pendingSeeds=0.0;
+		}
+	size_t advance(double timeStep,size_t maxNumSeeds); // Returns the number of seeds due after the given time has passed, up to the given maximum; seeds beyond the maximum are dropped
+	void generateSeeds(const CounterRandom& random,uint64_t firstStream,size_t numSeeds,uint32_t domain,const float center[3],const float direction[3],SeedQueue::Seed* seeds) const; // Generates seeds from a run of consecutive streams inside the emitter's volume placed at the given center and facing the given direction, with color channels between 32 and 255
+	};
+
+#endif
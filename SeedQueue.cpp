@@ -0,0 +1,80 @@
+/***********************************************************************
+SeedQueue - Bounded lock-free queue carrying batches of particle seeds
+from any number of producer threads to a single consumer. Producers
+reserve a contiguous run of slots for a whole batch with a single
+atomic operation and publish each slot with a sequence number; the
+consumer takes contiguous runs of published slots at once, so it can
+copy them into the particle store in bulk. Batches that do not fit are
+truncated instead of blocking the producer.
+***********************************************************************/
+
+#include "SeedQueue.h"
+
+/**************************
+Methods of class SeedQueue:
+**************************/
+
+SeedQueue::SeedQueue(size_t sCapacity)
+	:capacity(1),
+	 head(0),tail(0)
+	{
+	/* Round the capacity up to a power of two so that positions wrap with a mask: */
+	while(capacity<sCapacity)
+		capacity<<=1;
+	mask=capacity-1;
+
+	seeds=new Seed[capacity];
+	sequences=new std::atomic<size_t>[capacity];
+	for(size_t i=0;i<capacity;++i)
+		sequences[i].store(0,std::memory_order_relaxed);
+	}
+
+SeedQueue::~SeedQueue(void)
+	{
+	delete[] seeds;
+	delete[] sequences;
+	}
+
+size_t SeedQueue::push(const SeedQueue::Seed* batch,size_t numSeeds)
+	{
+	/* Reserve a run of slots for as much of the batch as fits: */
+	size_t begin=head.load(std::memory_order_relaxed);
+	size_t numReserved;
+	do
+		{
+		size_t numFree=capacity-(begin-tail.load(std::memory_order_acquire));
+		numReserved=numSeeds<numFree?numSeeds:numFree;
+		if(numReserved==0)
+			return 0;
+		}
+	while(!head.compare_exchange_weak(begin,begin+numReserved,std::memory_order_relaxed));
+
+	/* Write the seeds and publish each slot once it is complete: */
+	for(size_t i=0;i<numReserved;++i)
+		{
+		size_t pos=begin+i;
+		seeds[pos&mask]=batch[i];
+		sequences[pos&mask].store(pos+1,std::memory_order_release);
+		}
+
+	return numReserved;
+	}
+
+size_t SeedQueue::beginDrain(const SeedQueue::Seed*& run) const
+	{
+	/* Collect published slots up to the first unpublished one or the end of the slot array: */
+	size_t begin=tail.load(std::memory_order_relaxed);
+	size_t end=begin;
+	size_t wrap=(begin|mask)+1;
+	while(end<wrap&&sequences[end&mask].load(std::memory_order_acquire)==end+1)
+		++end;
+
+	run=seeds+(begin&mask);
+	return end-begin;
+	}
+
+void SeedQueue::endDrain(size_t numSeeds)
+	{
+	/* Hand the consumed slots back to the producers: */
+	tail.store(tail.load(std::memory_order_relaxed)+numSeeds,std::memory_order_release);
+	}
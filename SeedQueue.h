@@ -0,0 +1,65 @@
+/***********************************************************************
+SeedQueue - Bounded lock-free queue carrying batches of particle seeds
+from any number of producer threads to a single consumer. Producers
+reserve a contiguous run of slots for a whole batch with a single
+atomic operation and publish each slot with a sequence number; the
+consumer takes contiguous runs of published slots at once, so it can
+copy them into the particle store in bulk. Batches that do not fit are
+truncated instead of blocking the producer.
+***********************************************************************/
+
+#ifndef SEEDQUEUE_INCLUDED
+#define SEEDQUEUE_INCLUDED
+
+#include <stddef.h>
+#include <atomic>
+
+class SeedQueue
+	{
+	/* Embedded classes: */
+	public:
+	struct Seed // Structure describing a newly seeded particle
+		{
+		/* Elements: */
+		public:
+		float position[3]; // Initial particle position
+		unsigned char color[4]; // Initial particle RGBA color
+		};
+
+	/* Elements: */
+	private:
+	size_t capacity; // Number of slots; always a power of two
+	size_t mask; // Mask to wrap slot positions into the slot array
+	Seed* seeds; // Array of slots
+	std::atomic<size_t>* sequences; // Per-slot position plus one once the slot's seed has been published
+	alignas(64) std::atomic<size_t> head; // Position of the next slot to reserve; only touched by producers
+	alignas(64) std::atomic<size_t> tail; // Position of the next slot to consume; only written by the consumer
+
+	/* Private methods: */
+	SeedQueue(const SeedQueue& source); // Prohibit copy constructor
+	SeedQueue& operator=(const SeedQueue& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	SeedQueue(size_t sCapacity); // Creates a queue with at least the given number of slots
+	~SeedQueue(void);
+
+	/* Methods: */
+	size_t getCapacity(void) const // Returns the number of slots, which is the largest number of seeds the queue can hold
+		{
+		return capacity;
+		}
+
+	/* Producer methods: */
+	size_t push(const Seed* batch,size_t numSeeds); // Appends a batch of seeds; returns the number of seeds that fit into the queue
+	size_t push(const Seed& seed) // Appends a single seed; returns 0 if the queue is full
+		{
+		return push(&seed,1);
+		}
+
+	/* Consumer methods: */
+	size_t beginDrain(const Seed*& run) const; // Returns the longest contiguous run of published seeds at the front of the queue and its length
+	void endDrain(size_t numSeeds); // Releases the given number of seeds from the front of the queue after they have been consumed
+	};
+
+#endif
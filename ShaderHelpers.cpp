@@ -0,0 +1,91 @@
+/***********************************************************************
+ShaderHelpers - Functions to compile and link GLSL shader programs from
+source strings, including compute shaders, using the core OpenGL 4.3
+entry points.
+***********************************************************************/
+
+#include "ShaderHelpers.h"
+
+#include <string>
+#include <stdexcept>
+#include <GL/glext.h>
+
+namespace ShaderHelpers {
+
+GLuint compileShader(GLenum shaderType,const char* source)
+	{
+	GLuint shader=glCreateShader(shaderType);
+	glShaderSource(shader,1,&source,0);
+	glCompileShader(shader);
+	
+	/* Check for compilation errors: */
+	GLint compileStatus;
+	glGetShaderiv(shader,GL_COMPILE_STATUS,&compileStatus);
+	if(!compileStatus)
+		{
+		GLint logLength=0;
+		glGetShaderiv(shader,GL_INFO_LOG_LENGTH,&logLength);
+		std::string log(logLength>0?logLength:1,'\0');
+		glGetShaderInfoLog(shader,GLsizei(log.size()),0,&log[0]);
+		glDeleteShader(shader);
+		throw std::runtime_error(std::string("ShaderHelpers::compileShader: Error ")+log.c_str()+" while compiling shader");
+		}
+	
+	return shader;
+	}
+
+GLuint linkProgram(const std::vector<GLuint>& shaders,const char* const attributeNames[],int numAttributes)
+	{
+	GLuint program=glCreateProgram();
+	
+	/* Attribute locations only take effect when bound before linking: */
+	for(int i=0;i<numAttributes;++i)
+		glBindAttribLocation(program,GLuint(i),attributeNames[i]);
+	for(std::vector<GLuint>::const_iterator sIt=shaders.begin();sIt!=shaders.end();++sIt)
+		glAttachShader(program,*sIt);
+	glLinkProgram(program);
+	
+	/* The program keeps its attached shaders alive until it is deleted itself: */
+	for(std::vector<GLuint>::const_iterator sIt=shaders.begin();sIt!=shaders.end();++sIt)
+		glDeleteShader(*sIt);
+	
+	/* Check for link errors: */
+	GLint linkStatus;
+	glGetProgramiv(program,GL_LINK_STATUS,&linkStatus);
+	if(!linkStatus)
+		{
+		GLint logLength=0;
+		glGetProgramiv(program,GL_INFO_LOG_LENGTH,&logLength);
+		std::string log(logLength>0?logLength:1,'\0');
+		glGetProgramInfoLog(program,GLsizei(log.size()),0,&log[0]);
+		glDeleteProgram(program);
+		throw std::runtime_error(std::string("ShaderHelpers::linkProgram: Error ")+log.c_str()+" while linking shader program");
+		}
+	
+	return program;
+	}
+
+GLuint createComputeProgram(const char* source)
+	{
+	std::vector<GLuint> shaders;
+	shaders.push_back(compileShader(GL_COMPUTE_SHADER,source));
+	return linkProgram(shaders);
+	}
+
+GLuint createRenderProgram(const char* vertexSource,const char* fragmentSource,const char* const attributeNames[],int numAttributes)
+	{
+	std::vector<GLuint> shaders;
+	shaders.push_back(compileShader(GL_VERTEX_SHADER,vertexSource));
+	try
+		{
+		shaders.push_back(compileShader(GL_FRAGMENT_SHADER,fragmentSource));
+		}
+	catch(...)
+		{
+		glDeleteShader(shaders[0]);
+		throw;
+		}
+	return linkProgram(shaders,attributeNames,numAttributes);
+	}
+
+}
@@ -0,0 +1,22 @@
+/***********************************************************************
+ShaderHelpers - Functions to compile and link GLSL shader programs from
+source strings, including compute shaders, using the core OpenGL 4.3
+entry points.
+***********************************************************************/
+
+#ifndef SHADERHELPERS_INCLUDED
+#define SHADERHELPERS_INCLUDED
+
+#include <vector>
+#include <GL/gl.h>
+
+namespace ShaderHelpers {
+
+GLuint compileShader(GLenum shaderType,const char* source); // Compiles a shader of the given type from the given source; throws exception with the info log on failure
+GLuint linkProgram(const std::vector<GLuint>& shaders,const char* const attributeNames[]=0,int numAttributes=0); // Links the given shaders into a program and releases them, binding the named vertex attributes to consecutive indices starting at zero; throws exception with the info log on failure
+GLuint createComputeProgram(const char* source); // Compiles and links a compute shader program from the given source
+GLuint createRenderProgram(const char* vertexSource,const char* fragmentSource,const char* const attributeNames[],int numAttributes); // Compiles and links a vertex and fragment shader program; attributes are bound as in linkProgram
+
+}
+
+#endif
@@ -0,0 +1,1037 @@
+/***********************************************************************
+Simd - Thin wrappers around the platform's widest available SIMD
+floating-point registers (AVX-512, AVX2, or NEON, with a scalar
+fallback), so that particle kernels can be written once using ordinary
+arithmetic operators and compile to packed instructions. Double-precision
+packs fill the same registers with half as many lanes.
+***********************************************************************/
+
+#ifndef SIMD_INCLUDED
+#define SIMD_INCLUDED
+
+#include <stddef.h>
+#include <math.h>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Simd {
+
+static const size_t alignment=64; // Byte alignment of all arrays accessed through packs (one cache line, one AVX-512 register)
+
+#if defined(__AVX512F__)
+
+class FloatMask // Per-lane boolean results of comparing two FloatPacks
+	{
+	/* Elements: */
+	public:
+	__mmask16 m;
+
+	/* Constructors and destructors: */
+	FloatMask(__mmask16 sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend FloatMask operator&(const FloatMask& a,const FloatMask& b)
+		{
+		return __mmask16(a.m&b.m);
+		}
+	friend FloatMask operator|(const FloatMask& a,const FloatMask& b)
+		{
+		return __mmask16(a.m|b.m);
+		}
+	friend FloatMask andNot(const FloatMask& a,const FloatMask& b) // Returns a and not b
+		{
+		return __mmask16(a.m&~b.m);
+		}
+	friend bool any(const FloatMask& a) // Returns true if any lane is set
+		{
+		return a.m!=0;
+		}
+	};
+
+class FloatPack // Sixteen single-precision lanes in one AVX-512 register
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=16;
+
+	/* Elements: */
+	__m512 v;
+
+	/* Constructors and destructors: */
+	FloatPack(void)
+		{
+		}
+	FloatPack(float s) // Broadcasts a scalar to all lanes
+		:v(_mm512_set1_ps(s))
+		{
+		}
+	FloatPack(__m512 sV)
+		:v(sV)
+		{
+		}
+
+	/* Methods: */
+	static FloatPack load(const float* source) // Loads from an aligned address
+		{
+		return _mm512_load_ps(source);
+		}
+	void store(float* dest) const // Stores to an aligned address
+		{
+		_mm512_store_ps(dest,v);
+		}
+	friend FloatPack operator+(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_add_ps(a.v,b.v);
+		}
+	friend FloatPack operator-(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_sub_ps(a.v,b.v);
+		}
+	friend FloatPack operator*(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_mul_ps(a.v,b.v);
+		}
+	friend FloatPack operator-(const FloatPack& a)
+		{
+		return _mm512_sub_ps(_mm512_setzero_ps(),a.v);
+		}
+	friend FloatPack fma(const FloatPack& a,const FloatPack& b,const FloatPack& c) // Returns a*b+c
+		{
+		return _mm512_fmadd_ps(a.v,b.v,c.v);
+		}
+	friend FloatMask operator<(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_cmp_ps_mask(a.v,b.v,_CMP_LT_OQ);
+		}
+	friend FloatMask operator<=(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_cmp_ps_mask(a.v,b.v,_CMP_LE_OQ);
+		}
+	friend FloatMask operator>(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_cmp_ps_mask(a.v,b.v,_CMP_GT_OQ);
+		}
+	friend FloatPack select(const FloatMask& mask,const FloatPack& a,const FloatPack& b) // Returns a in lanes where mask is set, b elsewhere
+		{
+		return _mm512_mask_blend_ps(mask.m,b.v,a.v);
+		}
+	friend FloatPack abs(const FloatPack& a)
+		{
+		return _mm512_abs_ps(a.v);
+		}
+	friend FloatPack min(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_mask_min_ps(a.v,__mmask16(0xffff),a.v,b.v); // Masked form avoids a spurious uninitialized-value warning in some GCC versions
+		}
+	friend FloatPack max(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm512_mask_max_ps(a.v,__mmask16(0xffff),a.v,b.v);
+		}
+	friend FloatPack round(const FloatPack& a) // Rounds to the nearest integer
+		{
+		return _mm512_mask_roundscale_ps(a.v,__mmask16(0xffff),a.v,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+		}
+	};
+
+class DoubleMask // Per-lane boolean results of comparing two DoublePacks
+	{
+	/* Elements: */
+	public:
+	__mmask8 m;
+
+	/* Constructors and destructors: */
+	DoubleMask(__mmask8 sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend DoubleMask operator&(const DoubleMask& a,const DoubleMask& b)
+		{
+		return __mmask8(a.m&b.m);
+		}
+	friend DoubleMask operator|(const DoubleMask& a,const DoubleMask& b)
+		{
+		return __mmask8(a.m|b.m);
+		}
+	friend DoubleMask andNot(const DoubleMask& a,const DoubleMask& b)
+		{
+		return __mmask8(a.m&~b.m);
+		}
+	friend bool any(const DoubleMask& a)
+		{
+		return a.m!=0;
+		}
+	};
+
+class DoublePack // Eight double-precision lanes in one AVX-512 register
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=8;
+
+	/* Elements: */
+	__m512d v;
+
+	/* Constructors and destructors: */
+	DoublePack(void)
+		{
+		}
+	DoublePack(double s)
+		:v(_mm512_set1_pd(s))
+		{
+		}
+	DoublePack(__m512d sV)
+		:v(sV)
+		{
+		}
+
+	/* Methods: */
+	static DoublePack load(const double* source)
+		{
+		return _mm512_load_pd(source);
+		}
+	void store(double* dest) const
+		{
+		_mm512_store_pd(dest,v);
+		}
+	void storeFloat(float* dest) const // Stores all lanes rounded to single precision to an address aligned to half a register
+		{
+		_mm256_store_ps(dest,_mm512_cvtpd_ps(v));
+		}
+	friend DoublePack operator+(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_add_pd(a.v,b.v);
+		}
+	friend DoublePack operator-(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_sub_pd(a.v,b.v);
+		}
+	friend DoublePack operator*(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_mul_pd(a.v,b.v);
+		}
+	friend DoublePack operator-(const DoublePack& a)
+		{
+		return _mm512_sub_pd(_mm512_setzero_pd(),a.v);
+		}
+	friend DoublePack fma(const DoublePack& a,const DoublePack& b,const DoublePack& c)
+		{
+		return _mm512_fmadd_pd(a.v,b.v,c.v);
+		}
+	friend DoubleMask operator<(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_cmp_pd_mask(a.v,b.v,_CMP_LT_OQ);
+		}
+	friend DoubleMask operator<=(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_cmp_pd_mask(a.v,b.v,_CMP_LE_OQ);
+		}
+	friend DoubleMask operator>(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_cmp_pd_mask(a.v,b.v,_CMP_GT_OQ);
+		}
+	friend DoublePack select(const DoubleMask& mask,const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_mask_blend_pd(mask.m,b.v,a.v);
+		}
+	friend DoublePack abs(const DoublePack& a)
+		{
+		return _mm512_abs_pd(a.v);
+		}
+	friend DoublePack min(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_mask_min_pd(a.v,__mmask8(0xff),a.v,b.v);
+		}
+	friend DoublePack max(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm512_mask_max_pd(a.v,__mmask8(0xff),a.v,b.v);
+		}
+	friend DoublePack round(const DoublePack& a)
+		{
+		return _mm512_mask_roundscale_pd(a.v,__mmask8(0xff),a.v,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+		}
+	};
+
+#elif defined(__AVX2__)
+
+class FloatMask
+	{
+	/* Elements: */
+	public:
+	__m256 m;
+
+	/* Constructors and destructors: */
+	FloatMask(__m256 sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend FloatMask operator&(const FloatMask& a,const FloatMask& b)
+		{
+		return _mm256_and_ps(a.m,b.m);
+		}
+	friend FloatMask operator|(const FloatMask& a,const FloatMask& b)
+		{
+		return _mm256_or_ps(a.m,b.m);
+		}
+	friend FloatMask andNot(const FloatMask& a,const FloatMask& b)
+		{
+		return _mm256_andnot_ps(b.m,a.m);
+		}
+	friend bool any(const FloatMask& a)
+		{
+		return _mm256_movemask_ps(a.m)!=0;
+		}
+	};
+
+class FloatPack // Eight single-precision lanes in one AVX register
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=8;
+
+	/* Elements: */
+	__m256 v;
+
+	/* Constructors and destructors: */
+	FloatPack(void)
+		{
+		}
+	FloatPack(float s)
+		:v(_mm256_set1_ps(s))
+		{
+		}
+	FloatPack(__m256 sV)
+		:v(sV)
+		{
+		}
+
+	/* Methods: */
+	static FloatPack load(const float* source)
+		{
+		return _mm256_load_ps(source);
+		}
+	void store(float* dest) const
+		{
+		_mm256_store_ps(dest,v);
+		}
+	friend FloatPack operator+(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_add_ps(a.v,b.v);
+		}
+	friend FloatPack operator-(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_sub_ps(a.v,b.v);
+		}
+	friend FloatPack operator*(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_mul_ps(a.v,b.v);
+		}
+	friend FloatPack fma(const FloatPack& a,const FloatPack& b,const FloatPack& c)
+		{
+		#ifdef __FMA__
+		return _mm256_fmadd_ps(a.v,b.v,c.v);
+		#else
+		return _mm256_add_ps(_mm256_mul_ps(a.v,b.v),c.v);
+		#endif
+		}
+	friend FloatPack operator-(const FloatPack& a)
+		{
+		return _mm256_xor_ps(a.v,_mm256_set1_ps(-0.0f));
+		}
+	friend FloatMask operator<(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_cmp_ps(a.v,b.v,_CMP_LT_OQ);
+		}
+	friend FloatMask operator<=(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_cmp_ps(a.v,b.v,_CMP_LE_OQ);
+		}
+	friend FloatMask operator>(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_cmp_ps(a.v,b.v,_CMP_GT_OQ);
+		}
+	friend FloatPack select(const FloatMask& mask,const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_blendv_ps(b.v,a.v,mask.m);
+		}
+	friend FloatPack abs(const FloatPack& a)
+		{
+		return _mm256_andnot_ps(_mm256_set1_ps(-0.0f),a.v);
+		}
+	friend FloatPack min(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_min_ps(a.v,b.v);
+		}
+	friend FloatPack max(const FloatPack& a,const FloatPack& b)
+		{
+		return _mm256_max_ps(a.v,b.v);
+		}
+	friend FloatPack round(const FloatPack& a)
+		{
+		return _mm256_round_ps(a.v,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+		}
+	};
+
+class DoubleMask
+	{
+	/* Elements: */
+	public:
+	__m256d m;
+
+	/* Constructors and destructors: */
+	DoubleMask(__m256d sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend DoubleMask operator&(const DoubleMask& a,const DoubleMask& b)
+		{
+		return _mm256_and_pd(a.m,b.m);
+		}
+	friend DoubleMask operator|(const DoubleMask& a,const DoubleMask& b)
+		{
+		return _mm256_or_pd(a.m,b.m);
+		}
+	friend DoubleMask andNot(const DoubleMask& a,const DoubleMask& b)
+		{
+		return _mm256_andnot_pd(b.m,a.m);
+		}
+	friend bool any(const DoubleMask& a)
+		{
+		return _mm256_movemask_pd(a.m)!=0;
+		}
+	};
+
+class DoublePack // Four double-precision lanes in one AVX register
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=4;
+
+	/* Elements: */
+	__m256d v;
+
+	/* Constructors and destructors: */
+	DoublePack(void)
+		{
+		}
+	DoublePack(double s)
+		:v(_mm256_set1_pd(s))
+		{
+		}
+	DoublePack(__m256d sV)
+		:v(sV)
+		{
+		}
+
+	/* Methods: */
+	static DoublePack load(const double* source)
+		{
+		return _mm256_load_pd(source);
+		}
+	void store(double* dest) const
+		{
+		_mm256_store_pd(dest,v);
+		}
+	void storeFloat(float* dest) const
+		{
+		_mm_store_ps(dest,_mm256_cvtpd_ps(v));
+		}
+	friend DoublePack operator+(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_add_pd(a.v,b.v);
+		}
+	friend DoublePack operator-(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_sub_pd(a.v,b.v);
+		}
+	friend DoublePack operator*(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_mul_pd(a.v,b.v);
+		}
+	friend DoublePack fma(const DoublePack& a,const DoublePack& b,const DoublePack& c)
+		{
+		#ifdef __FMA__
+		return _mm256_fmadd_pd(a.v,b.v,c.v);
+		#else
+		return _mm256_add_pd(_mm256_mul_pd(a.v,b.v),c.v);
+		#endif
+		}
+	friend DoublePack operator-(const DoublePack& a)
+		{
+		return _mm256_xor_pd(a.v,_mm256_set1_pd(-0.0));
+		}
+	friend DoubleMask operator<(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_cmp_pd(a.v,b.v,_CMP_LT_OQ);
+		}
+	friend DoubleMask operator<=(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_cmp_pd(a.v,b.v,_CMP_LE_OQ);
+		}
+	friend DoubleMask operator>(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_cmp_pd(a.v,b.v,_CMP_GT_OQ);
+		}
+	friend DoublePack select(const DoubleMask& mask,const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_blendv_pd(b.v,a.v,mask.m);
+		}
+	friend DoublePack abs(const DoublePack& a)
+		{
+		return _mm256_andnot_pd(_mm256_set1_pd(-0.0),a.v);
+		}
+	friend DoublePack min(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_min_pd(a.v,b.v);
+		}
+	friend DoublePack max(const DoublePack& a,const DoublePack& b)
+		{
+		return _mm256_max_pd(a.v,b.v);
+		}
+	friend DoublePack round(const DoublePack& a)
+		{
+		return _mm256_round_pd(a.v,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+		}
+	};
+
+#elif defined(__ARM_NEON)
+
+class FloatMask
+	{
+	/* Elements: */
+	public:
+	uint32x4_t m;
+
+	/* Constructors and destructors: */
+	FloatMask(uint32x4_t sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend FloatMask operator&(const FloatMask& a,const FloatMask& b)
+		{
+		return vandq_u32(a.m,b.m);
+		}
+	friend FloatMask operator|(const FloatMask& a,const FloatMask& b)
+		{
+		return vorrq_u32(a.m,b.m);
+		}
+	friend FloatMask andNot(const FloatMask& a,const FloatMask& b)
+		{
+		return vbicq_u32(a.m,b.m);
+		}
+	friend bool any(const FloatMask& a)
+		{
+		return vmaxvq_u32(a.m)!=0;
+		}
+	};
+
+class FloatPack // Four single-precision lanes in one NEON register
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=4;
+
+	/* Elements: */
+	float32x4_t v;
+
+	/* Constructors and destructors: */
+	FloatPack(void)
+		{
+		}
+	FloatPack(float s)
+		:v(vdupq_n_f32(s))
+		{
+		}
+	FloatPack(float32x4_t sV)
+		:v(sV)
+		{
+		}
+
+	/* Methods: */
+	static FloatPack load(const float* source)
+		{
+		return vld1q_f32(source);
+		}
+	void store(float* dest) const
+		{
+		vst1q_f32(dest,v);
+		}
+	friend FloatPack operator+(const FloatPack& a,const FloatPack& b)
+		{
+		return vaddq_f32(a.v,b.v);
+		}
+	friend FloatPack operator-(const FloatPack& a,const FloatPack& b)
+		{
+		return vsubq_f32(a.v,b.v);
+		}
+	friend FloatPack operator*(const FloatPack& a,const FloatPack& b)
+		{
+		return vmulq_f32(a.v,b.v);
+		}
+	friend FloatPack fma(const FloatPack& a,const FloatPack& b,const FloatPack& c)
+		{
+		return vfmaq_f32(c.v,a.v,b.v);
+		}
+	friend FloatPack operator-(const FloatPack& a)
+		{
+		return vnegq_f32(a.v);
+		}
+	friend FloatMask operator<(const FloatPack& a,const FloatPack& b)
+		{
+		return vcltq_f32(a.v,b.v);
+		}
+	friend FloatMask operator<=(const FloatPack& a,const FloatPack& b)
+		{
+		return vcleq_f32(a.v,b.v);
+		}
+	friend FloatMask operator>(const FloatPack& a,const FloatPack& b)
+		{
+		return vcgtq_f32(a.v,b.v);
+		}
+	friend FloatPack select(const FloatMask& mask,const FloatPack& a,const FloatPack& b)
+		{
+		return vbslq_f32(mask.m,a.v,b.v);
+		}
+	friend FloatPack abs(const FloatPack& a)
+		{
+		return vabsq_f32(a.v);
+		}
+	friend FloatPack min(const FloatPack& a,const FloatPack& b)
+		{
+		return vminq_f32(a.v,b.v);
+		}
+	friend FloatPack max(const FloatPack& a,const FloatPack& b)
+		{
+		return vmaxq_f32(a.v,b.v);
+		}
+	friend FloatPack round(const FloatPack& a)
+		{
+		return vrndnq_f32(a.v);
+		}
+	};
+
+class DoubleMask
+	{
+	/* Elements: */
+	public:
+	uint64x2_t m;
+
+	/* Constructors and destructors: */
+	DoubleMask(uint64x2_t sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend DoubleMask operator&(const DoubleMask& a,const DoubleMask& b)
+		{
+		return vandq_u64(a.m,b.m);
+		}
+	friend DoubleMask operator|(const DoubleMask& a,const DoubleMask& b)
+		{
+		return vorrq_u64(a.m,b.m);
+		}
+	friend DoubleMask andNot(const DoubleMask& a,const DoubleMask& b)
+		{
+		return vbicq_u64(a.m,b.m);
+		}
+	friend bool any(const DoubleMask& a)
+		{
+		return vmaxvq_u32(vreinterpretq_u32_u64(a.m))!=0;
+		}
+	};
+
+class DoublePack // Two double-precision lanes in one NEON register
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=2;
+
+	/* Elements: */
+	float64x2_t v;
+
+	/* Constructors and destructors: */
+	DoublePack(void)
+		{
+		}
+	DoublePack(double s)
+		:v(vdupq_n_f64(s))
+		{
+		}
+	DoublePack(float64x2_t sV)
+		:v(sV)
+		{
+		}
+
+	/* Methods: */
+	static DoublePack load(const double* source)
+		{
+		return vld1q_f64(source);
+		}
+	void store(double* dest) const
+		{
+		vst1q_f64(dest,v);
+		}
+	void storeFloat(float* dest) const
+		{
+		vst1_f32(dest,vcvt_f32_f64(v));
+		}
+	friend DoublePack operator+(const DoublePack& a,const DoublePack& b)
+		{
+		return vaddq_f64(a.v,b.v);
+		}
+	friend DoublePack operator-(const DoublePack& a,const DoublePack& b)
+		{
+		return vsubq_f64(a.v,b.v);
+		}
+	friend DoublePack operator*(const DoublePack& a,const DoublePack& b)
+		{
+		return vmulq_f64(a.v,b.v);
+		}
+	friend DoublePack fma(const DoublePack& a,const DoublePack& b,const DoublePack& c)
+		{
+		return vfmaq_f64(c.v,a.v,b.v);
+		}
+	friend DoublePack operator-(const DoublePack& a)
+		{
+		return vnegq_f64(a.v);
+		}
+	friend DoubleMask operator<(const DoublePack& a,const DoublePack& b)
+		{
+		return vcltq_f64(a.v,b.v);
+		}
+	friend DoubleMask operator<=(const DoublePack& a,const DoublePack& b)
+		{
+		return vcleq_f64(a.v,b.v);
+		}
+	friend DoubleMask operator>(const DoublePack& a,const DoublePack& b)
+		{
+		return vcgtq_f64(a.v,b.v);
+		}
+	friend DoublePack select(const DoubleMask& mask,const DoublePack& a,const DoublePack& b)
+		{
+		return vbslq_f64(mask.m,a.v,b.v);
+		}
+	friend DoublePack abs(const DoublePack& a)
+		{
+		return vabsq_f64(a.v);
+		}
+	friend DoublePack min(const DoublePack& a,const DoublePack& b)
+		{
+		return vminq_f64(a.v,b.v);
+		}
+	friend DoublePack max(const DoublePack& a,const DoublePack& b)
+		{
+		return vmaxq_f64(a.v,b.v);
+		}
+	friend DoublePack round(const DoublePack& a)
+		{
+		return vrndnq_f64(a.v);
+		}
+	};
+
+#else
+
+class FloatMask
+	{
+	/* Elements: */
+	public:
+	bool m;
+
+	/* Constructors and destructors: */
+	FloatMask(bool sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend FloatMask operator&(const FloatMask& a,const FloatMask& b)
+		{
+		return a.m&&b.m;
+		}
+	friend FloatMask operator|(const FloatMask& a,const FloatMask& b)
+		{
+		return a.m||b.m;
+		}
+	friend FloatMask andNot(const FloatMask& a,const FloatMask& b)
+		{
+		return a.m&&!b.m;
+		}
+	friend bool any(const FloatMask& a)
+		{
+		return a.m;
+		}
+	};
+
+class FloatPack // Scalar fallback with a single lane
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=1;
+
+	/* Elements: */
+	float v;
+
+	/* Constructors and destructors: */
+	FloatPack(void)
+		{
+		}
+	FloatPack(float s)
+		:v(s)
+		{
+		}
+
+	/* Methods: */
+	static FloatPack load(const float* source)
+		{
+		return *source;
+		}
+	void store(float* dest) const
+		{
+		*dest=v;
+		}
+	friend FloatPack operator+(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v+b.v;
+		}
+	friend FloatPack operator-(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v-b.v;
+		}
+	friend FloatPack operator*(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v*b.v;
+		}
+	friend FloatPack fma(const FloatPack& a,const FloatPack& b,const FloatPack& c)
+		{
+		return a.v*b.v+c.v;
+		}
+	friend FloatPack operator-(const FloatPack& a)
+		{
+		return -a.v;
+		}
+	friend FloatMask operator<(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v<b.v;
+		}
+	friend FloatMask operator<=(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v<=b.v;
+		}
+	friend FloatMask operator>(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v>b.v;
+		}
+	friend FloatPack select(const FloatMask& mask,const FloatPack& a,const FloatPack& b)
+		{
+		return mask.m?a.v:b.v;
+		}
+	friend FloatPack abs(const FloatPack& a)
+		{
+		return fabsf(a.v);
+		}
+	friend FloatPack min(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v<b.v?a.v:b.v;
+		}
+	friend FloatPack max(const FloatPack& a,const FloatPack& b)
+		{
+		return a.v>b.v?a.v:b.v;
+		}
+	friend FloatPack round(const FloatPack& a)
+		{
+		return nearbyintf(a.v);
+		}
+	};
+
+class DoubleMask
+	{
+	/* Elements: */
+	public:
+	bool m;
+
+	/* Constructors and destructors: */
+	DoubleMask(bool sM)
+		:m(sM)
+		{
+		}
+
+	/* Methods: */
+	friend DoubleMask operator&(const DoubleMask& a,const DoubleMask& b)
+		{
+		return a.m&&b.m;
+		}
+	friend DoubleMask operator|(const DoubleMask& a,const DoubleMask& b)
+		{
+		return a.m||b.m;
+		}
+	friend DoubleMask andNot(const DoubleMask& a,const DoubleMask& b)
+		{
+		return a.m&&!b.m;
+		}
+	friend bool any(const DoubleMask& a)
+		{
+		return a.m;
+		}
+	};
+
+class DoublePack // Scalar fallback with a single double-precision lane
+	{
+	/* Embedded classes: */
+	public:
+	static const unsigned int numLanes=1;
+
+	/* Elements: */
+	double v;
+
+	/* Constructors and destructors: */
+	DoublePack(void)
+		{
+		}
+	DoublePack(double s)
+		:v(s)
+		{
+		}
+
+	/* Methods: */
+	static DoublePack load(const double* source)
+		{
+		return *source;
+		}
+	void store(double* dest) const
+		{
+		*dest=v;
+		}
+	void storeFloat(float* dest) const
+		{
+		*dest=float(v);
+		}
+	friend DoublePack operator+(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v+b.v;
+		}
+	friend DoublePack operator-(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v-b.v;
+		}
+	friend DoublePack operator*(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v*b.v;
+		}
+	friend DoublePack fma(const DoublePack& a,const DoublePack& b,const DoublePack& c)
+		{
+		return a.v*b.v+c.v;
+		}
+	friend DoublePack operator-(const DoublePack& a)
+		{
+		return -a.v;
+		}
+	friend DoubleMask operator<(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v<b.v;
+		}
+	friend DoubleMask operator<=(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v<=b.v;
+		}
+	friend DoubleMask operator>(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v>b.v;
+		}
+	friend DoublePack select(const DoubleMask& mask,const DoublePack& a,const DoublePack& b)
+		{
+		return mask.m?a.v:b.v;
+		}
+	friend DoublePack abs(const DoublePack& a)
+		{
+		return fabs(a.v);
+		}
+	friend DoublePack min(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v<b.v?a.v:b.v;
+		}
+	friend DoublePack max(const DoublePack& a,const DoublePack& b)
+		{
+		return a.v>b.v?a.v:b.v;
+		}
+	friend DoublePack round(const DoublePack& a)
+		{
+		return nearbyint(a.v);
+		}
+	};
+
+#endif
+
+/****************
+Helper functions:
+****************/
+
+template <class PackParam>
+inline PackParam reduceSinArgument(const PackParam& x) // Maps the arguments in all lanes of a pack to arguments in [-pi/2, pi/2] with the same sine
+	{
+	const double pi=3.14159265358979323846;
+
+	/* Reduce the argument to [-pi, pi]: */
+	PackParam xr=x-round(x*PackParam(0.5/pi))*PackParam(2.0*pi);
+
+	/* Reflect the argument into [-pi/2, pi/2] using sin(x)=sin(pi-x): */
+	return select(xr>PackParam(0.5*pi),PackParam(pi)-xr,select(xr<PackParam(-0.5*pi),PackParam(-pi)-xr,xr));
+	}
+
+template <class PackParam>
+inline PackParam polySin(const PackParam& x) // Approximates the sine of all lanes of a pack to about single precision
+	{
+	PackParam xr=reduceSinArgument(x);
+
+	/* Evaluate the Taylor series up to x^11 using Horner's scheme: */
+	PackParam x2=xr*xr;
+	PackParam p=fma(PackParam(-1.0/39916800.0),x2,PackParam(1.0/362880.0));
+	p=fma(p,x2,PackParam(-1.0/5040.0));
+	p=fma(p,x2,PackParam(1.0/120.0));
+	p=fma(p,x2,PackParam(-1.0/6.0));
+	return fma(xr*x2,p,xr);
+	}
+
+inline FloatPack sin(const FloatPack& x)
+	{
+	return polySin(x);
+	}
+
+inline DoublePack sin(const DoublePack& x) // Approximates the sine of all lanes of a pack to about double precision
+	{
+	DoublePack xr=reduceSinArgument(x);
+
+	/* Evaluate the Taylor series up to x^19, leaving a truncation error below 3e-16 on [-pi/2, pi/2]: */
+	DoublePack x2=xr*xr;
+	DoublePack p=fma(DoublePack(-1.0/121645100408832000.0),x2,DoublePack(1.0/355687428096000.0));
+	p=fma(p,x2,DoublePack(-1.0/1307674368000.0));
+	p=fma(p,x2,DoublePack(1.0/6227020800.0));
+	p=fma(p,x2,DoublePack(-1.0/39916800.0));
+	p=fma(p,x2,DoublePack(1.0/362880.0));
+	p=fma(p,x2,DoublePack(-1.0/5040.0));
+	p=fma(p,x2,DoublePack(1.0/120.0));
+	p=fma(p,x2,DoublePack(-1.0/6.0));
+	return fma(xr*x2,p,xr);
+	}
+
+inline size_t padToLanes(size_t numElements) // Rounds a number of elements up to the next multiple of the pack width
+	{
+	return (numElements+FloatPack::numLanes-1)&~size_t(FloatPack::numLanes-1);
+	}
+
+}
+
+#endif
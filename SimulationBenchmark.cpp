@@ -0,0 +1,383 @@
+/***********************************************************************
+SimulationBenchmark - Headless driver measuring the throughput of the CPU
+simulation engine without Vrui's application or rendering layers. The
+benchmark sweeps over particle counts, ODE systems, integrators, and
+thread counts, and for each combination times a number of frames, each
+consisting of one simulation step and one export of interleaved render
+vertices, as the background thread of StrangeAttractors would do,
+optionally with the particle store and render copy drawn from a particle
+arena. The results are written as CSV or JSON.
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+
+#include "ParticleArena.h"
+#include "ParticleStore.h"
+#include "ParticleKernels.h"
+#include "WorkerPool.h"
+#include "ParticleSimulator.h"
+#include "SimulationClock.h"
+#include "CounterRandom.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct Vertex // Interleaved render vertex with the same layout as the vertices exported by StrangeAttractors
+	{
+	/* Elements: */
+	public:
+	float texCoord[2]; // Particle birth time and lifespan
+	unsigned char color[4]; // Vertex RGBA color
+	float normal[3]; // Particle position before the most recent step
+	float position[3]; // Particle position
+	};
+
+struct Seed // Structure describing a newly seeded particle
+	{
+	/* Elements: */
+	public:
+	float position[3]; // Initial particle position
+	unsigned char color[4]; // Initial particle RGBA color
+	};
+
+struct Result // Structure holding the measurements of one benchmark run
+	{
+	/* Elements: */
+	public:
+	AttractorSystems::SystemType system; // Benchmarked ODE system
+	Integrators::IntegratorType integrator; // Benchmarked integrator
+	size_t numParticles; // Number of simulated particles
+	unsigned int numThreads; // Total number of threads sharing each step
+	unsigned int numSubsteps; // Number of integration substeps per step
+	bool highAccuracy; // Flag whether particles were advanced in double precision
+	bool arena; // Flag whether particle data was drawn from a huge-page arena placed by the workers
+	unsigned int numSteps; // Number of timed frames
+	double particlesPerSecond; // Particle steps per second of step time, excluding vertex export
+	double nsPerParticleStep; // Step time per particle step in nanoseconds
+	double bandwidth; // Estimated memory traffic per second of frame time in bytes
+	double frameTimes[4]; // 50th, 90th, and 99th percentile and maximum frame time in seconds
+	};
+
+/****************
+Helper functions:
+****************/
+
+template <class ValueParam,class ParseParam>
+std::vector<ValueParam> parseList(const char* list,ParseParam parse) // Parses a comma-separated list of values
+	{
+	std::vector<ValueParam> result;
+	const char* start=list;
+	while(true)
+		{
+		const char* end=start;
+		while(*end!='\0'&&*end!=',')
+			++end;
+		if(end!=start)
+			result.push_back(parse(std::string(start,end)));
+		if(*end=='\0')
+			break;
+		start=end+1;
+		}
+	return result;
+	}
+
+size_t parseCount(const std::string& value) // Parses a particle count, accepting scientific notation such as 1e6
+	{
+	return size_t(atof(value.c_str())+0.5);
+	}
+
+unsigned int parseUnsigned(const std::string& value)
+	{
+	return strtoul(value.c_str(),0,10);
+	}
+
+AttractorSystems::SystemType parseSystem(const std::string& value)
+	{
+	AttractorSystems::SystemType result=AttractorSystems::findSystem(value.c_str());
+	if(result==AttractorSystems::NUM_SYSTEMS)
+		std::cerr<<"SimulationBenchmark: Unknown ODE system "<<value<<std::endl;
+	return result;
+	}
+
+Integrators::IntegratorType parseIntegrator(const std::string& value)
+	{
+	Integrators::IntegratorType result=Integrators::findIntegrator(value.c_str());
+	if(result==Integrators::NUM_INTEGRATORS)
+		std::cerr<<"SimulationBenchmark: Unknown integrator "<<value<<std::endl;
+	return result;
+	}
+
+double percentile(const std::vector<double>& sortedValues,double fraction) // Returns the given fraction's percentile of a sorted array using the nearest-rank method
+	{
+	size_t rank=size_t(fraction*double(sortedValues.size())+0.999999);
+	if(rank<1)
+		rank=1;
+	if(rank>sortedValues.size())
+		rank=sortedValues.size();
+	return sortedValues[rank-1];
+	}
+
+Result runBenchmark(const ParticleKernels::StepParameters& stepParameters,bool highAccuracy,bool useArena,size_t numParticles,unsigned int numThreads,size_t chunkSize,unsigned int numWarmupSteps,unsigned int numSteps,const CounterRandom& random)
+	{
+	/* Create a simulator and fill it with particles that never expire, drawn from the same random streams in every run: */
+	ParticleArena arena(0,true);
+	ParticleSimulator simulator(stepParameters,numParticles,numThreads,chunkSize,useArena?&arena:0);
+	if(highAccuracy)
+		simulator.enableHighAccuracy();
+	static const float seedCenter[3]={0.0f,0.0f,0.0f};
+	float seedRadius=AttractorSystems::getSystemInfo(stepParameters.system).seedRadius;
+	float birthTime=0.0f;
+	float expiryTime=std::numeric_limits<float>::infinity();
+	std::vector<Seed> seeds(4096);
+	for(size_t numAdded=0;numAdded<numParticles;)
+		{
+		size_t numSeeds=std::min(seeds.size(),numParticles-numAdded);
+		random.generateSeeds(numAdded,numSeeds,0,seedCenter,seedRadius,64,seeds.data());
+		numAdded+=simulator.addParticles(seeds.data(),numSeeds,birthTime,expiryTime);
+		}
+
+	/* Allocate and touch the render copy up front so that page faults do not count against the first frames: */
+	std::vector<Vertex,ParticleArena::Allocator<Vertex> > vertices(ParticleArena::Allocator<Vertex>(useArena?&arena:0));
+	simulator.reserveRenderCopy(vertices);
+	vertices.resize(numParticles);
+	simulator.exportVertices(vertices.data());
+
+	/* Time all frames: */
+	double simulationTime=0.0;
+	double totalStepTime=0.0;
+	double totalFrameTime=0.0;
+	std::vector<double> frameTimes;
+	frameTimes.reserve(numSteps);
+	for(unsigned int step=0;step<numWarmupSteps+numSteps;++step)
+		{
+		double start=SimulationClock::getWallTime();
+		simulator.step(simulationTime,true);
+		simulator.compact();
+		double stepped=SimulationClock::getWallTime();
+		simulator.exportVertices(vertices.data());
+		double end=SimulationClock::getWallTime();
+		simulationTime+=stepParameters.timeStep;
+
+		if(step>=numWarmupSteps)
+			{
+			totalStepTime+=stepped-start;
+			totalFrameTime+=end-start;
+			frameTimes.push_back(end-start);
+			}
+		}
+
+	/* Calculate the results: */
+	Result result;
+	result.system=stepParameters.system;
+	result.integrator=stepParameters.integrator;
+	result.numParticles=numParticles;
+	result.numThreads=simulator.getNumThreads();
+	result.numSubsteps=stepParameters.numSubsteps;
+	result.highAccuracy=highAccuracy;
+	result.arena=useArena;
+	result.numSteps=numSteps;
+	double numParticleSteps=double(numParticles)*double(numSteps);
+	result.particlesPerSecond=numParticleSteps/totalStepTime;
+	result.nsPerParticleStep=totalStepTime*1.0e9/numParticleSteps;
+
+	/* Estimate the minimum memory traffic of a frame: saving and stepping positions, and exporting vertices: */
+	double bytesPerParticle=double(sizeof(ParticleStore::Scalar))*3.0*2.0 // Copy positions to previous positions
+	                       +double(sizeof(ParticleStore::Scalar))*3.0*2.0 // Read and write positions during the step
+	                       +(highAccuracy?double(sizeof(ParticleStore::MasterScalar))*3.0*2.0-double(sizeof(ParticleStore::Scalar))*3.0:0.0) // Read and write the master copy instead of reading positions
+	                       +double(sizeof(ParticleStore::Scalar))*6.0+double(sizeof(ParticleStore::Color))*4.0+double(sizeof(float))*2.0 // Read current and previous positions, colors, and birth and expiry times during export
+	                       +double(sizeof(Vertex)); // Write interleaved vertices
+	result.bandwidth=bytesPerParticle*numParticleSteps/totalFrameTime;
+
+	std::sort(frameTimes.begin(),frameTimes.end());
+	result.frameTimes[0]=percentile(frameTimes,0.5);
+	result.frameTimes[1]=percentile(frameTimes,0.9);
+	result.frameTimes[2]=percentile(frameTimes,0.99);
+	result.frameTimes[3]=frameTimes.back();
+
+	return result;
+	}
+
+void writeCsv(std::ostream& os,const std::vector<Result>& results)
+	{
+	os<<"system,integrator,particles,threads,substeps,highAccuracy,arena,steps,particlesPerSecond,nsPerParticleStep,bandwidthGBps,frameMsP50,frameMsP90,frameMsP99,frameMsMax"<<std::endl;
+	for(std::vector<Result>::const_iterator rIt=results.begin();rIt!=results.end();++rIt)
+		{
+		os<<AttractorSystems::getSystemInfo(rIt->system).name<<','<<Integrators::getIntegratorName(rIt->integrator);
+		os<<','<<rIt->numParticles<<','<<rIt->numThreads<<','<<rIt->numSubsteps<<','<<(rIt->highAccuracy?1:0)<<','<<(rIt->arena?1:0)<<','<<rIt->numSteps;
+		os<<','<<rIt->particlesPerSecond<<','<<rIt->nsPerParticleStep<<','<<rIt->bandwidth*1.0e-9;
+		for(int i=0;i<4;++i)
+			os<<','<<rIt->frameTimes[i]*1.0e3;
+		os<<std::endl;
+		}
+	}
+
+void writeJson(std::ostream& os,const std::vector<Result>& results)
+	{
+	static const char* percentileNames[4]={"p50","p90","p99","max"};
+	os<<'['<<std::endl;
+	for(std::vector<Result>::const_iterator rIt=results.begin();rIt!=results.end();++rIt)
+		{
+		os<<"\t{\"system\": \""<<AttractorSystems::getSystemInfo(rIt->system).name<<"\", \"integrator\": \""<<Integrators::getIntegratorName(rIt->integrator)<<'"';
+		os<<", \"particles\": "<<rIt->numParticles<<", \"threads\": "<<rIt->numThreads<<", \"substeps\": "<<rIt->numSubsteps<<", \"highAccuracy\": "<<(rIt->highAccuracy?"true":"false")<<", \"arena\": "<<(rIt->arena?"true":"false")<<", \"steps\": "<<rIt->numSteps;
+		os<<", \"particlesPerSecond\": "<<rIt->particlesPerSecond<<", \"nsPerParticleStep\": "<<rIt->nsPerParticleStep<<", \"bandwidthGBps\": "<<rIt->bandwidth*1.0e-9;
+		os<<", \"frameMs\": {";
+		for(int i=0;i<4;++i)
+			os<<(i>0?", ":"")<<'"'<<percentileNames[i]<<"\": "<<rIt->frameTimes[i]*1.0e3;
+		os<<"}}"<<(rIt+1!=results.end()?",":"")<<std::endl;
+		}
+	os<<']'<<std::endl;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Set up the default sweep: */
+	std::vector<size_t> particleCounts=parseList<size_t>("1e3,1e4,1e5,1e6,1e7",parseCount);
+	std::vector<AttractorSystems::SystemType> systems;
+	for(int i=0;i<AttractorSystems::NUM_SYSTEMS;++i)
+		systems.push_back(AttractorSystems::SystemType(i));
+	std::vector<Integrators::IntegratorType> integrators;
+	for(int i=0;i<Integrators::NUM_INTEGRATORS;++i)
+		integrators.push_back(Integrators::IntegratorType(i));
+	std::vector<unsigned int> threadCounts;
+	threadCounts.push_back(1);
+	if(WorkerPool::getNumCPUs()>1)
+		threadCounts.push_back(WorkerPool::getNumCPUs());
+	unsigned int numSubsteps=1;
+	bool highAccuracy=false;
+	bool useArena=false;
+	size_t chunkSize=16384;
+	unsigned int numWarmupSteps=10;
+	unsigned int numSteps=100;
+	bool json=false;
+	const char* outputFileName=0;
+	uint64_t randomSeed=0;
+
+	/* Parse the command line: */
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"particles")==0&&i+1<argc)
+				{
+				++i;
+				particleCounts=parseList<size_t>(argv[i],parseCount);
+				}
+			else if(strcasecmp(argv[i]+1,"systems")==0&&i+1<argc)
+				{
+				++i;
+				systems=parseList<AttractorSystems::SystemType>(argv[i],parseSystem);
+				systems.erase(std::remove(systems.begin(),systems.end(),AttractorSystems::NUM_SYSTEMS),systems.end());
+				}
+			else if(strcasecmp(argv[i]+1,"integrators")==0&&i+1<argc)
+				{
+				++i;
+				integrators=parseList<Integrators::IntegratorType>(argv[i],parseIntegrator);
+				integrators.erase(std::remove(integrators.begin(),integrators.end(),Integrators::NUM_INTEGRATORS),integrators.end());
+				}
+			else if(strcasecmp(argv[i]+1,"threads")==0&&i+1<argc)
+				{
+				++i;
+				threadCounts=parseList<unsigned int>(argv[i],parseUnsigned);
+				}
+			else if(strcasecmp(argv[i]+1,"substeps")==0&&i+1<argc)
+				{
+				++i;
+				numSubsteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"highAccuracy")==0)
+				highAccuracy=true;
+			else if(strcasecmp(argv[i]+1,"arena")==0)
+				useArena=true;
+			else if(strcasecmp(argv[i]+1,"chunkSize")==0&&i+1<argc)
+				{
+				++i;
+				chunkSize=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"warmup")==0&&i+1<argc)
+				{
+				++i;
+				numWarmupSteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"steps")==0&&i+1<argc)
+				{
+				++i;
+				numSteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"format")==0&&i+1<argc)
+				{
+				++i;
+				if(strcasecmp(argv[i],"json")==0)
+					json=true;
+				else if(strcasecmp(argv[i],"csv")==0)
+					json=false;
+				else
+					std::cerr<<"SimulationBenchmark: Unknown output format "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"output")==0&&i+1<argc)
+				{
+				++i;
+				outputFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"randomSeed")==0&&i+1<argc)
+				{
+				++i;
+				randomSeed=strtoull(argv[i],0,10);
+				}
+			else
+				std::cerr<<"SimulationBenchmark: Ignoring unknown option "<<argv[i]<<std::endl;
+			}
+		}
+	if(numSubsteps<1)
+		numSubsteps=1;
+	if(numSteps<1)
+		numSteps=1;
+
+	/* Run all combinations, reporting progress on stderr so that results can be piped: */
+	CounterRandom random(randomSeed);
+	std::vector<Result> results;
+	for(std::vector<AttractorSystems::SystemType>::iterator sIt=systems.begin();sIt!=systems.end();++sIt)
+		for(std::vector<Integrators::IntegratorType>::iterator iIt=integrators.begin();iIt!=integrators.end();++iIt)
+			for(std::vector<size_t>::iterator pIt=particleCounts.begin();pIt!=particleCounts.end();++pIt)
+				for(std::vector<unsigned int>::iterator tIt=threadCounts.begin();tIt!=threadCounts.end();++tIt)
+					{
+					if(*pIt==0)
+						continue;
+					std::cerr<<"SimulationBenchmark: "<<AttractorSystems::getSystemInfo(*sIt).name<<'/'<<Integrators::getIntegratorName(*iIt)<<", "<<*pIt<<" particles, "<<*tIt<<" threads"<<std::endl;
+					ParticleKernels::StepParameters stepParameters;
+					stepParameters.setSystem(*sIt);
+					stepParameters.integrator=*iIt;
+					stepParameters.numSubsteps=numSubsteps;
+					results.push_back(runBenchmark(stepParameters,highAccuracy,useArena,*pIt,*tIt,chunkSize,numWarmupSteps,numSteps,random));
+					}
+
+	/* Write the results: */
+	std::ofstream outputFile;
+	if(outputFileName!=0)
+		{
+		outputFile.open(outputFileName);
+		if(!outputFile)
+			{
+			std::cerr<<"SimulationBenchmark: Unable to open output file "<<outputFileName<<std::endl;
+			return 1;
+			}
+		}
+	std::ostream& os=outputFileName!=0?static_cast<std::ostream&>(outputFile):std::cout;
+	if(json)
+		writeJson(os,results);
+	else
+		writeCsv(os,results);
+
+	return 0;
+	}
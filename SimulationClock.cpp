@@ -0,0 +1,62 @@
+/***********************************************************************
+SimulationClock - Fixed-timestep scheduler decoupling the simulation
+rate from the time it takes to calculate a step and from the display
+rate. Elapsed wall-clock time is collected in an accumulator, which is
+spent in units of a fixed step interval. The number of steps taken to
+catch up after a slow update is limited; time beyond that limit is
+dropped, so that a slow step slows down the simulation temporarily
+instead of making it fall further and further behind.
+***********************************************************************/
+
+#include "SimulationClock.h"
+
+#include <time.h>
+
+/********************************
+Methods of class SimulationClock:
+********************************/
+
+SimulationClock::SimulationClock(double sStepInterval,unsigned int sMaxCatchUpSteps)
+	:stepInterval(sStepInterval),maxCatchUpSteps(sMaxCatchUpSteps>0?sMaxCatchUpSteps:1),
+	 lastTime(0.0),accumulator(0.0),stepTime(0.0)
+	{
+	}
+
+double SimulationClock::getWallTime(void)
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)*1.0e-9;
+	}
+
+void SimulationClock::reset(double now)
+	{
+	lastTime=now;
+	accumulator=0.0;
+	stepTime=now;
+	}
+
+unsigned int SimulationClock::update(double now)
+	{
+	/* Collect the elapsed time: */
+	accumulator+=now-lastTime;
+	lastTime=now;
+
+	/* Spend the accumulated time in full steps: */
+	unsigned int numSteps=0;
+	while(accumulator>=stepInterval&&numSteps<maxCatchUpSteps)
+		{
+		accumulator-=stepInterval;
+		++numSteps;
+		}
+
+	/* Drop time the simulation cannot catch up on: */
+	if(accumulator>=stepInterval)
+		accumulator=0.0;
+
+	/* The most recent step became due when the accumulator last crossed a step boundary: */
+	if(numSteps>0)
+		stepTime=now-accumulator;
+
+	return numSteps;
+	}
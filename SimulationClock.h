@@ -0,0 +1,51 @@
+/***********************************************************************
+SimulationClock - Fixed-timestep scheduler decoupling the simulation
+rate from the time it takes to calculate a step and from the display
+rate. Elapsed wall-clock time is collected in an accumulator, which is
+spent in units of a fixed step interval. The number of steps taken to
+catch up after a slow update is limited; time beyond that limit is
+dropped, so that a slow step slows down the simulation temporarily
+instead of making it fall further and further behind.
+***********************************************************************/
+
+#ifndef SIMULATIONCLOCK_INCLUDED
+#define SIMULATIONCLOCK_INCLUDED
+
+class SimulationClock
+	{
+	/* Elements: */
+	private:
+	double stepInterval; // Wall-clock time between simulation steps
+	unsigned int maxCatchUpSteps; // Maximum number of steps taken by a single update
+	double lastTime; // Wall-clock time of the last update
+	double accumulator; // Wall-clock time not yet spent on simulation steps
+	double stepTime; // Wall-clock time at which the most recent step became due
+
+	/* Constructors and destructors: */
+	public:
+	SimulationClock(double sStepInterval,unsigned int sMaxCatchUpSteps); // Creates a clock with the given step interval and catch-up limit
+
+	/* Methods: */
+	static double getWallTime(void); // Returns the current time of a monotonic wall clock in seconds
+	double getStepInterval(void) const // Returns the wall-clock time between simulation steps
+		{
+		return stepInterval;
+		}
+	void reset(double now); // Restarts the clock at the given wall-clock time with no steps due
+	unsigned int update(double now); // Adds the time elapsed since the last update and returns the number of steps due, at most the catch-up limit
+	double getStepTime(void) const // Returns the wall-clock time at which the most recent step became due
+		{
+		return stepTime;
+		}
+	double getNextStepTime(void) const // Returns the wall-clock time at which the next step becomes due
+		{
+		return lastTime+stepInterval-accumulator;
+		}
+	double getInterpolationWeight(double stateTime,double now) const // Returns the weight of the newer of two states one step apart at the given wall-clock time, where the newer state became due at stateTime
+		{
+		double weight=(now-stateTime)/stepInterval;
+		return weight<0.0?0.0:(weight>1.0?1.0:weight);
+		}
+	};
+
+#endif
@@ -0,0 +1,141 @@
+/***********************************************************************
+SimulationSettings - Block of simulation parameters that can be changed
+while the simulation runs: the ODE system's parameters, the time step
+and number of substeps, the lifespan of new particles, and the number of
+live particles beyond which new seeds are dropped. Settings are read at
+startup from a text file of "name value" lines, where names are those
+of the system's parameters or timeStep, substeps, lifespan, and
+maxParticles, and '#' starts a comment. At run time, the foreground
+thread edits its own copy and hands it to the simulation thread through
+a triple buffer, which applies it between two steps.
+***********************************************************************/
+
+#include "SimulationSettings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <stdexcept>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+bool parseNumber(const char* value,double& number) // Parses a number spanning the whole string; returns false if the string is not a number
+	{
+	char* end;
+	number=strtod(value,&end);
+	return end!=value&&*end=='\0';
+	}
+
+}
+
+/************************************
+Methods of struct SimulationSettings:
+************************************/
+
+SimulationSettings::SimulationSettings(void)
+	:lifespan(10.0f),maxNumParticles(1U<<20)
+	{
+	ParticleKernels::StepParameters defaults;
+	for(int i=0;i<AttractorSystems::maxNumParameters;++i)
+		systemParameters[i]=defaults.systemParameters[i];
+	timeStep=defaults.timeStep;
+	numSubsteps=defaults.numSubsteps;
+	}
+
+SimulationSettings::SimulationSettings(const ParticleKernels::StepParameters& stepParameters,float sLifespan,size_t sMaxNumParticles)
+	:timeStep(stepParameters.timeStep),numSubsteps(stepParameters.numSubsteps),
+	 lifespan(sLifespan),maxNumParticles(sMaxNumParticles)
+	{
+	for(int i=0;i<AttractorSystems::maxNumParameters;++i)
+		systemParameters[i]=stepParameters.systemParameters[i];
+	}
+
+void SimulationSettings::apply(ParticleKernels::StepParameters& stepParameters) const
+	{
+	for(int i=0;i<AttractorSystems::maxNumParameters;++i)
+		stepParameters.systemParameters[i]=systemParameters[i];
+	stepParameters.timeStep=timeStep;
+	stepParameters.numSubsteps=numSubsteps;
+	}
+
+bool SimulationSettings::set(AttractorSystems::SystemType system,const char* name,const char* value)
+	{
+	double number;
+	if(!parseNumber(value,number))
+		return false;
+
+	/* Check the system's parameters first: */
+	const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(system);
+	for(int i=0;i<si.numParameters;++i)
+		if(strcasecmp(name,si.parameterNames[i])==0)
+			{
+			systemParameters[i]=float(number);
+			return true;
+			}
+
+	/* Check the general settings, rejecting values the simulation cannot run with: */
+	if(strcasecmp(name,"timeStep")==0&&number>0.0)
+		timeStep=float(number);
+	else if(strcasecmp(name,"substeps")==0&&number>=1.0)
+		numSubsteps=(unsigned int)(number);
+	else if(strcasecmp(name,"lifespan")==0&&number>0.0)
+		lifespan=float(number);
+	else if(strcasecmp(name,"maxParticles")==0&&number>=0.0)
+		maxNumParticles=size_t(number);
+	else
+		return false;
+
+	return true;
+	}
+
+void SimulationSettings::load(AttractorSystems::SystemType system,const char* fileName)
+	{
+	FILE* file=fopen(fileName,"r");
+	if(file==0)
+		throw std::runtime_error(std::string("SimulationSettings: Unable to open settings file ")+fileName);
+
+	/* Read one setting per line, skipping empty lines and comments: */
+	std::string error;
+	char line[1024];
+	while(error.empty()&&fgets(line,sizeof(line),file)!=0)
+		{
+		char* comment=strchr(line,'#');
+		if(comment!=0)
+			*comment='\0';
+		char name[64],value[64];
+		int numFields=sscanf(line,"%63s %63s",name,value);
+		if(numFields<=0)
+			continue;
+		if(numFields!=2||!set(system,name,value))
+			error=std::string(" has an invalid line for setting ")+name;
+		}
+	if(error.empty()&&ferror(file))
+		error=" could not be read";
+	fclose(file);
+	if(!error.empty())
+		throw std::runtime_error(std::string("SimulationSettings: Settings file ")+fileName+error);
+	}
+
+bool SimulationSettings::save(AttractorSystems::SystemType system,const char* fileName) const
+	{
+	FILE* file=fopen(fileName,"w");
+	if(file==0)
+		return false;
+
+	const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(system);
+	bool ok=fprintf(file,"# Simulation settings for the %s system\n",si.name)>0;
+	for(int i=0;i<si.numParameters;++i)
+		ok=ok&&fprintf(file,"%s %.9g\n",si.parameterNames[i],systemParameters[i])>0;
+	ok=ok&&fprintf(file,"timeStep %.9g\n",timeStep)>0;
+	ok=ok&&fprintf(file,"substeps %u\n",numSubsteps)>0;
+	ok=ok&&fprintf(file,"lifespan %.9g\n",lifespan)>0;
+	ok=ok&&fprintf(file,"maxParticles %lu\n",(unsigned long)(maxNumParticles))>0;
+	ok=fclose(file)==0&&ok;
+	return ok;
+	}
@@ -0,0 +1,42 @@
+/***********************************************************************
+SimulationSettings - Block of simulation parameters that can be changed
+while the simulation runs: the ODE system's parameters, the time step
+and number of substeps, the lifespan of new particles, and the number of
+live particles beyond which new seeds are dropped. Settings are read at
+startup from a text file of "name value" lines, where names are those
+of the system's parameters or timeStep, substeps, lifespan, and
+maxParticles, and '#' starts a comment. At run time, the foreground
+thread edits its own copy and hands it to the simulation thread through
+a triple buffer, which applies it between two steps.
+***********************************************************************/
+
+#ifndef SIMULATIONSETTINGS_INCLUDED
+#define SIMULATIONSETTINGS_INCLUDED
+
+#include <stddef.h>
+
+#include "AttractorSystems.h"
+#include "ParticleKernels.h"
+
+struct SimulationSettings
+	{
+	/* Elements: */
+	public:
+	float systemParameters[AttractorSystems::maxNumParameters]; // Parameters of the ODE system
+	float timeStep; // Simulation time covered by one step
+	unsigned int numSubsteps; // Number of integration substeps per step
+	float lifespan; // Lifespan given to newly seeded particles
+	size_t maxNumParticles; // Number of live particles beyond which new seeds are dropped; at startup, also the capacity of the particle pool
+
+	/* Constructors and destructors: */
+	SimulationSettings(void); // Creates settings for the default parameters of the Lorenz system
+	SimulationSettings(const ParticleKernels::StepParameters& stepParameters,float sLifespan,size_t sMaxNumParticles); // Creates settings from the given simulation parameters, lifespan, and particle limit
+
+	/* Methods: */
+	void apply(ParticleKernels::StepParameters& stepParameters) const; // Writes the system parameters, time step, and number of substeps into the given simulation parameters
+	bool set(AttractorSystems::SystemType system,const char* name,const char* value); // Sets the setting of the given name, which is either one of the given system's parameter names or a general setting name, from the given string; returns false if there is no such setting or the value is not a number
+	void load(AttractorSystems::SystemType system,const char* fileName); // Sets all settings listed in the given file for the given system; throws std::runtime_error if the file cannot be read or lists an invalid setting
+	bool save(AttractorSystems::SystemType system,const char* fileName) const; // Writes all settings for the given system to the given file in the format read by load; returns false on errors
+	};
+
+#endif
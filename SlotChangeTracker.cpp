@@ -0,0 +1,82 @@
+/***********************************************************************
+SlotChangeTracker - Tracks which slots of a particle store received a
+different particle between published render copies, by comparing the
+persistent ids of the particles in all slots with those of the previous
+update. Every update starts a new sequence number and stamps each slot
+whose particle changed with it, so that a consumer holding the
+per-particle attributes of any older copy can be caught up to the newest
+one by rewriting only the slots stamped after that copy's sequence
+number, no matter how many copies it skipped. Changed slots are reported
+as ranges, merging ranges separated by short runs of unchanged slots to
+keep the number of ranges low.
+***********************************************************************/
+
+#include "SlotChangeTracker.h"
+
+/**********************************
+Methods of class SlotChangeTracker:
+**********************************/
+
+SlotChangeTracker::SlotChangeTracker(size_t capacity,size_t sMaxGap)
+	:numSlots(0),sequence(0),maxGap(sMaxGap)
+	{
+	/* Allocate the per-slot arrays for the full pool, so that updates never allocate memory: */
+	ids.reserve(capacity);
+	stamps.reserve(capacity);
+	}
+
+unsigned int SlotChangeTracker::update(const ParticleStore& particles)
+	{
+	++sequence;
+
+	/* Stamp the slots whose particle's persistent id differs from that of the previous update: */
+	size_t n=particles.getNumParticles();
+	const ParticleStore::Id* pIds=particles.getIds();
+	size_t numKept=n<ids.size()?n:ids.size();
+	for(size_t i=0;i<numKept;++i)
+		if(ids[i]!=pIds[i])
+			{
+			ids[i]=pIds[i];
+			stamps[i]=sequence;
+			}
+
+	/* Slots beyond those of any previous update always hold new particles: */
+	for(size_t i=numKept;i<n;++i)
+		{
+		ids.push_back(pIds[i]);
+		stamps.push_back(sequence);
+		}
+	numSlots=n;
+
+	return sequence;
+	}
+
+size_t SlotChangeTracker::findChangedRanges(unsigned int baseSequence,std::vector<SlotChangeTracker::Range>& ranges) const
+	{
+	ranges.clear();
+	size_t numChanged=0;
+	for(size_t i=0;i<numSlots;)
+		{
+		/* Skip unchanged slots, comparing sequence numbers such that they may wrap around: */
+		if(int(stamps[i]-baseSequence)<=0)
+			{
+			++i;
+			continue;
+			}
+
+		/* Extend the range up to its last changed slot that is not followed by a long gap: */
+		size_t first=i;
+		size_t end=i+1;
+		for(size_t j=end;j<numSlots&&j-end<=maxGap;++j)
+			if(int(stamps[j]-baseSequence)>0)
+				end=j+1;
+		Range range;
+		range.first=ParticleStore::Index(first);
+		range.count=ParticleStore::Index(end-first);
+		ranges.push_back(range);
+		numChanged+=end-first;
+		i=end;
+		}
+
+	return numChanged;
+	}
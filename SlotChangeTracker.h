@@ -0,0 +1,59 @@
+/***********************************************************************
+SlotChangeTracker - Tracks which slots of a particle store received a
+different particle between published render copies, by comparing the
+persistent ids of the particles in all slots with those of the previous
+update. Every update starts a new sequence number and stamps each slot
+whose particle changed with it, so that a consumer holding the
+per-particle attributes of any older copy can be caught up to the newest
+one by rewriting only the slots stamped after that copy's sequence
+number, no matter how many copies it skipped. Changed slots are reported
+as ranges, merging ranges separated by short runs of unchanged slots to
+keep the number of ranges low.
+***********************************************************************/
+
+#ifndef SLOTCHANGETRACKER_INCLUDED
+#define SLOTCHANGETRACKER_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+#include "ParticleStore.h"
+
+class SlotChangeTracker
+	{
+	/* Embedded classes: */
+	public:
+	struct Range // Structure for a range of consecutive changed slots
+		{
+		/* Elements: */
+		public:
+		ParticleStore::Index first; // Index of the first slot in the range
+		ParticleStore::Index count; // Number of slots in the range
+		};
+
+	/* Elements: */
+	private:
+	std::vector<ParticleStore::Id> ids; // Persistent id of the particle in each slot as of the most recent update
+	std::vector<unsigned int> stamps; // Sequence number of the update at which each slot last received a different particle
+	size_t numSlots; // Number of slots in use as of the most recent update
+	unsigned int sequence; // Sequence number of the most recent update; 0 before the first update
+	size_t maxGap; // Largest number of unchanged slots between two changed slots that are still reported in the same range
+
+	/* Constructors and destructors: */
+	public:
+	SlotChangeTracker(size_t capacity,size_t sMaxGap); // Creates a tracker for a particle store of the given capacity, merging ranges separated by up to the given number of unchanged slots
+
+	/* Methods: */
+	unsigned int getSequence(void) const // Returns the sequence number of the most recent update
+		{
+		return sequence;
+		}
+	size_t getNumSlots(void) const // Returns the number of slots in use as of the most recent update
+		{
+		return numSlots;
+		}
+	unsigned int update(const ParticleStore& particles); // Stamps all slots of the given compacted store whose particle changed since the previous update with a new sequence number, and returns it
+	size_t findChangedRanges(unsigned int baseSequence,std::vector<Range>& ranges) const; // Replaces the given list with the ranges of slots in use that changed after the update of the given sequence number, which are all slots in use for sequence number 0; returns the total number of slots in the ranges
+	};
+
+#endif
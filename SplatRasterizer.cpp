@@ -0,0 +1,254 @@
+/***********************************************************************
+SplatRasterizer - CPU rasterizer drawing particles into a floating-point
+image of any size, for offline rendering without an OpenGL context. Each
+particle is splatted with bilinear weights at several positions along
+its motion during the most recent step, which antialiases the image and
+blurs fast particles along their paths, and colors fade with age like
+those drawn by the interactive application. Particles are projected in
+parallel batches, binned into horizontal bands of the image, and
+splatted band by band, with even and odd bands in separate passes so
+that no two workers ever touch the same pixel; the accumulated image is
+tone-mapped into 8-bit sRGB pixels.
+***********************************************************************/
+
+#include "SplatRasterizer.h"
+
+#include <string.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+/********************************************
+Methods of class SplatRasterizer::ProjectJob:
+********************************************/
+
+void SplatRasterizer::ProjectJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t begin=chunkIndex*chunkSize;
+	size_t end=begin+chunkSize<numVertices?begin+chunkSize:numVertices;
+	Chunk& chunk=rasterizer.chunks[chunkIndex];
+	chunk.unsorted.clear();
+	chunk.bands.clear();
+
+	float cx=float(rasterizer.width)*0.5f-0.5f;
+	float cy=float(rasterizer.height)*0.5f-0.5f;
+	for(const Vertex* vPtr=vertices+begin;vPtr!=vertices+end;++vPtr)
+		{
+		/* Drain the color channels with age such that the particle turns black at the end of its lifespan: */
+		float age=(currentTime-vPtr->texCoord[0])/vPtr->texCoord[1];
+		if(!(age>0.0f))
+			age=0.0f;
+		else if(age>1.0f)
+			age=1.0f;
+		float color[3];
+		for(int j=0;j<3;++j)
+			color[j]=float(vPtr->color[j]);
+		float drain=age*(color[0]+color[1]+color[2]);
+		float dg=Math::min(color[1],drain);
+		float dr=Math::min(color[0],drain-dg);
+		float db=Math::min(color[2],drain-dg-dr);
+		Splat splat;
+		splat.color[0]=(color[0]-dr)*rasterizer.sampleWeight;
+		splat.color[1]=(color[1]-dg)*rasterizer.sampleWeight;
+		splat.color[2]=(color[2]-db)*rasterizer.sampleWeight;
+		if(splat.color[0]+splat.color[1]+splat.color[2]<=0.0f)
+			continue;
+
+		for(unsigned int sample=0;sample<rasterizer.numSamples;++sample)
+			{
+			/* Place the sample along the particle's motion during the most recent step: */
+			float t=(float(sample)+0.5f)/float(rasterizer.numSamples);
+			float d[3];
+			for(int j=0;j<3;++j)
+				d[j]=vPtr->normal[j]+(vPtr->position[j]-vPtr->normal[j])*t-rasterizer.eye[j];
+
+			/* Project the sample and drop it if it lies behind the camera or off the image: */
+			float z=d[0]*rasterizer.axes[2][0]+d[1]*rasterizer.axes[2][1]+d[2]*rasterizer.axes[2][2];
+			if(z<=0.0f)
+				continue;
+			splat.x=cx+(d[0]*rasterizer.axes[0][0]+d[1]*rasterizer.axes[0][1]+d[2]*rasterizer.axes[0][2])*rasterizer.scale[0]/z;
+			splat.y=cy-(d[0]*rasterizer.axes[1][0]+d[1]*rasterizer.axes[1][1]+d[2]*rasterizer.axes[1][2])*rasterizer.scale[1]/z;
+			if(!(splat.x>-1.0f&&splat.x<float(rasterizer.width)&&splat.y>-1.0f&&splat.y<float(rasterizer.height)))
+				continue;
+
+			/* Bin the sample by the top row of its footprint: */
+			int row=int(Math::floor(splat.y));
+			chunk.unsorted.push_back(splat);
+			chunk.bands.push_back((row>0?unsigned(row):0U)/rasterizer.bandHeight);
+			}
+		}
+
+	/* Sort the samples by band: */
+	chunk.bandOffsets.assign(rasterizer.numBands+1,0);
+	for(std::vector<unsigned int>::iterator bIt=chunk.bands.begin();bIt!=chunk.bands.end();++bIt)
+		++chunk.bandOffsets[*bIt+1];
+	for(unsigned int band=0;band<rasterizer.numBands;++band)
+		chunk.bandOffsets[band+1]+=chunk.bandOffsets[band];
+	chunk.splats.resize(chunk.unsorted.size());
+	std::vector<unsigned int> next(chunk.bandOffsets.begin(),chunk.bandOffsets.end()-1);
+	for(size_t i=0;i<chunk.unsorted.size();++i)
+		chunk.splats[next[chunk.bands[i]]++]=chunk.unsorted[i];
+	}
+
+/******************************************
+Methods of class SplatRasterizer::SplatJob:
+******************************************/
+
+void SplatRasterizer::SplatJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	unsigned int band=(unsigned int)(chunkIndex)*2+parity;
+	if(band>=rasterizer.numBands)
+		return;
+
+	int width=int(rasterizer.width);
+	int height=int(rasterizer.height);
+	float* image=rasterizer.image.data();
+	for(size_t i=0;i<numChunks;++i)
+		{
+		const Chunk& chunk=rasterizer.chunks[i];
+		const Splat* sEnd=chunk.splats.data()+chunk.bandOffsets[band+1];
+		for(const Splat* sPtr=chunk.splats.data()+chunk.bandOffsets[band];sPtr!=sEnd;++sPtr)
+			{
+			/* Deposit the sample's color into the four pixels around it with bilinear weights: */
+			float fx=Math::floor(sPtr->x);
+			float fy=Math::floor(sPtr->y);
+			int x0=int(fx);
+			int y0=int(fy);
+			float wx=sPtr->x-fx;
+			float wy=sPtr->y-fy;
+			for(int dy=0;dy<2;++dy)
+				{
+				int y=y0+dy;
+				if(y<0||y>=height)
+					continue;
+				float rowWeight=dy==0?1.0f-wy:wy;
+				for(int dx=0;dx<2;++dx)
+					{
+					int x=x0+dx;
+					if(x<0||x>=width)
+						continue;
+					float weight=rowWeight*(dx==0?1.0f-wx:wx);
+					float* pixel=image+(size_t(y)*size_t(width)+size_t(x))*3;
+					for(int j=0;j<3;++j)
+						pixel[j]+=sPtr->color[j]*weight;
+					}
+				}
+			}
+		}
+	}
+
+/********************************************
+Methods of class SplatRasterizer::ResolveJob:
+********************************************/
+
+void SplatRasterizer::ResolveJob::processChunk(size_t chunkIndex,unsigned int workerIndex)
+	{
+	size_t rowBegin=chunkIndex*rasterizer.bandHeight;
+	size_t rowEnd=rowBegin+rasterizer.bandHeight<rasterizer.height?rowBegin+rasterizer.bandHeight:rasterizer.height;
+	size_t begin=rowBegin*rasterizer.width*3;
+	size_t end=rowEnd*rasterizer.width*3;
+
+	/* Saturate accumulated colors exponentially so that dense regions do not clip, and encode them in sRGB: */
+	float* image=rasterizer.image.data();
+	float maxIndex=float(toneMapSize-1);
+	for(size_t i=begin;i<end;++i)
+		{
+		/* Most pixels of a particle image stay black: */
+		if(image[i]==0.0f)
+			pixels[i]=0;
+		else
+			{
+			float exposed=1.0f-Math::exp(-rasterizer.exposure*image[i]);
+			pixels[i]=rasterizer.toneMap[int(exposed*maxIndex+0.5f)];
+			}
+		}
+
+	/* Clear the band for the next frame: */
+	memset(image+begin,0,(end-begin)*sizeof(float));
+	}
+
+/********************************
+Methods of class SplatRasterizer:
+********************************/
+
+SplatRasterizer::SplatRasterizer(unsigned int sWidth,unsigned int sHeight,unsigned int numThreads)
+	:width(sWidth>0?sWidth:1),height(sHeight>0?sHeight:1),
+	 image(size_t(width)*size_t(height)*3,0.0f),
+	 workerPool(numThreads),
+	 chunks(batchSize/chunkSize),
+	 numSamples(1),sampleWeight(1.0f/255.0f),exposure(1.0f)
+	{
+	/* Use enough bands that each of the two splatting passes balances well over all workers: */
+	bandHeight=height/(workerPool.getNumWorkers()*16);
+	if(bandHeight<2)
+		bandHeight=2;
+	numBands=(height+bandHeight-1)/bandHeight;
+
+	/* Look along the y axis at the origin until a view is set: */
+	static const float center[3]={0.0f,0.0f,0.0f};
+	setView(center,1.0f,-0.5f*Math::Constants<float>::pi,0.0f,0.5f);
+
+	/* Tabulate the sRGB encoding: */
+	for(unsigned int i=0;i<toneMapSize;++i)
+		{
+		float linear=float(i)/float(toneMapSize-1);
+		float encoded=linear<=0.0031308f?12.92f*linear:1.055f*Math::pow(linear,1.0f/2.4f)-0.055f;
+		toneMap[i]=(unsigned char)(encoded*255.0f+0.5f);
+		}
+	}
+
+SplatRasterizer::~SplatRasterizer(void)
+	{
+	}
+
+void SplatRasterizer::setView(const float center[3],float distance,float azimuth,float elevation,float fov)
+	{
+	/* Place the camera on a sphere around the center, looking at it with the z axis pointing up: */
+	float viewDir[3]={-Math::cos(elevation)*Math::cos(azimuth),-Math::cos(elevation)*Math::sin(azimuth),-Math::sin(elevation)};
+	for(int j=0;j<3;++j)
+		{
+		eye[j]=center[j]-viewDir[j]*distance;
+		axes[2][j]=viewDir[j];
+		}
+	axes[0][0]=-Math::sin(azimuth);
+	axes[0][1]=Math::cos(azimuth);
+	axes[0][2]=0.0f;
+	axes[1][0]=axes[0][1]*axes[2][2]-axes[0][2]*axes[2][1];
+	axes[1][1]=axes[0][2]*axes[2][0]-axes[0][0]*axes[2][2];
+	axes[1][2]=axes[0][0]*axes[2][1]-axes[0][1]*axes[2][0];
+
+	/* Scale tangents by half the image height over the tangent of half the field of view, with square pixels: */
+	scale[1]=float(height)*0.5f/Math::tan(fov*0.5f);
+	scale[0]=scale[1];
+	}
+
+void SplatRasterizer::setSampling(unsigned int newNumSamples,float newExposure)
+	{
+	numSamples=newNumSamples>0?newNumSamples:1;
+	sampleWeight=1.0f/(255.0f*float(numSamples));
+	exposure=newExposure;
+	}
+
+void SplatRasterizer::splat(const Vertex* vertices,size_t numVertices,float currentTime)
+	{
+	for(size_t base=0;base<numVertices;base+=batchSize)
+		{
+		/* Project and bin one batch of particles in parallel: */
+		size_t numBatchVertices=numVertices-base<batchSize?numVertices-base:batchSize;
+		size_t numChunks=(numBatchVertices+chunkSize-1)/chunkSize;
+		ProjectJob projectJob(*this,vertices+base,numBatchVertices,currentTime);
+		workerPool.run(projectJob,numChunks);
+
+		/* Splat the even bands, then the odd bands, so that no two neighboring bands are splatted at the same time: */
+		for(unsigned int parity=0;parity<2;++parity)
+			{
+			SplatJob splatJob(*this,numChunks,parity);
+			workerPool.run(splatJob,(numBands+1)/2);
+			}
+		}
+	}
+
+void SplatRasterizer::resolve(unsigned char* pixels)
+	{
+	ResolveJob resolveJob(*this,pixels);
+	workerPool.run(resolveJob,numBands);
+	}
@@ -0,0 +1,159 @@
+/***********************************************************************
+SplatRasterizer - CPU rasterizer drawing particles into a floating-point
+image of any size, for offline rendering without an OpenGL context. Each
+particle is splatted with bilinear weights at several positions along
+its motion during the most recent step, which antialiases the image and
+blurs fast particles along their paths, and colors fade with age like
+those drawn by the interactive application. Particles are projected in
+parallel batches, binned into horizontal bands of the image, and
+splatted band by band, with even and odd bands in separate passes so
+that no two workers ever touch the same pixel; the accumulated image is
+tone-mapped into 8-bit sRGB pixels.
+***********************************************************************/
+
+#ifndef SPLATRASTERIZER_INCLUDED
+#define SPLATRASTERIZER_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+#include "WorkerPool.h"
+
+class SplatRasterizer
+	{
+	/* Embedded classes: */
+	public:
+	struct Vertex // Interleaved particle vertex with the same layout as the vertices exported by StrangeAttractors
+		{
+		/* Elements: */
+		public:
+		float texCoord[2]; // Particle birth time and lifespan
+		unsigned char color[4]; // Particle RGBA color
+		float normal[3]; // Particle position before the most recent step
+		float position[3]; // Particle position
+		};
+
+	private:
+	struct Splat // Structure for one projected sample of a particle
+		{
+		/* Elements: */
+		public:
+		float x,y; // Pixel coordinates of the sample, with pixel centers at integers
+		float color[3]; // Weighted RGB color deposited by the sample
+		};
+
+	struct Chunk // Structure holding the samples projected from one chunk of a batch, sorted by band
+		{
+		/* Elements: */
+		public:
+		std::vector<Splat> splats; // Projected samples
+		std::vector<unsigned int> bandOffsets; // Index of the first sample of each band, and the total number of samples
+		std::vector<unsigned int> bands; // Band of each projected sample, before sorting
+		std::vector<Splat> unsorted; // Projected samples, before sorting
+		};
+
+	class ProjectJob:public WorkerPool::Job // Job projecting the particles of one chunk of a batch
+		{
+		/* Elements: */
+		public:
+		SplatRasterizer& rasterizer; // Rasterizer receiving the samples
+		const Vertex* vertices; // First vertex of the batch
+		size_t numVertices; // Number of vertices in the batch
+		float currentTime; // Time against which particle ages are measured
+
+		/* Constructors and destructors: */
+		ProjectJob(SplatRasterizer& sRasterizer,const Vertex* sVertices,size_t sNumVertices,float sCurrentTime)
+			:rasterizer(sRasterizer),vertices(sVertices),numVertices(sNumVertices),currentTime(sCurrentTime)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class SplatJob:public WorkerPool::Job // Job splatting the samples of one band of the image
+		{
+		/* Elements: */
+		public:
+		SplatRasterizer& rasterizer; // Rasterizer owning the image
+		size_t numChunks; // Number of chunks projected in the current batch
+		unsigned int parity; // Parity of the bands splatted in this pass
+
+		/* Constructors and destructors: */
+		SplatJob(SplatRasterizer& sRasterizer,size_t sNumChunks,unsigned int sParity)
+			:rasterizer(sRasterizer),numChunks(sNumChunks),parity(sParity)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	class ResolveJob:public WorkerPool::Job // Job tone-mapping and clearing one band of the image
+		{
+		/* Elements: */
+		public:
+		SplatRasterizer& rasterizer; // Rasterizer owning the image
+		unsigned char* pixels; // RGB pixel array receiving the tone-mapped image
+
+		/* Constructors and destructors: */
+		ResolveJob(SplatRasterizer& sRasterizer,unsigned char* sPixels)
+			:rasterizer(sRasterizer),pixels(sPixels)
+			{
+			}
+
+		/* Methods from WorkerPool::Job: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex);
+		};
+
+	/* Elements: */
+	static const size_t chunkSize=4096; // Number of particles projected by a worker at a time
+	static const size_t batchSize=chunkSize*64; // Number of particles projected before their samples are splatted, to bound the memory held by samples
+	static const unsigned int toneMapSize=4096; // Number of entries of the tone-mapping table
+	unsigned int width,height; // Image size in pixels
+	unsigned int bandHeight; // Number of image rows per band; at least two, so that a bilinear splat only reaches into the next band
+	unsigned int numBands; // Number of bands covering the image
+	std::vector<float> image; // Accumulated RGB image, row by row from the top
+	WorkerPool workerPool; // Pool of worker threads sharing projection, splatting, and tone mapping; the thread calling the rasterizer is its first worker
+	std::vector<Chunk> chunks; // Samples projected from each chunk of the current batch
+	float eye[3]; // Camera position
+	float axes[3][3]; // Camera's right, up, and viewing directions
+	float scale[2]; // Factors from tangent space to pixels along the image's x and y axes
+	unsigned int numSamples; // Number of samples per particle along its motion during the most recent step
+	float sampleWeight; // Weight of the color deposited by each sample
+	float exposure; // Factor applied to accumulated colors before tone mapping
+	unsigned char toneMap[toneMapSize]; // Table from exposed color in [0, 1] to 8-bit sRGB value
+
+	/* Private methods: */
+	SplatRasterizer(const SplatRasterizer& source); // Prohibit copy constructor
+	SplatRasterizer& operator=(const SplatRasterizer& source); // Prohibit assignment operator
+
+	/* Constructors and destructors: */
+	public:
+	SplatRasterizer(unsigned int sWidth,unsigned int sHeight,unsigned int numThreads); // Creates a rasterizer for images of the given size, using the given total number of threads; 0 uses one thread per CPU
+	~SplatRasterizer(void);
+
+	/* Methods: */
+	unsigned int getWidth(void) const // Returns the image width in pixels
+		{
+		return width;
+		}
+	unsigned int getHeight(void) const // Returns the image height in pixels
+		{
+		return height;
+		}
+	size_t getImageSize(void) const // Returns the size of a tone-mapped RGB image in bytes
+		{
+		return size_t(width)*size_t(height)*3;
+		}
+	unsigned int getNumThreads(void) const // Returns the total number of threads sharing the rasterization
+		{
+		return workerPool.getNumWorkers();
+		}
+	void setView(const float center[3],float distance,float azimuth,float elevation,float fov); // Places the camera at the given distance from the given center, in the direction of the given azimuth around the z axis and elevation above the x-y plane in radians, with the given vertical field of view in radians
+	void setSampling(unsigned int newNumSamples,float newExposure); // Sets the number of samples per particle and the exposure of the tone mapping
+	void splat(const Vertex* vertices,size_t numVertices,float currentTime); // Adds the given particles, with ages measured against the given time, to the accumulated image
+	void resolve(unsigned char* pixels); // Writes the tone-mapped accumulated image into the given RGB pixel array, and clears the accumulated image for the next frame
+	};
+
+#endif
@@ -0,0 +1,72 @@
+/***********************************************************************
+StepKernel - Generic loop advancing structure-of-arrays particle
+positions by one time step, instantiated for each combination of ODE
+system and integrator, in single or double precision. Only include this
+from source files compiled with the SIMD instruction set flags.
+***********************************************************************/
+
+#ifndef STEPKERNEL_INCLUDED
+#define STEPKERNEL_INCLUDED
+
+#include <stddef.h>
+
+#include "Simd.h"
+
+namespace ParticleKernels {
+
+template <class SystemParam,class IntegratorParam>
+inline void stepParticles(const SystemParam& system,const IntegratorParam& integrator,float* x,float* y,float* z,size_t numParticles,double dt,unsigned int numSubsteps) // Advances particles in full SIMD packs by the given number of substeps covering dt
+	{
+	typedef Simd::FloatPack Pack;
+	double substepDt=numSubsteps>1?dt/double(numSubsteps):dt;
+
+	for(size_t i=0;i<numParticles;i+=Pack::numLanes)
+		{
+		/* Load the next pack of particle positions: */
+		Pack p[3];
+		p[0]=Pack::load(x+i);
+		p[1]=Pack::load(y+i);
+		p[2]=Pack::load(z+i);
+
+		/* Advance the pack along the ODE system, keeping it in registers across substeps: */
+		for(unsigned int substep=0;substep<numSubsteps;++substep)
+			integrator.step(system,p,substepDt);
+
+		/* Store the updated positions: */
+		p[0].store(x+i);
+		p[1].store(y+i);
+		p[2].store(z+i);
+		}
+	}
+
+template <class SystemParam,class IntegratorParam>
+inline void stepParticles(const SystemParam& system,const IntegratorParam& integrator,double* x,double* y,double* z,float* renderX,float* renderY,float* renderZ,size_t numParticles,double dt,unsigned int numSubsteps) // Advances double-precision particles in full SIMD packs like above, and writes their new positions rounded to single precision into the render arrays
+	{
+	typedef Simd::DoublePack Pack;
+	double substepDt=numSubsteps>1?dt/double(numSubsteps):dt;
+
+	for(size_t i=0;i<numParticles;i+=Pack::numLanes)
+		{
+		/* Load the next pack of particle positions: */
+		Pack p[3];
+		p[0]=Pack::load(x+i);
+		p[1]=Pack::load(y+i);
+		p[2]=Pack::load(z+i);
+
+		/* Advance the pack along the ODE system, keeping it in registers across substeps: */
+		for(unsigned int substep=0;substep<numSubsteps;++substep)
+			integrator.step(system,p,substepDt);
+
+		/* Store the updated positions, and round them once for all other users of the particle state: */
+		p[0].store(x+i);
+		p[1].store(y+i);
+		p[2].store(z+i);
+		p[0].storeFloat(renderX+i);
+		p[1].storeFloat(renderY+i);
+		p[2].storeFloat(renderZ+i);
+		}
+	}
+
+}
+
+#endif
@@ -12,49 +12,269 @@ Last Modified: 9/24/24
 ***********************************************************************/
 
 #include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
 #include <Threads/Thread.h>
 #include <Threads/TripleBuffer.h>
-#include <Threads/RingBuffer.h>
 #include <Math/Math.h>
 #include <Math/Constants.h>
-#include <Math/Random.h>
 #include <Geometry/OrthogonalTransformation.h>
 #include <GL/gl.h>
+#include <GL/GLObject.h>
+#include <GL/GLContextData.h>
+#include <GL/GLVertexArrayParts.h>
 #include <GL/GLGeometryVertex.h>
-#include <GL/GLVertexBuffer.h>
+#include <GL/GLExtensionManager.h>
 #include <vector>
+#include <GLMotif/StyleSheet.h>
+#include <GLMotif/WidgetManager.h>
+#include <GLMotif/PopupWindow.h>
+#include <GLMotif/RowColumn.h>
+#include <GLMotif/Label.h>
+#include <GLMotif/TextField.h>
+#include <GLMotif/Slider.h>
+#include <GLMotif/Button.h>
 #include <Vrui/Tool.h>
 #include <Vrui/GenericToolFactory.h>
 #include <Vrui/ToolManager.h>
 #include <Vrui/Vrui.h>
 #include <Vrui/Application.h>
 
-class StrangeAttractors:public Vrui::Application
+#include "QuantizedVertex.h"
+#include "ParticleStore.h"
+#include "SeedQueue.h"
+#include "SeedEmitter.h"
+#include "ParticleKernels.h"
+#include "WorkerPool.h"
+#include "ParticleArena.h"
+#include "ParticleSimulator.h"
+#include "EnsembleTable.h"
+#include "EnsembleSimulator.h"
+#include "TrajectoryRecorder.h"
+#include "TrajectoryPlayer.h"
+#include "ParticleSnapshot.h"
+#include "AttractorCloud.h"
+#include "ClusterParticleSync.h"
+#include "CounterRandom.h"
+#include "GPUParticleEngine.h"
+#include "StreamingVertexBuffer.h"
+#include "ParticleTrails.h"
+#include "SimulationClock.h"
+#include "ShaderHelpers.h"
+#include "ParticleAppearance.h"
+#include "Profiler.h"
+#include "GPUTimer.h"
+#include "BudgetController.h"
+#include "SimulationSettings.h"
+#include "SlotChangeTracker.h"
+
+class StrangeAttractors:public Vrui::Application,public GLObject
 	{
 	/* Embedded classes: */
 	private:
-	typedef GLGeometry::Vertex<void,0,GLubyte,4,void,float,3> ParticleVertex; // Type for Particles storing colors and positions
-	typedef std::vector<ParticleVertex> ParticleList; // Vector of particleVertex
-	typedef std::vector<float> TimeList; // Vector of times
-	typedef GLVertexBuffer<ParticleVertex> VertexBuffer; // Type for OpenGL buffers holding mesh vertices
+	typedef GLGeometry::Vertex<GLfloat,2,GLubyte,4,float,float,3> ParticleVertex; // Type for Particles storing colors and positions; texture coordinates hold birth times and lifespans for fading, and normals hold the positions before the most recent step for interpolation
+	typedef std::vector<ParticleVertex,ParticleArena::Allocator<ParticleVertex> > ParticleList; // Vector of particleVertex, drawn from the particle arena
+	typedef std::vector<QuantizedVertex,ParticleArena::Allocator<QuantizedVertex> > QuantizedVertexList; // Vector of compact vertices, drawn from the particle arena
+	typedef std::vector<ParticleTrails::Vertex,ParticleArena::Allocator<ParticleTrails::Vertex> > TrailVertexList; // Vector of trail history entries, drawn from the particle arena
+	
+	struct MotionVertex // Structure for the parts of a particle's vertex that change with every step in incremental mode
+		{
+		/* Elements: */
+		public:
+		GLfloat normal[3]; // Position before the most recent step
+		GLfloat position[3]; // Current position
+		};
+	
+	struct AttributeVertex // Structure for the parts of a particle's vertex that stay fixed while it keeps its slot in incremental mode
+		{
+		/* Elements: */
+		public:
+		GLfloat texCoord[2]; // Birth time and lifespan
+		GLubyte color[4]; // Color
+		};
+	
+	typedef std::vector<MotionVertex,ParticleArena::Allocator<MotionVertex> > MotionVertexList; // Vector of motion vertices, drawn from the particle arena
+	typedef std::vector<AttributeVertex,ParticleArena::Allocator<AttributeVertex> > AttributeVertexList; // Vector of attribute vertices, drawn from the particle arena
+	
+	struct ParticleState // Structure holding a render copy of the particle state
+		{
+		/* Elements: */
+		public:
+		ParticleList vertices; // Interleaved vertices of all particles
+		QuantizedVertexList quantizedVertices; // Compact vertices of all particles in compact mode
+		float vertexTime; // Application time against which the ages of compact vertices are measured
+		TrailVertexList trailVertices; // Newest trail history layer of all particles in slot order, if trails are drawn
+		MotionVertexList motionVertices; // Positions and previous positions of all particles in slot order in incremental mode
+		std::vector<SlotChangeTracker::Range> attributeRanges; // Ranges of slots whose particles changed after the base sequence number in incremental mode
+		AttributeVertexList attributeVertices; // Attribute vertices of the slots in all changed ranges, one range after another, in incremental mode
+		unsigned int sequence; // Slot change sequence number of this state in incremental mode
+		unsigned int baseSequence; // Sequence number of the newest state acknowledged by the foreground thread when this state was produced, against which the changed ranges are found
+		std::vector<GLubyte> densityVoxels; // Tone-mapped density histogram of all particles in density mode
+		std::vector<unsigned int> cellCounts; // Number of vertices in each cell of the culling grid, if vertices are binned
+		std::vector<unsigned int> ensembleFirsts; // Index of each ensemble's first vertex, followed by the total number of vertices, in sweep mode
+		size_t numParticles; // Number of particles in the simulation when this state was produced
+		double stateTime; // Wall-clock time at which the simulation step producing this state became due
+		};
+	
+	enum ProfilerZone // Enumerated type for instrumented code paths
+		{
+		ZONE_STEP=0,ZONE_EXPORT,ZONE_UPDATE_MESH,ZONE_HANDOFF,ZONE_UPLOAD,ZONE_DRAW,ZONE_GPU_DRAW,NUM_ZONES
+		};
+	
+	enum ProfilerCounter // Enumerated type for counted events
+		{
+		COUNTER_SEEDS=0,COUNTER_UPLOAD_BYTES,NUM_COUNTERS
+		};
+	
+	enum RandomDomain // Enumerated type for independent families of random streams
+		{
+		DOMAIN_INITIAL_SEEDS=0,DOMAIN_SPRAYED_SEEDS
+		};
+	
+	enum Statistic // Enumerated type for values shown in the statistics dialog
+		{
+		STAT_PARTICLES=0,STAT_SEEDS,STAT_STEP,STAT_EXPORT,STAT_UPLOAD,STAT_DRAW,STAT_GPU_DRAW,NUM_STATISTICS
+		};
+	
+	enum Setting // Enumerated type for general settings in the settings dialog, which lists the system parameters after them
+		{
+		SETTING_TIME_STEP=0,SETTING_SUBSTEPS,SETTING_LIFESPAN,SETTING_MAX_PARTICLES,NUM_GENERAL_SETTINGS
+		};
+	
+	struct DataItem:public GLObject::DataItem // Structure holding per-context rendering state
+		{
+		/* Elements: */
+		public:
+		GLuint particleProgram; // Shader program fading particles by age and interpolating their positions between the two most recent steps, or 0
+		GLint particleUniforms[3]; // Locations of the particle program's uniform variables
+		GLint quantizerUniforms[4]; // Locations of the uniform variables decoding compact vertices, if the particle program reads them
+		double uniformFrameTime; // Application time of the frame whose values were last loaded into the particle program's uniform variables
+		GLuint vertexBufferId; // Buffer holding the locked render copy of the triple-buffered particle state, or 0
+		GLuint vertexArrayId; // Vertex array object capturing the vertex buffer's attribute layout, or 0 if not supported
+		double vertexStateTime; // Time of the render state whose vertices are currently in the vertex buffer
+		size_t numBufferVertices; // Number of vertices currently in the vertex buffer
+		GLuint attributeBufferId; // Buffer holding the attribute vertices of all slots in incremental mode, or 0
+		unsigned int attributeSequence; // Slot change sequence number of the state whose attributes are currently in the attribute buffer
+		GPUTimer gpuTimer; // Timer queries measuring the GPU time spent drawing particles
+		GLuint densityTextureId; // 3D texture holding the tone-mapped density histogram in density mode, or 0
+		double densityStateTime; // Time of the render state whose density histogram is currently in the texture
+		std::vector<GLint> drawFirsts; // First vertices of the ranges of visible grid cells drawn in the current pass
+		std::vector<GLsizei> drawCounts; // Numbers of vertices of the ranges of visible grid cells drawn in the current pass
+		
+		/* Constructors and destructors: */
+		DataItem(void)
+			:particleProgram(0),
+			 uniformFrameTime(-1.0),
+			 vertexBufferId(0),vertexArrayId(0),vertexStateTime(-1.0),numBufferVertices(0),
+			 attributeBufferId(0),attributeSequence(0),
+			 densityTextureId(0),densityStateTime(-1.0)
+			{
+			for(int i=0;i<3;++i)
+				particleUniforms[i]=-1;
+			for(int i=0;i<4;++i)
+				quantizerUniforms[i]=-1;
+			}
+		virtual ~DataItem(void)
+			{
+			if(particleProgram!=0)
+				glDeleteProgram(particleProgram);
+			if(vertexArrayId!=0)
+				glDeleteVertexArrays(1,&vertexArrayId);
+			if(vertexBufferId!=0)
+				glDeleteBuffers(1,&vertexBufferId);
+			if(attributeBufferId!=0)
+				glDeleteBuffers(1,&attributeBufferId);
+			if(densityTextureId!=0)
+				glDeleteTextures(1,&densityTextureId);
+			}
+		};
+	
 	class SeedParticlesTool; // Forward declaration
 	typedef Vrui::GenericToolFactory<SeedParticlesTool> SeedParticlesToolFactory; // Tool class uses the generic factory class	
+	class EmitParticlesTool; // Forward declaration
+	typedef Vrui::GenericToolFactory<EmitParticlesTool> EmitParticlesToolFactory; // Tool class uses the generic factory class
 	
 	/* Elements: */
 	private:
+	ParticleKernels::StepParameters stepParameters; // ODE system, parameters, integrator, and time step of the simulation
 	int initParticleSize; // number of Particles
 	float timeDecay; // lifespan of a Particle
-	struct ParticleTimeList{
-		ParticleList particleList;
-		TimeList timeList;
-	};
-	Threads::TripleBuffer<ParticleTimeList> particleVertices;
-	Threads::RingBuffer<ParticleVertex> inputParticles;
-	const ParticleList* oldParticleList; //pointer to array of particles from the last step
-	const TimeList* oldTimeList; //pointer to array of time from the last step
-	VertexBuffer vertexBuffer; // Buffer holding mesh vertices
+	size_t maxNumParticles; // Capacity of the particle pool; seeds beyond this are dropped
+	ParticleArena* arena; // Arena holding the CPU simulation engine's particle store and the render copies in the triple buffer's slots, or null
+	ParticleSimulator* simulator; // CPU simulation engine advancing all particles on the background thread, or null
+	EnsembleSimulator* ensembleSimulator; // CPU simulation engine advancing a parameter sweep of independent ensembles on the background thread instead, or null
+	std::vector<unsigned int> shownEnsembles; // Indices of the ensembles being drawn in sweep mode
+	bool overlayEnsembles; // Flag whether shown ensembles are drawn on top of each other instead of side by side
+	unsigned int numEnsembleColumns; // Number of ensembles per row when drawn side by side
+	float ensembleSpacing; // Distance between the centers of neighboring ensembles drawn side by side
+	Threads::TripleBuffer<ParticleState> particleStates; // Interleaved render copies of the particle state
+	SeedQueue seedQueue; // Lock-free queue of particles seeded by any number of tools, drained in bulk by the simulation
+	unsigned int seedsPerFrame; // Number of particles each seeding tool sprays per frame
+	SeedEmitter::Shape emitterShape; // Shape of the volume from which each emitter tool emits particles
+	float emitterSize; // Size of each emitter tool's volume, or 0 to scale it to the attractor's size
+	double emitterRate; // Number of particles each emitter tool emits per second
+	BudgetController* budgetController; // Controller adapting the particle budget to the measured load, or null
+	std::atomic<size_t> particleBudget; // Number of live particles beyond which the simulation drops new seeds
+	std::atomic<float> lifespanScale; // Fraction of the configured lifespan given to newly seeded particles by the simulation
+	float drawFraction; // Fraction of particles drawn
+	unsigned int numBudgetFrames; // Number of frames since the most recent profiler snapshot
+	CounterRandom random; // Counter-based generator drawing every seed from its own random stream
+	uint64_t nextSprayStream; // Index of the random stream of the next particle sprayed by any seeding tool
+	StreamingVertexBuffer* streamingBuffer; // Persistently mapped buffer into which the background thread writes mesh vertices directly, or null
+	bool compactVertices; // Flag whether render copies hold quantized vertices instead of interleaved floats
+	VertexQuantizer vertexQuantizer; // Ranges of the positions and lifespans of quantized vertices
+	float regionVertexTimes[StreamingVertexBuffer::numRegions]; // Times against which the ages of the compact vertices in each region of the streaming buffer are measured
+	float lockedVertexTime; // Time against which the ages of the locked compact vertices are measured
+	SlotChangeTracker* slotChanges; // Tracker of the slots receiving different particles between render copies, if only their changed attributes are published, or null
+	std::atomic<unsigned int> acknowledgedSequence; // Slot change sequence number of the newest render copy whose attributes were applied by the foreground thread
+	std::vector<AttributeVertex> attributeMirror; // Attribute vertices of all slots as of the locked render copy, for contexts whose attribute buffers fell too far behind
+	ParticleTrails* trails; // Renderer drawing the recent path of every particle, or null
+	GPUParticleEngine* gpuEngine; // Engine simulating particles on the GPU instead of the background thread, or null
+	volatile bool keepRunning; // Flag to tell the background StrangeAttractors thread to shut down
 	Threads::Thread strangeAttractorsThread; // Thread object for the background StrangeAttractors thread
+	SimulationClock simulationClock; // Fixed-timestep clock scheduling simulation steps on the background thread
+	bool interpolate; // Flag whether to interpolate particle positions between the two most recent steps while rendering
+	double lockedStateTime; // Wall-clock time at which the locked render state became due
+	float interpolationWeight; // Weight of the most recent step in the interpolated positions of the current frame
+	float densityGain; // Brightness of the density volume
+	int densitySliceAxis; // Axis perpendicular to the slices through the density volume drawn in the current frame
+	std::vector<unsigned int> regionCellCounts[StreamingVertexBuffer::numRegions]; // Culling grid cell sizes of the vertices in each region of the streaming buffer
+	const unsigned int* lockedCellCounts; // Culling grid cell sizes of the locked vertices, or null
+	float lodDistance; // Eye distance in physical units beyond which grid cells are drawn at reduced density, or 0 to draw all visible particles
+	float lodMinFraction; // Smallest fraction of a distant grid cell's particles that is drawn
+	TrajectoryRecorder* recorder; // Recorder writing posted particle states to a trajectory file, or null
+	unsigned int recordInterval; // Number of posted particle states per recorded state
+	unsigned int numUnrecordedPosts; // Number of particle states posted since the last recorded state
+	double lastStepTime; // Application time of the most recent simulation step
+	const char* checkpointFileName; // Name of the snapshot file restored at startup and written at exit and periodically, or null
+	double checkpointInterval; // Application time between periodic checkpoints, or 0 to only save at exit
+	double nextCheckpointTime; // Application time at which the next periodic checkpoint is due
+	static const char* const zoneNames[NUM_ZONES]; // Names of instrumented code paths
+	mutable Profiler profiler; // Profiler timing the instrumented code paths on all threads
+	const char* traceFileName; // Name of the file receiving a Chrome trace of all timed zones at exit, or null
+	size_t numVisibleParticles; // Number of particles drawn in the current frame
+	GLMotif::PopupWindow* statisticsDialog; // Dialog showing performance statistics, or null
+	GLMotif::TextField* statisticsFields[NUM_STATISTICS]; // Text fields showing the values in the statistics dialog
+	TrajectoryPlayer* trajectoryPlayer; // Engine playing back a recorded trajectory file instead of simulating, or null
+	GLMotif::PopupWindow* playbackDialog; // Dialog controlling trajectory playback, or null
+	GLMotif::Slider* playbackSliders[2]; // Sliders setting the playback time and speed
+	GLMotif::TextField* playbackFields[2]; // Text fields showing the playback time and speed
+	SimulationSettings settings; // Simulation settings as edited by the foreground thread
+	Threads::TripleBuffer<SimulationSettings> settingsExchange; // Settings handed from the foreground thread to the simulation thread
+	SimulationSettings appliedSettings; // Settings in effect on the simulation thread
+	const char* settingsFileName; // Name of the file from which settings are loaded at startup, and into which the settings dialog saves them
+	float maxLifespan; // Longest lifespan the settings dialog can select, and the range of compact vertex ages
+	GLMotif::PopupWindow* settingsDialog; // Dialog changing the simulation settings while the simulation runs, or null
+	GLMotif::Slider* settingsSliders[NUM_GENERAL_SETTINGS+AttractorSystems::maxNumParameters]; // Sliders setting the general settings and the system parameters
+	GLMotif::TextField* settingsFields[NUM_GENERAL_SETTINGS+AttractorSystems::maxNumParameters]; // Text fields showing the general settings and the system parameters
+	ClusterParticleSync* clusterSync; // Distributor of the head node's particle states to all render nodes of a cluster, or null
+	bool clusterMirror; // Flag whether this render node shows the head node's particle states instead of simulating
 	
 	class SeedParticlesTool:public Vrui::Tool,public Vrui::Application::Tool<StrangeAttractors>// The custom tool class, derived from application tool class
 		{
@@ -63,6 +283,7 @@ class StrangeAttractors:public Vrui::Application
 		/* Elements: */
 		private:
 		static SeedParticlesToolFactory* factory; // Pointer to the factory object for this class
+		std::vector<SeedQueue::Seed> spray; // Batch of seeds sprayed in the current frame
 		
 		/* Constructors and destructors: */
 		public:
@@ -75,9 +296,57 @@ class StrangeAttractors:public Vrui::Application
 		virtual void frame(void);
 		};
 	
+	class EmitParticlesTool:public Vrui::Tool,public Vrui::Application::Tool<StrangeAttractors> // Tool emitting particles at a fixed rate from a volume attached to its input device
+		{
+		friend class Vrui::GenericToolFactory<EmitParticlesTool>;
+		
+		/* Elements: */
+		private:
+		static EmitParticlesToolFactory* factory; // Pointer to the factory object for this class
+		SeedEmitter emitter; // Emitter releasing seeds at the configured rate and shape
+		std::vector<SeedQueue::Seed> seeds; // Batch of seeds emitted in the current frame
+		
+		/* Constructors and destructors: */
+		public:
+		static void initClass(void); // Initializes the custom tool's factory class
+		EmitParticlesTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment);
+		
+		/* Methods: */
+		virtual const Vrui::ToolFactory* getFactory(void) const;
+		virtual void buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData);
+		virtual void frame(void);
+		};
+	
 	/* Private methods: */
-	void updateMesh(ParticleTimeList& thisParticleTimeList); // Recalculates all ParticleTimeList
+	void getTileOffset(size_t tile,float offset[3]) const; // Returns the translation at which the shown ensemble of the given index is drawn side by side
+	void addEnsembleSeeds(const SeedQueue::Seed* seeds,size_t numSeeds,double now); // Adds seeds to all shown ensembles if they are overlaid, or to the ensemble drawn where each seed lies
+	void advanceParticles(bool savePrevious); // Advances all particles by one step, retiring expired and adding newly seeded particles; saves positions for interpolation first if flag is true
+	float exportQuantizedVertices(QuantizedVertex* vertices,unsigned int* cellCounts); // Writes the compact render copy of all particles, sorted by culling grid cell if cell counts are given; returns the time against which their ages are measured
+	void publishIncremental(ParticleState& thisState); // Writes the positions of all particles, and the attributes of only those slots that changed since the newest render copy acknowledged by the foreground thread, into the given state
+	void updateMesh(ParticleState& thisState,unsigned int numSteps); // Advances all particles by the given number of steps and writes their render copy into the given state
 	void* strangeAttractorsThreadMethod(void); // Thread method for the background StrangeAttractors thread
+	void* clusterMirrorThreadMethod(void); // Thread method for the background thread on render nodes, receiving the head node's particle states instead of simulating
+	GLMotif::PopupWindow* createStatisticsDialog(void); // Creates the performance statistics dialog
+	double takeProfilerSnapshot(void); // Condenses the profiler's measurements twice per second; returns the length of the condensed interval, or zero if it is too early for a new snapshot
+	void updateStatisticsDialog(bool newSnapshot); // Shows the number of visible particles, and the most recent profiler snapshot if flag is true, in the statistics dialog
+	void updateBudget(double snapshotInterval); // Adapts the particle budget to the load measured during the most recent profiler snapshot of the given length
+	GLMotif::PopupWindow* createPlaybackDialog(void); // Creates the trajectory playback dialog
+	void playbackTimeCallback(GLMotif::Slider::ValueChangedCallbackData* cbData); // Jumps to the recorded time selected in the playback dialog
+	void playbackSpeedCallback(GLMotif::Slider::ValueChangedCallbackData* cbData); // Sets the playback speed selected in the playback dialog
+	GLMotif::PopupWindow* createSettingsDialog(void); // Creates the simulation settings dialog
+	void settingsSliderCallback(GLMotif::Slider::ValueChangedCallbackData* cbData); // Changes the setting selected by a slider in the settings dialog
+	void saveSettingsCallback(Misc::CallbackData* cbData); // Writes the current settings to the settings file
+	void postSettings(void); // Hands the current settings to the simulation thread
+	void applySettings(const SimulationSettings& newSettings); // Applies the given settings between two steps on the simulation thread
+	static void enableQuantizedVertexArrays(const GLvoid* base); // Points the particle program's attributes to compact vertices starting at the given offset into the bound buffer, and enables them
+	void enableVertexArrays(const GLvoid* base) const; // Points the vertex arrays to compact or interleaved vertices starting at the given offset into the bound buffer, and enables them
+	void disableVertexArrays(void) const; // Disables the vertex arrays enabled by enableVertexArrays
+	bool streamsVertices(void) const; // Returns true if the background thread writes vertices into the streaming buffer, and false if there is none or no context could map it
+	static void enableSplitVertexArrays(const DataItem* dataItem); // Points the vertex arrays to the given context's attribute and motion buffers in incremental mode, and enables them
+	void bindVertexBuffer(DataItem* dataItem) const; // Uploads the locked render copy into the context's vertex buffer if the buffer holds an older state, and binds the buffer's vertex arrays
+	void unbindVertexBuffer(DataItem* dataItem) const; // Unbinds the vertex arrays bound by bindVertexBuffer
+	void drawCells(DataItem* dataItem,size_t numVertices) const; // Draws the given number of vertices from the current vertex arrays, skipping grid cells outside the view frustum and thinning out distant cells if vertices are binned
+	void drawDensity(DataItem* dataItem) const; // Uploads the locked density histogram if it changed and draws it as a stack of additively blended slices
 	/* Constructors and destructors: */
 	public:
 	StrangeAttractors(int& argc,char**& argv);
@@ -87,88 +356,315 @@ class StrangeAttractors:public Vrui::Application
 	virtual void frame(void);
 	virtual void display(GLContextData& contextData) const;
 	virtual void resetNavigation(void);
+	
+	/* Methods from GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+	};
+
+/******************************************
+Static elements of class StrangeAttractors:
+******************************************/
+
+const char* const StrangeAttractors::zoneNames[StrangeAttractors::NUM_ZONES]=
+	{
+	"Simulation step","Vertex export","Mesh update","Buffer hand-off","Vertex upload","Draw","GPU draw"
 	};
 
 /**********************************
 Methods of class StrangeAttractors:
 **********************************/
 
-void StrangeAttractors::updateMesh(StrangeAttractors::ParticleTimeList& thisParticleTimeList)
+void StrangeAttractors::getTileOffset(size_t tile,float offset[3]) const
+	{
+	offset[0]=float(tile%numEnsembleColumns)*ensembleSpacing;
+	offset[1]=-float(tile/numEnsembleColumns)*ensembleSpacing;
+	offset[2]=0.0f;
+	}
+
+void StrangeAttractors::addEnsembleSeeds(const SeedQueue::Seed* seeds,size_t numSeeds,double now)
 	{
-	/* Update the [x,y,z] coordinate of all Particles: */
-	thisParticleTimeList.particleList.clear();
-	thisParticleTimeList.timeList.clear();
-	float s = 10;
-	float r = 28;
-	float b = 2.667;
+	if(overlayEnsembles)
+		{
+		/* Seed every shown ensemble at the same positions: */
+		for(std::vector<unsigned int>::iterator seIt=shownEnsembles.begin();seIt!=shownEnsembles.end();++seIt)
+			ensembleSimulator->addParticles(*seIt,seeds,numSeeds,now,now+timeDecay);
+		return;
+		}
+	
+	/* Seed the ensemble drawn in the tile containing each seed, at the seed's position relative to the tile: */
+	const float* center=AttractorSystems::getSystemInfo(stepParameters.system).densityCenter;
+	size_t numRows=(shownEnsembles.size()+numEnsembleColumns-1)/numEnsembleColumns;
+	for(size_t i=0;i<numSeeds;++i)
+		{
+		int column=int(Math::floor((seeds[i].position[0]-center[0])/ensembleSpacing+0.5f));
+		int row=int(Math::floor((center[1]-seeds[i].position[1])/ensembleSpacing+0.5f));
+		if(column<0||column>=int(numEnsembleColumns)||row<0||row>=int(numRows))
+			continue;
+		size_t tile=size_t(row)*numEnsembleColumns+size_t(column);
+		if(tile>=shownEnsembles.size())
+			continue;
+		
+		SeedQueue::Seed seed=seeds[i];
+		float offset[3];
+		getTileOffset(tile,offset);
+		for(int j=0;j<3;++j)
+			seed.position[j]-=offset[j];
+		ensembleSimulator->addParticles(shownEnsembles[tile],&seed,1,now,now+timeDecay);
+		}
+	}
 
-	TimeList::const_iterator oldTimeListIt = oldTimeList->begin();
-	ParticleList::const_iterator oldParticleListIt = oldParticleList->begin();
-	for(;oldParticleListIt!=oldParticleList->end();++oldParticleListIt,++oldTimeListIt)
+void StrangeAttractors::advanceParticles(bool savePrevious)
+	{
+	Profiler::Scope scope(profiler,ZONE_STEP);
+	
+	/* Advance all particles in parallel and retire those whose lifespan has run out: */
+	double now=Vrui::getApplicationTime();
+	lastStepTime=now;
+	if(ensembleSimulator!=0)
+		ensembleSimulator->step(now,savePrevious);
+	else
+		simulator->step(now,savePrevious);
+	
+	/* Add all newly seeded particles in bulk, reusing free slots first; seeds beyond the pool's capacity are dropped: */
+	if(ensembleSimulator!=0)
 		{
-		float tp = *oldTimeListIt;
-		if (tp>Vrui::getApplicationTime())
+		const SeedQueue::Seed* seeds;
+		size_t numSeeds;
+		while((numSeeds=seedQueue.beginDrain(seeds))>0)
 			{
-			/* initial x,y,z coordinates */
-			ParticleVertex pv = *oldParticleListIt;
-			//std::cout<< pv.position[1] << std::endl;
-			float x = pv.position[0];
-			float y = pv.position[1];
-			float z = pv.position[2];
-			
-			/* change at each time step for the Lorenz attractor system: */
-			ParticleVertex::Position::Vector dot;
-			dot[0]=s*(y-x);
-			dot[1]=x*(r-z)-y;
-			dot[2]=(x*y)-(b*z);
-			float t = 0.003;
+			addEnsembleSeeds(seeds,numSeeds,now);
+			seedQueue.endDrain(numSeeds);
+			profiler.count(COUNTER_SEEDS,numSeeds);
+			}
+		}
+	else
+		{
+		/* Admit seeds only up to the particle budget: */
+		size_t budget=particleBudget.load(std::memory_order_relaxed);
+		if(budget>appliedSettings.maxNumParticles)
+			budget=appliedSettings.maxNumParticles;
+		double expiryTime=now+appliedSettings.lifespan*lifespanScale.load(std::memory_order_relaxed);
+		profiler.count(COUNTER_SEEDS,simulator->addParticles(seedQueue,budget,float(now),float(expiryTime)));
+		}
+	
+	/* Close the remaining free slots by moving particles from the end: */
+	if(ensembleSimulator!=0)
+		ensembleSimulator->compact();
+	else
+		simulator->compact();
+	}
+
+float StrangeAttractors::exportQuantizedVertices(QuantizedVertex* vertices,unsigned int* cellCounts)
+	{
+	/* Measure ages against the most recent step, so that they stay small: */
+	VertexQuantizer quantizer=vertexQuantizer;
+	quantizer.setVertexTime(float(lastStepTime));
+	if(cellCounts!=0)
+		simulator->exportVertices(vertices,cellCounts,quantizer);
+	else
+		simulator->exportVertices(vertices,quantizer);
+	return quantizer.getVertexTime();
+	}
+
+void StrangeAttractors::publishIncremental(StrangeAttractors::ParticleState& thisState)
+	{
+	/* Positions change with every step, and are always written in full: */
+	const ParticleStore& particles=simulator->getParticles();
+	thisState.motionVertices.resize(particles.getNumParticles());
+	simulator->exportMotionVertices(thisState.motionVertices.data());
+	
+	/* Find the slots that changed since the newest state whose attributes the foreground thread already applied: */
+	thisState.sequence=slotChanges->update(particles);
+	thisState.baseSequence=acknowledgedSequence.load(std::memory_order_acquire);
+	size_t numChanged=slotChanges->findChangedRanges(thisState.baseSequence,thisState.attributeRanges);
+	
+	/* Gather the changed slots' attributes one range after another: */
+	thisState.attributeVertices.resize(numChanged);
+	AttributeVertex* avPtr=thisState.attributeVertices.data();
+	for(std::vector<SlotChangeTracker::Range>::const_iterator rIt=thisState.attributeRanges.begin();rIt!=thisState.attributeRanges.end();++rIt)
+		{
+		particles.gatherAttributeVertices(avPtr,rIt->first,rIt->first+rIt->count);
+		avPtr+=rIt->count;
+		}
+	}
+
+void StrangeAttractors::updateMesh(StrangeAttractors::ParticleState& thisState,unsigned int numSteps)
+	{
+	Profiler::Scope scope(profiler,ZONE_UPDATE_MESH);
+	
+	/* Only the last step's starting positions are needed for interpolation: */
+	for(unsigned int step=0;step<numSteps;++step)
+		advanceParticles(step+1==numSteps);
+	thisState.numParticles=ensembleSimulator!=0?ensembleSimulator->getNumParticles():simulator->getParticles().getNumParticles();
+	{
+	Profiler::Scope exportScope(profiler,ZONE_EXPORT);
+	if(ensembleSimulator!=0)
+		{
+		/* Write all ensembles one after another: */
+		thisState.vertices.resize(thisState.numParticles);
+		ensembleSimulator->exportVertices(thisState.vertices.data(),thisState.ensembleFirsts.data());
+		}
+	else if(simulator->getDensity()!=0)
+		{
+		/* Merge the positions accumulated during these steps into the density histogram: */
+		simulator->exportDensity(thisState.densityVoxels.data());
+		}
+	else if(compactVertices)
+		{
+		thisState.quantizedVertices.resize(thisState.numParticles);
+		thisState.vertexTime=exportQuantizedVertices(thisState.quantizedVertices.data(),simulator->getGrid()!=0?thisState.cellCounts.data():0);
+		}
+	else if(slotChanges!=0)
+		publishIncremental(thisState);
+	else if(simulator->getGrid()!=0)
+		{
+		/* Sort the vertices by culling grid cell: */
+		thisState.vertices.resize(thisState.numParticles);
+		simulator->exportVertices(thisState.vertices.data(),thisState.cellCounts.data());
+		}
+	else
+		{
+		thisState.vertices.resize(thisState.numParticles);
+		simulator->exportVertices(thisState.vertices.data());
+		}
+	if(trails!=0)
+		{
+		/* Write the newest trail history layer in slot order, independent of any binning: */
+		thisState.trailVertices.resize(thisState.numParticles);
+		simulator->exportTrailVertices(thisState.trailVertices.data());
+		}
+	}
+	thisState.stateTime=simulationClock.getStepTime();
+	}
+
+void* StrangeAttractors::strangeAttractorsThreadMethod(void)
+	{
+	while(keepRunning)
+		{
+		/* Sleep until the next simulation step is due: */
+		double now=SimulationClock::getWallTime();
+		double wait=simulationClock.getNextStepTime()-now;
+		if(wait>0.0)
+			{
+			usleep(useconds_t(wait*1.0e6));
+			now=SimulationClock::getWallTime();
+			}
+		
+		/* Take all steps that have become due, up to the catch-up limit: */
+		unsigned int numSteps=simulationClock.update(now);
+		if(numSteps==0)
+			continue;
+		
+		/* Pick up settings changed since the last step: */
+		if(settingsExchange.lockNewValue())
+			applySettings(settingsExchange.getLockedValue());
+		
+		/* Wait for a region of the streaming buffer that the GPU is no longer reading: */
+		void* region=0;
+		if(streamingBuffer!=0)
+			{
+			{
+			Profiler::Scope scope(profiler,ZONE_HANDOFF);
+			region=streamingBuffer->startRegion();
+			}
 			
-			/* updated color */
-			if (pv.color[1]>0)
-				{
-				pv.color[1] -= .1;
-				}
-			else if(pv.color[0]>0)
-				{
-				pv.color[0] -= .1;
-				}
+			/* Shut down, or hand vertices through the triple buffer if no context could map the streaming buffer: */
+			if(region==0&&!streamingBuffer->isUnavailable())
+				break;
+			}
+		
+		if(region!=0)
+			{
+			/* Write the new mesh vertices straight into GPU-visible memory and post them to the foreground thread: */
+			for(unsigned int step=0;step<numSteps;++step)
+				advanceParticles(step+1==numSteps);
+			size_t numParticles=simulator->getParticles().getNumParticles();
+			int writeRegion=streamingBuffer->getWriteRegion();
+			{
+			Profiler::Scope scope(profiler,ZONE_EXPORT);
+			if(compactVertices)
+				regionVertexTimes[writeRegion]=exportQuantizedVertices(static_cast<QuantizedVertex*>(region),simulator->getGrid()!=0?regionCellCounts[writeRegion].data():0);
+			else if(simulator->getGrid()!=0)
+				simulator->exportVertices(static_cast<ParticleVertex*>(region),regionCellCounts[writeRegion].data());
 			else
+				simulator->exportVertices(static_cast<ParticleVertex*>(region));
+			}
+			profiler.count(COUNTER_UPLOAD_BYTES,numParticles*(compactVertices?sizeof(QuantizedVertex):sizeof(ParticleVertex)));
+			Profiler::Scope scope(profiler,ZONE_HANDOFF);
+			streamingBuffer->postRegion(numParticles,simulationClock.getStepTime());
+			}
+		else
+			{
+			/* Start a new value in the mesh triple buffer: */
+			ParticleState* thisState;
+			{
+			Profiler::Scope scope(profiler,ZONE_HANDOFF);
+			thisState=&particleStates.startNewValue();
+			}
+			
+			/* Recalculate the mesh vertices in the new triple buffer slot: */
+			updateMesh(*thisState,numSteps);
+			
+			/* Push the new triple buffer slot to the foreground thread: */
+			{
+			Profiler::Scope scope(profiler,ZONE_HANDOFF);
+			particleStates.postNewValue();
+			}
+			
+			/* Broadcast the new state to the render nodes of a cluster: */
+			if(clusterSync!=0)
 				{
-				pv.color[2] -= .1;
+				if(simulator->getDensity()!=0)
+					clusterSync->sendDensity(thisState->numParticles,thisState->densityVoxels.data(),thisState->densityVoxels.size());
+				else
+					clusterSync->sendParticles(simulator->getParticles(),numSteps==1);
 				}
-			
-			/* updated positions: */
-			pv.position+= dot*t;
+			}
 		
-			thisParticleTimeList.particleList.push_back (pv);
-			thisParticleTimeList.timeList.push_back (tp);
+		/* Hand a copy of the posted particle state to the trajectory recorder's I/O thread; frames are dropped if it falls behind: */
+		if(recorder!=0&&++numUnrecordedPosts>=recordInterval)
+			{
+			recorder->record(lastStepTime,simulator->getParticles());
+			numUnrecordedPosts=0;
 			}
+		
+		/* Save a periodic checkpoint, so that a crash loses at most one interval: */
+		if(checkpointFileName!=0&&checkpointInterval>0.0&&lastStepTime>=nextCheckpointTime)
+			{
+			if(!ParticleSnapshot::save(checkpointFileName,simulator->getParticles(),simulator->getStepParameters(),lastStepTime))
+				std::cerr<<"StrangeAttractors: Unable to write checkpoint file "<<checkpointFileName<<std::endl;
+			nextCheckpointTime=lastStepTime+checkpointInterval;
+			}
+		
+		/* Wake up the foreground thread by requesting a Vrui frame immediately: */
+		Vrui::requestUpdate();
 		}
-	while(!inputParticles.empty())
-		{
-		thisParticleTimeList.particleList.push_back(inputParticles.read());
-		thisParticleTimeList.timeList.push_back(Vrui::getApplicationTime()+timeDecay);
-		}
-	//work from step for new iteration
-	oldParticleList = &thisParticleTimeList.particleList;
-	oldTimeList = &thisParticleTimeList.timeList;
+	return 0;
 	}
 
-void* StrangeAttractors::strangeAttractorsThreadMethod(void)
+void* StrangeAttractors::clusterMirrorThreadMethod(void)
 	{
 	while(true)
 		{
-		/* Sleep for approx. 1/60th of a second: */
-		usleep(1000000/60);
+		/* Wait for the head node's next message: */
+		ClusterParticleSync::MessageType message=clusterSync->receive();
+		if(message==ClusterParticleSync::SHUTDOWN)
+			break;
 		
-		/* Start a new value in the mesh triple buffer: */
-		ParticleTimeList& thisParticleTimeList = particleVertices.startNewValue();
+		/* Write the received particle state into a new triple buffer slot: */
+		ParticleState& thisState=particleStates.startNewValue();
+		thisState.numParticles=clusterSync->getNumParticles();
+		if(message==ClusterParticleSync::DENSITY)
+			clusterSync->exportDensity(thisState.densityVoxels.data(),thisState.densityVoxels.size());
+		else
+			{
+			thisState.vertices.resize(thisState.numParticles);
+			clusterSync->exportVertices(thisState.vertices.data());
+			}
 		
-		/* Recalculate the mesh vertices in the new triple buffer slot: */
-		updateMesh(thisParticleTimeList);
-
-		/* Push the new triple buffer slot to the foreground thread: */
-		particleVertices.postNewValue();
+		/* Interpolate from the time the state arrived, as the nodes' wall clocks are not synchronized: */
+		thisState.stateTime=SimulationClock::getWallTime();
+		particleStates.postNewValue();
 		
 		/* Wake up the foreground thread by requesting a Vrui frame immediately: */
 		Vrui::requestUpdate();
@@ -176,148 +672,1926 @@ void* StrangeAttractors::strangeAttractorsThreadMethod(void)
 	return 0;
 	}
 
-StrangeAttractors::StrangeAttractors(int& argc,char**& argv)
-	:Vrui::Application(argc,argv),
-	initParticleSize(100), 
-	inputParticles(100),
-	timeDecay(10)
+GLMotif::PopupWindow* StrangeAttractors::createStatisticsDialog(void)
 	{
-	SeedParticlesTool::initClass();
+	static const char* labels[NUM_STATISTICS]=
+		{
+		"Particles","Seeds/s","Step (ms)","Export (ms)","Upload (MB/s)","Draw (ms)","GPU (ms)"
+		};
 	
-	ParticleTimeList& thisParticleTimeList = particleVertices.startNewValue();
-	for(int i = 0; i< initParticleSize ;++i)
+	GLMotif::PopupWindow* dialog=new GLMotif::PopupWindow("StatisticsDialog",Vrui::getWidgetManager(),"Performance Statistics");
+	dialog->setResizableFlags(false,false);
+	
+	GLMotif::RowColumn* statistics=new GLMotif::RowColumn("Statistics",dialog,false);
+	statistics->setOrientation(GLMotif::RowColumn::VERTICAL);
+	statistics->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	statistics->setNumMinorWidgets(2);
+	
+	for(int i=0;i<NUM_STATISTICS;++i)
 		{
-		/* Initialize the random position of Particles: */
-		ParticleVertex pv;
-		
-		pv.position[0]=Math::randUniformCO(-20.0f,20.0f);
-		pv.position[1]=Math::randUniformCO(-20.0f,20.0f);
-		pv.position[2]=Math::randUniformCO(-20.0f,20.0f);
-		
-		/* Initialize the random color of Particles: */
-		pv.color[0]=Math::randUniformCO(64,256);
-		pv.color[1]=Math::randUniformCO(64,256);
-		pv.color[2]=Math::randUniformCO(64,256);
-		pv.color[3]=255;
-		
-		thisParticleTimeList.particleList.push_back(pv);
-		
-		/* Initialize the time of Particles: */
-		thisParticleTimeList.timeList.push_back(Vrui::getApplicationTime()+timeDecay);
+		new GLMotif::Label(labels[i],statistics,labels[i]);
+		statisticsFields[i]=new GLMotif::TextField(labels[i],statistics,10);
+		statisticsFields[i]->setFieldWidth(10);
+		statisticsFields[i]->setPrecision(i<=STAT_SEEDS?0:2);
+		statisticsFields[i]->setFloatFormat(GLMotif::TextField::FIXED);
 		}
-	oldParticleList = &thisParticleTimeList.particleList;
-	oldTimeList = &thisParticleTimeList.timeList;
 	
-	/* Calculate the first full mesh state in a new triple buffer slot: */
-	particleVertices.postNewValue();
+	statistics->manageChild();
 	
-	/* Start the background StrangeAttractors thread: */
-	strangeAttractorsThread.start(this,&StrangeAttractors::strangeAttractorsThreadMethod);
+	return dialog;
 	}
 
-StrangeAttractors::~StrangeAttractors(void)
+double StrangeAttractors::takeProfilerSnapshot(void)
 	{
-	/* Shut down the background StrangeAttractors thread: */
-	strangeAttractorsThread.cancel();
-	strangeAttractorsThread.join();
+	/* Condense the profiler's measurements twice per second to keep the values readable and the budget stable: */
+	double now=SimulationClock::getWallTime();
+	double interval=profiler.getSnapshotInterval(now);
+	if(interval<0.5)
+		return 0.0;
+	profiler.takeSnapshot(now);
+	return interval;
 	}
 
-void StrangeAttractors::frame(void)
+void StrangeAttractors::updateStatisticsDialog(bool newSnapshot)
+	{
+	statisticsFields[STAT_PARTICLES]->setValue(double(numVisibleParticles));
+	if(!newSnapshot)
+		return;
+	
+	statisticsFields[STAT_SEEDS]->setValue(profiler.getCounterRate(COUNTER_SEEDS));
+	statisticsFields[STAT_STEP]->setValue(profiler.getZoneAverage(ZONE_STEP)*1.0e3);
+	statisticsFields[STAT_EXPORT]->setValue(profiler.getZoneAverage(ZONE_EXPORT)*1.0e3);
+	statisticsFields[STAT_UPLOAD]->setValue(profiler.getCounterRate(COUNTER_UPLOAD_BYTES)*1.0e-6);
+	statisticsFields[STAT_DRAW]->setValue(profiler.getZoneAverage(ZONE_DRAW)*1.0e3);
+	statisticsFields[STAT_GPU_DRAW]->setValue(profiler.getZoneAverage(ZONE_GPU_DRAW)*1.0e3);
+	}
+
+void StrangeAttractors::updateBudget(double snapshotInterval)
 	{
-	/* Check if there is a new entry in the triple buffer and lock it: */
-	if(particleVertices.lockNewValue())
+	/* Measure the fraction of time the simulation thread was busy, and the GPU time per frame spent drawing particles in all eyes and windows: */
+	double simulationBusy=profiler.getZoneAverage(ZONE_STEP)*profiler.getZoneRate(ZONE_STEP)+profiler.getZoneAverage(ZONE_EXPORT)*profiler.getZoneRate(ZONE_EXPORT);
+	double drawTime=0.0;
+	if(numBudgetFrames>0)
+		drawTime=profiler.getZoneAverage(ZONE_GPU_DRAW)*profiler.getZoneRate(ZONE_GPU_DRAW)*snapshotInterval/double(numBudgetFrames);
+	numBudgetFrames=0;
+	
+	/* Hand a changed budget to the simulation thread and the renderer: */
+	if(budgetController->update(simulationBusy,drawTime))
 		{
-		const ParticleTimeList& thisParticleList=particleVertices.getLockedValue();
-				
-		/* Point the vertex buffer to the new mesh vertices: */
-		vertexBuffer.setSource(thisParticleList.particleList.size(),thisParticleList.particleList.data());
+		BudgetController::Budget budget=budgetController->getBudget();
+		particleBudget.store(budget.maxNumParticles,std::memory_order_relaxed);
+		lifespanScale.store(budget.lifespan,std::memory_order_relaxed);
+		drawFraction=budget.drawFraction;
 		}
 	}
 
-void StrangeAttractors::display(GLContextData& contextData) const
+GLMotif::PopupWindow* StrangeAttractors::createPlaybackDialog(void)
 	{
-	/* Save OpenGL state: */
-	glPushAttrib(GL_ENABLE_BIT|GL_POINT_BIT);
+	static const char* labels[2]=
+		{
+		"Time","Speed"
+		};
 	
-	glDisable(GL_LIGHTING);
-	glPointSize(3.0f);
+	GLMotif::PopupWindow* dialog=new GLMotif::PopupWindow("PlaybackDialog",Vrui::getWidgetManager(),"Trajectory Playback");
+	dialog->setResizableFlags(true,false);
 	
-	/* Bind the vertex buffer (which automatically uploads any new vertex data): */
-	VertexBuffer::DataItem* vbdi=vertexBuffer.bind(contextData);
-		
-	vertexBuffer.draw(GL_POINTS, vbdi);
+	GLMotif::RowColumn* playback=new GLMotif::RowColumn("Playback",dialog,false);
+	playback->setOrientation(GLMotif::RowColumn::VERTICAL);
+	playback->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	playback->setNumMinorWidgets(3);
+	
+	for(int i=0;i<2;++i)
+		{
+		new GLMotif::Label(labels[i],playback,labels[i]);
+		playbackSliders[i]=new GLMotif::Slider(labels[i],playback,GLMotif::Slider::HORIZONTAL,Vrui::getUiStyleSheet()->fontHeight*20.0f);
+		playbackFields[i]=new GLMotif::TextField(labels[i],playback,8);
+		playbackFields[i]->setFieldWidth(8);
+		playbackFields[i]->setPrecision(2);
+		playbackFields[i]->setFloatFormat(GLMotif::TextField::FIXED);
+		}
 	
-	/* Unbind the buffers: */
-	vertexBuffer.unbind();
+	/* Scrub through the whole recording, and play at up to four times the recorded speed in either direction: */
+	const TrajectoryReader& reader=trajectoryPlayer->getReader();
+	playbackSliders[0]->setValueRange(reader.getStartTime(),reader.getEndTime(),0.0);
+	playbackSliders[0]->setValue(trajectoryPlayer->getPlaybackTime());
+	playbackSliders[0]->getValueChangedCallbacks().add(this,&StrangeAttractors::playbackTimeCallback);
+	playbackFields[0]->setValue(trajectoryPlayer->getPlaybackTime());
+	playbackSliders[1]->setValueRange(-4.0,4.0,0.25);
+	playbackSliders[1]->setValue(trajectoryPlayer->getSpeed());
+	playbackSliders[1]->getValueChangedCallbacks().add(this,&StrangeAttractors::playbackSpeedCallback);
+	playbackFields[1]->setValue(trajectoryPlayer->getSpeed());
 	
-	/* Restore OpenGL state: */
-	glPopAttrib();
+	playback->manageChild();
+	
+	return dialog;
 	}
 
-void StrangeAttractors::resetNavigation(void)
+void StrangeAttractors::playbackTimeCallback(GLMotif::Slider::ValueChangedCallbackData* cbData)
 	{
-	/* Center and scale the object: */
-	Vrui::setNavigationTransformation(Vrui::Point::origin,150.0);
+	trajectoryPlayer->setPlaybackTime(cbData->value);
+	playbackFields[0]->setValue(cbData->value);
 	}
 
-/********************************************************************
-Static elements of class StrangeAttractors::SeedParticlesToolFactory:
-********************************************************************/
+void StrangeAttractors::playbackSpeedCallback(GLMotif::Slider::ValueChangedCallbackData* cbData)
+	{
+	trajectoryPlayer->setSpeed(cbData->value);
+	playbackFields[1]->setValue(cbData->value);
+	Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
+	}
 
-StrangeAttractors::SeedParticlesToolFactory* StrangeAttractors::SeedParticlesTool::factory=0;
+GLMotif::PopupWindow* StrangeAttractors::createSettingsDialog(void)
+	{
+	static const char* labels[NUM_GENERAL_SETTINGS]=
+		{
+		"Time step","Substeps","Lifespan (s)","Max particles"
+		};
+	
+	GLMotif::PopupWindow* dialog=new GLMotif::PopupWindow("SettingsDialog",Vrui::getWidgetManager(),"Simulation Settings");
+	dialog->setResizableFlags(true,false);
+	
+	GLMotif::RowColumn* root=new GLMotif::RowColumn("Root",dialog,false);
+	root->setOrientation(GLMotif::RowColumn::VERTICAL);
+	root->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	
+	GLMotif::RowColumn* sliders=new GLMotif::RowColumn("Settings",root,false);
+	sliders->setOrientation(GLMotif::RowColumn::VERTICAL);
+	sliders->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	sliders->setNumMinorWidgets(3);
+	
+	/* Create one slider for each general setting, followed by one for each of the system's parameters: */
+	const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+	int numSettings=NUM_GENERAL_SETTINGS+si.numParameters;
+	for(int i=0;i<numSettings;++i)
+		{
+		const char* label=i<NUM_GENERAL_SETTINGS?labels[i]:si.parameterNames[i-NUM_GENERAL_SETTINGS];
+		new GLMotif::Label(label,sliders,label);
+		settingsSliders[i]=new GLMotif::Slider(label,sliders,GLMotif::Slider::HORIZONTAL,Vrui::getUiStyleSheet()->fontHeight*20.0f);
+		settingsFields[i]=new GLMotif::TextField(label,sliders,10);
+		settingsFields[i]->setFieldWidth(10);
+		if(i==SETTING_SUBSTEPS||i==SETTING_MAX_PARTICLES)
+			{
+			settingsFields[i]->setPrecision(0);
+			settingsFields[i]->setFloatFormat(GLMotif::TextField::FIXED);
+			}
+		else
+			{
+			settingsFields[i]->setPrecision(5);
+			settingsFields[i]->setFloatFormat(GLMotif::TextField::SMART);
+			}
+		}
+	
+	/* Tune the time step around its startup value, and system parameters between zero and twice their defaults: */
+	settingsSliders[SETTING_TIME_STEP]->setValueRange(settings.timeStep*0.1,settings.timeStep*4.0,0.0);
+	settingsSliders[SETTING_TIME_STEP]->setValue(settings.timeStep);
+	settingsFields[SETTING_TIME_STEP]->setValue(settings.timeStep);
+	settingsSliders[SETTING_SUBSTEPS]->setValueRange(1.0,16.0,1.0);
+	settingsSliders[SETTING_SUBSTEPS]->setValue(settings.numSubsteps);
+	settingsFields[SETTING_SUBSTEPS]->setValue(settings.numSubsteps);
+	settingsSliders[SETTING_LIFESPAN]->setValueRange(maxLifespan*0.01,maxLifespan,0.0);
+	settingsSliders[SETTING_LIFESPAN]->setValue(settings.lifespan);
+	settingsFields[SETTING_LIFESPAN]->setValue(settings.lifespan);
+	settingsSliders[SETTING_MAX_PARTICLES]->setValueRange(0.0,double(simulator->getParticles().getCapacity()),1.0);
+	settingsSliders[SETTING_MAX_PARTICLES]->setValue(double(settings.maxNumParticles));
+	settingsFields[SETTING_MAX_PARTICLES]->setValue(double(settings.maxNumParticles));
+	for(int i=0;i<si.numParameters;++i)
+		{
+		double d=si.defaultParameters[i];
+		GLMotif::Slider* slider=settingsSliders[NUM_GENERAL_SETTINGS+i];
+		if(d>0.0)
+			slider->setValueRange(0.0,2.0*d,0.0);
+		else if(d<0.0)
+			slider->setValueRange(2.0*d,0.0,0.0);
+		else
+			slider->setValueRange(-1.0,1.0,0.0);
+		slider->setValue(settings.systemParameters[i]);
+		settingsFields[NUM_GENERAL_SETTINGS+i]->setValue(settings.systemParameters[i]);
+		}
+	for(int i=0;i<numSettings;++i)
+		settingsSliders[i]->getValueChangedCallbacks().add(this,&StrangeAttractors::settingsSliderCallback);
+	
+	sliders->manageChild();
+	
+	GLMotif::Button* saveButton=new GLMotif::Button("SaveButton",root,"Save Settings");
+	saveButton->getSelectCallbacks().add(this,&StrangeAttractors::saveSettingsCallback);
+	
+	root->manageChild();
+	
+	return dialog;
+	}
 
-void StrangeAttractors::SeedParticlesTool::initClass(void)
+void StrangeAttractors::settingsSliderCallback(GLMotif::Slider::ValueChangedCallbackData* cbData)
 	{
-	/* Create a factory object for the custom tool class: */
-	factory=new SeedParticlesToolFactory("SeedParticlesTool","Seed Particles",0,*Vrui::getToolManager());
+	/* Find the setting controlled by the slider: */
+	int setting=0;
+	while(settingsSliders[setting]!=cbData->slider)
+		++setting;
 	
-	/* Set the custom tool class' input layout: */
-	factory->setNumButtons(1);
-	factory->setButtonFunction(0,"Seed Particles");
+	switch(setting)
+		{
+		case SETTING_TIME_STEP:
+			settings.timeStep=float(cbData->value);
+			break;
+		
+		case SETTING_SUBSTEPS:
+			settings.numSubsteps=(unsigned int)(cbData->value+0.5);
+			break;
+		
+		case SETTING_LIFESPAN:
+			settings.lifespan=float(cbData->value);
+			break;
+		
+		case SETTING_MAX_PARTICLES:
+			settings.maxNumParticles=size_t(cbData->value+0.5);
+			break;
+		
+		default:
+			settings.systemParameters[setting-NUM_GENERAL_SETTINGS]=float(cbData->value);
+		}
+	settingsFields[setting]->setValue(cbData->value);
 	
-	/* Register the custom tool class with Vrui's tool manager: */
-	Vrui::getToolManager()->addClass(factory,Vrui::ToolManager::defaultToolFactoryDestructor);
+	postSettings();
 	}
 
-StrangeAttractors::SeedParticlesTool::SeedParticlesTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
-	:Vrui::Tool(factory,inputAssignment)
+void StrangeAttractors::saveSettingsCallback(Misc::CallbackData* cbData)
 	{
+	if(!settings.save(stepParameters.system,settingsFileName))
+		std::cerr<<"StrangeAttractors: Unable to write settings file "<<settingsFileName<<std::endl;
 	}
 
-const Vrui::ToolFactory* StrangeAttractors::SeedParticlesTool::getFactory(void) const
+void StrangeAttractors::postSettings(void)
 	{
-	return factory;
+	/* Hand a complete copy to the simulation thread, which picks up the most recent one before its next step: */
+	settingsExchange.startNewValue()=settings;
+	settingsExchange.postNewValue();
 	}
 
-void StrangeAttractors::SeedParticlesTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData)
+void StrangeAttractors::applySettings(const SimulationSettings& newSettings)
 	{
-	if(cbData->newButtonState) // Button has just been pressed
+	appliedSettings=newSettings;
+	ParticleKernels::StepParameters newStepParameters=simulator->getStepParameters();
+	appliedSettings.apply(newStepParameters);
+	simulator->setStepParameters(newStepParameters);
+	}
+
+void StrangeAttractors::enableQuantizedVertexArrays(const GLvoid* base)
+	{
+	/* Read positions with ages and previous positions with lifespans as normalized 16-bit vectors, and colors as normalized bytes: */
+	const char* basePtr=static_cast<const char*>(base);
+	for(GLuint i=0;i<3;++i)
+		glEnableVertexAttribArray(i);
+	glVertexAttribPointer(0,4,GL_UNSIGNED_SHORT,GL_TRUE,sizeof(QuantizedVertex),basePtr+offsetof(QuantizedVertex,position));
+	glVertexAttribPointer(1,4,GL_UNSIGNED_SHORT,GL_TRUE,sizeof(QuantizedVertex),basePtr+offsetof(QuantizedVertex,previousPosition));
+	glVertexAttribPointer(2,4,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(QuantizedVertex),basePtr+offsetof(QuantizedVertex,color));
+	}
+
+void StrangeAttractors::enableVertexArrays(const GLvoid* base) const
+	{
+	if(compactVertices)
+		enableQuantizedVertexArrays(base);
+	else
 		{
-		std::cout<<"MyTool: Button "<<buttonSlotIndex<<" has just been pressed"<<std::endl;
+		GLVertexArrayParts::enable(ParticleVertex::getPartsMask());
+		glVertexPointer(static_cast<const ParticleVertex*>(base));
 		}
-	else // Button has just been released
+	}
+
+void StrangeAttractors::disableVertexArrays(void) const
+	{
+	if(compactVertices)
 		{
-		std::cout<<"MyTool: Button "<<buttonSlotIndex<<" has just been released"<<std::endl;
+		for(GLuint i=0;i<3;++i)
+			glDisableVertexAttribArray(i);
 		}
+	else
+		GLVertexArrayParts::disable(ParticleVertex::getPartsMask());
 	}
-void StrangeAttractors::SeedParticlesTool::frame(void)
+
+void StrangeAttractors::enableSplitVertexArrays(const StrangeAttractors::DataItem* dataItem)
 	{
-		if(getButtonState(0))
-		{
-			ParticleVertex pv;
-			pv.position = Vrui::getNavigationTransformation().inverseTransform(getButtonDevicePosition(0));
+	/* Read birth times, lifespans, and colors from the attribute buffer, and previous and current positions from the vertex buffer: */
+	GLVertexArrayParts::enable(ParticleVertex::getPartsMask());
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->attributeBufferId);
+	glTexCoordPointer(2,GL_FLOAT,sizeof(AttributeVertex),reinterpret_cast<const GLvoid*>(offsetof(AttributeVertex,texCoord)));
+	glColorPointer(4,GL_UNSIGNED_BYTE,sizeof(AttributeVertex),reinterpret_cast<const GLvoid*>(offsetof(AttributeVertex,color)));
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->vertexBufferId);
+	glNormalPointer(GL_FLOAT,sizeof(MotionVertex),reinterpret_cast<const GLvoid*>(offsetof(MotionVertex,normal)));
+	glVertexPointer(3,GL_FLOAT,sizeof(MotionVertex),reinterpret_cast<const GLvoid*>(offsetof(MotionVertex,position)));
+	}
+
+bool StrangeAttractors::streamsVertices(void) const
+	{
+	return streamingBuffer!=0&&!streamingBuffer->isUnavailable();
+	}
+
+void StrangeAttractors::bindVertexBuffer(StrangeAttractors::DataItem* dataItem) const
+	{
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->vertexBufferId);
+	
+	/* Upload the locked render copy once per state, no matter how many eyes and windows draw it: */
+	const ParticleState& lockedState=particleStates.getLockedValue();
+	if(dataItem->vertexStateTime!=lockedState.stateTime)
+		{
+		Profiler::Scope scope(profiler,ZONE_UPLOAD);
+		
+		/* Orphan the buffer's previous contents, so that the upload does not wait for draws still reading them: */
+		if(compactVertices)
+			{
+			dataItem->numBufferVertices=lockedState.quantizedVertices.size();
+			glBufferData(GL_ARRAY_BUFFER,dataItem->numBufferVertices*sizeof(QuantizedVertex),lockedState.quantizedVertices.data(),GL_STREAM_DRAW);
+			}
+		else if(slotChanges!=0)
+			{
+			dataItem->numBufferVertices=lockedState.motionVertices.size();
+			glBufferData(GL_ARRAY_BUFFER,dataItem->numBufferVertices*sizeof(MotionVertex),lockedState.motionVertices.data(),GL_STREAM_DRAW);
+			
+			/* Rewrite only the changed slots' attributes if the attribute buffer holds the base state or a newer one, or all of them otherwise: */
+			glBindBuffer(GL_ARRAY_BUFFER,dataItem->attributeBufferId);
+			if(int(dataItem->attributeSequence-lockedState.baseSequence)>=0)
+				{
+				const AttributeVertex* avPtr=lockedState.attributeVertices.data();
+				for(std::vector<SlotChangeTracker::Range>::const_iterator rIt=lockedState.attributeRanges.begin();rIt!=lockedState.attributeRanges.end();++rIt)
+					{
+					glBufferSubData(GL_ARRAY_BUFFER,GLintptr(rIt->first)*sizeof(AttributeVertex),GLsizeiptr(rIt->count)*sizeof(AttributeVertex),avPtr);
+					avPtr+=rIt->count;
+					}
+				}
+			else if(!attributeMirror.empty())
+				glBufferSubData(GL_ARRAY_BUFFER,0,GLsizeiptr(attributeMirror.size())*sizeof(AttributeVertex),attributeMirror.data());
+			dataItem->attributeSequence=lockedState.sequence;
+			glBindBuffer(GL_ARRAY_BUFFER,dataItem->vertexBufferId);
+			}
+		else
+			{
+			dataItem->numBufferVertices=lockedState.vertices.size();
+			glBufferData(GL_ARRAY_BUFFER,dataItem->numBufferVertices*sizeof(ParticleVertex),lockedState.vertices.data(),GL_STREAM_DRAW);
+			}
+		dataItem->vertexStateTime=lockedState.stateTime;
+		}
+	
+	/* Bind the cached attribute layout, or set it up from scratch if vertex array objects are not supported: */
+	if(dataItem->vertexArrayId!=0)
+		glBindVertexArray(dataItem->vertexArrayId);
+	else if(slotChanges!=0)
+		enableSplitVertexArrays(dataItem);
+	else
+		enableVertexArrays(0);
+	}
+
+void StrangeAttractors::unbindVertexBuffer(StrangeAttractors::DataItem* dataItem) const
+	{
+	if(dataItem->vertexArrayId!=0)
+		glBindVertexArray(0);
+	else
+		disableVertexArrays();
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+	}
+
+void StrangeAttractors::drawCells(StrangeAttractors::DataItem* dataItem,size_t numVertices) const
+	{
+	if(lockedCellCounts==0)
+		{
+		/* Decimate by drawing a leading fraction of all vertices: */
+		GLsizei count=GLsizei(numVertices);
+		if(drawFraction<1.0f)
+			count=GLsizei(Math::ceil(double(numVertices)*double(drawFraction)));
+		glDrawArrays(GL_POINTS,0,count);
+		return;
+		}
+	
+	/* Select the visible cells' vertex ranges for this pass's eye and screen: */
+	GLdouble modelview[16],projection[16];
+	glGetDoublev(GL_MODELVIEW_MATRIX,modelview);
+	glGetDoublev(GL_PROJECTION_MATRIX,projection);
+	size_t numRanges=simulator->getGrid()->selectDrawRanges(modelview,projection,lodDistance,lodMinFraction,drawFraction,lockedCellCounts,dataItem->drawFirsts.data(),dataItem->drawCounts.data());
+	
+	/* Draw all visible cells at once: */
+	if(numRanges>0)
+		glMultiDrawArrays(GL_POINTS,dataItem->drawFirsts.data(),dataItem->drawCounts.data(),GLsizei(numRanges));
+	}
+
+void StrangeAttractors::drawDensity(StrangeAttractors::DataItem* dataItem) const
+	{
+	const DensityHistogram& density=*simulator->getDensity();
+	GLsizei resolution=GLsizei(density.getResolution());
+	glBindTexture(GL_TEXTURE_3D,dataItem->densityTextureId);
+	
+	/* Upload the locked density volume if the texture holds an older one: */
+	const ParticleState& lockedState=particleStates.getLockedValue();
+	if(dataItem->densityStateTime!=lockedState.stateTime)
+		{
+		glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+		glTexSubImage3D(GL_TEXTURE_3D,0,0,0,0,resolution,resolution,resolution,GL_LUMINANCE,GL_UNSIGNED_BYTE,lockedState.densityVoxels.data());
+		dataItem->densityStateTime=lockedState.stateTime;
+		}
+	
+	/* Accumulate the slices' emission without occluding each other, so that their order does not matter: */
+	glEnable(GL_TEXTURE_3D);
+	glTexEnvi(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE,GL_MODULATE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE,GL_ONE);
+	glDepthMask(GL_FALSE);
+	
+	/* Scale each slice's emission such that the volume's brightness does not depend on its resolution: */
+	GLfloat emission=densityGain*4.0f/GLfloat(resolution);
+	glColor4f(emission,emission,emission,1.0f);
+	
+	/* Draw one quad through the center of each layer of voxels: */
+	float domainMin[3],domainMax[3];
+	density.getDomain(domainMin,domainMax);
+	int a0=densitySliceAxis;
+	int a1=(a0+1)%3;
+	int a2=(a0+2)%3;
+	static const float corners[4][2]={{0.0f,0.0f},{1.0f,0.0f},{1.0f,1.0f},{0.0f,1.0f}};
+	glBegin(GL_QUADS);
+	for(GLsizei slice=0;slice<resolution;++slice)
+		{
+		float tc[3],pos[3];
+		tc[a0]=(float(slice)+0.5f)/float(resolution);
+		pos[a0]=domainMin[a0]+(domainMax[a0]-domainMin[a0])*tc[a0];
+		for(int i=0;i<4;++i)
+			{
+			tc[a1]=corners[i][0];
+			tc[a2]=corners[i][1];
+			pos[a1]=domainMin[a1]+(domainMax[a1]-domainMin[a1])*tc[a1];
+			pos[a2]=domainMin[a2]+(domainMax[a2]-domainMin[a2])*tc[a2];
+			glTexCoord3f(tc[0],tc[1],tc[2]);
+			glVertex3f(pos[0],pos[1],pos[2]);
+			}
+		}
+	glEnd();
+	
+	glBindTexture(GL_TEXTURE_3D,0);
+	}
+
+StrangeAttractors::StrangeAttractors(int& argc,char**& argv)
+	:Vrui::Application(argc,argv),
+	initParticleSize(100), 
+	timeDecay(10),
+	maxNumParticles(1U<<20),
+	arena(0),
+	simulator(0),
+	ensembleSimulator(0),
+	overlayEnsembles(false),
+	numEnsembleColumns(1),
+	ensembleSpacing(0.0f),
+	seedQueue(1U<<16),
+	seedsPerFrame(1),
+	emitterShape(SeedEmitter::SPHERE),
+	emitterSize(0.0f),
+	emitterRate(1000.0),
+	budgetController(0),
+	particleBudget(~size_t(0)),
+	lifespanScale(1.0f),
+	drawFraction(1.0f),
+	numBudgetFrames(0),
+	nextSprayStream(0),
+	streamingBuffer(0),
+	compactVertices(false),
+	lockedVertexTime(0.0f),
+	slotChanges(0),
+	acknowledgedSequence(0),
+	trails(0),
+	gpuEngine(0),
+	keepRunning(true),
+	simulationClock(1.0/60.0,4),
+	interpolate(true),
+	lockedStateTime(0.0),
+	interpolationWeight(1.0f),
+	densityGain(1.0f),
+	densitySliceAxis(2),
+	lockedCellCounts(0),
+	lodDistance(0.0f),
+	lodMinFraction(0.1f),
+	recorder(0),
+	recordInterval(1),
+	numUnrecordedPosts(0),
+	lastStepTime(0.0),
+	checkpointFileName(0),
+	checkpointInterval(0.0),
+	nextCheckpointTime(0.0),
+	profiler(NUM_ZONES,zoneNames,NUM_COUNTERS),
+	traceFileName(0),
+	numVisibleParticles(0),
+	statisticsDialog(0),
+	trajectoryPlayer(0),
+	playbackDialog(0),
+	settingsFileName("StrangeAttractors.settings"),
+	maxLifespan(10.0f),
+	settingsDialog(0),
+	clusterSync(0),
+	clusterMirror(false)
+	{
+	/* Parse the command line: */
+	size_t chunkSize=16384;
+	bool useGPU=false;
+	bool streamVertices=false;
+	bool showStatistics=false;
+	bool density=false;
+	unsigned int trailLength=0;
+	bool highAccuracy=false;
+	bool incrementalPublish=false; // Flag whether render copies only carry the attributes of slots that received different particles
+	size_t memoryCap=0; // Hard cap on the memory held by the particle arena in bytes, or 0 for no cap
+	bool hugePages=true; // Flag whether the particle arena is backed by huge pages
+	bool showSettings=false;
+	bool loadSettings=false; // Flag whether settings are loaded from the settings file at startup
+	std::vector<std::pair<const char*,const char*> > settingOverrides; // Names and values of settings given on the command line
+	double adaptiveDrawBudget=0.0; // GPU time per frame in milliseconds within which the adaptive budget holds particle drawing, or 0 to disable it
+	unsigned int densityResolution=128;
+	double densityWarmup=1.0;
+	unsigned int cullGridResolution=16;
+	bool cullGridRequested=false; // Flag whether the culling grid resolution was given on the command line instead of defaulted
+	const char* sweepParameterNames[2]; // Names of the parameters swept along each sweep axis
+	float sweepRanges[2][2]; // Parameter ranges of each sweep axis
+	unsigned int sweepNumValues[2]; // Number of parameter values along each sweep axis
+	int numSweepAxes=0;
+	const char* shownEnsembleList=0; // Comma-separated list of indices of shown ensembles, or null to show all
+	const char* recordFileName=0; // Name of the trajectory file to record into, or null
+	const char* replayFileName=0; // Name of the trajectory file to play back instead of simulating, or null
+	double replaySpeed=1.0;
+	bool replayLoop=false;
+	bool preconverged=false;
+	const char* attractorCacheFileName=0; // Name of the file caching the point cloud used for pre-converged seeding, or null
+	TrajectoryFormat::Compression recordCompression=TrajectoryFormat::RAW;
+	size_t maxNumTraceEvents=1U<<20;
+	double stepRate=60.0;
+	unsigned int maxCatchUpSteps=4;
+	unsigned int numThreads=WorkerPool::getNumCPUs()>1?WorkerPool::getNumCPUs()-1:1; // Leave one CPU to the rendering thread by default
+	float timeStepOverride=0.0f; // Time step requested on the command line; selecting a system resets the time step to its default
+	uint64_t randomSeed=0;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"numThreads")==0&&i+1<argc)
+				{
+				++i;
+				numThreads=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"chunkSize")==0&&i+1<argc)
+				{
+				++i;
+				chunkSize=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"system")==0&&i+1<argc)
+				{
+				++i;
+				AttractorSystems::SystemType system=AttractorSystems::findSystem(argv[i]);
+				if(system!=AttractorSystems::NUM_SYSTEMS)
+					stepParameters.setSystem(system);
+				else
+					std::cerr<<"StrangeAttractors: Unknown ODE system "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"integrator")==0&&i+1<argc)
+				{
+				++i;
+				Integrators::IntegratorType integrator=Integrators::findIntegrator(argv[i]);
+				if(integrator!=Integrators::NUM_INTEGRATORS)
+					stepParameters.integrator=integrator;
+				else
+					std::cerr<<"StrangeAttractors: Unknown integrator "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"timeStep")==0&&i+1<argc)
+				{
+				++i;
+				timeStepOverride=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"maxParticles")==0&&i+1<argc)
+				{
+				++i;
+				maxNumParticles=strtoul(argv[i],0,10);
+				}
+			else if(strcasecmp(argv[i]+1,"gpu")==0)
+				useGPU=true;
+			else if(strcasecmp(argv[i]+1,"streamVertices")==0)
+				streamVertices=true;
+			else if(strcasecmp(argv[i]+1,"compactVertices")==0)
+				compactVertices=true;
+			else if(strcasecmp(argv[i]+1,"incrementalPublish")==0)
+				incrementalPublish=true;
+			else if(strcasecmp(argv[i]+1,"trails")==0&&i+1<argc)
+				{
+				++i;
+				trailLength=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"stepRate")==0&&i+1<argc)
+				{
+				++i;
+				stepRate=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"maxCatchUpSteps")==0&&i+1<argc)
+				{
+				++i;
+				maxCatchUpSteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"substeps")==0&&i+1<argc)
+				{
+				++i;
+				stepParameters.numSubsteps=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"highAccuracy")==0)
+				highAccuracy=true;
+			else if(strcasecmp(argv[i]+1,"memoryCap")==0&&i+1<argc)
+				{
+				++i;
+				memoryCap=size_t(atof(argv[i])*1048576.0+0.5);
+				}
+			else if(strcasecmp(argv[i]+1,"noHugePages")==0)
+				hugePages=false;
+			else if(strcasecmp(argv[i]+1,"settings")==0&&i+1<argc)
+				{
+				++i;
+				settingsFileName=argv[i];
+				loadSettings=true;
+				}
+			else if(strcasecmp(argv[i]+1,"set")==0&&i+2<argc)
+				{
+				settingOverrides.push_back(std::make_pair(argv[i+1],argv[i+2]));
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"settingsDialog")==0)
+				showSettings=true;
+			else if(strcasecmp(argv[i]+1,"noInterpolation")==0)
+				interpolate=false;
+			else if(strcasecmp(argv[i]+1,"seedsPerFrame")==0&&i+1<argc)
+				{
+				++i;
+				seedsPerFrame=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"emitterShape")==0&&i+1<argc)
+				{
+				++i;
+				SeedEmitter::Shape shape=SeedEmitter::findShape(argv[i]);
+				if(shape!=SeedEmitter::NUM_SHAPES)
+					emitterShape=shape;
+				else
+					std::cerr<<"StrangeAttractors: Unknown emitter shape "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"emitterSize")==0&&i+1<argc)
+				{
+				++i;
+				emitterSize=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"emitterRate")==0&&i+1<argc)
+				{
+				++i;
+				emitterRate=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"randomSeed")==0&&i+1<argc)
+				{
+				++i;
+				randomSeed=strtoull(argv[i],0,10);
+				}
+			else if(strcasecmp(argv[i]+1,"adaptiveBudget")==0&&i+1<argc)
+				{
+				++i;
+				adaptiveDrawBudget=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"profile")==0)
+				profiler.setEnabled(true);
+			else if(strcasecmp(argv[i]+1,"statistics")==0)
+				{
+				profiler.setEnabled(true);
+				showStatistics=true;
+				}
+			else if(strcasecmp(argv[i]+1,"trace")==0&&i+1<argc)
+				{
+				++i;
+				profiler.setEnabled(true);
+				traceFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"traceEvents")==0&&i+1<argc)
+				{
+				++i;
+				maxNumTraceEvents=strtoul(argv[i],0,10);
+				}
+			else if(strcasecmp(argv[i]+1,"density")==0)
+				density=true;
+			else if(strcasecmp(argv[i]+1,"densityResolution")==0&&i+1<argc)
+				{
+				++i;
+				densityResolution=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"densityWarmup")==0&&i+1<argc)
+				{
+				++i;
+				densityWarmup=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"densityGain")==0&&i+1<argc)
+				{
+				++i;
+				densityGain=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"cullGrid")==0&&i+1<argc)
+				{
+				++i;
+				cullGridResolution=atoi(argv[i]);
+				cullGridRequested=true;
+				}
+			else if(strcasecmp(argv[i]+1,"lodDistance")==0&&i+1<argc)
+				{
+				++i;
+				lodDistance=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"lodMinFraction")==0&&i+1<argc)
+				{
+				++i;
+				lodMinFraction=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"sweep")==0&&i+4<argc)
+				{
+				if(numSweepAxes<2)
+					{
+					sweepParameterNames[numSweepAxes]=argv[i+1];
+					sweepRanges[numSweepAxes][0]=atof(argv[i+2]);
+					sweepRanges[numSweepAxes][1]=atof(argv[i+3]);
+					sweepNumValues[numSweepAxes]=atoi(argv[i+4]);
+					++numSweepAxes;
+					}
+				else
+					std::cerr<<"StrangeAttractors: Ignoring sweep axis "<<argv[i+1]<<"; at most two axes are supported"<<std::endl;
+				i+=4;
+				}
+			else if(strcasecmp(argv[i]+1,"showEnsembles")==0&&i+1<argc)
+				{
+				++i;
+				shownEnsembleList=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"overlayEnsembles")==0)
+				overlayEnsembles=true;
+			else if(strcasecmp(argv[i]+1,"record")==0&&i+1<argc)
+				{
+				++i;
+				recordFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"recordCompression")==0&&i+1<argc)
+				{
+				++i;
+				if(strcasecmp(argv[i],"raw")==0)
+					recordCompression=TrajectoryFormat::RAW;
+				else if(strcasecmp(argv[i],"quantized")==0)
+					recordCompression=TrajectoryFormat::QUANTIZED;
+				else
+					std::cerr<<"StrangeAttractors: Ignoring unknown trajectory compression "<<argv[i]<<std::endl;
+				}
+			else if(strcasecmp(argv[i]+1,"recordEvery")==0&&i+1<argc)
+				{
+				++i;
+				recordInterval=atoi(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"replay")==0&&i+1<argc)
+				{
+				++i;
+				replayFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"replaySpeed")==0&&i+1<argc)
+				{
+				++i;
+				replaySpeed=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"replayLoop")==0)
+				replayLoop=true;
+			else if(strcasecmp(argv[i]+1,"checkpoint")==0&&i+1<argc)
+				{
+				++i;
+				checkpointFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"checkpointInterval")==0&&i+1<argc)
+				{
+				++i;
+				checkpointInterval=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"preconverged")==0)
+				preconverged=true;
+			else if(strcasecmp(argv[i]+1,"attractorCache")==0&&i+1<argc)
+				{
+				++i;
+				preconverged=true;
+				attractorCacheFileName=argv[i];
+				}
+			}
+		}
+	
+	if(timeStepOverride>0.0f)
+		stepParameters.timeStep=timeStepOverride;
+	random=CounterRandom(randomSeed);
+	if(stepParameters.numSubsteps<1)
+		stepParameters.numSubsteps=1;
+	
+	/* Start from the settings given by the options above, overridden by the settings file and then by individual settings: */
+	settings=SimulationSettings(stepParameters,timeDecay,maxNumParticles);
+	if(loadSettings)
+		{
+		try
+			{
+			settings.load(stepParameters.system,settingsFileName);
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"StrangeAttractors: "<<err.what()<<"; ignoring the rest of the file"<<std::endl;
+			}
+		}
+	for(std::vector<std::pair<const char*,const char*> >::iterator soIt=settingOverrides.begin();soIt!=settingOverrides.end();++soIt)
+		if(!settings.set(stepParameters.system,soIt->first,soIt->second))
+			std::cerr<<"StrangeAttractors: Ignoring invalid setting "<<soIt->first<<' '<<soIt->second<<std::endl;
+	settings.apply(stepParameters);
+	timeDecay=settings.lifespan;
+	maxNumParticles=settings.maxNumParticles;
+	appliedSettings=settings;
+	if(stepRate<=0.0)
+		stepRate=60.0;
+	simulationClock=SimulationClock(1.0/stepRate,maxCatchUpSteps);
+	if(traceFileName!=0)
+		profiler.enableTracing(maxNumTraceEvents);
+	if(numSweepAxes>0&&useGPU)
+		{
+		std::cerr<<"StrangeAttractors: Parameter sweeps are not supported by the GPU engine; ignoring -sweep"<<std::endl;
+		numSweepAxes=0;
+		}
+	if(numSweepAxes>0)
+		{
+		/* Sweeps draw each ensemble from its own range of the triple-buffered vertices; only warn about options that were asked for: */
+		if(density)
+			std::cerr<<"StrangeAttractors: Density mode is not supported by parameter sweeps; ignoring -density"<<std::endl;
+		if(streamVertices)
+			std::cerr<<"StrangeAttractors: Vertex streaming is not supported by parameter sweeps; ignoring -streamVertices"<<std::endl;
+		if(cullGridRequested&&cullGridResolution>0)
+			std::cerr<<"StrangeAttractors: Culling is not supported by parameter sweeps; ignoring -cullGrid"<<std::endl;
+		density=false;
+		streamVertices=false;
+		cullGridResolution=0;
+		}
+	if(recordFileName!=0&&(useGPU||numSweepAxes>0))
+		{
+		std::cerr<<"StrangeAttractors: Trajectory recording is not supported by the GPU engine or parameter sweeps; ignoring -record"<<std::endl;
+		recordFileName=0;
+		}
+	if(recordInterval<1)
+		recordInterval=1;
+	if(density&&useGPU)
+		{
+		std::cerr<<"StrangeAttractors: Density mode is not supported by the GPU engine; ignoring -density"<<std::endl;
+		density=false;
+		}
+	if(density)
+		{
+		/* Density volumes are handed off through the triple buffer and drawn without per-particle interpolation: */
+		streamVertices=false;
+		interpolate=false;
+		if(densityResolution<1)
+			densityResolution=1;
+		}
+	if(compactVertices&&(useGPU||numSweepAxes>0||density||Vrui::getMainPipe()!=0))
+		{
+		std::cerr<<"StrangeAttractors: Compact vertices are not supported by the GPU engine, parameter sweeps, density mode, or clusters; ignoring -compactVertices"<<std::endl;
+		compactVertices=false;
+		}
+	if(incrementalPublish&&(useGPU||numSweepAxes>0||density||compactVertices||streamVertices||replayFileName!=0||Vrui::getMainPipe()!=0))
+		{
+		std::cerr<<"StrangeAttractors: Incremental publishing is not supported by the GPU engine, parameter sweeps, density mode, compact vertices, vertex streaming, playback, or clusters; ignoring -incrementalPublish"<<std::endl;
+		incrementalPublish=false;
+		}
+	if(incrementalPublish)
+		{
+		/* Vertices must stay in slot order for their attributes to stay in place, which rules out binning them for culling: */
+		cullGridResolution=0;
+		}
+	if(showSettings&&(useGPU||numSweepAxes>0||replayFileName!=0))
+		{
+		std::cerr<<"StrangeAttractors: Changing settings at run time is not supported by the GPU engine, parameter sweeps, or playback; ignoring -settingsDialog"<<std::endl;
+		showSettings=false;
+		}
+	
+	/* Let the settings dialog lengthen lifespans up to four times their startup value: */
+	maxLifespan=showSettings?timeDecay*4.0f:timeDecay;
+	if(highAccuracy&&(useGPU||numSweepAxes>0))
+		{
+		std::cerr<<"StrangeAttractors: High-accuracy integration is not supported by the GPU engine or parameter sweeps; ignoring -highAccuracy"<<std::endl;
+		highAccuracy=false;
+		}
+	if(trailLength>0&&(useGPU||numSweepAxes>0||density||streamVertices||replayFileName!=0||Vrui::getMainPipe()!=0))
+		{
+		std::cerr<<"StrangeAttractors: Trails are not supported by the GPU engine, parameter sweeps, density mode, vertex streaming, playback, or clusters; ignoring -trails"<<std::endl;
+		trailLength=0;
+		}
+	if(Vrui::getMainPipe()!=0&&!useGPU&&numSweepAxes==0)
+		{
+		/* Render nodes of a cluster receive the head node's particle states unbinned, through the triple buffer: */
+		if(streamVertices)
+			std::cerr<<"StrangeAttractors: Vertex streaming is not supported on clusters; ignoring -streamVertices"<<std::endl;
+		streamVertices=false;
+		cullGridResolution=0;
+		}
+	
+	SeedParticlesTool::initClass();
+	EmitParticlesTool::initClass();
+	
+	/* Show performance statistics if requested: */
+	if(showStatistics)
+		{
+		statisticsDialog=createStatisticsDialog();
+		Vrui::popupPrimaryWidget(statisticsDialog);
+		}
+	
+	if(replayFileName!=0)
+		{
+		/* Open the recording to play back; fall back to simulating if it cannot be read: */
+		try
+			{
+			trajectoryPlayer=new TrajectoryPlayer(replayFileName,timeDecay,replaySpeed,replayLoop);
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"StrangeAttractors: "<<err.what()<<"; simulating instead"<<std::endl;
+			}
+		}
+	
+	if(trajectoryPlayer!=0)
+		{
+		/* Recorded particles replace the initial seeds and the simulation thread: */
+		initParticleSize=0;
+		if(recordFileName!=0)
+			std::cerr<<"StrangeAttractors: Ignoring -record during playback"<<std::endl;
+		playbackDialog=createPlaybackDialog();
+		Vrui::popupPrimaryWidget(playbackDialog);
+		}
+	else if(useGPU)
+		{
+		/* Create the GPU engine, stepping at the same rate as the background thread: */
+		gpuEngine=new GPUParticleEngine(stepParameters,maxNumParticles,timeDecay,1.0/stepRate,maxCatchUpSteps);
+		gpuEngine->startFrame(Vrui::getApplicationTime());
+		}
+	else if(numSweepAxes>0)
+		{
+		/* Build the table of swept parameter sets: */
+		const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+		EnsembleTable table(stepParameters.system,stepParameters.systemParameters);
+		for(int axis=0;axis<numSweepAxes;++axis)
+			{
+			int parameterIndex;
+			for(parameterIndex=0;parameterIndex<si.numParameters&&strcasecmp(si.parameterNames[parameterIndex],sweepParameterNames[axis])!=0;++parameterIndex)
+				;
+			if(parameterIndex<si.numParameters)
+				table.addAxis(parameterIndex,sweepRanges[axis][0],sweepRanges[axis][1],sweepNumValues[axis]);
+			else
+				std::cerr<<"StrangeAttractors: Ignoring sweep over unknown parameter "<<sweepParameterNames[axis]<<" of the "<<si.name<<" system"<<std::endl;
+			}
+		
+		/* Create the ensemble engine, sharing the particle pool's capacity evenly between all ensembles: */
+		size_t numEnsembles=table.getNumEnsembles();
+		ensembleSimulator=new EnsembleSimulator(stepParameters,table,(maxNumParticles+numEnsembles-1)/numEnsembles,numThreads,chunkSize);
+		for(int i=0;i<3;++i)
+			{
+			particleStates.getBuffer(i).vertices.reserve(maxNumParticles);
+			particleStates.getBuffer(i).ensembleFirsts.resize(numEnsembles+1,0);
+			}
+		
+		/* Select the shown ensembles: */
+		if(shownEnsembleList!=0)
+			{
+			for(const char* sePtr=shownEnsembleList;*sePtr!='\0';)
+				{
+				char* end;
+				unsigned long ensemble=strtoul(sePtr,&end,10);
+				if(end==sePtr)
+					break;
+				if(ensemble<numEnsembles)
+					shownEnsembles.push_back((unsigned int)(ensemble));
+				sePtr=*end==','?end+1:end;
+				}
+			}
+		else
+			{
+			for(size_t ensemble=0;ensemble<numEnsembles;++ensemble)
+				shownEnsembles.push_back((unsigned int)(ensemble));
+			}
+		
+		/* Lay out the shown ensembles in a grid, one row per value of the first sweep axis if all are shown: */
+		if(shownEnsembles.size()==numEnsembles&&table.getNumAxes()>0)
+			numEnsembleColumns=table.getAxis(table.getNumAxes()-1).numValues;
+		else
+			numEnsembleColumns=(unsigned int)(Math::ceil(Math::sqrt(double(shownEnsembles.size()))));
+		if(numEnsembleColumns<1)
+			numEnsembleColumns=1;
+		ensembleSpacing=2.2f*si.densityRadius;
+		}
+	else
+		{
+		if(Vrui::getMainPipe()!=0)
+			{
+			/* Only simulate on the head node, and mirror its particle states on all render nodes: */
+			clusterSync=new ClusterParticleSync(Vrui::openPipe());
+			clusterMirror=!Vrui::isHeadNode();
+			}
+		
+		/* Draw the particle store and the render copies in the triple buffer's slots from one arena: */
+		arena=new ParticleArena(memoryCap,hugePages);
+		for(int i=0;i<3;++i)
+			{
+			ParticleState& state=particleStates.getBuffer(i);
+			state.vertices=ParticleList(ParticleList::allocator_type(arena));
+			state.quantizedVertices=QuantizedVertexList(QuantizedVertexList::allocator_type(arena));
+			state.trailVertices=TrailVertexList(TrailVertexList::allocator_type(arena));
+			state.motionVertices=MotionVertexList(MotionVertexList::allocator_type(arena));
+			state.attributeVertices=AttributeVertexList(AttributeVertexList::allocator_type(arena));
+			}
+		if(memoryCap>0)
+			{
+			/* Find the largest particle pool whose store and render copies fit under the memory cap: */
+			size_t vertexSize=0;
+			if(incrementalPublish)
+				vertexSize=sizeof(MotionVertex)+sizeof(AttributeVertex);
+			else if(!density)
+				{
+				/* Count the render copies even when streaming, which falls back to them if no context can map the streaming buffer: */
+				vertexSize=compactVertices?sizeof(QuantizedVertex):sizeof(ParticleVertex);
+				}
+			size_t trailVertexSize=trailLength>0?sizeof(ParticleTrails::Vertex):0;
+			size_t low=0;
+			size_t high=maxNumParticles;
+			while(low<high)
+				{
+				size_t capacity=low+(high-low+1)/2;
+				size_t paddedCapacity=ParticleStore::padToPackSize(capacity);
+				size_t poolSize=ParticleStore::getMemorySize(capacity,highAccuracy&&!clusterMirror,arena);
+				if(vertexSize>0)
+					poolSize+=arena->getBlockSize(paddedCapacity*vertexSize)*3;
+				if(trailVertexSize>0)
+					poolSize+=arena->getBlockSize(paddedCapacity*trailVertexSize)*3;
+				if(poolSize<=memoryCap)
+					low=capacity;
+				else
+					high=capacity-1;
+				}
+			if(low<maxNumParticles)
+				{
+				std::cerr<<"StrangeAttractors: Reducing the particle pool to "<<low<<" particles to fit under the memory cap"<<std::endl;
+				maxNumParticles=low;
+				if(settings.maxNumParticles>maxNumParticles)
+					settings.maxNumParticles=maxNumParticles;
+				if(appliedSettings.maxNumParticles>maxNumParticles)
+					appliedSettings.maxNumParticles=maxNumParticles;
+				}
+			}
+		
+		/* Create the simulation engine; the background StrangeAttractors thread acts as the first worker of its pool; render nodes keep an idle engine without workers for its configuration: */
+		simulator=new ParticleSimulator(stepParameters,maxNumParticles,clusterMirror?1:numThreads,chunkSize,arena);
+		if(highAccuracy&&!clusterMirror)
+			simulator->enableHighAccuracy();
+		const ParticleStore& particles=simulator->getParticles();
+		if(density)
+			{
+			/* Accumulate particle positions into a histogram covering the attractor's default extent: */
+			const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+			simulator->enableDensity(si.densityCenter,si.densityRadius,densityResolution,densityWarmup);
+			for(int i=0;i<3;++i)
+				particleStates.getBuffer(i).densityVoxels.resize(simulator->getDensity()->getNumCells(),0);
+			}
+		else if(streamVertices)
+			{
+			/* Create a streaming buffer with one full particle pool's worth of vertices per region: */
+			streamingBuffer=new StreamingVertexBuffer(compactVertices?sizeof(QuantizedVertex):sizeof(ParticleVertex),particles.getCapacity());
+			}
+		else if(compactVertices)
+			{
+			for(int i=0;i<3;++i)
+				simulator->reserveRenderCopy(particleStates.getBuffer(i).quantizedVertices);
+			}
+		else if(incrementalPublish)
+			{
+			/* Track slot changes across the full pool, and reserve room for the worst case of every slot changing: */
+			slotChanges=new SlotChangeTracker(particles.getCapacity(),16);
+			for(int i=0;i<3;++i)
+				{
+				ParticleState& state=particleStates.getBuffer(i);
+				simulator->reserveRenderCopy(state.motionVertices);
+				simulator->reserveRenderCopy(state.attributeVertices);
+				state.attributeRanges.reserve(particles.getCapacity()/2+1);
+				}
+			attributeMirror.reserve(particles.getCapacity());
+			}
+		else
+			{
+			for(int i=0;i<3;++i)
+				simulator->reserveRenderCopy(particleStates.getBuffer(i).vertices);
+			}
+		
+		if(compactVertices)
+			{
+			/* Quantize positions inside the attractor's initial view, and ages by the particles' lifespan: */
+			const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+			vertexQuantizer=VertexQuantizer(si.densityCenter,si.displayRadius,maxLifespan);
+			}
+		
+		if(trailLength>0)
+			{
+			/* Keep one history layer per state along the trails, plus the newest one: */
+			trails=new ParticleTrails(particles.getCapacity(),trailLength+1);
+			for(int i=0;i<3;++i)
+				simulator->reserveRenderCopy(particleStates.getBuffer(i).trailVertices);
+			}
+		
+		if(!density&&cullGridResolution>0)
+			{
+			/* Bin exported vertices into a culling grid covering the attractor's default extent: */
+			const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+			simulator->enableGrid(si.densityCenter,si.densityRadius,cullGridResolution);
+			size_t numCells=simulator->getGrid()->getNumCells();
+			if(streamingBuffer!=0)
+				{
+				for(int i=0;i<StreamingVertexBuffer::numRegions;++i)
+					regionCellCounts[i].resize(numCells,0);
+				}
+			for(int i=0;i<3;++i)
+				particleStates.getBuffer(i).cellCounts.resize(numCells,0);
+			}
+		
+		if(recordFileName!=0&&!clusterMirror)
+			{
+			/* Record the particle state posted by the background thread: */
+			try
+				{
+				recorder=new TrajectoryRecorder(recordFileName,recordCompression,particles.getCapacity());
+				}
+			catch(const std::runtime_error& err)
+				{
+				std::cerr<<"StrangeAttractors: "<<err.what()<<"; not recording"<<std::endl;
+				}
+			}
+		}
+	
+	if(Vrui::getMainPipe()!=0&&simulator==0&&trajectoryPlayer==0)
+		std::cerr<<"StrangeAttractors: The GPU engine and parameter sweeps simulate independently on every cluster node"<<std::endl;
+	if(adaptiveDrawBudget>0.0&&!clusterMirror)
+		{
+		if(simulator!=0)
+			{
+			/* Keep the simulation thread at most three quarters busy, and particle drawing within the given GPU time per frame: */
+			budgetController=new BudgetController(simulator->getParticles().getCapacity(),1.0f,0.75,adaptiveDrawBudget*1.0e-3); // Lifespans from the controller are fractions of the configured lifespan
+			profiler.setEnabled(true);
+			}
+		else
+			std::cerr<<"StrangeAttractors: The adaptive particle budget is not supported by the GPU engine, parameter sweeps, or playback; ignoring -adaptiveBudget"<<std::endl;
+		}
+	if(showSettings&&simulator!=0)
+		{
+		settingsDialog=createSettingsDialog();
+		Vrui::popupPrimaryWidget(settingsDialog);
+		}
+	if(clusterMirror)
+		{
+		/* Render nodes receive the head node's particles, including those restored from its checkpoint: */
+		initParticleSize=0;
+		checkpointFileName=0;
+		}
+	if(checkpointFileName!=0&&simulator==0)
+		{
+		std::cerr<<"StrangeAttractors: Checkpoints are not supported by the GPU engine, parameter sweeps, or playback; ignoring -checkpoint"<<std::endl;
+		checkpointFileName=0;
+		}
+	if(checkpointFileName!=0&&access(checkpointFileName,F_OK)==0)
+		{
+		/* Resume from the last checkpoint instead of seeding new particles: */
+		try
+			{
+			ParticleSnapshot::load(checkpointFileName,simulator->getParticles(),stepParameters,Vrui::getApplicationTime(),false);
+			initParticleSize=0;
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"StrangeAttractors: "<<err.what()<<"; starting with new particles"<<std::endl;
+			}
+		}
+	nextCheckpointTime=Vrui::getApplicationTime()+checkpointInterval;
+	
+	AttractorCloud* attractorCloud=0;
+	if(preconverged&&initParticleSize>0)
+		{
+		/* Seed the initial particles from points that already lie on the attractor: */
+		attractorCloud=new AttractorCloud(stepParameters,1U<<16,20.0f,attractorCacheFileName);
+		if(attractorCloud->getNumPoints()==0)
+			{
+			delete attractorCloud;
+			attractorCloud=0;
+			}
+		}
+	
+	/* Draw the random positions and colors of all initial Particles in bulk, each from the stream keyed by the id it will receive: */
+	static const float seedCenter[3]={0.0f,0.0f,0.0f};
+	float seedRadius=AttractorSystems::getSystemInfo(stepParameters.system).seedRadius;
+	uint64_t firstSeedStream=simulator!=0?simulator->getParticles().getNextId():0;
+	std::vector<SeedQueue::Seed> initialSeeds(initParticleSize>0?initParticleSize:0);
+	random.generateSeeds(firstSeedStream,initialSeeds.size(),DOMAIN_INITIAL_SEEDS,seedCenter,seedRadius,64,initialSeeds.data());
+	for(int i = 0; i< initParticleSize ;++i)
+		{
+		const float* position=initialSeeds[i].position;
+		const ParticleStore::Color* color=initialSeeds[i].color;
+		ParticleStore::Scalar cloudPosition[3];
+		if(attractorCloud!=0)
+			{
+			/* Replace the random position by a random point of the cloud, using the next draw of the same stream: */
+			CounterRandom::Block block;
+			random.generate(firstSeedStream+i,DOMAIN_INITIAL_SEEDS,1,block);
+			attractorCloud->getPoint(CounterRandom::index(block[0],attractorCloud->getNumPoints()),cloudPosition);
+			position=cloudPosition;
+			}
+		
+		/* Initialize the time of Particles: */
+		double now=Vrui::getApplicationTime();
+		if(gpuEngine!=0)
+			gpuEngine->addParticle(position,color,now+timeDecay);
+		else if(ensembleSimulator!=0)
+			{
+			/* Start every ensemble from the same positions: */
+			for(size_t ensemble=0;ensemble<ensembleSimulator->getNumEnsembles();++ensemble)
+				ensembleSimulator->getEnsemble(ensemble).addParticle(position,color,now,now+timeDecay);
+			}
+		else
+			simulator->getParticles().addParticle(position,color,now,now+timeDecay);
+		}
+	delete attractorCloud;
+	
+	if(gpuEngine==0&&trajectoryPlayer==0)
+		{
+		/* Start the simulation clock: */
+		simulationClock.reset(SimulationClock::getWallTime());
+		
+		/* Calculate the first full mesh state in a new triple buffer slot: */
+		ParticleState& thisState=particleStates.startNewValue();
+		thisState.numParticles=ensembleSimulator!=0?ensembleSimulator->getNumParticles():simulator->getParticles().getNumParticles();
+		if(ensembleSimulator!=0)
+			{
+			thisState.vertices.resize(thisState.numParticles);
+			ensembleSimulator->exportVertices(thisState.vertices.data(),thisState.ensembleFirsts.data());
+			}
+		else if(compactVertices)
+			{
+			thisState.quantizedVertices.resize(thisState.numParticles);
+			thisState.vertexTime=exportQuantizedVertices(thisState.quantizedVertices.data(),simulator->getGrid()!=0?thisState.cellCounts.data():0);
+			}
+		else if(slotChanges!=0)
+			publishIncremental(thisState);
+		else if(simulator->getGrid()!=0)
+			{
+			thisState.vertices.resize(thisState.numParticles);
+			simulator->exportVertices(thisState.vertices.data(),thisState.cellCounts.data());
+			}
+		else if(simulator->getDensity()==0)
+			{
+			thisState.vertices.resize(thisState.numParticles);
+			simulator->exportVertices(thisState.vertices.data());
+			}
+		if(trails!=0)
+			{
+			thisState.trailVertices.resize(thisState.numParticles);
+			simulator->exportTrailVertices(thisState.trailVertices.data());
+			}
+		thisState.stateTime=simulationClock.getStepTime();
+		particleStates.postNewValue();
+		
+		/* Start the background StrangeAttractors thread, or the thread receiving the head node's particle states on render nodes: */
+		if(clusterMirror)
+			strangeAttractorsThread.start(this,&StrangeAttractors::clusterMirrorThreadMethod);
+		else
+			strangeAttractorsThread.start(this,&StrangeAttractors::strangeAttractorsThreadMethod);
+		}
+	}
+
+StrangeAttractors::~StrangeAttractors(void)
+	{
+	if(gpuEngine!=0)
+		delete gpuEngine;
+	else if(trajectoryPlayer!=0)
+		delete trajectoryPlayer;
+	else
+		{
+		/* Shut down the background StrangeAttractors thread after it finishes its current step: */
+		keepRunning=false;
+		if(streamingBuffer!=0)
+			streamingBuffer->shutdownProducer();
+		strangeAttractorsThread.join();
+		delete streamingBuffer;
+		
+		/* Release the render nodes' receiving threads, which shut down once the head node's last message arrives: */
+		if(clusterSync!=0)
+			{
+			if(!clusterMirror)
+				clusterSync->sendShutdown();
+			delete clusterSync;
+			}
+		
+		/* Write the remaining recorded frames and the trajectory file's time index: */
+		if(recorder!=0)
+			{
+			if(recorder->getNumDroppedFrames()>0)
+				std::cerr<<"StrangeAttractors: Trajectory recorder fell behind; dropped "<<recorder->getNumDroppedFrames()<<" frames"<<std::endl;
+			delete recorder;
+			}
+		
+		/* Save the final particle state for the next start: */
+		if(checkpointFileName!=0&&!ParticleSnapshot::save(checkpointFileName,simulator->getParticles(),simulator->getStepParameters(),lastStepTime))
+			std::cerr<<"StrangeAttractors: Unable to write checkpoint file "<<checkpointFileName<<std::endl;
+		
+		/* Shut down the simulation engine and its worker pool: */
+		delete budgetController;
+		delete trails;
+		delete slotChanges;
+		delete simulator;
+		delete ensembleSimulator;
+		
+		/* Return the render copies to the arena before releasing it: */
+		for(int i=0;i<3;++i)
+			{
+			ParticleState& state=particleStates.getBuffer(i);
+			state.vertices=ParticleList();
+			state.quantizedVertices=QuantizedVertexList();
+			state.trailVertices=TrailVertexList();
+			state.motionVertices=MotionVertexList();
+			state.attributeVertices=AttributeVertexList();
+			}
+		delete arena;
+		}
+	
+	delete statisticsDialog;
+	delete playbackDialog;
+	delete settingsDialog;
+	
+	/* Write the trace of all timed zones: */
+	if(traceFileName!=0)
+		{
+		if(profiler.writeChromeTrace(traceFileName))
+			{
+			if(profiler.getNumDroppedEvents()>0)
+				std::cerr<<"StrangeAttractors: Trace buffer overflowed; dropped "<<profiler.getNumDroppedEvents()<<" events"<<std::endl;
+			}
+		else
+			std::cerr<<"StrangeAttractors: Unable to write trace file "<<traceFileName<<std::endl;
+		}
+	}
+
+void StrangeAttractors::frame(void)
+	{
+	if(trajectoryPlayer!=0)
+		{
+		/* Advance playback and show the new position in the playback dialog: */
+		trajectoryPlayer->startFrame(Vrui::getApplicationTime());
+		playbackSliders[0]->setValue(trajectoryPlayer->getPlaybackTime());
+		playbackFields[0]->setValue(trajectoryPlayer->getPlaybackTime());
+		numVisibleParticles=trajectoryPlayer->getNumParticles();
+		if(statisticsDialog!=0)
+			updateStatisticsDialog(takeProfilerSnapshot()>0.0);
+		
+		/* Keep animating while playback is not paused: */
+		if(trajectoryPlayer->getSpeed()!=0.0)
+			Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
+		return;
+		}
+	
+	if(gpuEngine!=0)
+		{
+		/* Hand all newly seeded particles to the GPU engine: */
+		double now=Vrui::getApplicationTime();
+		gpuEngine->startFrame(now);
+		const SeedQueue::Seed* seeds;
+		size_t numSeeds;
+		while((numSeeds=seedQueue.beginDrain(seeds))>0)
+			{
+			for(size_t i=0;i<numSeeds;++i)
+				gpuEngine->addParticle(seeds[i].position,seeds[i].color,now+timeDecay);
+			seedQueue.endDrain(numSeeds);
+			profiler.count(COUNTER_SEEDS,numSeeds);
+			profiler.count(COUNTER_UPLOAD_BYTES,numSeeds*GPUParticleEngine::getSeedSize());
+			}
+		numVisibleParticles=gpuEngine->getNumUsedSlots();
+		if(statisticsDialog!=0)
+			updateStatisticsDialog(takeProfilerSnapshot()>0.0);
+		
+		/* Keep animating; the GPU engine advances particles during display: */
+		Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
+		return;
+		}
+	
+	if(streamsVertices())
+		{
+		/* Lock the most recent region written by the background thread: */
+		Profiler::Scope scope(profiler,ZONE_HANDOFF);
+		if(streamingBuffer->lockNewRegion())
+			{
+			lockedStateTime=streamingBuffer->getLockedStateTime();
+			lockedVertexTime=regionVertexTimes[streamingBuffer->getLockedRegion()];
+			numVisibleParticles=streamingBuffer->getLockedNumVertices();
+			if(simulator->getGrid()!=0)
+				lockedCellCounts=regionCellCounts[streamingBuffer->getLockedRegion()].data();
+			}
+		}
+	else
+		{
+		/* Check if there is a new entry in the triple buffer and lock it: */
+		bool newValue;
+		{
+		Profiler::Scope scope(profiler,ZONE_HANDOFF);
+		newValue=particleStates.lockNewValue();
+		}
+		if(newValue)
+			{
+			const ParticleState& thisState=particleStates.getLockedValue();
 			
-			pv.position[0]+=Math::randUniformCO(-3.0f,3.0f);
-			pv.position[1]+=Math::randUniformCO(-3.0f,3.0f);
-			pv.position[2]+=Math::randUniformCO(-3.0f,3.0f);
+			if(simulator!=0&&simulator->getDensity()!=0)
+				{
+				/* The density volume is uploaded into each context's texture during display: */
+				profiler.count(COUNTER_UPLOAD_BYTES,thisState.densityVoxels.size());
+				}
+			else
+				{
+				/* The new render copy is uploaded into each context's vertex buffer once, during its first display: */
+				if(compactVertices)
+					{
+					profiler.count(COUNTER_UPLOAD_BYTES,thisState.quantizedVertices.size()*sizeof(QuantizedVertex));
+					lockedVertexTime=thisState.vertexTime;
+					}
+				else if(slotChanges!=0)
+					{
+					/* Bring the foreground copy of all slots' attributes up to the new state, and let the simulation thread find later changes against it: */
+					attributeMirror.resize(thisState.motionVertices.size());
+					const AttributeVertex* avPtr=thisState.attributeVertices.data();
+					for(std::vector<SlotChangeTracker::Range>::const_iterator rIt=thisState.attributeRanges.begin();rIt!=thisState.attributeRanges.end();++rIt)
+						{
+						std::copy(avPtr,avPtr+rIt->count,attributeMirror.begin()+rIt->first);
+						avPtr+=rIt->count;
+						}
+					acknowledgedSequence.store(thisState.sequence,std::memory_order_release);
+					profiler.count(COUNTER_UPLOAD_BYTES,thisState.motionVertices.size()*sizeof(MotionVertex)+thisState.attributeVertices.size()*sizeof(AttributeVertex));
+					}
+				else
+					profiler.count(COUNTER_UPLOAD_BYTES,thisState.vertices.size()*sizeof(ParticleVertex));
+				if(simulator!=0&&simulator->getGrid()!=0)
+					lockedCellCounts=thisState.cellCounts.data();
+				}
+			if(trails!=0)
+				{
+				/* The newest trail layer is uploaded into each context's history buffer during display: */
+				profiler.count(COUNTER_UPLOAD_BYTES,thisState.trailVertices.size()*sizeof(ParticleTrails::Vertex));
+				}
+			lockedStateTime=thisState.stateTime;
+			numVisibleParticles=thisState.numParticles;
+			}
+		}
+	
+	if(simulator!=0&&simulator->getDensity()!=0)
+		{
+		/* Slice the density volume perpendicular to the axis closest to the viewing direction in model coordinates: */
+		Vrui::Vector viewDirection=Vrui::getNavigationTransformation().inverseTransform(Vrui::getForwardDirection());
+		densitySliceAxis=0;
+		for(int i=1;i<3;++i)
+			if(Math::abs(viewDirection[i])>Math::abs(viewDirection[densitySliceAxis]))
+				densitySliceAxis=i;
+		}
+	
+	if(statisticsDialog!=0||budgetController!=0)
+		{
+		/* Adapt the particle budget to the load measured by each new profiler snapshot: */
+		++numBudgetFrames;
+		double snapshotInterval=takeProfilerSnapshot();
+		if(snapshotInterval>0.0&&budgetController!=0)
+			updateBudget(snapshotInterval);
+		if(statisticsDialog!=0)
+			updateStatisticsDialog(snapshotInterval>0.0);
+		}
+	
+	if(interpolate)
+		{
+		/* Calculate how far this frame is between the two most recent steps: */
+		interpolationWeight=float(simulationClock.getInterpolationWeight(lockedStateTime,SimulationClock::getWallTime()));
+		
+		/* Keep rendering frames to show interpolated motion until the next step arrives: */
+		Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
+		}
+	}
+
+void StrangeAttractors::display(GLContextData& contextData) const
+	{
+	/* Save OpenGL state: */
+	glPushAttrib(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_ENABLE_BIT|GL_POINT_BIT|GL_TEXTURE_BIT);
+	
+	glDisable(GL_LIGHTING);
+	glPointSize(ParticleAppearance::defaultPointSize);
+	glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+	
+	/* Collect finished GPU time measurements and start timing this frame's drawing: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	bool timeGpu=profiler.isEnabled();
+	if(timeGpu)
+		{
+		dataItem->gpuTimer.collect(profiler,ZONE_GPU_DRAW);
+		dataItem->gpuTimer.start();
+		}
+	
+	if(gpuEngine!=0)
+		{
+		/* Advance and draw the particles on the GPU: */
+		gpuEngine->display(contextData);
+		if(timeGpu)
+			dataItem->gpuTimer.stop();
+		glPopAttrib();
+		return;
+		}
+	
+	Profiler::Scope scope(profiler,ZONE_DRAW);
+	
+	if(trajectoryPlayer!=0)
+		{
+		/* Draw the current chunk of the recording straight from its uploaded arrays: */
+		trajectoryPlayer->display(contextData);
+		if(timeGpu)
+			dataItem->gpuTimer.stop();
+		glPopAttrib();
+		return;
+		}
+	
+	if(dataItem->densityTextureId!=0)
+		{
+		/* Draw the density histogram as an emission-only volume: */
+		drawDensity(dataItem);
+		if(timeGpu)
+			dataItem->gpuTimer.stop();
+		glPopAttrib();
+		return;
+		}
+	
+	if(trails!=0)
+		{
+		/* Draw the particles' recent paths, adding the locked state as their newest layer: */
+		const ParticleState& lockedState=particleStates.getLockedValue();
+		trails->display(contextData,lockedState.trailVertices.data(),lockedState.trailVertices.size(),lockedState.stateTime);
+		}
+	
+	/* Compact vertices can only be drawn by the program decoding them: */
+	if(compactVertices&&dataItem->particleProgram==0)
+		{
+		if(timeGpu)
+			dataItem->gpuTimer.stop();
+		glPopAttrib();
+		return;
+		}
+	
+	/* Fade particles by age and interpolate their positions between the two most recent steps: */
+	if(dataItem->particleProgram!=0)
+		{
+		glUseProgram(dataItem->particleProgram);
+		
+		/* Uniform values only change between frames, and stay in the program for all other eyes and windows: */
+		double frameTime=Vrui::getApplicationTime();
+		if(dataItem->uniformFrameTime!=frameTime)
+			{
+			glUniform1f(dataItem->particleUniforms[0],interpolate?interpolationWeight:1.0f);
+			glUniform1f(dataItem->particleUniforms[1],GLfloat(frameTime));
+			glUniform1f(dataItem->particleUniforms[2],ParticleAppearance::defaultPointSize);
+			if(compactVertices)
+				{
+				glUniform3fv(dataItem->quantizerUniforms[0],1,vertexQuantizer.getOrigin());
+				glUniform3fv(dataItem->quantizerUniforms[1],1,vertexQuantizer.getExtent());
+				glUniform1f(dataItem->quantizerUniforms[2],lockedVertexTime);
+				glUniform1f(dataItem->quantizerUniforms[3],vertexQuantizer.getMaxLifespan());
+				}
+			dataItem->uniformFrameTime=frameTime;
+			}
+		}
+	
+	if(streamsVertices())
+		{
+		/* Draw straight from the locked region of the streaming buffer: */
+		const GLvoid* regionOffset;
+		size_t numVertices;
+		if(streamingBuffer->bind(contextData,regionOffset,numVertices))
+			{
+			enableVertexArrays(regionOffset);
+			drawCells(dataItem,numVertices);
+			disableVertexArrays();
+			streamingBuffer->unbind(contextData);
+			}
+		}
+	else
+		{
+		/* Bind the vertex buffer, uploading the locked render copy if it is new: */
+		bindVertexBuffer(dataItem);
+		
+		if(ensembleSimulator!=0)
+			{
+			/* Draw each shown ensemble's range of the bound buffer, side by side or on top of each other: */
+			const std::vector<unsigned int>& ensembleFirsts=particleStates.getLockedValue().ensembleFirsts;
+			for(size_t tile=0;tile<shownEnsembles.size();++tile)
+				{
+				unsigned int ensemble=shownEnsembles[tile];
+				if(!overlayEnsembles)
+					{
+					float offset[3];
+					getTileOffset(tile,offset);
+					glPushMatrix();
+					glTranslatef(offset[0],offset[1],offset[2]);
+					}
+				glDrawArrays(GL_POINTS,GLint(ensembleFirsts[ensemble]),GLsizei(ensembleFirsts[ensemble+1]-ensembleFirsts[ensemble]));
+				if(!overlayEnsembles)
+					glPopMatrix();
+				}
+			}
+		else
+			{
+			/* Draw the visible grid cells, or all vertices if they are not binned: */
+			drawCells(dataItem,dataItem->numBufferVertices);
+			}
+		
+		unbindVertexBuffer(dataItem);
+		}
+	
+	if(dataItem->particleProgram!=0)
+		glUseProgram(0);
+	
+	if(timeGpu)
+		dataItem->gpuTimer.stop();
+	
+	/* Restore OpenGL state: */
+	glPopAttrib();
+	}
+
+void StrangeAttractors::resetNavigation(void)
+	{
+	const AttractorSystems::SystemInfo& si=AttractorSystems::getSystemInfo(stepParameters.system);
+	if(ensembleSimulator!=0&&!overlayEnsembles)
+		{
+		/* Center and scale the grid of ensembles drawn side by side: */
+		size_t numRows=(shownEnsembles.size()+numEnsembleColumns-1)/numEnsembleColumns;
+		Vrui::Scalar width=Vrui::Scalar(numEnsembleColumns-1)*Vrui::Scalar(ensembleSpacing);
+		Vrui::Scalar height=Vrui::Scalar(numRows>0?numRows-1:0)*Vrui::Scalar(ensembleSpacing);
+		Vrui::Point center(width*Vrui::Scalar(0.5),-height*Vrui::Scalar(0.5),0);
+		Vrui::setNavigationTransformation(center,Vrui::Scalar(si.displayRadius)+Math::sqrt(width*width+height*height)*Vrui::Scalar(0.5));
+		return;
+		}
+	
+	/* Center and scale the object: */
+	Vrui::setNavigationTransformation(Vrui::Point::origin,si.displayRadius);
+	}
+
+void StrangeAttractors::initContext(GLContextData& contextData) const
+	{
+	DataItem* dataItem=new DataItem;
+	contextData.addDataItem(this,dataItem);
+	
+	if(simulator!=0&&simulator->getDensity()!=0)
+		{
+		/* Create an empty 3D texture receiving the tone-mapped density histogram: */
+		GLsizei resolution=GLsizei(simulator->getDensity()->getResolution());
+		glGenTextures(1,&dataItem->densityTextureId);
+		glBindTexture(GL_TEXTURE_3D,dataItem->densityTextureId);
+		glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_R,GL_CLAMP_TO_EDGE);
+		glTexImage3D(GL_TEXTURE_3D,0,GL_LUMINANCE8,resolution,resolution,resolution,0,GL_LUMINANCE,GL_UNSIGNED_BYTE,0);
+		glBindTexture(GL_TEXTURE_3D,0);
+		}
+	else if(gpuEngine==0&&trajectoryPlayer==0)
+		{
+		if(simulator!=0&&simulator->getGrid()!=0)
+			{
+			/* Allocate room for one draw range per culling grid cell: */
+			dataItem->drawFirsts.resize(simulator->getGrid()->getNumCells());
+			dataItem->drawCounts.resize(simulator->getGrid()->getNumCells());
+			}
+		
+		/* Create the buffer receiving each new render copy, also when streaming in case no context can map the streaming buffer: */
+		glGenBuffers(1,&dataItem->vertexBufferId);
+		
+		if(slotChanges!=0)
+			{
+			/* Create a buffer holding all slots' attributes, which is only ever partially rewritten: */
+			glGenBuffers(1,&dataItem->attributeBufferId);
+			glBindBuffer(GL_ARRAY_BUFFER,dataItem->attributeBufferId);
+			glBufferData(GL_ARRAY_BUFFER,simulator->getParticles().getCapacity()*sizeof(AttributeVertex),0,GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER,0);
+			}
+		
+		/* Create a shader program fading particles by their birth times and lifespans, held in texture coordinates, and blending previous positions, held in vertex normals, with current positions: */
+		static const char* vertexSource=
+			"uniform float interpolationWeight;\n"
+			"void main()\n"
+			"	{\n"
+			"	float age=particleAge(gl_MultiTexCoord0.x,gl_MultiTexCoord0.y);\n"
+			"	gl_Position=gl_ModelViewProjectionMatrix*vec4(mix(gl_Normal,gl_Vertex.xyz,interpolationWeight),1.0);\n"
+			"	gl_FrontColor=agedColor(gl_Color,age);\n"
+			"	gl_PointSize=agedPointSize(age);\n"
+			"	}\n";
+		
+		/* In compact mode, decode the same attributes from normalized integers instead: */
+		static const char* quantizedVertexSource=
+			"attribute vec4 positionAge;\n"
+			"attribute vec4 previousPositionLifespan;\n"
+			"attribute vec4 color;\n"
+			"uniform float interpolationWeight;\n"
+			"uniform vec3 positionOrigin;\n"
+			"uniform vec3 positionExtent;\n"
+			"uniform float vertexTime;\n"
+			"uniform float maxLifespan;\n"
+			"void main()\n"
+			"	{\n"
+			"	float age=particleAge(vertexTime-positionAge.w*maxLifespan,previousPositionLifespan.w*maxLifespan);\n"
+			"	vec3 position=positionOrigin+positionExtent*mix(previousPositionLifespan.xyz,positionAge.xyz,interpolationWeight);\n"
+			"	gl_Position=gl_ModelViewProjectionMatrix*vec4(position,1.0);\n"
+			"	gl_FrontColor=agedColor(color,age);\n"
+			"	gl_PointSize=agedPointSize(age);\n"
+			"	}\n";
+		static const char* quantizedAttributeNames[3]=
+			{
+			"positionAge","previousPositionLifespan","color"
+			};
+		static const char* fragmentSource=
+			"#version 120\n"
+			"void main()\n"
+			"	{\n"
+			"	gl_FragColor=gl_Color;\n"
+			"	}\n";
+		static const char* uniformNames[3]=
+			{
+			"interpolationWeight","currentTime","pointSize"
+			};
+		static const char* quantizerUniformNames[4]=
+			{
+			"positionOrigin","positionExtent","vertexTime","maxLifespan"
+			};
+		try
+			{
+			std::string fullVertexSource="#version 120\n";
+			fullVertexSource.append(ParticleAppearance::getShaderSource());
+			if(compactVertices)
+				{
+				fullVertexSource.append(quantizedVertexSource);
+				dataItem->particleProgram=ShaderHelpers::createRenderProgram(fullVertexSource.c_str(),fragmentSource,quantizedAttributeNames,3);
+				for(int i=0;i<4;++i)
+					dataItem->quantizerUniforms[i]=glGetUniformLocation(dataItem->particleProgram,quantizerUniformNames[i]);
+				}
+			else
+				{
+				fullVertexSource.append(vertexSource);
+				dataItem->particleProgram=ShaderHelpers::createRenderProgram(fullVertexSource.c_str(),fragmentSource,0,0);
+				}
+			for(int i=0;i<3;++i)
+				dataItem->particleUniforms[i]=glGetUniformLocation(dataItem->particleProgram,uniformNames[i]);
+			}
+		catch(const std::runtime_error& err)
+			{
+			std::cerr<<"StrangeAttractors: Disabling fading and interpolation due to exception "<<err.what()<<std::endl;
+			}
+		
+		if(dataItem->vertexBufferId!=0&&GLExtensionManager::isExtensionSupported("GL_ARB_vertex_array_object"))
+			{
+			/* Capture the vertex buffer's attribute layout once, so that every display call binds it with a single call: */
+			glGenVertexArrays(1,&dataItem->vertexArrayId);
+			glBindVertexArray(dataItem->vertexArrayId);
+			if(slotChanges!=0)
+				enableSplitVertexArrays(dataItem);
+			else
+				{
+				glBindBuffer(GL_ARRAY_BUFFER,dataItem->vertexBufferId);
+				enableVertexArrays(0);
+				}
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER,0);
+			}
+		}
+	}
+
+/********************************************************************
+Static elements of class StrangeAttractors::SeedParticlesToolFactory:
+********************************************************************/
+
+StrangeAttractors::SeedParticlesToolFactory* StrangeAttractors::SeedParticlesTool::factory=0;
+
+void StrangeAttractors::SeedParticlesTool::initClass(void)
+	{
+	/* Create a factory object for the custom tool class: */
+	factory=new SeedParticlesToolFactory("SeedParticlesTool","Seed Particles",0,*Vrui::getToolManager());
+	
+	/* Set the custom tool class' input layout: */
+	factory->setNumButtons(1);
+	factory->setButtonFunction(0,"Seed Particles");
+	
+	/* Register the custom tool class with Vrui's tool manager: */
+	Vrui::getToolManager()->addClass(factory,Vrui::ToolManager::defaultToolFactoryDestructor);
+	}
+
+StrangeAttractors::SeedParticlesTool::SeedParticlesTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
+	:Vrui::Tool(factory,inputAssignment)
+	{
+	}
+
+const Vrui::ToolFactory* StrangeAttractors::SeedParticlesTool::getFactory(void) const
+	{
+	return factory;
+	}
+
+void StrangeAttractors::SeedParticlesTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData)
+	{
+	if(cbData->newButtonState) // Button has just been pressed
+		{
+		std::cout<<"MyTool: Button "<<buttonSlotIndex<<" has just been pressed"<<std::endl;
+		}
+	else // Button has just been released
+		{
+		std::cout<<"MyTool: Button "<<buttonSlotIndex<<" has just been released"<<std::endl;
+		}
+	}
+void StrangeAttractors::SeedParticlesTool::frame(void)
+	{
+	if(getButtonState(0))
+		{
+		Vrui::Point center=Vrui::getNavigationTransformation().inverseTransform(getButtonDevicePosition(0));
+		
+		/* Jitter seeds in a cube scaled to the attractor's size (+-3 for the Lorenz attractor): */
+		float jitter=AttractorSystems::getSystemInfo(application->stepParameters.system).seedRadius*0.15f;
+		
+		/* Spray a batch of seeds around the tool's position, each from the next unused random stream: */
+		float sprayCenter[3];
+		for(int i=0;i<3;++i)
+			sprayCenter[i]=float(center[i]);
+		spray.resize(application->seedsPerFrame);
+		application->random.generateSeeds(application->nextSprayStream,spray.size(),DOMAIN_SPRAYED_SEEDS,sprayCenter,jitter,32,spray.data());
+		application->nextSprayStream+=spray.size();
+		
+		/* Hand the whole batch to the simulation at once: */
+		application->seedQueue.push(spray.data(),spray.size());
+		Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
+		}
+	}
+
+/********************************************************************
+Static elements of class StrangeAttractors::EmitParticlesToolFactory:
+********************************************************************/
+
+StrangeAttractors::EmitParticlesToolFactory* StrangeAttractors::EmitParticlesTool::factory=0;
+
+/*****************************************************
+Methods of class StrangeAttractors::EmitParticlesTool:
+*****************************************************/
+
+void StrangeAttractors::EmitParticlesTool::initClass(void)
+	{
+	/* Create a factory object for the custom tool class: */
+	factory=new EmitParticlesToolFactory("EmitParticlesTool","Emit Particles",0,*Vrui::getToolManager());
+	
+	/* Set the custom tool class' input layout: */
+	factory->setNumButtons(1);
+	factory->setButtonFunction(0,"Emit Particles");
+	
+	/* Register the custom tool class with Vrui's tool manager: */
+	Vrui::getToolManager()->addClass(factory,Vrui::ToolManager::defaultToolFactoryDestructor);
+	}
+
+StrangeAttractors::EmitParticlesTool::EmitParticlesTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
+	:Vrui::Tool(factory,inputAssignment),
+	 emitter(application->emitterShape,application->emitterSize>0.0f?application->emitterSize:AttractorSystems::getSystemInfo(application->stepParameters.system).seedRadius*0.15f,application->emitterRate)
+	{
+	}
+
+const Vrui::ToolFactory* StrangeAttractors::EmitParticlesTool::getFactory(void) const
+	{
+	return factory;
+	}
+
+void StrangeAttractors::EmitParticlesTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData)
+	{
+	/* Start every press without a fraction of a seed left over from the last one: */
+	if(cbData->newButtonState)
+		emitter.reset();
+	}
+
+void StrangeAttractors::EmitParticlesTool::frame(void)
+	{
+	if(getButtonState(0))
+		{
+		/* Emit the seeds due since the last frame, at most as many as the seed queue holds: */
+		size_t numSeeds=emitter.advance(Vrui::getFrameTime(),application->seedQueue.getCapacity());
+		if(numSeeds>0)
+			{
+			/* Place the emitter at the tool's position and pointing direction in model coordinates: */
+			const Vrui::NavTransform& nav=Vrui::getNavigationTransformation();
+			Vrui::Point center=nav.inverseTransform(getButtonDevicePosition(0));
+			Vrui::Vector direction=nav.inverseTransform(getButtonDeviceRayDirection(0));
+			float emitterCenter[3],emitterDirection[3];
+			for(int i=0;i<3;++i)
+				{
+				emitterCenter[i]=float(center[i]);
+				emitterDirection[i]=float(direction[i]);
+				}
 			
-			pv.color[0]=Math::randUniformCO(32,256);
-			pv.color[1]=Math::randUniformCO(32,256);
-			pv.color[2]=Math::randUniformCO(32,256);
-			pv.color[3]=255;
+			/* Generate the whole batch, each seed from the next unused random stream, and hand it to the simulation at once: */
+			seeds.resize(numSeeds);
+			emitter.generateSeeds(application->random,application->nextSprayStream,numSeeds,DOMAIN_SPRAYED_SEEDS,emitterCenter,emitterDirection,seeds.data());
 			
-			application->inputParticles.write(pv);
-			Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
+			/* Only use up the random streams of seeds that fit into the queue; those of dropped seeds go to the next batch: */
+			application->nextSprayStream+=application->seedQueue.push(seeds.data(),numSeeds);
+			}
+		
+		/* Keep frames coming while the button is held, so that emission does not stall: */
+		Vrui::scheduleUpdate(Vrui::getNextAnimationTime());
 		}
 	}
 	
@@ -0,0 +1,237 @@
+/***********************************************************************
+StreamingVertexBuffer - Vertex buffer streaming data from a producer
+thread straight into GPU-visible memory. The buffer is allocated once
+with immutable storage and mapped persistently and coherently, and is
+divided into a ring of regions. The producer fills a free region and
+posts it; the rendering thread draws from the most recently posted
+region, and releases regions only once fences show that the GPU has
+finished reading them. No data is copied on the rendering thread, and
+the buffer is never re-specified.
+Requires OpenGL 4.4 or the GL_ARB_buffer_storage extension. Only the
+first OpenGL context to be initialized receives the streamed data; if it
+can not map the buffer, the producer is told so instead of waiting for a
+region forever, and can hand its data to the renderer some other way.
+***********************************************************************/
+
+#include "StreamingVertexBuffer.h"
+
+#include <iostream>
+#include <GL/glext.h>
+#include <GL/GLContextData.h>
+#include <GL/GLExtensionManager.h>
+
+/**************************************************
+Methods of class StreamingVertexBuffer::DataItem:
+**************************************************/
+
+StreamingVertexBuffer::DataItem::DataItem(void)
+	:streaming(false),bufferId(0)
+	{
+	for(int i=0;i<numRegions;++i)
+		fences[i]=0;
+	}
+
+StreamingVertexBuffer::DataItem::~DataItem(void)
+	{
+	for(int i=0;i<numRegions;++i)
+		if(fences[i]!=0)
+			glDeleteSync(fences[i]);
+	if(bufferId!=0)
+		{
+		/* Deleting the buffer also unmaps it: */
+		glDeleteBuffers(1,&bufferId);
+		}
+	}
+
+/**************************************
+Methods of class StreamingVertexBuffer:
+**************************************/
+
+void StreamingVertexBuffer::releaseRetiredRegions(StreamingVertexBuffer::DataItem* dataItem) const
+	{
+	StreamingVertexBuffer* self=const_cast<StreamingVertexBuffer*>(this);
+	Threads::Mutex::Lock regionLock(self->regionMutex);
+	bool released=false;
+	for(int i=0;i<numRegions;++i)
+		if(states[i]==RETIRED)
+			{
+			/* Poll the region's fence without blocking: */
+			if(dataItem->fences[i]!=0)
+				{
+				GLenum result=glClientWaitSync(dataItem->fences[i],0,0);
+				if(result!=GL_ALREADY_SIGNALED&&result!=GL_CONDITION_SATISFIED)
+					continue;
+				glDeleteSync(dataItem->fences[i]);
+				dataItem->fences[i]=0;
+				}
+			self->states[i]=FREE;
+			released=true;
+			}
+
+	/* Wake up a producer waiting for a free region: */
+	if(released)
+		self->regionCond.signal();
+	}
+
+StreamingVertexBuffer::StreamingVertexBuffer(size_t sVertexSize,size_t sCapacity)
+	:vertexSize(sVertexSize),capacity(sCapacity>0?sCapacity:1),
+	 memory(0),
+	 writeRegion(-1),readyRegion(-1),lockedRegion(-1),
+	 shutdown(false),unavailable(false),claimed(false)
+	{
+	/* Pad regions to a multiple of 64 bytes, which keeps vertices aligned and producers' cache lines separate: */
+	regionSize=(vertexSize*capacity+63)&~size_t(63);
+	for(int i=0;i<numRegions;++i)
+		{
+		states[i]=FREE;
+		numVertices[i]=0;
+		stateTimes[i]=0.0;
+		}
+	}
+
+StreamingVertexBuffer::~StreamingVertexBuffer(void)
+	{
+	}
+
+void StreamingVertexBuffer::initContext(GLContextData& contextData) const
+	{
+	DataItem* dataItem=new DataItem;
+	contextData.addDataItem(this,dataItem);
+
+	/* Only the first context can receive streamed data, as the producer writes into a single mapping: */
+	if(claimed)
+		{
+		std::cerr<<"StreamingVertexBuffer: Streamed vertices are only shown in the first window"<<std::endl;
+		return;
+		}
+	claimed=true;
+	StreamingVertexBuffer* self=const_cast<StreamingVertexBuffer*>(this);
+	if(!GLExtensionManager::isExtensionSupported("GL_ARB_buffer_storage"))
+		{
+		/* Release a producer waiting for the mapping, which will never arrive: */
+		std::cerr<<"StreamingVertexBuffer: OpenGL context does not support persistently mapped buffers; disabling vertex streaming"<<std::endl;
+		Threads::Mutex::Lock regionLock(self->regionMutex);
+		self->unavailable=true;
+		self->regionCond.broadcast();
+		return;
+		}
+
+	/* Allocate immutable storage for all regions and map it once for the lifetime of the buffer: */
+	GLbitfield flags=GL_MAP_WRITE_BIT|GL_MAP_PERSISTENT_BIT|GL_MAP_COHERENT_BIT;
+	glGenBuffers(1,&dataItem->bufferId);
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->bufferId);
+	glBufferStorage(GL_ARRAY_BUFFER,regionSize*numRegions,0,flags);
+	void* mapped=glMapBufferRange(GL_ARRAY_BUFFER,0,regionSize*numRegions,flags);
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+
+	/* Hand the mapped memory to the producer, or tell it that there will be none: */
+	Threads::Mutex::Lock regionLock(self->regionMutex);
+	if(mapped!=0)
+		{
+		dataItem->streaming=true;
+		self->memory=static_cast<char*>(mapped);
+		}
+	else
+		{
+		std::cerr<<"StreamingVertexBuffer: Unable to map vertex buffer; disabling vertex streaming"<<std::endl;
+		self->unavailable=true;
+		}
+	self->regionCond.broadcast();
+	}
+
+bool StreamingVertexBuffer::isUnavailable(void) const
+	{
+	StreamingVertexBuffer* self=const_cast<StreamingVertexBuffer*>(this);
+	Threads::Mutex::Lock regionLock(self->regionMutex);
+	return unavailable;
+	}
+
+void* StreamingVertexBuffer::startRegion(void)
+	{
+	Threads::Mutex::Lock regionLock(regionMutex);
+	while(true)
+		{
+		if(shutdown||unavailable)
+			return 0;
+
+		/* Claim any free region once the buffer is mapped: */
+		if(memory!=0)
+			for(int i=0;i<numRegions;++i)
+				if(states[i]==FREE)
+					{
+					states[i]=WRITING;
+					writeRegion=i;
+					return memory+regionSize*i;
+					}
+
+		regionCond.wait(regionMutex);
+		}
+	}
+
+void StreamingVertexBuffer::postRegion(size_t newNumVertices,double newStateTime)
+	{
+	Threads::Mutex::Lock regionLock(regionMutex);
+
+	/* A posted region that was never locked has never been drawn either, and can be reused right away: */
+	if(readyRegion>=0)
+		states[readyRegion]=FREE;
+
+	readyRegion=writeRegion;
+	states[readyRegion]=READY;
+	numVertices[readyRegion]=newNumVertices<capacity?newNumVertices:capacity;
+	stateTimes[readyRegion]=newStateTime;
+	writeRegion=-1;
+	}
+
+void StreamingVertexBuffer::shutdownProducer(void)
+	{
+	Threads::Mutex::Lock regionLock(regionMutex);
+	shutdown=true;
+	regionCond.broadcast();
+	}
+
+bool StreamingVertexBuffer::lockNewRegion(void)
+	{
+	Threads::Mutex::Lock regionLock(regionMutex);
+	if(readyRegion<0)
+		return false;
+
+	/* Retire the previously locked region; it becomes free once the GPU has finished drawing from it: */
+	if(lockedRegion>=0)
+		states[lockedRegion]=RETIRED;
+	lockedRegion=readyRegion;
+	states[lockedRegion]=DRAWING;
+	readyRegion=-1;
+
+	return true;
+	}
+
+bool StreamingVertexBuffer::bind(GLContextData& contextData,const GLvoid*& regionOffset,size_t& numLockedVertices) const
+	{
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	if(!dataItem->streaming)
+		return false;
+
+	/* Hand regions the GPU has finished with back to the producer: */
+	releaseRetiredRegions(dataItem);
+
+	if(lockedRegion<0||numVertices[lockedRegion]==0)
+		return false;
+
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->bufferId);
+	regionOffset=reinterpret_cast<const GLvoid*>(regionSize*lockedRegion);
+	numLockedVertices=numVertices[lockedRegion];
+	return true;
+	}
+
+void StreamingVertexBuffer::unbind(GLContextData& contextData) const
+	{
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+
+	/* Replace the locked region's fence, as a fence after the last draw covers all earlier ones: */
+	if(dataItem->fences[lockedRegion]!=0)
+		glDeleteSync(dataItem->fences[lockedRegion]);
+	dataItem->fences[lockedRegion]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+	}
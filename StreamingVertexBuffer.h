@@ -0,0 +1,115 @@
+/***********************************************************************
+StreamingVertexBuffer - Vertex buffer streaming data from a producer
+thread straight into GPU-visible memory. The buffer is allocated once
+with immutable storage and mapped persistently and coherently, and is
+divided into a ring of regions. The producer fills a free region and
+posts it; the rendering thread draws from the most recently posted
+region, and releases regions only once fences show that the GPU has
+finished reading them. No data is copied on the rendering thread, and
+the buffer is never re-specified.
+Requires OpenGL 4.4 or the GL_ARB_buffer_storage extension. Only the
+first OpenGL context to be initialized receives the streamed data; if it
+can not map the buffer, the producer is told so instead of waiting for a
+region forever, and can hand its data to the renderer some other way.
+***********************************************************************/
+
+#ifndef STREAMINGVERTEXBUFFER_INCLUDED
+#define STREAMINGVERTEXBUFFER_INCLUDED
+
+#include <stddef.h>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+#include <Threads/Mutex.h>
+#include <Threads/Cond.h>
+
+/* Forward declarations: */
+class GLContextData;
+
+class StreamingVertexBuffer:public GLObject
+	{
+	/* Embedded classes: */
+	public:
+	static const int numRegions=4; // Number of regions: one each being written, waiting to be drawn, being drawn, and waiting for the GPU to finish
+
+	private:
+	enum RegionState // Enumerated type for states of buffer regions
+		{
+		FREE=0,WRITING,READY,DRAWING,RETIRED
+		};
+
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elements: */
+		public:
+		bool streaming; // Flag whether this context owns the mapped buffer
+		GLuint bufferId; // ID of the vertex buffer
+		GLsync fences[numRegions]; // Fences inserted after the last draw from each region, or null
+
+		/* Constructors and destructors: */
+		DataItem(void);
+		virtual ~DataItem(void);
+		};
+
+	/* Elements: */
+	size_t vertexSize; // Size of a vertex in bytes
+	size_t capacity; // Maximum number of vertices per region
+	size_t regionSize; // Size of a region in bytes, padded to keep all regions aligned
+	Threads::Mutex regionMutex; // Mutex protecting the region states and the mapped memory pointer
+	Threads::Cond regionCond; // Condition variable signaled when a region becomes free, the buffer is mapped, or the buffer shuts down
+	char* memory; // Start of the mapped buffer, or null before the owning context has been initialized
+	RegionState states[numRegions]; // States of all regions
+	size_t numVertices[numRegions]; // Number of valid vertices in each region
+	double stateTimes[numRegions]; // Producer-defined time stamps of the states held in each region
+	int writeRegion; // Index of the region being written by the producer, or -1
+	int readyRegion; // Index of the most recently posted region not yet locked, or -1
+	int lockedRegion; // Index of the region being drawn, or -1
+	bool shutdown; // Flag to release a producer waiting for a free region
+	bool unavailable; // Flag whether the first context could not map the buffer, so that the producer will never receive a region
+	mutable bool claimed; // Flag whether a context has already claimed the mapped buffer
+
+	/* Private methods: */
+	StreamingVertexBuffer(const StreamingVertexBuffer& source); // Prohibit copy constructor
+	StreamingVertexBuffer& operator=(const StreamingVertexBuffer& source); // Prohibit assignment operator
+	void releaseRetiredRegions(DataItem* dataItem) const; // Frees all retired regions whose fences have been passed
+
+	/* Constructors and destructors: */
+	public:
+	StreamingVertexBuffer(size_t sVertexSize,size_t sCapacity); // Creates a buffer for up to the given number of vertices of the given size per region
+	virtual ~StreamingVertexBuffer(void);
+
+	/* Methods from GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+
+	/* Producer methods: */
+	size_t getCapacity(void) const // Returns the maximum number of vertices per region
+		{
+		return capacity;
+		}
+	bool isUnavailable(void) const; // Returns true if the first context could not map the buffer, so that no region will ever become free
+	void* startRegion(void); // Blocks until a region is free and returns a pointer to its mapped memory; returns null if the buffer shuts down or can not be mapped
+	int getWriteRegion(void) const // Returns the index of the region being written, for producers keeping per-region data alongside the vertices
+		{
+		return writeRegion;
+		}
+	void postRegion(size_t newNumVertices,double newStateTime); // Posts the region being written, holding the given number of vertices of a state with the given time stamp, to the rendering thread
+	void shutdownProducer(void); // Releases a producer blocked in startRegion; all subsequent calls to startRegion return null
+
+	/* Rendering methods: */
+	bool lockNewRegion(void); // Locks the most recently posted region for drawing; returns true if a new region was locked
+	int getLockedRegion(void) const // Returns the index of the locked region, or -1
+		{
+		return lockedRegion;
+		}
+	double getLockedStateTime(void) const // Returns the time stamp of the state in the locked region
+		{
+		return lockedRegion>=0?stateTimes[lockedRegion]:0.0;
+		}
+	size_t getLockedNumVertices(void) const // Returns the number of vertices in the locked region
+		{
+		return lockedRegion>=0?numVertices[lockedRegion]:0;
+		}
+	bool bind(GLContextData& contextData,const GLvoid*& regionOffset,size_t& numLockedVertices) const; // Binds the buffer and returns the offset and number of vertices of the locked region; returns false if there is nothing to draw
+	void unbind(GLContextData& contextData) const; // Fences the locked region after drawing from it and unbinds the buffer
+	};
+
+#endif
@@ -0,0 +1,80 @@
+/***********************************************************************
+TrajectoryFormat - On-disk layout of recorded particle trajectories. A
+trajectory file starts with a file header, followed by one chunk per
+recorded simulation step, and ends with a time index holding the time,
+offset, and particle count of each chunk. Each chunk holds a chunk
+header and the particles' persistent ids, birth times, and positions.
+Raw chunks store ids, birth times, and x, y, and z coordinates as
+separate native-endian arrays, each starting at a multiple of the chunk
+alignment, so that readers can use them straight from a memory map.
+Quantized chunks sort particles by id, store id differences as
+variable-length integers, and store positions as 16-bit fractions of
+the chunk's bounding box. All structures are in native byte order.
+***********************************************************************/
+
+#ifndef TRAJECTORYFORMAT_INCLUDED
+#define TRAJECTORYFORMAT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace TrajectoryFormat {
+
+static const char fileMagic[8]={'S','A','T','R','A','J','\0','\1'}; // Identifier at the start of every trajectory file
+static const uint32_t version=1; // Version of the layout described here
+static const uint32_t chunkMagic=0x4b4e4843U; // Identifier at the start of every chunk ("CHNK" in little-endian order)
+static const size_t alignment=64; // Alignment of chunks and of chunk arrays in the file
+
+enum Compression // Enumerated type for chunk encodings
+	{
+	RAW=0,QUANTIZED
+	};
+
+struct FileHeader // Structure at the start of a trajectory file
+	{
+	/* Elements: */
+	public:
+	char magic[8]; // Equal to fileMagic
+	uint32_t version; // Layout version
+	uint32_t compression; // Encoding of all chunks
+	uint64_t numChunks; // Number of chunks in the file; zero while the file is being written
+	uint64_t indexOffset; // Offset of the time index from the start of the file; zero while the file is being written
+	uint8_t reserved[32]; // Padding to the chunk alignment
+	};
+
+struct ChunkHeader // Structure at the start of a chunk
+	{
+	/* Elements: */
+	public:
+	uint32_t magic; // Equal to chunkMagic
+	uint32_t numParticles; // Number of particles in the chunk
+	double time; // Application time of the simulation step recorded in the chunk
+	float boundsMin[3]; // Lower corner of the bounding box of all finite positions in the chunk; quantized positions outside it are clamped to its faces
+	float boundsMax[3]; // Upper corner of the bounding box of all finite positions in the chunk
+	uint64_t payloadSize; // Size of the chunk's data following the header, including padding
+	uint8_t reserved[16]; // Padding to the chunk alignment
+	};
+
+struct IndexEntry // Structure describing one chunk in the time index
+	{
+	/* Elements: */
+	public:
+	double time; // Application time of the chunk's simulation step
+	uint64_t offset; // Offset of the chunk header from the start of the file
+	uint32_t numParticles; // Number of particles in the chunk
+	uint32_t reserved; // Padding
+	};
+
+inline size_t align(size_t size) // Rounds a size up to the chunk alignment
+	{
+	return (size+alignment-1)&~(alignment-1);
+	}
+
+inline size_t getRawPayloadSize(size_t numParticles) // Returns the payload size of a raw chunk of the given number of particles
+	{
+	return align(numParticles*sizeof(uint32_t))+4*align(numParticles*sizeof(float));
+	}
+
+}
+
+#endif
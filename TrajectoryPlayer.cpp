@@ -0,0 +1,219 @@
+/***********************************************************************
+TrajectoryPlayer - Alternative particle engine playing back a recorded
+trajectory file instead of simulating. The file is memory-mapped through
+a TrajectoryReader, and the chunk recorded closest before the current
+playback time is uploaded into each context's vertex buffer straight
+from the mapped pages, once per chunk change; the vertex shader reads
+the chunk's separate birth time and coordinate arrays as individual
+vertex attributes, and expands quantized coordinates from 16-bit
+fractions of the chunk's bounding box, so chunks are never parsed or
+converted on the CPU. Playback runs at variable speed, backwards, or
+jumps to any time through the file's time index, and the chunks coming
+up in playback direction are prefetched from disk in the background.
+***********************************************************************/
+
+#include "TrajectoryPlayer.h"
+
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <GL/glext.h>
+#include <GL/GLContextData.h>
+#include <Math/Math.h>
+
+#include "ShaderHelpers.h"
+#include "ParticleAppearance.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const char* renderVertexSource=
+	"attribute float birthTime;\n"
+	"attribute float positionX;\n"
+	"attribute float positionY;\n"
+	"attribute float positionZ;\n"
+	"uniform float lifespan;\n"
+	"uniform vec3 positionOffset;\n"
+	"uniform vec3 positionScale;\n"
+	"varying vec4 particleColor;\n"
+	"void main()\n"
+	"	{\n"
+	"	vec3 position=positionOffset+positionScale*vec3(positionX,positionY,positionZ);\n"
+	"	gl_Position=gl_ModelViewProjectionMatrix*vec4(position,1.0);\n"
+	"	/* Recordings carry no colors; derive a stable color from the birth time instead: */\n"
+	"	vec3 color=0.25+0.75*fract(sin(birthTime*vec3(12.9898,78.233,37.719))*43758.5453);\n"
+	"	float age=particleAge(birthTime,lifespan);\n"
+	"	particleColor=agedColor(vec4(color,1.0),age);\n"
+	"	gl_PointSize=agedPointSize(age);\n"
+	"	}\n";
+
+const char* renderFragmentSource=
+	"#version 120\n"
+	"varying vec4 particleColor;\n"
+	"void main()\n"
+	"	{\n"
+	"	gl_FragColor=particleColor;\n"
+	"	}\n";
+
+const char* renderAttributeNames[4]=
+	{
+	"birthTime","positionX","positionY","positionZ"
+	};
+
+/* Names of the render program's uniform variables, in the order of DataItem::renderUniforms: */
+const char* renderUniformNames[5]=
+	{
+	"currentTime","pointSize","lifespan","positionOffset","positionScale"
+	};
+
+}
+
+/*********************************************
+Methods of class TrajectoryPlayer::DataItem:
+*********************************************/
+
+TrajectoryPlayer::DataItem::DataItem(size_t sUploadedChunk)
+	:bufferId(0),
+	 uploadedChunk(sUploadedChunk),
+	 renderProgram(0)
+	{
+	glGenBuffers(1,&bufferId);
+	for(int i=0;i<5;++i)
+		renderUniforms[i]=-1;
+	}
+
+TrajectoryPlayer::DataItem::~DataItem(void)
+	{
+	glDeleteBuffers(1,&bufferId);
+	if(renderProgram!=0)
+		glDeleteProgram(renderProgram);
+	}
+
+/*********************************
+Methods of class TrajectoryPlayer:
+*********************************/
+
+TrajectoryPlayer::TrajectoryPlayer(const char* fileName,float sLifespan,double sSpeed,bool sLoop,size_t sNumPrefetchChunks)
+	:reader(fileName),
+	 lifespan(sLifespan),
+	 speed(sSpeed),loop(sLoop),
+	 numPrefetchChunks(sNumPrefetchChunks),
+	 frameTime(-1.0),
+	 playbackTime(0.0),currentChunk(0)
+	{
+	/* Start at the end of the recording that playback moves away from: */
+	setPlaybackTime(speed<0.0?reader.getEndTime():reader.getStartTime());
+	}
+
+void TrajectoryPlayer::initContext(GLContextData& contextData) const
+	{
+	/* Every context uploads its first chunk while drawing it: */
+	DataItem* dataItem=new DataItem(reader.getNumChunks());
+	contextData.addDataItem(this,dataItem);
+
+	/* Allocate the vertex buffer once for the largest chunk: */
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->bufferId);
+	glBufferData(GL_ARRAY_BUFFER,reader.getMaxPayloadSize(),0,GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+
+	try
+		{
+		/* Compile the render program with the shared particle appearance functions: */
+		std::string vertexSource="#version 120\n";
+		vertexSource.append(ParticleAppearance::getShaderSource());
+		vertexSource.append(renderVertexSource);
+		dataItem->renderProgram=ShaderHelpers::createRenderProgram(vertexSource.c_str(),renderFragmentSource,renderAttributeNames,4);
+		for(int i=0;i<5;++i)
+			dataItem->renderUniforms[i]=glGetUniformLocation(dataItem->renderProgram,renderUniformNames[i]);
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"TrajectoryPlayer: "<<err.what()<<"; particles will not be shown"<<std::endl;
+		}
+	}
+
+void TrajectoryPlayer::setSpeed(double newSpeed)
+	{
+	/* Restart the frame clock when resuming, so that the time spent paused is not played back: */
+	if(speed==0.0)
+		frameTime=-1.0;
+	speed=newSpeed;
+	}
+
+void TrajectoryPlayer::setPlaybackTime(double newPlaybackTime)
+	{
+	/* Clamp the time to the recording and find the chunk to show: */
+	double startTime=reader.getStartTime();
+	double endTime=reader.getEndTime();
+	playbackTime=newPlaybackTime<startTime?startTime:newPlaybackTime>endTime?endTime:newPlaybackTime;
+	currentChunk=reader.findChunk(playbackTime);
+	}
+
+void TrajectoryPlayer::startFrame(double newFrameTime)
+	{
+	/* Advance the playback time by the application time passed since the last frame: */
+	double newPlaybackTime=playbackTime;
+	if(frameTime>=0.0)
+		newPlaybackTime+=speed*(newFrameTime-frameTime);
+	frameTime=newFrameTime;
+
+	/* Wrap around either end of the recording if looping: */
+	double startTime=reader.getStartTime();
+	double duration=reader.getEndTime()-startTime;
+	if(loop&&duration>0.0&&(newPlaybackTime<startTime||newPlaybackTime>startTime+duration))
+		{
+		double offset=newPlaybackTime-startTime;
+		newPlaybackTime=startTime+offset-Math::floor(offset/duration)*duration;
+		}
+	setPlaybackTime(newPlaybackTime);
+
+	/* Start reading the chunks needed next in the background: */
+	reader.prefetch(currentChunk,speed<0.0?-1:1,numPrefetchChunks);
+	}
+
+void TrajectoryPlayer::display(GLContextData& contextData) const
+	{
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	if(dataItem->renderProgram==0)
+		return;
+
+	TrajectoryReader::Chunk chunk=reader.getChunk(currentChunk);
+	glBindBuffer(GL_ARRAY_BUFFER,dataItem->bufferId);
+	if(dataItem->uploadedChunk!=currentChunk)
+		{
+		/* Orphan the buffer's previous contents and upload the chunk's payload straight from the mapped file: */
+		glBufferData(GL_ARRAY_BUFFER,reader.getMaxPayloadSize(),0,GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER,0,chunk.header->payloadSize,chunk.payload);
+		dataItem->uploadedChunk=currentChunk;
+		}
+
+	/* Read each coordinate from its own array, as floats or as normalized 16-bit fractions of the chunk's bounding box: */
+	GLfloat offset[3],scale[3];
+	bool quantized=reader.getCompression()==TrajectoryFormat::QUANTIZED;
+	for(int j=0;j<3;++j)
+		{
+		offset[j]=quantized?chunk.header->boundsMin[j]:0.0f;
+		scale[j]=quantized?chunk.header->boundsMax[j]-chunk.header->boundsMin[j]:1.0f;
+		}
+
+	/* Draw all particles of the chunk: */
+	glUseProgram(dataItem->renderProgram);
+	glUniform1f(dataItem->renderUniforms[0],GLfloat(chunk.header->time));
+	glUniform1f(dataItem->renderUniforms[1],ParticleAppearance::defaultPointSize);
+	glUniform1f(dataItem->renderUniforms[2],lifespan);
+	glUniform3fv(dataItem->renderUniforms[3],1,offset);
+	glUniform3fv(dataItem->renderUniforms[4],1,scale);
+	for(GLuint i=0;i<4;++i)
+		glEnableVertexAttribArray(i);
+	glVertexAttribPointer(0,1,GL_FLOAT,GL_FALSE,0,reinterpret_cast<const GLvoid*>(chunk.birthTimeOffset));
+	for(int j=0;j<3;++j)
+		glVertexAttribPointer(GLuint(j+1),1,quantized?GL_UNSIGNED_SHORT:GL_FLOAT,quantized?GL_TRUE:GL_FALSE,0,reinterpret_cast<const GLvoid*>(chunk.positionOffsets[j]));
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+	glDrawArrays(GL_POINTS,0,GLsizei(chunk.header->numParticles));
+	for(GLuint i=0;i<4;++i)
+		glDisableVertexAttribArray(i);
+	glUseProgram(0);
+	}
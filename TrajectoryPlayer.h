@@ -0,0 +1,85 @@
+/***********************************************************************
+TrajectoryPlayer - Alternative particle engine playing back a recorded
+trajectory file instead of simulating. The file is memory-mapped through
+a TrajectoryReader, and the chunk recorded closest before the current
+playback time is uploaded into each context's vertex buffer straight
+from the mapped pages, once per chunk change; the vertex shader reads
+the chunk's separate birth time and coordinate arrays as individual
+vertex attributes, and expands quantized coordinates from 16-bit
+fractions of the chunk's bounding box, so chunks are never parsed or
+converted on the CPU. Playback runs at variable speed, backwards, or
+jumps to any time through the file's time index, and the chunks coming
+up in playback direction are prefetched from disk in the background.
+***********************************************************************/
+
+#ifndef TRAJECTORYPLAYER_INCLUDED
+#define TRAJECTORYPLAYER_INCLUDED
+
+#include <stddef.h>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+
+#include "TrajectoryReader.h"
+
+/* Forward declarations: */
+class GLContextData;
+
+class TrajectoryPlayer:public GLObject
+	{
+	/* Embedded classes: */
+	private:
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elements: */
+		public:
+		GLuint bufferId; // ID of the vertex buffer holding the most recently uploaded chunk's payload
+		size_t uploadedChunk; // Index of the chunk in the vertex buffer, or the number of chunks if none
+		GLuint renderProgram; // Shader program drawing particles from the separate arrays of a chunk, or 0
+		GLint renderUniforms[5]; // Locations of the render program's uniform variables
+
+		/* Constructors and destructors: */
+		DataItem(size_t sUploadedChunk);
+		virtual ~DataItem(void);
+		};
+
+	/* Elements: */
+	TrajectoryReader reader; // Memory-mapped trajectory file
+	float lifespan; // Lifespan over which particles fade out, as in the recording
+	double speed; // Playback speed in recorded seconds per second of application time; negative to play backwards, zero to pause
+	bool loop; // Flag whether playback wraps around at either end of the recording instead of stopping
+	size_t numPrefetchChunks; // Number of chunks read ahead in playback direction
+	double frameTime; // Application time of the current frame, or negative before the first frame
+	double playbackTime; // Recorded time shown in the current frame
+	size_t currentChunk; // Index of the chunk shown in the current frame
+
+	/* Constructors and destructors: */
+	public:
+	TrajectoryPlayer(const char* fileName,float sLifespan,double sSpeed,bool sLoop,size_t sNumPrefetchChunks =4); // Opens the given trajectory file for playback at the given speed, fading particles over the given lifespan; throws std::runtime_error if the file cannot be read
+
+	/* Methods from GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+
+	/* New methods: */
+	const TrajectoryReader& getReader(void) const // Returns the mapped trajectory file
+		{
+		return reader;
+		}
+	double getSpeed(void) const // Returns the playback speed
+		{
+		return speed;
+		}
+	void setSpeed(double newSpeed); // Sets the playback speed; negative speeds play backwards
+	double getPlaybackTime(void) const // Returns the recorded time shown in the current frame
+		{
+		return playbackTime;
+		}
+	void setPlaybackTime(double newPlaybackTime); // Jumps to the given recorded time
+	size_t getNumParticles(void) const // Returns the number of particles in the current chunk
+		{
+		return reader.getChunk(currentChunk).header->numParticles;
+		}
+	void startFrame(double newFrameTime); // Advances playback to the given application time and prefetches the upcoming chunks
+	void display(GLContextData& contextData) const; // Uploads the current chunk into the context's vertex buffer if it changed, and draws its particles as points
+	};
+
+#endif
@@ -0,0 +1,191 @@
+/***********************************************************************
+TrajectoryReader - Read-only view of a trajectory file written by
+TrajectoryRecorder. The whole file is memory-mapped once, and chunks are
+accessed in place through the file's time index, without parsing or
+copying their arrays. Readahead is disabled for the mapping, as playback
+may run backwards or jump; instead, callers prefetch the chunks they
+will need next.
+***********************************************************************/
+
+#include "TrajectoryReader.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <stdexcept>
+
+/*********************************
+Methods of class TrajectoryReader:
+*********************************/
+
+bool TrajectoryReader::locateChunk(size_t chunkIndex,TrajectoryReader::Chunk& chunk) const
+	{
+	/* Check that the chunk header lies between the file header and the time index: */
+	uint64_t indexOffset=uint64_t(reinterpret_cast<const char*>(index)-map);
+	uint64_t offset=index[chunkIndex].offset;
+	if(offset<sizeof(TrajectoryFormat::FileHeader)||offset+sizeof(TrajectoryFormat::ChunkHeader)>indexOffset)
+		return false;
+	chunk.header=reinterpret_cast<const TrajectoryFormat::ChunkHeader*>(map+offset);
+	chunk.payload=map+offset+sizeof(TrajectoryFormat::ChunkHeader);
+	if(chunk.header->magic!=TrajectoryFormat::chunkMagic||chunk.header->numParticles!=index[chunkIndex].numParticles)
+		return false;
+	if(chunk.header->payloadSize>indexOffset-(offset+sizeof(TrajectoryFormat::ChunkHeader)))
+		return false;
+
+	/* Locate the arrays according to the chunk encoding: */
+	size_t n=chunk.header->numParticles;
+	size_t end;
+	if(compression==TrajectoryFormat::QUANTIZED)
+		{
+		/* Skip the variable-length id stream, padded to 4 bytes: */
+		if(chunk.header->payloadSize<sizeof(uint32_t))
+			return false;
+		uint32_t idStreamSize;
+		memcpy(&idStreamSize,chunk.payload,sizeof(uint32_t));
+		chunk.birthTimeOffset=(sizeof(uint32_t)+size_t(idStreamSize)+3)&~size_t(3);
+		for(int j=0;j<3;++j)
+			chunk.positionOffsets[j]=chunk.birthTimeOffset+n*sizeof(float)+size_t(j)*n*sizeof(uint16_t);
+		end=chunk.positionOffsets[2]+n*sizeof(uint16_t);
+		}
+	else
+		{
+		size_t arraySize=TrajectoryFormat::align(n*sizeof(float));
+		chunk.birthTimeOffset=TrajectoryFormat::align(n*sizeof(uint32_t));
+		for(int j=0;j<3;++j)
+			chunk.positionOffsets[j]=chunk.birthTimeOffset+size_t(j+1)*arraySize;
+		end=TrajectoryFormat::getRawPayloadSize(n);
+		}
+
+	return end<=chunk.header->payloadSize;
+	}
+
+TrajectoryReader::TrajectoryReader(const char* fileName)
+	:fd(-1),map(0),mapSize(0),
+	 pageSize(size_t(sysconf(_SC_PAGESIZE))),
+	 compression(TrajectoryFormat::RAW),
+	 index(0),numChunks(0),
+	 maxPayloadSize(0),maxNumParticles(0)
+	{
+	/* Map the entire file: */
+	fd=open(fileName,O_RDONLY);
+	if(fd<0)
+		throw std::runtime_error(std::string("TrajectoryReader: Unable to open trajectory file ")+fileName);
+	struct stat fileStat;
+	if(fstat(fd,&fileStat)!=0||size_t(fileStat.st_size)<sizeof(TrajectoryFormat::FileHeader))
+		{
+		close(fd);
+		throw std::runtime_error(std::string("TrajectoryReader: ")+fileName+" is not a trajectory file");
+		}
+	mapSize=size_t(fileStat.st_size);
+	void* mapPtr=mmap(0,mapSize,PROT_READ,MAP_SHARED,fd,0);
+	if(mapPtr==MAP_FAILED)
+		{
+		close(fd);
+		throw std::runtime_error(std::string("TrajectoryReader: Unable to map trajectory file ")+fileName);
+		}
+	map=static_cast<const char*>(mapPtr);
+
+	/* Playback jumps around the file, so the kernel's sequential readahead would only waste bandwidth: */
+	madvise(mapPtr,mapSize,MADV_RANDOM);
+
+	/* Check the file header and the time index: */
+	const TrajectoryFormat::FileHeader* header=reinterpret_cast<const TrajectoryFormat::FileHeader*>(map);
+	std::string error;
+	if(memcmp(header->magic,TrajectoryFormat::fileMagic,sizeof(header->magic))!=0)
+		error=" is not a trajectory file";
+	else if(header->version!=TrajectoryFormat::version)
+		error=" has an unsupported layout version";
+	else if(header->compression>TrajectoryFormat::QUANTIZED)
+		error=" has an unsupported chunk encoding";
+	else if(header->indexOffset==0)
+		error=" was not closed properly and has no time index";
+	else if(header->numChunks==0)
+		error=" contains no chunks";
+	else if(header->indexOffset>mapSize||header->numChunks>(mapSize-header->indexOffset)/sizeof(TrajectoryFormat::IndexEntry))
+		error=" is truncated";
+	else
+		{
+		compression=TrajectoryFormat::Compression(header->compression);
+		index=reinterpret_cast<const TrajectoryFormat::IndexEntry*>(map+header->indexOffset);
+		numChunks=size_t(header->numChunks);
+
+		/* Check all chunks once, so that playback can trust the index: */
+		for(size_t i=0;i<numChunks&&error.empty();++i)
+			{
+			Chunk chunk;
+			if(!locateChunk(i,chunk)||(i>0&&index[i].time<index[i-1].time))
+				error=" is damaged";
+			else
+				{
+				if(maxPayloadSize<chunk.header->payloadSize)
+					maxPayloadSize=size_t(chunk.header->payloadSize);
+				if(maxNumParticles<chunk.header->numParticles)
+					maxNumParticles=chunk.header->numParticles;
+				}
+			}
+		}
+	if(!error.empty())
+		{
+		munmap(mapPtr,mapSize);
+		close(fd);
+		throw std::runtime_error(std::string("TrajectoryReader: Trajectory file ")+fileName+error);
+		}
+	}
+
+TrajectoryReader::~TrajectoryReader(void)
+	{
+	munmap(const_cast<char*>(map),mapSize);
+	close(fd);
+	}
+
+size_t TrajectoryReader::findChunk(double time) const
+	{
+	/* Binary search for the first chunk recorded after the given time: */
+	size_t l=0;
+	size_t r=numChunks;
+	while(l<r)
+		{
+		size_t m=(l+r)/2;
+		if(index[m].time<=time)
+			l=m+1;
+		else
+			r=m;
+		}
+	return l>0?l-1:0;
+	}
+
+TrajectoryReader::Chunk TrajectoryReader::getChunk(size_t chunkIndex) const
+	{
+	Chunk result;
+	locateChunk(chunkIndex,result);
+	return result;
+	}
+
+void TrajectoryReader::prefetch(size_t chunkIndex,int direction,size_t numPrefetchChunks) const
+	{
+	for(size_t i=0;i<numPrefetchChunks;++i)
+		{
+		/* Find the next chunk in playback direction: */
+		if(direction<0)
+			{
+			if(chunkIndex==0)
+				break;
+			--chunkIndex;
+			}
+		else
+			{
+			if(chunkIndex+1>=numChunks)
+				break;
+			++chunkIndex;
+			}
+
+		/* Start reading the chunk's pages in the background: */
+		uint64_t begin=index[chunkIndex].offset;
+		uint64_t end=begin+sizeof(TrajectoryFormat::ChunkHeader)+reinterpret_cast<const TrajectoryFormat::ChunkHeader*>(map+begin)->payloadSize;
+		begin&=~uint64_t(pageSize-1);
+		madvise(const_cast<char*>(map)+begin,size_t(end-begin),MADV_WILLNEED);
+		}
+	}
@@ -0,0 +1,88 @@
+/***********************************************************************
+TrajectoryReader - Read-only view of a trajectory file written by
+TrajectoryRecorder. The whole file is memory-mapped once, and chunks are
+accessed in place through the file's time index, without parsing or
+copying their arrays. Readahead is disabled for the mapping, as playback
+may run backwards or jump; instead, callers prefetch the chunks they
+will need next.
+***********************************************************************/
+
+#ifndef TRAJECTORYREADER_INCLUDED
+#define TRAJECTORYREADER_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "TrajectoryFormat.h"
+
+class TrajectoryReader
+	{
+	/* Embedded classes: */
+	public:
+	struct Chunk // Structure locating the arrays of one chunk inside the mapped file
+		{
+		/* Elements: */
+		public:
+		const TrajectoryFormat::ChunkHeader* header; // Chunk header
+		const char* payload; // Start of the chunk's payload
+		size_t birthTimeOffset; // Offset of the float birth time array from the start of the payload
+		size_t positionOffsets[3]; // Offsets of the x, y, and z coordinate arrays from the start of the payload
+		};
+
+	/* Elements: */
+	private:
+	int fd; // File descriptor of the trajectory file
+	const char* map; // Read-only memory map of the entire file
+	size_t mapSize; // Size of the memory map
+	size_t pageSize; // System page size, to align prefetch ranges
+	TrajectoryFormat::Compression compression; // Encoding of all chunks
+	const TrajectoryFormat::IndexEntry* index; // Time index of all chunks, in order of recording
+	size_t numChunks; // Number of chunks in the file
+	size_t maxPayloadSize; // Largest payload size of any chunk
+	size_t maxNumParticles; // Largest number of particles in any chunk
+
+	/* Private methods: */
+	TrajectoryReader(const TrajectoryReader& source); // Prohibit copy constructor
+	TrajectoryReader& operator=(const TrajectoryReader& source); // Prohibit assignment operator
+	bool locateChunk(size_t chunkIndex,Chunk& chunk) const; // Locates the arrays of the given chunk; returns false if the chunk does not fit between the file header and the time index
+
+	/* Constructors and destructors: */
+	public:
+	TrajectoryReader(const char* fileName); // Maps the given trajectory file; throws std::runtime_error if the file cannot be mapped, is not a complete trajectory file, or is damaged
+	~TrajectoryReader(void);
+
+	/* Methods: */
+	TrajectoryFormat::Compression getCompression(void) const // Returns the encoding of all chunks
+		{
+		return compression;
+		}
+	size_t getNumChunks(void) const // Returns the number of chunks
+		{
+		return numChunks;
+		}
+	size_t getMaxPayloadSize(void) const // Returns the largest payload size of any chunk
+		{
+		return maxPayloadSize;
+		}
+	size_t getMaxNumParticles(void) const // Returns the largest number of particles in any chunk
+		{
+		return maxNumParticles;
+		}
+	double getChunkTime(size_t chunkIndex) const // Returns the application time of the given chunk
+		{
+		return index[chunkIndex].time;
+		}
+	double getStartTime(void) const // Returns the time of the first chunk
+		{
+		return numChunks>0?index[0].time:0.0;
+		}
+	double getEndTime(void) const // Returns the time of the last chunk
+		{
+		return numChunks>0?index[numChunks-1].time:0.0;
+		}
+	size_t findChunk(double time) const; // Returns the index of the last chunk recorded at or before the given time, or of the first chunk if the time precedes all chunks
+	Chunk getChunk(size_t chunkIndex) const; // Returns the locations of the given chunk's arrays
+	void prefetch(size_t chunkIndex,int direction,size_t numPrefetchChunks) const; // Asks the kernel to read ahead the given number of chunks following the given chunk in the given direction (+1 or -1)
+	};
+
+#endif
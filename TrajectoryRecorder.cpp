@@ -0,0 +1,357 @@
+/***********************************************************************
+TrajectoryRecorder - Records particle state into a trajectory file, one
+chunk per recorded simulation step. The simulation thread only copies
+the particles' ids, birth times, and positions into one of a fixed set
+of frame buffers; a dedicated I/O thread encodes the frames and writes
+them through memory maps of the growing file, and appends the time
+index when the recorder is closed. If the I/O thread falls behind so
+far that no frame buffer is free, frames are dropped instead of
+blocking the simulation thread.
+***********************************************************************/
+
+#include "TrajectoryRecorder.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+static const uint64_t fileExtentSize=uint64_t(64)<<20; // Granularity in which the trajectory file is grown, to avoid resizing it for every chunk
+
+class IdOrder // Functor sorting particle indices by particle id
+	{
+	/* Elements: */
+	private:
+	const ParticleStore::Id* ids; // Particle ids
+
+	/* Constructors and destructors: */
+	public:
+	IdOrder(const ParticleStore::Id* sIds)
+		:ids(sIds)
+		{
+		}
+
+	/* Methods: */
+	bool operator()(unsigned int a,unsigned int b) const
+		{
+		return ids[a]<ids[b];
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+inline unsigned char* writeVarint(unsigned char* ptr,uint32_t value) // Writes an unsigned integer in 7-bit groups, least significant group first
+	{
+	while(value>=0x80U)
+		{
+		*(ptr++)=(unsigned char)(value|0x80U);
+		value>>=7;
+		}
+	*(ptr++)=(unsigned char)(value);
+	return ptr;
+	}
+
+inline void findFiniteBounds(const float* values,size_t numValues,float& min,float& max) // Returns the range of all finite values, or [0, 0] if there are none
+	{
+	bool found=false;
+	min=max=0.0f;
+	for(size_t i=0;i<numValues;++i)
+		if(std::isfinite(values[i]))
+			{
+			if(!found||min>values[i])
+				min=values[i];
+			if(!found||max<values[i])
+				max=values[i];
+			found=true;
+			}
+	}
+
+inline uint16_t quantizeFraction(float q) // Rounds a value scaled to [0, 65535] to a 16-bit integer, clamping values outside and mapping NaN to 0
+	{
+	return !(q>0.0f)?uint16_t(0):q>=65535.0f?uint16_t(65535):uint16_t(q+0.5f);
+	}
+
+}
+
+/***********************************
+Methods of class TrajectoryRecorder:
+***********************************/
+
+bool TrajectoryRecorder::writeAt(uint64_t offset,const void* data,size_t size)
+	{
+	if(size==0)
+		return true;
+
+	/* Grow the file in whole extents: */
+	if(offset+size>fileSize)
+		{
+		uint64_t newFileSize=((offset+size+fileExtentSize-1)/fileExtentSize)*fileExtentSize;
+		if(ftruncate(fd,off_t(newFileSize))!=0)
+			return false;
+		fileSize=newFileSize;
+		}
+
+	/* Map the pages covering the range, copy the data, and let the kernel write the dirty pages back: */
+	uint64_t mapOffset=offset&~uint64_t(pageSize-1);
+	size_t mapSize=size_t(offset+size-mapOffset);
+	void* map=mmap(0,mapSize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,off_t(mapOffset));
+	if(map==MAP_FAILED)
+		return false;
+	memcpy(static_cast<char*>(map)+(offset-mapOffset),data,size);
+	munmap(map,mapSize);
+
+	return true;
+	}
+
+size_t TrajectoryRecorder::encodeQuantized(const TrajectoryRecorder::Frame& frame,const float boundsMin[3],const float boundsMax[3])
+	{
+	/* Sort particles by id, so that id differences are small: */
+	size_t n=frame.numParticles;
+	sortOrder.resize(n);
+	for(size_t i=0;i<n;++i)
+		sortOrder[i]=(unsigned int)(i);
+	std::sort(sortOrder.begin(),sortOrder.end(),IdOrder(frame.ids.data()));
+
+	/****************************************************************
+	Quantized payload: 32-bit size of the id stream, the id stream of
+	variable-length id differences, padded to 4 bytes, the birth times
+	as floats, and the x, y, and z coordinates as 16-bit fractions of
+	the bounding box, all in id order.
+	****************************************************************/
+
+	encodeBuffer.resize(sizeof(uint32_t)+n*5+3+n*sizeof(float)+n*3*sizeof(uint16_t)+TrajectoryFormat::alignment);
+	unsigned char* start=encodeBuffer.data();
+	unsigned char* ptr=start+sizeof(uint32_t);
+	ParticleStore::Id previousId=0;
+	for(size_t i=0;i<n;++i)
+		{
+		ParticleStore::Id id=frame.ids[sortOrder[i]];
+		ptr=writeVarint(ptr,id-previousId);
+		previousId=id;
+		}
+	uint32_t idStreamSize=uint32_t(ptr-(start+sizeof(uint32_t)));
+	memcpy(start,&idStreamSize,sizeof(uint32_t));
+	while((ptr-start)%4!=0)
+		*(ptr++)=0;
+
+	float* bPtr=reinterpret_cast<float*>(ptr);
+	for(size_t i=0;i<n;++i)
+		bPtr[i]=frame.birthTimes[sortOrder[i]];
+	ptr+=n*sizeof(float);
+
+	for(int j=0;j<3;++j)
+		{
+		float extent=boundsMax[j]-boundsMin[j];
+		float scale=extent>0.0f?65535.0f/extent:0.0f;
+		uint16_t* qPtr=reinterpret_cast<uint16_t*>(ptr);
+		for(size_t i=0;i<n;++i)
+			qPtr[i]=quantizeFraction((frame.positions[j][sortOrder[i]]-boundsMin[j])*scale);
+		ptr+=n*sizeof(uint16_t);
+		}
+
+	/* Pad the payload to the chunk alignment: */
+	size_t payloadSize=TrajectoryFormat::align(size_t(ptr-start));
+	memset(ptr,0,payloadSize-size_t(ptr-start));
+	return payloadSize;
+	}
+
+void TrajectoryRecorder::writeFrame(const TrajectoryRecorder::Frame& frame)
+	{
+	/* Prepare the chunk header: */
+	TrajectoryFormat::ChunkHeader header;
+	memset(&header,0,sizeof(header));
+	header.magic=TrajectoryFormat::chunkMagic;
+	header.numParticles=uint32_t(frame.numParticles);
+	header.time=frame.time;
+	for(int j=0;j<3;++j)
+		{
+		/* Escaped particles would stretch the box to infinity and collapse all others onto its corner; they are clamped to its faces instead: */
+		findFiniteBounds(frame.positions[j].data(),frame.numParticles,header.boundsMin[j],header.boundsMax[j]);
+		}
+
+	uint64_t chunkOffset=writeOffset;
+	uint64_t payloadOffset=chunkOffset+sizeof(header);
+	bool ok;
+	if(compression==TrajectoryFormat::QUANTIZED)
+		{
+		header.payloadSize=encodeQuantized(frame,header.boundsMin,header.boundsMax);
+		ok=writeAt(chunkOffset,&header,sizeof(header))&&writeAt(payloadOffset,encodeBuffer.data(),size_t(header.payloadSize));
+		}
+	else
+		{
+		/* Write each array at its aligned offset straight from the frame buffer: */
+		header.payloadSize=TrajectoryFormat::getRawPayloadSize(frame.numParticles);
+		size_t arraySize=frame.numParticles*sizeof(float);
+		ok=writeAt(chunkOffset,&header,sizeof(header));
+		uint64_t arrayOffset=payloadOffset;
+		ok=ok&&writeAt(arrayOffset,frame.ids.data(),frame.numParticles*sizeof(ParticleStore::Id));
+		arrayOffset+=TrajectoryFormat::align(frame.numParticles*sizeof(uint32_t));
+		ok=ok&&writeAt(arrayOffset,frame.birthTimes.data(),arraySize);
+		for(int j=0;j<3;++j)
+			{
+			arrayOffset+=TrajectoryFormat::align(arraySize);
+			ok=ok&&writeAt(arrayOffset,frame.positions[j].data(),arraySize);
+			}
+		}
+	if(!ok)
+		{
+		std::cerr<<"TrajectoryRecorder: Unable to write to trajectory file "<<fileName<<"; stopping recording"<<std::endl;
+		ioError=true;
+		return;
+		}
+
+	/* Add the chunk to the time index: */
+	TrajectoryFormat::IndexEntry entry;
+	entry.time=frame.time;
+	entry.offset=chunkOffset;
+	entry.numParticles=uint32_t(frame.numParticles);
+	entry.reserved=0;
+	index.push_back(entry);
+	writeOffset=payloadOffset+header.payloadSize;
+	}
+
+void* TrajectoryRecorder::ioThreadMethod(void)
+	{
+	while(true)
+		{
+		/* Wait for the next queued frame, or for shutdown once all frames are written: */
+		Frame* frame;
+		{
+		Threads::Mutex::Lock frameLock(frameMutex);
+		while(!shutdown&&queuedFrames.empty())
+			frameCond.wait(frameMutex);
+		if(queuedFrames.empty())
+			break;
+		frame=queuedFrames.front();
+		queuedFrames.erase(queuedFrames.begin());
+		}
+
+		if(!ioError)
+			writeFrame(*frame);
+
+		/* Return the frame buffer to the simulation thread: */
+		{
+		Threads::Mutex::Lock frameLock(frameMutex);
+		freeFrames.push_back(frame);
+		}
+		}
+
+	return 0;
+	}
+
+TrajectoryRecorder::TrajectoryRecorder(const char* sFileName,TrajectoryFormat::Compression sCompression,size_t maxNumParticles,unsigned int sNumFrames)
+	:fileName(sFileName),
+	 fd(-1),
+	 compression(sCompression),
+	 pageSize(size_t(sysconf(_SC_PAGESIZE))),
+	 fileSize(0),writeOffset(sizeof(TrajectoryFormat::FileHeader)),
+	 frames(0),numFrames(sNumFrames>0?sNumFrames:1),
+	 shutdown(false),numDroppedFrames(0),ioError(false)
+	{
+	/* Create the file and write a header marking it as incomplete: */
+	fd=open(fileName.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644);
+	if(fd<0)
+		throw std::runtime_error(std::string("TrajectoryRecorder: Unable to create trajectory file ")+fileName);
+	TrajectoryFormat::FileHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,TrajectoryFormat::fileMagic,sizeof(header.magic));
+	header.version=TrajectoryFormat::version;
+	header.compression=uint32_t(compression);
+	if(!writeAt(0,&header,sizeof(header)))
+		{
+		close(fd);
+		throw std::runtime_error(std::string("TrajectoryRecorder: Unable to write trajectory file ")+fileName);
+		}
+
+	/* Allocate all frame buffers for the full particle count, so that recording never allocates memory: */
+	frames=new Frame[numFrames];
+	for(unsigned int i=0;i<numFrames;++i)
+		{
+		frames[i].ids.resize(maxNumParticles);
+		frames[i].birthTimes.resize(maxNumParticles);
+		for(int j=0;j<3;++j)
+			frames[i].positions[j].resize(maxNumParticles);
+		freeFrames.push_back(&frames[i]);
+		}
+	queuedFrames.reserve(numFrames);
+
+	/* Start the I/O thread: */
+	ioThread.start(this,&TrajectoryRecorder::ioThreadMethod);
+	}
+
+TrajectoryRecorder::~TrajectoryRecorder(void)
+	{
+	/* Let the I/O thread write all queued frames and exit: */
+	{
+	Threads::Mutex::Lock frameLock(frameMutex);
+	shutdown=true;
+	frameCond.signal();
+	}
+	ioThread.join();
+
+	if(!ioError)
+		{
+		/* Append the time index, complete the file header, and trim the unused end of the last extent: */
+		uint64_t indexOffset=writeOffset;
+		bool ok=writeAt(indexOffset,index.data(),index.size()*sizeof(TrajectoryFormat::IndexEntry));
+		TrajectoryFormat::FileHeader header;
+		memset(&header,0,sizeof(header));
+		memcpy(header.magic,TrajectoryFormat::fileMagic,sizeof(header.magic));
+		header.version=TrajectoryFormat::version;
+		header.compression=uint32_t(compression);
+		header.numChunks=index.size();
+		header.indexOffset=indexOffset;
+		ok=ok&&writeAt(0,&header,sizeof(header));
+		ok=ok&&ftruncate(fd,off_t(indexOffset+index.size()*sizeof(TrajectoryFormat::IndexEntry)))==0;
+		if(!ok)
+			std::cerr<<"TrajectoryRecorder: Unable to write time index to trajectory file "<<fileName<<std::endl;
+		}
+	close(fd);
+
+	delete[] frames;
+	}
+
+bool TrajectoryRecorder::record(double time,const ParticleStore& particles)
+	{
+	/* Grab a free frame buffer, or drop the frame if the I/O thread is behind: */
+	Frame* frame;
+	{
+	Threads::Mutex::Lock frameLock(frameMutex);
+	if(freeFrames.empty())
+		{
+		++numDroppedFrames;
+		return false;
+		}
+	frame=freeFrames.back();
+	freeFrames.pop_back();
+	}
+
+	/* Copy the particle state: */
+	size_t n=particles.getNumParticles();
+	if(n>frame->ids.size())
+		n=frame->ids.size();
+	frame->time=time;
+	frame->numParticles=n;
+	memcpy(frame->ids.data(),particles.getIds(),n*sizeof(ParticleStore::Id));
+	memcpy(frame->birthTimes.data(),particles.getBirthTimes(),n*sizeof(float));
+	for(int j=0;j<3;++j)
+		memcpy(frame->positions[j].data(),particles.getPositions(j),n*sizeof(float));
+
+	/* Queue the frame for the I/O thread: */
+	Threads::Mutex::Lock frameLock(frameMutex);
+	queuedFrames.push_back(frame);
+	frameCond.signal();
+	return true;
+	}
@@ -0,0 +1,83 @@
+/***********************************************************************
+TrajectoryRecorder - Records particle state into a trajectory file, one
+chunk per recorded simulation step. The simulation thread only copies
+the particles' ids, birth times, and positions into one of a fixed set
+of frame buffers; a dedicated I/O thread encodes the frames and writes
+them through memory maps of the growing file, and appends the time
+index when the recorder is closed. If the I/O thread falls behind so
+far that no frame buffer is free, frames are dropped instead of
+blocking the simulation thread.
+***********************************************************************/
+
+#ifndef TRAJECTORYRECORDER_INCLUDED
+#define TRAJECTORYRECORDER_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Threads/Thread.h>
+#include <Threads/Mutex.h>
+#include <Threads/Cond.h>
+
+#include "ParticleStore.h"
+#include "TrajectoryFormat.h"
+
+class TrajectoryRecorder
+	{
+	/* Embedded classes: */
+	private:
+	struct Frame // Structure holding a copy of the particle state of one simulation step
+		{
+		/* Elements: */
+		public:
+		double time; // Application time of the simulation step
+		size_t numParticles; // Number of particles in the frame
+		std::vector<ParticleStore::Id> ids; // Persistent particle identifiers
+		std::vector<float> birthTimes; // Particle birth times
+		std::vector<float> positions[3]; // Particle x, y, and z coordinates
+		};
+
+	/* Elements: */
+	std::string fileName; // Name of the trajectory file
+	int fd; // File descriptor of the trajectory file
+	TrajectoryFormat::Compression compression; // Encoding of all chunks
+	size_t pageSize; // System page size, to align memory maps
+	uint64_t fileSize; // Current size of the file, grown in large extents
+	uint64_t writeOffset; // Offset at which the next chunk is written
+	std::vector<TrajectoryFormat::IndexEntry> index; // Time index of all written chunks
+	std::vector<unsigned char> encodeBuffer; // Buffer receiving encoded chunk payloads
+	std::vector<unsigned int> sortOrder; // Permutation sorting a frame's particles by id for quantized encoding
+	Frame* frames; // Fixed set of frame buffers
+	unsigned int numFrames; // Number of frame buffers
+	Threads::Mutex frameMutex; // Mutex protecting the frame queues and the shutdown flag
+	Threads::Cond frameCond; // Condition variable signaled when a frame is queued or the recorder shuts down
+	std::vector<Frame*> freeFrames; // Frame buffers available to the simulation thread
+	std::vector<Frame*> queuedFrames; // Frame buffers waiting to be written, in order of recording
+	bool shutdown; // Flag to tell the I/O thread to write all queued frames and exit
+	size_t numDroppedFrames; // Number of frames dropped because no frame buffer was free
+	bool ioError; // Flag whether writing the file failed; later frames are discarded
+	Threads::Thread ioThread; // Thread writing frames to the file
+
+	/* Private methods: */
+	TrajectoryRecorder(const TrajectoryRecorder& source); // Prohibit copy constructor
+	TrajectoryRecorder& operator=(const TrajectoryRecorder& source); // Prohibit assignment operator
+	bool writeAt(uint64_t offset,const void* data,size_t size); // Copies data into the file through a temporary memory map, growing the file as needed
+	size_t encodeQuantized(const Frame& frame,const float boundsMin[3],const float boundsMax[3]); // Encodes a frame into the encode buffer in quantized format; returns the padded payload size
+	void writeFrame(const Frame& frame); // Writes a frame as the next chunk of the file
+	void* ioThreadMethod(void); // Thread method writing queued frames
+
+	/* Constructors and destructors: */
+	public:
+	TrajectoryRecorder(const char* sFileName,TrajectoryFormat::Compression sCompression,size_t maxNumParticles,unsigned int sNumFrames =4); // Creates a trajectory file of the given chunk encoding, recording up to the given number of particles per frame with the given number of frame buffers; throws std::runtime_error if the file cannot be created
+	~TrajectoryRecorder(void); // Writes all queued frames and the time index and closes the file
+
+	/* Methods: */
+	bool record(double time,const ParticleStore& particles); // Queues a copy of the given particles' state at the given application time for writing; returns false without blocking if the frame had to be dropped
+	size_t getNumDroppedFrames(void) const // Returns the number of frames dropped so far
+		{
+		return numDroppedFrames;
+		}
+	};
+
+#endif
@@ -0,0 +1,200 @@
+/***********************************************************************
+WorkerPool - Persistent pool of worker threads that execute jobs split
+into a range of independent chunks. Each worker starts on its own
+contiguous share of the chunks and, once that runs dry, steals half of
+the remaining chunks of another worker, which balances uneven chunk
+costs without a central queue.
+***********************************************************************/
+
+#include "WorkerPool.h"
+
+#include <unistd.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline unsigned long long packRange(size_t begin,size_t end)
+	{
+	return (static_cast<unsigned long long>(begin)<<32)|static_cast<unsigned long long>(end);
+	}
+
+}
+
+/***********************************
+Methods of class WorkerPool::Worker:
+***********************************/
+
+bool WorkerPool::Worker::popFront(size_t& chunkIndex)
+	{
+	unsigned long long r=range.load(std::memory_order_relaxed);
+	while(true)
+		{
+		size_t begin=size_t(r>>32);
+		size_t end=size_t(r&0xffffffffULL);
+		if(begin>=end)
+			return false;
+		if(range.compare_exchange_weak(r,packRange(begin+1,end),std::memory_order_acq_rel,std::memory_order_relaxed))
+			{
+			chunkIndex=begin;
+			return true;
+			}
+		}
+	}
+
+bool WorkerPool::Worker::stealBack(size_t& stolenBegin,size_t& stolenEnd)
+	{
+	unsigned long long r=range.load(std::memory_order_relaxed);
+	while(true)
+		{
+		size_t begin=size_t(r>>32);
+		size_t end=size_t(r&0xffffffffULL);
+		if(begin>=end)
+			return false;
+
+		/* Take the back half of the remaining chunks, rounding up so that single chunks can be stolen: */
+		size_t split=end-(end-begin+1)/2;
+		if(range.compare_exchange_weak(r,packRange(begin,split),std::memory_order_acq_rel,std::memory_order_relaxed))
+			{
+			stolenBegin=split;
+			stolenEnd=end;
+			return true;
+			}
+		}
+	}
+
+void* WorkerPool::Worker::threadMethod(void)
+	{
+	unsigned int lastGeneration=0;
+	while(true)
+		{
+		/* Wait for the next job or for shutdown: */
+		Job* job;
+		{
+		Threads::Mutex::Lock jobLock(pool->jobMutex);
+		while(!pool->shutdown&&pool->jobGeneration==lastGeneration)
+			pool->jobCond.wait(pool->jobMutex);
+		if(pool->shutdown)
+			break;
+		lastGeneration=pool->jobGeneration;
+		job=pool->currentJob;
+		}
+
+		/* Work on the job until no chunks are left: */
+		pool->work(*job,index);
+
+		/* Check out from the job: */
+		{
+		Threads::Mutex::Lock jobLock(pool->jobMutex);
+		if(--pool->numActiveWorkers==0)
+			pool->doneCond.signal();
+		}
+		}
+
+	return 0;
+	}
+
+/***************************
+Methods of class WorkerPool:
+***************************/
+
+void WorkerPool::work(WorkerPool::Job& job,unsigned int workerIndex)
+	{
+	Worker& self=workers[workerIndex];
+	while(true)
+		{
+		/* Process chunks from the own range: */
+		size_t chunkIndex;
+		while(self.popFront(chunkIndex))
+			job.processChunk(chunkIndex,workerIndex);
+
+		/* Try stealing from the other workers, starting with the next one: */
+		bool stole=false;
+		for(unsigned int i=1;i<numWorkers&&!stole;++i)
+			{
+			size_t begin,end;
+			if(workers[(workerIndex+i)%numWorkers].stealBack(begin,end))
+				{
+				/* Make the stolen chunks this worker's new range, where others can steal from it in turn: */
+				self.range.store(packRange(begin,end),std::memory_order_release);
+				stole=true;
+				}
+			}
+
+		/* Stop if all other workers' ranges are empty; chunks in transit are processed by their thieves: */
+		if(!stole)
+			break;
+		}
+	}
+
+WorkerPool::WorkerPool(unsigned int sNumWorkers)
+	:numWorkers(sNumWorkers>0?sNumWorkers:getNumCPUs()),
+	 workers(new Worker[numWorkers]),
+	 jobGeneration(0),currentJob(0),numActiveWorkers(0),shutdown(false)
+	{
+	/* Initialize all workers and start the background threads: */
+	for(unsigned int i=0;i<numWorkers;++i)
+		{
+		workers[i].range.store(packRange(0,0));
+		workers[i].pool=this;
+		workers[i].index=i;
+		if(i>0)
+			workers[i].thread.start(&workers[i],&WorkerPool::Worker::threadMethod);
+		}
+	}
+
+WorkerPool::~WorkerPool(void)
+	{
+	/* Tell all background workers to exit: */
+	{
+	Threads::Mutex::Lock jobLock(jobMutex);
+	shutdown=true;
+	jobCond.broadcast();
+	}
+
+	/* Wait for the background workers to exit: */
+	for(unsigned int i=1;i<numWorkers;++i)
+		workers[i].thread.join();
+	delete[] workers;
+	}
+
+void WorkerPool::run(WorkerPool::Job& job,size_t numChunks)
+	{
+	/* Distribute the chunks evenly over all workers' initial ranges: */
+	for(unsigned int i=0;i<numWorkers;++i)
+		workers[i].range.store(packRange((numChunks*i)/numWorkers,(numChunks*(i+1))/numWorkers),std::memory_order_relaxed);
+
+	if(numWorkers>1&&numChunks>1)
+		{
+		/* Post the job to the background workers: */
+		{
+		Threads::Mutex::Lock jobLock(jobMutex);
+		currentJob=&job;
+		numActiveWorkers=numWorkers-1;
+		++jobGeneration;
+		jobCond.broadcast();
+		}
+
+		/* Work on the job from the calling thread: */
+		work(job,0);
+
+		/* Wait until all background workers have checked out, so that no thief is still touching any range: */
+		Threads::Mutex::Lock jobLock(jobMutex);
+		while(numActiveWorkers>0)
+			doneCond.wait(jobMutex);
+		}
+	else
+		{
+		/* Process all chunks serially: */
+		for(size_t chunkIndex=0;chunkIndex<numChunks;++chunkIndex)
+			job.processChunk(chunkIndex,0);
+		}
+	}
+
+unsigned int WorkerPool::getNumCPUs(void)
+	{
+	long numCPUs=sysconf(_SC_NPROCESSORS_ONLN);
+	return numCPUs>0?(unsigned int)numCPUs:1U;
+	}
@@ -0,0 +1,80 @@
+/***********************************************************************
+WorkerPool - Persistent pool of worker threads that execute jobs split
+into a range of independent chunks. Each worker starts on its own
+contiguous share of the chunks and, once that runs dry, steals half of
+the remaining chunks of another worker, which balances uneven chunk
+costs without a central queue.
+***********************************************************************/
+
+#ifndef WORKERPOOL_INCLUDED
+#define WORKERPOOL_INCLUDED
+
+#include <stddef.h>
+#include <atomic>
+#include <Threads/Thread.h>
+#include <Threads/Mutex.h>
+#include <Threads/Cond.h>
+
+class WorkerPool
+	{
+	/* Embedded classes: */
+	public:
+	class Job // Abstract base class for jobs executed by the pool
+		{
+		/* Constructors and destructors: */
+		public:
+		virtual ~Job(void)
+			{
+			}
+
+		/* Methods: */
+		virtual void processChunk(size_t chunkIndex,unsigned int workerIndex) =0; // Processes one chunk; called concurrently from all workers
+		};
+
+	private:
+	struct Worker // Structure holding the state of one worker; aligned to avoid false sharing of ranges
+		{
+		/* Elements: */
+		public:
+		alignas(64) std::atomic<unsigned long long> range; // Chunk range [begin, end) not yet claimed by anyone, packed into (begin<<32)|end
+		WorkerPool* pool; // Pointer to the pool owning this worker
+		unsigned int index; // Index of this worker in the pool
+		Threads::Thread thread; // Background thread for this worker; unused for worker 0, which is the thread calling run()
+
+		/* Methods: */
+		bool popFront(size_t& chunkIndex); // Claims the next chunk from this worker's own range
+		bool stealBack(size_t& begin,size_t& end); // Steals the back half of this worker's range
+		void* threadMethod(void); // Thread method for background workers
+		};
+
+	/* Elements: */
+	unsigned int numWorkers; // Total number of workers, including the calling thread
+	Worker* workers; // Array of workers
+	Threads::Mutex jobMutex; // Mutex serializing job hand-off
+	Threads::Cond jobCond; // Condition variable to wake up workers when a new job is posted
+	Threads::Cond doneCond; // Condition variable to signal the calling thread when all workers are done
+	unsigned int jobGeneration; // Counter incremented for every posted job
+	Job* currentJob; // Job currently being executed
+	unsigned int numActiveWorkers; // Number of background workers still working on the current job
+	bool shutdown; // Flag to tell background workers to exit
+
+	/* Private methods: */
+	WorkerPool(const WorkerPool& source); // Prohibit copy constructor
+	WorkerPool& operator=(const WorkerPool& source); // Prohibit assignment operator
+	void work(Job& job,unsigned int workerIndex); // Processes chunks of the given job until no chunks are left anywhere
+
+	/* Constructors and destructors: */
+	public:
+	WorkerPool(unsigned int sNumWorkers =0); // Creates a pool with the given total number of workers; 0 uses one worker per CPU
+	~WorkerPool(void);
+
+	/* Methods: */
+	unsigned int getNumWorkers(void) const // Returns the total number of workers, including the calling thread
+		{
+		return numWorkers;
+		}
+	void run(Job& job,size_t numChunks); // Executes the given job on chunks [0, numChunks) and returns when all chunks are done
+	static unsigned int getNumCPUs(void); // Returns the number of online CPUs
+	};
+
+#endif